@@ -15,6 +15,11 @@ namespace UnorderedMapKeyHashingFunctions
     {
         return xxHash::Calc32( key );
     }
+    inline uint32_t Hash( uint64_t key )
+    {
+        // Keys are expected to be hashes already
+        return static_cast<uint32_t>( key ^ ( key >> 32 ) );
+    }
 }
 
 // UnorderedMap
@@ -0,0 +1,173 @@
+// WorkStealingQueue
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Env/Assert.h"
+#include "Core/Env/Types.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Process/Atomic.h"
+
+// WorkStealingQueue
+//  - Lock-free queue of trivially copyable items (typically pointers)
+//  - A single "owner" thread pushes items to the bottom
+//  - Any number of threads "steal" items from the top (oldest first)
+//  - Storage grows as needed. Retired storage is kept until destruction
+//    since stealing threads may still be reading from it.
+//------------------------------------------------------------------------------
+template <class T>
+class WorkStealingQueue
+{
+public:
+    explicit WorkStealingQueue( uint32_t initialCapacity = 64 );
+    ~WorkStealingQueue();
+
+    // Owner thread only
+    void Push( const T & item );
+
+    // Any thread
+    [[nodiscard]] bool Steal( T & outItem );
+    [[nodiscard]] uint32_t GetCount() const;
+    [[nodiscard]] bool IsEmpty() const { return ( GetCount() == 0 ); }
+
+private:
+    WorkStealingQueue( const WorkStealingQueue & other ) = delete;
+    void operator=( const WorkStealingQueue & other ) = delete;
+
+    class Buffer
+    {
+    public:
+        Buffer( uint32_t capacity, Buffer * previous )
+            : m_Mask( capacity - 1 )
+            , m_Items( FNEW_ARRAY( T[ capacity ] ) )
+            , m_Previous( previous )
+        {
+            ASSERT( ( capacity & m_Mask ) == 0 ); // Must be a power of 2
+        }
+        ~Buffer() { FDELETE_ARRAY m_Items; }
+
+        uint64_t m_Mask;
+        T * m_Items;
+        Buffer * m_Previous; // Retired buffer, freed on destruction
+    };
+
+    Buffer * Grow( Buffer * buffer, uint64_t top, uint64_t bottom );
+
+    // Indices increase monotonically (they are masked to access the Buffer).
+    // Top and bottom are kept apart to avoid false sharing between thieves
+    // and the owner.
+    volatile uint64_t m_Top = 0; // Next item to steal
+    uint8_t m_Padding1[ 64 - sizeof( uint64_t ) ];
+    volatile uint64_t m_Bottom = 0; // Next slot to push to (modified only by owner)
+    Buffer * volatile m_Buffer = nullptr; // Created on first Push
+    uint32_t m_InitialCapacity;
+    uint8_t m_Padding2[ 64 - sizeof( uint64_t ) - sizeof( Buffer * ) - sizeof( uint32_t ) ];
+};
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+template <class T>
+WorkStealingQueue<T>::WorkStealingQueue( uint32_t initialCapacity )
+    : m_InitialCapacity( initialCapacity )
+{
+    ASSERT( initialCapacity > 0 );
+    ASSERT( ( initialCapacity & ( initialCapacity - 1 ) ) == 0 ); // Must be a power of 2
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+template <class T>
+WorkStealingQueue<T>::~WorkStealingQueue()
+{
+    Buffer * buffer = m_Buffer;
+    while ( buffer )
+    {
+        Buffer * previous = buffer->m_Previous;
+        FDELETE buffer;
+        buffer = previous;
+    }
+}
+
+// Push
+//------------------------------------------------------------------------------
+template <class T>
+void WorkStealingQueue<T>::Push( const T & item )
+{
+    // Only the owner modifies bottom and the buffer
+    const uint64_t bottom = AtomicLoadRelaxed( &m_Bottom );
+    const uint64_t top = AtomicLoadAcquire( &m_Top );
+    Buffer * buffer = AtomicLoadRelaxed( &m_Buffer );
+
+    // Grow if full (or not yet allocated)
+    if ( ( buffer == nullptr ) || ( ( bottom - top ) > buffer->m_Mask ) )
+    {
+        buffer = Grow( buffer, top, bottom );
+    }
+
+    // Store the item and then publish it
+    AtomicStoreRelaxed( &buffer->m_Items[ bottom & buffer->m_Mask ], item );
+    AtomicStoreRelease( &m_Bottom, bottom + 1 );
+}
+
+// Steal
+//------------------------------------------------------------------------------
+template <class T>
+bool WorkStealingQueue<T>::Steal( T & outItem )
+{
+    for ( ;; )
+    {
+        const uint64_t top = AtomicLoadAcquire( &m_Top );
+        const uint64_t bottom = AtomicLoadAcquire( &m_Bottom );
+        if ( top >= bottom )
+        {
+            return false; // Empty
+        }
+
+        // Read item before claiming it. If the owner has since wrapped around
+        // and overwritten this slot, top must have moved and the claim will fail.
+        const Buffer * buffer = AtomicLoadAcquire( &m_Buffer );
+        const T item = AtomicLoadRelaxed( &buffer->m_Items[ top & buffer->m_Mask ] );
+
+        // Claim the item
+        if ( AtomicCompareExchange( &m_Top, top, top + 1 ) )
+        {
+            outItem = item;
+            return true;
+        }
+
+        // Lost the race to another thief - try again
+    }
+}
+
+// GetCount
+//------------------------------------------------------------------------------
+template <class T>
+uint32_t WorkStealingQueue<T>::GetCount() const
+{
+    // Load top first so that the count can never appear negative
+    const uint64_t top = AtomicLoadAcquire( &m_Top );
+    const uint64_t bottom = AtomicLoadAcquire( &m_Bottom );
+    return static_cast<uint32_t>( bottom - top );
+}
+
+// Grow
+//------------------------------------------------------------------------------
+template <class T>
+typename WorkStealingQueue<T>::Buffer * WorkStealingQueue<T>::Grow( Buffer * buffer, uint64_t top, uint64_t bottom )
+{
+    const uint32_t newCapacity = buffer ? static_cast<uint32_t>( ( buffer->m_Mask + 1 ) * 2 ) : m_InitialCapacity;
+    Buffer * newBuffer = FNEW( Buffer( newCapacity, buffer ) );
+
+    // Copy unclaimed items. Thieves can continue to read from the old buffer
+    // which remains valid.
+    for ( uint64_t i = top; i < bottom; ++i )
+    {
+        newBuffer->m_Items[ i & newBuffer->m_Mask ] = buffer->m_Items[ i & buffer->m_Mask ];
+    }
+
+    AtomicStoreRelease( &m_Buffer, newBuffer );
+    return newBuffer;
+}
+
+//------------------------------------------------------------------------------
@@ -37,6 +37,7 @@ int main( int, char *[] )
     REGISTER_TESTGROUP( TestTimer )
     REGISTER_TESTGROUP( TestUniquePtr )
     REGISTER_TESTGROUP( TestUnorderedMap )
+    REGISTER_TESTGROUP( TestWorkStealingQueue )
 
     TestManager utm;
 
@@ -115,6 +115,17 @@ private:
 
     // Pointer
     void Pointer() const;
+
+    // CompareExchange
+    template <typename T>
+    void DoCompareExchangeTestsForType() const
+    {
+        volatile T value = 99;
+        TEST_ASSERT( AtomicCompareExchange( &value, (T)98, (T)100 ) == false ); // Mismatch
+        TEST_ASSERT( AtomicLoadRelaxed( &value ) == 99 );
+        TEST_ASSERT( AtomicCompareExchange( &value, (T)99, (T)100 ) == true ); // Match
+        TEST_ASSERT( AtomicLoadRelaxed( &value ) == 100 );
+    }
 };
 
 // Register Tests
@@ -134,6 +145,12 @@ REGISTER_TESTS_BEGIN( TestAtomic )
 
     // Pointer
     REGISTER_TEST( Pointer )
+
+    // CompareExchange
+    REGISTER_TEST( DoCompareExchangeTestsForType<uint32_t> )
+    REGISTER_TEST( DoCompareExchangeTestsForType<uint64_t> )
+    REGISTER_TEST( DoCompareExchangeTestsForType<int32_t> )
+    REGISTER_TEST( DoCompareExchangeTestsForType<int64_t> )
 REGISTER_TESTS_END
 
 // Boolean
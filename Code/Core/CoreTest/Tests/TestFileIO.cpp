@@ -333,6 +333,17 @@ void TestFileIO::FileTime() const
     TEST_ASSERT( FileIO::SetFileLastWriteTime( path, oldTime ) == true );
     const uint64_t timeNow = FileIO::GetFileLastWriteTime( path );
     TEST_ASSERT( timeNow == oldTime );
+
+    // relative paths
+    const AStackString relativePath( "../tmp/Test/FileIO/FileTime.tmp" );
+    TEST_ASSERT( FileIO::EnsurePathExistsForFile( relativePath ) );
+    TEST_ASSERT( f.Open( relativePath.Get(), FileStream::WRITE_ONLY ) == true );
+    f.Close();
+    TEST_ASSERT( FileIO::SetFileLastWriteTime( relativePath, oldTime ) == true );
+    TEST_ASSERT( FileIO::GetFileLastWriteTime( relativePath ) == oldTime );
+    TEST_ASSERT( FileIO::SetFileLastWriteTimeToNow( relativePath ) == true );
+    TEST_ASSERT( FileIO::GetFileLastWriteTime( relativePath ) > oldTime );
+    TEST_ASSERT( FileIO::FileDelete( relativePath.Get() ) );
 }
 
 // LongPaths
@@ -8,6 +8,7 @@
 // Core
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryMappedFile.h"
 #include "Core/Process/Process.h"
 #include "Core/Strings/AStackString.h"
 
@@ -20,6 +21,8 @@ private:
 
     void WriteOnly() const;
     void ReadOnly() const;
+    void CreateNew() const;
+    void MemoryMapped() const;
 
     // Helpers
     mutable uint32_t m_TempFileId = 0;
@@ -31,6 +34,8 @@ private:
 REGISTER_TESTS_BEGIN( TestFileStream )
     REGISTER_TEST( WriteOnly )
     REGISTER_TEST( ReadOnly )
+    REGISTER_TEST( CreateNew )
+    REGISTER_TEST( MemoryMapped )
 REGISTER_TESTS_END
 
 // WriteOnly
@@ -111,6 +116,87 @@ void TestFileStream::ReadOnly() const
     TEST_ASSERT( FileIO::FileDelete( fileName.Get() ) );
 }
 
+// CreateNew
+//------------------------------------------------------------------------------
+void TestFileStream::CreateNew() const
+{
+    AStackString fileName;
+    GenerateTempFileName( fileName );
+
+    // Create a new file
+    FileStream f;
+    TEST_ASSERT( f.Open( fileName.Get(), FileStream::CREATE_NEW_WRITE_ONLY ) == true );
+
+    // Creating it again fails, even while it's open
+    {
+        FileStream f2;
+        TEST_ASSERT( f2.Open( fileName.Get(), FileStream::CREATE_NEW_WRITE_ONLY ) == false );
+    }
+
+    // Creating it again fails after it's closed
+    f.Close();
+    {
+        FileStream f2;
+        TEST_ASSERT( f2.Open( fileName.Get(), FileStream::CREATE_NEW_WRITE_ONLY ) == false );
+    }
+
+    // Once deleted, it can be created again
+    TEST_ASSERT( FileIO::FileDelete( fileName.Get() ) );
+    TEST_ASSERT( f.Open( fileName.Get(), FileStream::CREATE_NEW_WRITE_ONLY ) == true );
+    f.Close();
+
+    // Clean up
+    TEST_ASSERT( FileIO::FileDelete( fileName.Get() ) );
+}
+
+// MemoryMapped
+//------------------------------------------------------------------------------
+void TestFileStream::MemoryMapped() const
+{
+    AStackString fileName;
+    GenerateTempFileName( fileName );
+
+    // Missing file
+    {
+        MemoryMappedFile f;
+        TEST_ASSERT( f.Open( fileName.Get() ) == false );
+        TEST_ASSERT( f.IsOpen() == false );
+    }
+
+    // Empty file
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( fileName.Get(), FileStream::WRITE_ONLY ) == true );
+    }
+    {
+        MemoryMappedFile f;
+        TEST_ASSERT( f.Open( fileName.Get() ) == true );
+        TEST_ASSERT( f.IsOpen() == true );
+        TEST_ASSERT( f.GetSize() == 0 );
+    }
+
+    // File with some data in it
+    const AStackString data( "Some Data To Store In A File" );
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( fileName.Get(), FileStream::WRITE_ONLY ) == true );
+        TEST_ASSERT( f.WriteBuffer( data.Get(), data.GetLength() ) == data.GetLength() );
+    }
+    {
+        MemoryMappedFile f;
+        TEST_ASSERT( f.Open( fileName.Get() ) == true );
+        TEST_ASSERT( f.GetSize() == data.GetLength() );
+        TEST_ASSERT( AString::StrNCmp( static_cast<const char *>( f.GetData() ), data.Get(), data.GetLength() ) == 0 );
+
+        f.Close();
+        TEST_ASSERT( f.IsOpen() == false );
+        TEST_ASSERT( f.GetData() == nullptr );
+    }
+
+    // Clean up
+    TEST_ASSERT( FileIO::FileDelete( fileName.Get() ) );
+}
+
 // GenerateTempFileName
 //------------------------------------------------------------------------------
 void TestFileStream::GenerateTempFileName( AString & outTempFileName ) const
@@ -8,6 +8,7 @@
 // Core
 #include "Core/Containers/UniquePtr.h"
 #include "Core/Math/CRC32.h"
+#include "Core/Math/GearHash.h"
 #include "Core/Math/Random.h"
 #include "Core/Math/xxHash.h"
 #include "Core/Strings/AStackString.h"
@@ -26,6 +27,7 @@ private:
     void CompareHashTimes_Large() const;
     void CompareHashTimes_Small() const;
     void Accumulator() const;
+    void ChunkBoundaries() const;
 };
 
 // Register Tests
@@ -34,6 +36,7 @@ REGISTER_TESTS_BEGIN( TestHash )
     REGISTER_TEST( CompareHashTimes_Large )
     REGISTER_TEST( CompareHashTimes_Small )
     REGISTER_TEST( Accumulator )
+    REGISTER_TEST( ChunkBoundaries )
 REGISTER_TESTS_END
 
 // CompareHashTimes_Large
@@ -286,3 +289,40 @@ void TestHash::Accumulator() const
 }
 
 //------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+void TestHash::ChunkBoundaries() const
+{
+    const size_t minSize = ( 16 * 1024 );
+    const size_t avgSize = ( 64 * 1024 );
+    const size_t maxSize = ( 256 * 1024 );
+
+    // Random data
+    const size_t dataSize = ( 4 * 1024 * 1024 );
+    UniquePtr<uint8_t, FreeDeletor> data( static_cast<uint8_t *>( ALLOC( dataSize ) ) );
+    Random r( 1234 );
+    for ( size_t i = 0; i < dataSize; ++i )
+    {
+        data.Get()[ i ] = static_cast<uint8_t>( r.GetRand() );
+    }
+
+    // Data no larger than the minimum is a single chunk
+    TEST_ASSERT( GearHash::FindChunkEnd( data.Get(), minSize, minSize, avgSize, maxSize ) == minSize );
+    TEST_ASSERT( GearHash::FindChunkEnd( data.Get(), 100, minSize, avgSize, maxSize ) == 100 );
+
+    // Chunks respect the limits and average close to the requested size
+    size_t pos = 0;
+    size_t numChunks = 0;
+    while ( pos < dataSize )
+    {
+        const size_t chunkSize = GearHash::FindChunkEnd( data.Get() + pos, dataSize - pos, minSize, avgSize, maxSize );
+        TEST_ASSERT( chunkSize > 0 );
+        TEST_ASSERT( chunkSize <= maxSize );
+        TEST_ASSERT( ( chunkSize >= minSize ) || ( pos + chunkSize == dataSize ) );
+        pos += chunkSize;
+        ++numChunks;
+    }
+    TEST_ASSERT( pos == dataSize );
+    const size_t avgChunkSize = ( dataSize / numChunks );
+    TEST_ASSERT( ( avgChunkSize > ( avgSize / 2 ) ) && ( avgChunkSize < ( avgSize * 2 ) ) );
+}
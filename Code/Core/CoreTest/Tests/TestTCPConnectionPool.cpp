@@ -7,6 +7,7 @@
 
 // Core
 #include "Core/Containers/UniquePtr.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Network/TCPConnectionPool.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Process/Semaphore.h"
@@ -47,11 +48,17 @@ private:
     void TestMultipleServersOneClient() const;
     void TestConnectionCount() const;
     void TestDataTransfer() const;
+    void TestGatheredPayload() const;
 
     void TestConnectionStuckDuringSend() const;
     static uint32_t TestConnectionStuckDuringSend_ThreadFunc( void * userData );
 
     void TestConnectionFailure() const;
+
+    // Benchmarks
+    void TestThroughput() const;
+    static uint32_t TestThroughput_ThreadFunc( void * userData );
+    void TestLatency() const;
 };
 
 // Helper Macros
@@ -74,8 +81,11 @@ REGISTER_TESTS_BEGIN( TestTestTCPConnectionPool )
     REGISTER_TEST( TestMultipleServersOneClient )
     REGISTER_TEST( TestConnectionCount )
     REGISTER_TEST( TestDataTransfer )
+    REGISTER_TEST( TestGatheredPayload )
     REGISTER_TEST( TestConnectionStuckDuringSend )
     REGISTER_TEST( TestConnectionFailure )
+    REGISTER_TEST( TestThroughput )
+    REGISTER_TEST( TestLatency )
 REGISTER_TESTS_END
 
 // TestOneServerMultipleClients
@@ -264,6 +274,82 @@ void TestTestTCPConnectionPool::TestDataTransfer() const
     client.ShutdownAllConnections();
 }
 
+// TestGatheredPayload
+//------------------------------------------------------------------------------
+void TestTestTCPConnectionPool::TestGatheredPayload() const
+{
+    // a server which checks each message is followed by the expected payload
+    class TestServer : public TCPConnectionPool
+    {
+    public:
+        virtual ~TestServer() override { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo *, void * data, uint32_t size, bool & ) override
+        {
+            if ( m_ExpectingPayload )
+            {
+                TEST_ASSERT( size == m_PayloadSize );
+                TEST_ASSERT( memcmp( data, m_ExpectedPayload, size ) == 0 );
+                m_NumPayloadsReceived.Increment();
+            }
+            else
+            {
+                TEST_ASSERT( ( size == sizeof( m_MessageData ) ) && ( memcmp( data, &m_MessageData, size ) == 0 ) );
+            }
+            m_ExpectingPayload = !m_ExpectingPayload;
+        }
+        bool m_ExpectingPayload = false;
+        uint32_t m_MessageData = 0x12345678;
+        uint32_t m_PayloadSize = 0;
+        const char * m_ExpectedPayload = nullptr;
+        Atomic<uint32_t> m_NumPayloadsReceived;
+    };
+
+    const uint16_t testPort( TEST_PORT );
+
+    // data, initialized to some known pattern
+    const size_t dataSize( 4 * 1024 * 1024 );
+    UniquePtr<char, FreeDeletor> data( (char *)ALLOC( dataSize ) );
+    for ( size_t i = 0; i < dataSize; ++i )
+    {
+        data.Get()[ i ] = (char)i;
+    }
+
+    // gather the data from many buffers of varying sizes, including more
+    // buffers than can be sent at once
+    Array<TCPConnectionPool::SendBuffer> buffers;
+    uint32_t offset = 0;
+    for ( uint32_t i = 0; offset < dataSize; ++i )
+    {
+        const uint32_t size = Math::Min( ( i % 4 == 0 ) ? ( i * 997 ) : ( i * 7 ), static_cast<uint32_t>( dataSize ) - offset );
+        buffers.Append( { size, data.Get() + offset } );
+        offset += size;
+    }
+    TEST_ASSERT( buffers.GetSize() > 64 );
+
+    TestServer server;
+    server.m_ExpectedPayload = data.Get();
+    server.m_PayloadSize = static_cast<uint32_t>( dataSize );
+    TEST_ASSERT( server.Listen( testPort ) );
+
+    // client
+    TCPConnectionPool client;
+    const ConnectionInfo * ci = client.Connect( AStackString( "127.0.0.1" ), testPort );
+    TEST_ASSERT( ci );
+
+    const uint32_t numSends = 8;
+    for ( uint32_t i = 0; i < numSends; ++i )
+    {
+        TEST_ASSERT( client.Send( ci,
+                                  &server.m_MessageData,
+                                  sizeof( server.m_MessageData ),
+                                  buffers.Begin(),
+                                  static_cast<uint32_t>( buffers.GetSize() ) ) );
+    }
+    WAIT_UNTIL_WITH_TIMEOUT( server.m_NumPayloadsReceived.Load() == numSends );
+
+    client.ShutdownAllConnections();
+}
+
 // TestConnectionStuckDuringSend
 //------------------------------------------------------------------------------
 void TestTestTCPConnectionPool::TestConnectionStuckDuringSend() const
@@ -342,4 +428,178 @@ void TestTestTCPConnectionPool::TestConnectionFailure() const
     client.ShutdownAllConnections();
 }
 
+// TestThroughput
+//------------------------------------------------------------------------------
+namespace
+{
+    // Counts bytes received over all connections
+    class ThroughputServer : public TCPConnectionPool
+    {
+    public:
+        virtual ~ThroughputServer() override { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo *, void * data, uint32_t size, bool & ) override
+        {
+            // Spot check data integrity
+            TEST_ASSERT( static_cast<const uint8_t *>( data )[ size - 1 ] == uint8_t( size - 1 ) );
+            m_ReceivedBytes.Add( size );
+        }
+        Atomic<uint64_t> m_ReceivedBytes;
+    };
+
+    class ThroughputSender
+    {
+    public:
+        const ConnectionInfo * m_Connection = nullptr;
+        const void * m_Data = nullptr;
+        uint32_t m_MessageSize = 0;
+        uint32_t m_NumMessages = 0;
+    };
+}
+
+//------------------------------------------------------------------------------
+void TestTestTCPConnectionPool::TestThroughput() const
+{
+    const uint16_t testPort( TEST_PORT );
+
+    // data, initialized to some known pattern
+    const uint32_t maxMessageSize( 1024 * 1024 );
+    UniquePtr<uint8_t, FreeDeletor> data( (uint8_t *)ALLOC( maxMessageSize ) );
+    for ( size_t i = 0; i < maxMessageSize; ++i )
+    {
+        data.Get()[ i ] = (uint8_t)i;
+    }
+
+    ThroughputServer server;
+    TEST_ASSERT( server.Listen( testPort ) );
+
+    // Many connections sending simultaneously, like a worker serving many clients
+    const uint32_t numConnections = 16;
+    TCPConnectionPool client;
+    ThroughputSender senders[ numConnections ];
+    for ( uint32_t i = 0; i < numConnections; ++i )
+    {
+        senders[ i ].m_Connection = client.Connect( AStackString( "127.0.0.1" ), testPort );
+        TEST_ASSERT( senders[ i ].m_Connection );
+        senders[ i ].m_Data = data.Get();
+
+        // Listen has no backlog, so wait for accept to avoid connection retries
+        WAIT_UNTIL_WITH_TIMEOUT( server.GetNumConnections() == ( i + 1 ) );
+    }
+
+    // Small messages are dominated by per-message overhead, large ones by copying
+    const uint32_t messageSizes[] = { 64, 4 * 1024, 64 * 1024, maxMessageSize };
+    for ( const uint32_t messageSize : messageSizes )
+    {
+        // Send up to 16 MiB per connection, limiting the number of small messages
+        const uint32_t numMessages = Math::Min( ( 16u * 1024 * 1024 ) / messageSize, 4096u );
+        const uint64_t totalBytes = ( (uint64_t)messageSize * numMessages * numConnections );
+
+        server.m_ReceivedBytes.Store( 0 );
+        const Timer timer;
+
+        Thread threads[ numConnections ];
+        for ( uint32_t i = 0; i < numConnections; ++i )
+        {
+            senders[ i ].m_MessageSize = messageSize;
+            senders[ i ].m_NumMessages = numMessages;
+            threads[ i ].Start( TestThroughput_ThreadFunc, "Sender", &senders[ i ] );
+        }
+        for ( Thread & thread : threads )
+        {
+            thread.Join();
+        }
+        WAIT_UNTIL_WITH_TIMEOUT( server.m_ReceivedBytes.Load() == totalBytes );
+
+        const float seconds = timer.GetElapsed();
+        const float speedMBs = ( float( totalBytes ) / seconds ) / float( 1024 * 1024 );
+        const float messagesPerSec = float( numMessages * numConnections ) / seconds;
+        OUTPUT( "Throughput: %7.1f MiB/s, %9.0f msg/s, MsgSize: %u, Connections: %u\n", (double)speedMBs, (double)messagesPerSec, messageSize, numConnections );
+    }
+
+    client.ShutdownAllConnections();
+}
+
+//------------------------------------------------------------------------------
+/*static*/ uint32_t TestTestTCPConnectionPool::TestThroughput_ThreadFunc( void * userData )
+{
+    const ThroughputSender * sender = static_cast<const ThroughputSender *>( userData );
+    TCPConnectionPool & client = sender->m_Connection->GetTCPConnectionPool();
+    for ( uint32_t i = 0; i < sender->m_NumMessages; ++i )
+    {
+        TEST_ASSERT( client.Send( sender->m_Connection, sender->m_Data, sender->m_MessageSize ) );
+    }
+    return 0;
+}
+
+// TestLatency
+//------------------------------------------------------------------------------
+void TestTestTCPConnectionPool::TestLatency() const
+{
+    // Server replies to every message from within OnReceive
+    class EchoServer : public TCPConnectionPool
+    {
+    public:
+        virtual ~EchoServer() override { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & ) override
+        {
+            TEST_ASSERT( Send( connection, data, size ) );
+        }
+    };
+
+    // Client signals when reply is received
+    class EchoClient : public TCPConnectionPool
+    {
+    public:
+        virtual void OnReceive( const ConnectionInfo *, void * data, uint32_t size, bool & ) override
+        {
+            TEST_ASSERT( size == m_ExpectedSize );
+            TEST_ASSERT( memcmp( data, m_ExpectedData, size ) == 0 );
+            m_ReplySemaphore.Signal();
+        }
+        uint32_t m_ExpectedSize = 0;
+        const uint8_t * m_ExpectedData = nullptr;
+        Semaphore m_ReplySemaphore;
+    };
+
+    const uint16_t testPort( TEST_PORT );
+
+    const uint32_t maxMessageSize( 4 * 1024 * 1024 );
+    UniquePtr<uint8_t, FreeDeletor> data( (uint8_t *)ALLOC( maxMessageSize ) );
+    for ( size_t i = 0; i < maxMessageSize; ++i )
+    {
+        data.Get()[ i ] = (uint8_t)( i * 7 );
+    }
+
+    EchoServer server;
+    TEST_ASSERT( server.Listen( testPort ) );
+
+    EchoClient client;
+    client.m_ExpectedData = data.Get();
+    const ConnectionInfo * ci = client.Connect( AStackString( "127.0.0.1" ), testPort );
+    TEST_ASSERT( ci );
+
+    // Round trips of various sizes, including some too large to be
+    // sent by the echo server without blocking
+    const uint32_t messageSizes[] = { 16, 1024, 64 * 1024, 1024 * 1024, maxMessageSize };
+    for ( const uint32_t messageSize : messageSizes )
+    {
+        client.m_ExpectedSize = messageSize;
+
+        const uint32_t numRoundTrips = ( messageSize >= ( 1024 * 1024 ) ) ? 16 : 1000;
+        float maxMS = 0.0f;
+        const Timer timer;
+        for ( uint32_t i = 0; i < numRoundTrips; ++i )
+        {
+            const Timer roundTripTimer;
+            TEST_ASSERT( client.Send( ci, data.Get(), messageSize ) );
+            client.m_ReplySemaphore.Wait();
+            maxMS = Math::Max( maxMS, roundTripTimer.GetElapsedMS() );
+        }
+        const float avgMS = ( timer.GetElapsedMS() / float( numRoundTrips ) );
+        OUTPUT( "Latency: Avg %8.3f ms, Max %8.3f ms, MsgSize: %u\n", (double)avgMS, (double)maxMS, messageSize );
+    }
+
+    client.ShutdownAllConnections();
+}
+
 //------------------------------------------------------------------------------
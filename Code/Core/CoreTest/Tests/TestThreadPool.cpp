@@ -21,6 +21,7 @@ private:
     void Unused() const;
     void SingleJob() const;
     void MultipleJobs() const;
+    void ParallelFor() const;
 
     // Helpers
     static void Increment( void * userData )
@@ -28,6 +29,14 @@ private:
         Atomic<uint32_t> * u32 = static_cast<Atomic<uint32_t> *>( userData );
         u32->Increment();
     }
+    static void IncrementRange( uint32_t begin, uint32_t end, void * userData )
+    {
+        volatile uint32_t * counts = static_cast<volatile uint32_t *>( userData );
+        for ( uint32_t i = begin; i < end; ++i )
+        {
+            AtomicInc( &counts[ i ] );
+        }
+    }
 };
 
 // Register Tests
@@ -36,6 +45,7 @@ REGISTER_TESTS_BEGIN( TestThreadPool )
     REGISTER_TEST( Unused )
     REGISTER_TEST( SingleJob )
     REGISTER_TEST( MultipleJobs )
+    REGISTER_TEST( ParallelFor )
 REGISTER_TESTS_END
 
 // Unused
@@ -86,4 +96,30 @@ void TestThreadPool::MultipleJobs() const
     TEST_ASSERT( count.Load() == numJobs );
 }
 
+// ParallelFor
+//------------------------------------------------------------------------------
+void TestThreadPool::ParallelFor() const
+{
+    ThreadPool threadPool( 4 );
+
+    // Various counts and batch sizes, including partial and empty batches
+    const uint32_t numItems = 1000;
+    const uint32_t counts[] = { 0, 1, 7, 999, 1000 };
+    const uint32_t batchSizes[] = { 1, 3, 64, 2000 };
+    for ( const uint32_t count : counts )
+    {
+        for ( const uint32_t batchSize : batchSizes )
+        {
+            uint32_t items[ numItems ] = {};
+            threadPool.ParallelFor( count, batchSize, IncrementRange, items );
+
+            // Every item in range processed exactly once
+            for ( uint32_t i = 0; i < numItems; ++i )
+            {
+                TEST_ASSERT( items[ i ] == ( ( i < count ) ? 1u : 0u ) );
+            }
+        }
+    }
+}
+
 //------------------------------------------------------------------------------
@@ -0,0 +1,345 @@
+// TestWorkStealingQueue.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "TestFramework/TestGroup.h"
+
+#include "Core/Containers/Array.h"
+#include "Core/Containers/WorkStealingQueue.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Thread.h"
+#include "Core/Time/Timer.h"
+#include "Core/Tracing/Tracing.h"
+
+// TestWorkStealingQueue
+//------------------------------------------------------------------------------
+class TestWorkStealingQueue : public TestGroup
+{
+private:
+    DECLARE_TESTS
+
+    void Empty() const;
+    void PushSteal() const;
+    void Grow() const;
+    void MultiThreaded() const;
+    void ContentionBenchmark() const;
+
+    // Helpers for threaded tests
+    static const uint32_t kMaxBenchmarkThreads = 16;
+    class ThreadInfo
+    {
+    public:
+        Thread m_Thread;
+        uint32_t m_ThreadIndex = 0;
+        uint32_t m_NumThreads = 0;
+        uint32_t m_NumItemsTaken = 0;
+        volatile bool * m_ProducerDone = nullptr;
+        WorkStealingQueue<uint32_t> * m_Queues = nullptr; // One per thread
+        Array<uint32_t> * m_SeenCounts = nullptr;
+        Mutex * m_Mutex = nullptr; // For Mutex based benchmark
+        Array<uint32_t> * m_LockedItems = nullptr; // For Mutex based benchmark
+    };
+    static uint32_t ThreadFunction_Steal( void * userData );
+    static uint32_t ThreadFunction_Mutex( void * userData );
+    static float RunMutexBenchmark( uint32_t numThreads, uint32_t numItems );
+    static float RunWorkStealingBenchmark( uint32_t numThreads, uint32_t numItems );
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestWorkStealingQueue )
+    REGISTER_TEST( Empty )
+    REGISTER_TEST( PushSteal )
+    REGISTER_TEST( Grow )
+    REGISTER_TEST( MultiThreaded )
+    REGISTER_TEST( ContentionBenchmark )
+REGISTER_TESTS_END
+
+// Empty
+//------------------------------------------------------------------------------
+void TestWorkStealingQueue::Empty() const
+{
+    WorkStealingQueue<uint32_t> queue;
+    TEST_ASSERT( queue.IsEmpty() );
+    TEST_ASSERT( queue.GetCount() == 0 );
+
+    uint32_t item = 0;
+    TEST_ASSERT( queue.Steal( item ) == false );
+}
+
+// PushSteal
+//------------------------------------------------------------------------------
+void TestWorkStealingQueue::PushSteal() const
+{
+    WorkStealingQueue<uint32_t> queue;
+    queue.Push( 1 );
+    queue.Push( 2 );
+    queue.Push( 3 );
+    TEST_ASSERT( queue.GetCount() == 3 );
+
+    // Items are stolen oldest first
+    uint32_t item = 0;
+    TEST_ASSERT( queue.Steal( item ) && ( item == 1 ) );
+    TEST_ASSERT( queue.Steal( item ) && ( item == 2 ) );
+    queue.Push( 4 );
+    TEST_ASSERT( queue.Steal( item ) && ( item == 3 ) );
+    TEST_ASSERT( queue.Steal( item ) && ( item == 4 ) );
+    TEST_ASSERT( queue.Steal( item ) == false );
+    TEST_ASSERT( queue.IsEmpty() );
+}
+
+// Grow
+//------------------------------------------------------------------------------
+void TestWorkStealingQueue::Grow() const
+{
+    WorkStealingQueue<uint32_t> queue( 4 );
+
+    // Interleave pushes and steals so items wrap around the buffer
+    // before it grows
+    uint32_t nextToSteal = 0;
+    uint32_t item = 0;
+    for ( uint32_t i = 0; i < 1000; ++i )
+    {
+        queue.Push( i );
+        if ( ( i % 3 ) == 0 )
+        {
+            TEST_ASSERT( queue.Steal( item ) && ( item == nextToSteal ) );
+            ++nextToSteal;
+        }
+    }
+    TEST_ASSERT( queue.GetCount() == ( 1000 - nextToSteal ) );
+
+    while ( queue.Steal( item ) )
+    {
+        TEST_ASSERT( item == nextToSteal );
+        ++nextToSteal;
+    }
+    TEST_ASSERT( nextToSteal == 1000 );
+}
+
+// MultiThreaded
+//------------------------------------------------------------------------------
+void TestWorkStealingQueue::MultiThreaded() const
+{
+#if defined( DEBUG )
+    const uint32_t numItems = ( 100 * 1000 );
+#else
+    const uint32_t numItems = ( 1000 * 1000 );
+#endif
+    const uint32_t numThreads = 4;
+
+    WorkStealingQueue<uint32_t> queues[ numThreads ];
+    Array<uint32_t> seenCounts;
+    seenCounts.SetCapacity( numItems );
+    for ( uint32_t i = 0; i < numItems; ++i )
+    {
+        seenCounts.Append( 0 );
+    }
+    volatile bool producerDone = false;
+
+    // Create thieves
+    ThreadInfo info[ numThreads ];
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        info[ i ].m_ThreadIndex = i;
+        info[ i ].m_NumThreads = numThreads;
+        info[ i ].m_ProducerDone = &producerDone;
+        info[ i ].m_Queues = queues;
+        info[ i ].m_SeenCounts = &seenCounts;
+        info[ i ].m_Thread.Start( ThreadFunction_Steal, "WorkStealingQueue", &info[ i ] );
+    }
+
+    // Push items while thieves are stealing them (growing the queues as we go)
+    for ( uint32_t i = 0; i < numItems; ++i )
+    {
+        queues[ i % numThreads ].Push( i );
+    }
+    AtomicStoreRelease( &producerDone, true );
+
+    // Join the threads
+    uint32_t numItemsTaken = 0;
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        info[ i ].m_Thread.Join();
+        numItemsTaken += info[ i ].m_NumItemsTaken;
+    }
+
+    // Every item should have been taken exactly once
+    TEST_ASSERT( numItemsTaken == numItems );
+    for ( const uint32_t seenCount : seenCounts )
+    {
+        TEST_ASSERT( seenCount == 1 );
+    }
+}
+
+// ContentionBenchmark
+//------------------------------------------------------------------------------
+void TestWorkStealingQueue::ContentionBenchmark() const
+{
+#if defined( DEBUG )
+    const uint32_t numItems = ( 100 * 1000 );
+#else
+    const uint32_t numItems = ( 1000 * 1000 );
+#endif
+
+    for ( uint32_t numThreads = 1; numThreads <= kMaxBenchmarkThreads; numThreads *= 2 )
+    {
+        const float time1 = RunMutexBenchmark( numThreads, numItems );
+        const float time2 = RunWorkStealingBenchmark( numThreads, numItems );
+
+        // output
+        OUTPUT( "Threads: %2u\n", numThreads );
+        OUTPUT( " - Mutex             : %2.3fs - %u items @ %u items/sec\n", (double)time1, numItems, (uint32_t)( float( numItems ) / time1 ) );
+        OUTPUT( " - WorkStealingQueue : %2.3fs - %u items @ %u items/sec\n", (double)time2, numItems, (uint32_t)( float( numItems ) / time2 ) );
+    }
+}
+
+// ThreadFunction_Steal
+//------------------------------------------------------------------------------
+/*static*/ uint32_t TestWorkStealingQueue::ThreadFunction_Steal( void * userData )
+{
+    ThreadInfo & info = *( static_cast<ThreadInfo *>( userData ) );
+
+    for ( ;; )
+    {
+        // Check before trying to steal to ensure no items are missed
+        const bool producerDone = AtomicLoadAcquire( info.m_ProducerDone );
+
+        // Take from own queue first, then steal from others
+        bool tookItem = false;
+        for ( uint32_t i = 0; i < info.m_NumThreads; ++i )
+        {
+            uint32_t item;
+            if ( info.m_Queues[ ( info.m_ThreadIndex + i ) % info.m_NumThreads ].Steal( item ) )
+            {
+                if ( info.m_SeenCounts )
+                {
+                    AtomicInc( &( *info.m_SeenCounts )[ item ] );
+                }
+                ++info.m_NumItemsTaken;
+                tookItem = true;
+                break;
+            }
+        }
+
+        if ( ( tookItem == false ) && producerDone )
+        {
+            return 0;
+        }
+    }
+}
+
+// ThreadFunction_Mutex
+//------------------------------------------------------------------------------
+/*static*/ uint32_t TestWorkStealingQueue::ThreadFunction_Mutex( void * userData )
+{
+    ThreadInfo & info = *( static_cast<ThreadInfo *>( userData ) );
+
+    for ( ;; )
+    {
+        const bool producerDone = AtomicLoadAcquire( info.m_ProducerDone );
+
+        bool tookItem = false;
+        {
+            MutexHolder mh( *info.m_Mutex );
+            if ( info.m_LockedItems->IsEmpty() == false )
+            {
+                info.m_LockedItems->Pop();
+                tookItem = true;
+            }
+        }
+
+        if ( tookItem )
+        {
+            ++info.m_NumItemsTaken;
+        }
+        else if ( producerDone )
+        {
+            return 0;
+        }
+    }
+}
+
+// RunMutexBenchmark
+//------------------------------------------------------------------------------
+/*static*/ float TestWorkStealingQueue::RunMutexBenchmark( uint32_t numThreads, uint32_t numItems )
+{
+    // Items are queued up front so only consumer contention is measured
+    Mutex mutex;
+    Array<uint32_t> items;
+    items.SetCapacity( numItems );
+    for ( uint32_t i = 0; i < numItems; ++i )
+    {
+        items.Append( i );
+    }
+    volatile bool producerDone = true;
+
+    const Timer timer;
+
+    // Create consumers
+    ASSERT( numThreads <= kMaxBenchmarkThreads );
+    ThreadInfo info[ kMaxBenchmarkThreads ];
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        info[ i ].m_ProducerDone = &producerDone;
+        info[ i ].m_Mutex = &mutex;
+        info[ i ].m_LockedItems = &items;
+        info[ i ].m_Thread.Start( ThreadFunction_Mutex, "WorkStealingQueue", &info[ i ] );
+    }
+
+    uint32_t numItemsTaken = 0;
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        info[ i ].m_Thread.Join();
+        numItemsTaken += info[ i ].m_NumItemsTaken;
+    }
+    TEST_ASSERT( numItemsTaken == numItems );
+
+    return timer.GetElapsed();
+}
+
+// RunWorkStealingBenchmark
+//------------------------------------------------------------------------------
+/*static*/ float TestWorkStealingQueue::RunWorkStealingBenchmark( uint32_t numThreads, uint32_t numItems )
+{
+    // Items are queued up front (round-robin into each consumer's queue)
+    // so only consumer contention is measured
+    WorkStealingQueue<uint32_t> * queues = FNEW_ARRAY( WorkStealingQueue<uint32_t>[ numThreads ] );
+    for ( uint32_t i = 0; i < numItems; ++i )
+    {
+        queues[ i % numThreads ].Push( i );
+    }
+    volatile bool producerDone = true;
+
+    const Timer timer;
+
+    // Create consumers
+    ASSERT( numThreads <= kMaxBenchmarkThreads );
+    ThreadInfo info[ kMaxBenchmarkThreads ];
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        info[ i ].m_ThreadIndex = i;
+        info[ i ].m_NumThreads = numThreads;
+        info[ i ].m_ProducerDone = &producerDone;
+        info[ i ].m_Queues = queues;
+        info[ i ].m_Thread.Start( ThreadFunction_Steal, "WorkStealingQueue", &info[ i ] );
+    }
+
+    uint32_t numItemsTaken = 0;
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        info[ i ].m_Thread.Join();
+        numItemsTaken += info[ i ].m_NumItemsTaken;
+    }
+    TEST_ASSERT( numItemsTaken == numItems );
+
+    const float time = timer.GetElapsed();
+
+    FDELETE_ARRAY queues;
+    return time;
+}
+
+//------------------------------------------------------------------------------
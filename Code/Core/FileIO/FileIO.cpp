@@ -14,6 +14,7 @@
 #endif
 #include "Core/FileIO/PathUtils.h"
 #include "Core/Math/Conversions.h"
+#include "Core/Mem/Mem.h"
 #include "Core/Process/Thread.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
@@ -36,10 +37,12 @@
 #if defined( __LINUX__ )
     #include <fcntl.h>
     #include <sys/sendfile.h>
+    #include <sys/syscall.h>
 #endif
 #if defined( __APPLE__ )
     #include <copyfile.h>
     #include <dlfcn.h>
+    #include <fcntl.h>
     #include <sys/time.h>
 #endif
 
@@ -77,6 +80,79 @@ public:
 } gOSXHelper_utimensat;
 #endif
 
+// LinuxDirectoryReader
+//------------------------------------------------------------------------------
+#if defined( __LINUX__ )
+    // Reads the entries of a directory with getdents64, fetching many entries
+    // per syscall. The directory stays open so entries can be stat'd relative
+    // to it (avoiding a lookup of the full path for each entry, which is
+    // expensive on network file systems).
+class LinuxDirectoryReader
+{
+public:
+    explicit LinuxDirectoryReader( const char * path )
+        : m_FD( open( path, O_RDONLY | O_DIRECTORY | O_CLOEXEC ) )
+    {
+    }
+    ~LinuxDirectoryReader()
+    {
+        if ( m_FD != -1 )
+        {
+            close( m_FD );
+        }
+        FREE( m_Buffer );
+    }
+
+    bool IsOpen() const { return ( m_FD != -1 ); }
+    int GetFD() const { return m_FD; }
+
+    const dirent64 * Next()
+    {
+        if ( m_Pos >= m_Size )
+        {
+            if ( m_Buffer == nullptr )
+            {
+                m_Buffer = static_cast<char *>( ALLOC( kBufferSize ) );
+            }
+            const long bytesRead = syscall( SYS_getdents64, m_FD, m_Buffer, kBufferSize );
+            if ( bytesRead <= 0 )
+            {
+                return nullptr; // no more entries (or error)
+            }
+            m_Size = static_cast<size_t>( bytesRead );
+            m_Pos = 0;
+        }
+        const dirent64 * entry = reinterpret_cast<const dirent64 *>( m_Buffer + m_Pos );
+        m_Pos += entry->d_reclen;
+        return entry;
+    }
+
+    // Attributes of an entry, retrieving only the fields used by FileInfo
+    static bool GetFileInfo( int dirFD, const char * name, FileIO::FileInfo & info )
+    {
+        struct statx s;
+        if ( statx( dirFD, name, AT_SYMLINK_NOFOLLOW, ( STATX_TYPE | STATX_MODE | STATX_MTIME | STATX_SIZE ), &s ) != 0 )
+        {
+            return false;
+        }
+        info.m_Attributes = s.stx_mode;
+        info.m_LastWriteTime = ( ( (uint64_t)s.stx_mtime.tv_sec * 1000000000ULL ) + (uint64_t)s.stx_mtime.tv_nsec );
+        info.m_Size = static_cast<uint64_t>( s.stx_size );
+        return true;
+    }
+
+    LinuxDirectoryReader & operator=( const LinuxDirectoryReader & ) = delete;
+
+private:
+    static const size_t kBufferSize = ( 64 * 1024 );
+
+    const int m_FD;
+    char * m_Buffer = nullptr;
+    size_t m_Pos = 0;
+    size_t m_Size = 0;
+};
+#endif
+
 // Exists
 //------------------------------------------------------------------------------
 /*static*/ bool FileIO::FileExists( const char * fileName )
@@ -425,6 +501,45 @@ public:
     return false;
 }
 
+// GetFileInfos
+//------------------------------------------------------------------------------
+/*static*/ void FileIO::GetFileInfos( const AString & dirPath,
+                                      const char * const * fileNames,
+                                      size_t count,
+                                      FileInfo * outInfos,
+                                      bool * outFound )
+{
+    ASSERT( dirPath.EndsWith( NATIVE_SLASH ) );
+
+#if defined( __LINUX__ )
+    // Stat relative to the directory, so the path is only looked up once
+    const int dirFD = open( dirPath.Get(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+    if ( dirFD != -1 )
+    {
+        for ( size_t i = 0; i < count; ++i )
+        {
+            FileInfo & info = outInfos[ i ];
+            outFound[ i ] = LinuxDirectoryReader::GetFileInfo( dirFD, fileNames[ i ], info );
+            if ( outFound[ i ] )
+            {
+                info.m_Name = dirPath;
+                info.m_Name += fileNames[ i ];
+            }
+        }
+        close( dirFD );
+        return;
+    }
+#endif
+
+    AStackString fullPath;
+    for ( size_t i = 0; i < count; ++i )
+    {
+        fullPath = dirPath;
+        fullPath += fileNames[ i ];
+        outFound[ i ] = GetFileInfo( fullPath, outInfos[ i ] );
+    }
+}
+
 // GetCurrentDir
 //------------------------------------------------------------------------------
 /*static*/ bool FileIO::GetCurrentDir( AString & output )
@@ -864,7 +979,7 @@ public:
         t[ 0 ].tv_sec = fileTime / 1000000000ULL;
         t[ 0 ].tv_nsec = ( fileTime % 1000000000ULL );
         t[ 1 ] = t[ 0 ];
-        return ( ( gOSXHelper_utimensat.m_FuncPtr )( 0, fileName.Get(), t, 0 ) == 0 );
+        return ( ( gOSXHelper_utimensat.m_FuncPtr )( AT_FDCWD, fileName.Get(), t, 0 ) == 0 );
     }
 
         // Fallback to regular low-resolution filetime setting
@@ -878,7 +993,7 @@ public:
     t[ 0 ].tv_sec = fileTime / 1000000000ULL;
     t[ 0 ].tv_nsec = ( fileTime % 1000000000ULL );
     t[ 1 ] = t[ 0 ];
-    return ( utimensat( 0, fileName.Get(), t, 0 ) == 0 );
+    return ( utimensat( AT_FDCWD, fileName.Get(), t, 0 ) == 0 );
 #else
     #error Unknown platform
 #endif
@@ -895,13 +1010,13 @@ public:
     // Use higher precision function if available
     if ( gOSXHelper_utimensat.m_FuncPtr )
     {
-        return ( ( gOSXHelper_utimensat.m_FuncPtr )( 0, fileName.Get(), nullptr, 0 ) == 0 );
+        return ( ( gOSXHelper_utimensat.m_FuncPtr )( AT_FDCWD, fileName.Get(), nullptr, 0 ) == 0 );
     }
 
     // Fallback to regular low-resolution filetime setting
     return ( utimes( fileName.Get(), nullptr ) == 0 );
 #elif defined( __LINUX__ )
-    return ( utimensat( 0, fileName.Get(), nullptr, 0 ) == 0 );
+    return ( utimensat( AT_FDCWD, fileName.Get(), nullptr, 0 ) == 0 );
 #else
     #error Unknown platform
 #endif
@@ -1050,6 +1165,12 @@ public:
     {
         return;
     }
+#elif defined( __LINUX__ )
+    LinuxDirectoryReader dir( pathCopy.Get() );
+    if ( dir.IsOpen() == false )
+    {
+        return;
+    }
 #else
     DIR * dir = opendir( pathCopy.Get() );
     if ( dir == nullptr )
@@ -1065,7 +1186,13 @@ public:
     do
 #endif
     {
-#if defined( __LINUX__ ) || defined( __APPLE__ )
+#if defined( __LINUX__ )
+        const dirent64 * entry = dir.Next();
+        if ( entry == nullptr )
+        {
+            break; // no more entries
+        }
+#elif defined( __APPLE__ )
         dirent * entry = readdir( dir );
         if ( entry == nullptr )
         {
@@ -1090,11 +1217,16 @@ public:
         // d_type and applications must properly handle a return of DT_UNKNOWN.
         if ( entry->d_type == DT_UNKNOWN )
         {
+    #if defined( __LINUX__ )
+            struct stat info;
+            VERIFY( fstatat( dir.GetFD(), entry->d_name, &info, AT_SYMLINK_NOFOLLOW ) == 0 );
+    #else
             pathCopy.SetLength( baseLength );
             pathCopy += entry->d_name;
 
             struct stat info;
             VERIFY( lstat( pathCopy.Get(), &info ) == 0 );
+    #endif
             isDir = S_ISDIR( info.st_mode );
         }
 #endif
@@ -1137,15 +1269,13 @@ public:
             fileInfo.m_Attributes = findData.dwFileAttributes;
             fileInfo.m_LastWriteTime = (uint64_t)findData.ftLastWriteTime.dwLowDateTime | ( (uint64_t)findData.ftLastWriteTime.dwHighDateTime << 32 );
             fileInfo.m_Size = (uint64_t)findData.nFileSizeLow | ( (uint64_t)findData.nFileSizeHigh << 32 );
+#elif defined( __LINUX__ )
+            VERIFY( LinuxDirectoryReader::GetFileInfo( dir.GetFD(), entryName, fileInfo ) );
 #else
             struct stat info;
             VERIFY( lstat( fileInfo.m_Name.Get(), &info ) == 0 );
             fileInfo.m_Attributes = info.st_mode;
-    #if defined( __APPLE__ )
             fileInfo.m_LastWriteTime = ( ( (uint64_t)info.st_mtimespec.tv_sec * 1000000000ULL ) + (uint64_t)info.st_mtimespec.tv_nsec );
-    #else
-            fileInfo.m_LastWriteTime = ( ( (uint64_t)info.st_mtim.tv_sec * 1000000000ULL ) + (uint64_t)info.st_mtim.tv_nsec );
-    #endif
             fileInfo.m_Size = static_cast<uint64_t>( info.st_size );
 #endif
             helper.OnFile( Move( fileInfo ) );
@@ -1159,7 +1289,7 @@ public:
 
 #if defined( __WINDOWS__ )
     FindClose( hFind );
-#else
+#elif defined( __APPLE__ )
     closedir( dir );
 #endif
 }
@@ -48,6 +48,11 @@ public:
                             bool recurse,
                             Array<FileInfo> * results );
     static bool GetFileInfo( const AString & fileName, FileInfo & info );
+    static void GetFileInfos( const AString & dirPath, // With trailing slash
+                              const char * const * fileNames,
+                              size_t count,
+                              FileInfo * outInfos,
+                              bool * outFound );
 
     static bool GetCurrentDir( AString & output );
     static bool SetCurrentDir( const AString & dir );
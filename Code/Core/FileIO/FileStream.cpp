@@ -84,6 +84,12 @@ bool FileStream::Open( const char * fileName, uint32_t fileMode )
         shareMode |= FILE_SHARE_READ; // allow other readers
         creationDisposition |= OPEN_ALWAYS; // open or create
     }
+    else if ( ( fileMode & CREATE_NEW_WRITE_ONLY ) != 0 )
+    {
+        desiredAccess |= GENERIC_WRITE;
+        shareMode |= FILE_SHARE_READ; // allow other readers
+        creationDisposition |= CREATE_NEW; // fail if file exists
+    }
     else
     {
         ASSERT( false ); // must specify an access mode
@@ -148,6 +154,10 @@ bool FileStream::Open( const char * fileName, uint32_t fileMode )
     {
         flags |= ( O_RDWR | O_CREAT );
     }
+    else if ( ( fileMode & CREATE_NEW_WRITE_ONLY ) != 0 )
+    {
+        flags |= ( O_WRONLY | O_CREAT | O_EXCL );
+    }
     else
     {
         ASSERT( false ); // must specify an access mode
@@ -19,6 +19,7 @@ public:
         WRITE_ONLY = 0x2,
         OPEN_OR_CREATE_READ_WRITE = 0x4,
         TEMP = 0x8,
+        CREATE_NEW_WRITE_ONLY = 0x10, // Fails if file already exists (can be used as a lock)
         NO_RETRY_ON_SHARING_VIOLATION = 0x80,
     };
 
@@ -0,0 +1,336 @@
+// FileSystemWatcher.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FileSystemWatcher.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Process/Thread.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+
+// system
+#if defined( __LINUX__ )
+    #include <errno.h>
+    #include <poll.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+// SubDirectoryLister
+//  - Lists the sub-directories of a single directory (names only, without stats)
+//------------------------------------------------------------------------------
+#if defined( __LINUX__ )
+class SubDirectoryLister : public GetFilesHelper
+{
+public:
+    explicit SubDirectoryLister( Array<AString> & outSubDirs )
+        : GetFilesHelper( 0 )
+        , m_SubDirs( outSubDirs )
+    {
+        m_Recurse = false;
+    }
+
+    virtual bool OnDirectory( const AString & dirPath ) override
+    {
+        m_SubDirs.EmplaceBack( dirPath );
+        return false;
+    }
+
+    virtual bool ShouldIncludeFile( const char * /*fileName*/ ) override
+    {
+        return false;
+    }
+
+    SubDirectoryLister & operator=( const SubDirectoryLister & ) = delete;
+
+private:
+    Array<AString> & m_SubDirs;
+};
+#endif
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+FileSystemWatcher::FileSystemWatcher()
+{
+#if defined( __LINUX__ )
+    m_FD = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+    if ( m_FD == -1 )
+    {
+        m_WatchesIncomplete = true;
+    }
+#else
+    m_WatchesIncomplete = true;
+#endif
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+FileSystemWatcher::~FileSystemWatcher()
+{
+#if defined( __LINUX__ )
+    if ( m_FD != -1 )
+    {
+        close( m_FD ); // Removes all watches
+    }
+#endif
+}
+
+// IsSupported
+//------------------------------------------------------------------------------
+/*static*/ bool FileSystemWatcher::IsSupported()
+{
+#if defined( __LINUX__ )
+    return true;
+#else
+    return false;
+#endif
+}
+
+// AddDirectory
+//------------------------------------------------------------------------------
+bool FileSystemWatcher::AddDirectory( const AString & path, bool recursive )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( path.EndsWith( NATIVE_SLASH ) );
+
+#if defined( __LINUX__ )
+    if ( m_FD == -1 )
+    {
+        return false;
+    }
+    return AddWatch( path, recursive );
+#else
+    (void)path;
+    (void)recursive;
+    return false;
+#endif
+}
+
+// IsWatched
+//------------------------------------------------------------------------------
+bool FileSystemWatcher::IsWatched( const AString & path )
+{
+#if defined( __LINUX__ )
+    const UnorderedMap<AString, uint32_t>::KeyValue * existing = m_WatchesByPath.Find( path );
+    return ( existing && m_Watches[ existing->m_Value ].m_Active );
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+// Update
+//------------------------------------------------------------------------------
+void FileSystemWatcher::Update()
+{
+#if defined( __LINUX__ )
+    if ( m_FD == -1 )
+    {
+        return;
+    }
+
+    alignas( struct inotify_event ) char buffer[ 16 * 1024 ];
+    for ( ;; )
+    {
+        const ssize_t bytesRead = read( m_FD, buffer, sizeof( buffer ) );
+        if ( bytesRead <= 0 )
+        {
+            return; // No more events (EAGAIN) or error
+        }
+
+        for ( ssize_t pos = 0; pos < bytesRead; )
+        {
+            const struct inotify_event * event = reinterpret_cast<const struct inotify_event *>( buffer + pos );
+            pos += static_cast<ssize_t>( sizeof( struct inotify_event ) + event->len );
+
+            // Notifications were discarded by the OS
+            if ( event->mask & IN_Q_OVERFLOW )
+            {
+                m_EventsLost = true;
+                continue;
+            }
+
+            UnorderedMap<uint64_t, uint32_t>::KeyValue * watchIndex = m_WatchesByDescriptor.Find( static_cast<uint64_t>( event->wd ) );
+            if ( watchIndex == nullptr )
+            {
+                continue; // Already removed
+            }
+            const uint32_t index = watchIndex->m_Value;
+
+            // Watched directory removed
+            if ( event->mask & IN_IGNORED )
+            {
+                m_Watches[ index ].m_Active = false;
+                continue;
+            }
+            if ( event->mask & ( IN_DELETE_SELF | IN_MOVE_SELF ) )
+            {
+                // A moved directory would otherwise still be watched under its old path
+                inotify_rm_watch( m_FD, event->wd );
+                m_Watches[ index ].m_Active = false;
+                AddChange( m_Watches[ index ].m_Path );
+                continue;
+            }
+            if ( event->len == 0 )
+            {
+                continue; // Change to the directory itself (e.g. attributes)
+            }
+
+            AStackString path( m_Watches[ index ].m_Path );
+            path += event->name;
+            if ( event->mask & IN_ISDIR )
+            {
+                path += NATIVE_SLASH;
+
+                // New directories below recursively watched ones are watched too.
+                // Files created before the watch is added are not reported, but
+                // users of the directory are affected by its creation anyway.
+                if ( m_Watches[ index ].m_Recursive && ( event->mask & ( IN_CREATE | IN_MOVED_TO ) ) )
+                {
+                    AddWatch( path, true );
+                }
+            }
+            AddChange( path );
+        }
+    }
+#endif
+}
+
+// WaitForChanges
+//------------------------------------------------------------------------------
+bool FileSystemWatcher::WaitForChanges( uint32_t timeoutMS )
+{
+#if defined( __LINUX__ )
+    Update();
+    if ( m_ChangedPaths.IsEmpty() && ( m_EventsLost == false ) && ( m_FD != -1 ) )
+    {
+        struct pollfd pfd;
+        pfd.fd = m_FD;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if ( poll( &pfd, 1, static_cast<int>( timeoutMS ) ) > 0 )
+        {
+            Update();
+        }
+    }
+    return ( ( m_ChangedPaths.IsEmpty() == false ) || m_EventsLost );
+#else
+    // Changes are unknown
+    Thread::Sleep( timeoutMS );
+    return false;
+#endif
+}
+
+// GetChanges
+//------------------------------------------------------------------------------
+bool FileSystemWatcher::GetChanges( Array<AString> & outChangedPaths )
+{
+    Update();
+
+#if defined( __LINUX__ )
+    outChangedPaths.Swap( m_ChangedPaths );
+    m_ChangedPaths.Clear();
+    m_ChangedPathsSet.Destruct();
+#else
+    (void)outChangedPaths;
+#endif
+
+    const bool changesKnown = ( ( m_WatchesIncomplete == false ) && ( m_EventsLost == false ) );
+    m_EventsLost = false;
+    return changesKnown;
+}
+
+#if defined( __LINUX__ )
+// AddWatch
+//------------------------------------------------------------------------------
+bool FileSystemWatcher::AddWatch( const AString & path, bool recursive )
+{
+    const uint32_t mask = ( IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB |
+                            IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF |
+                            IN_ONLYDIR | IN_EXCL_UNLINK );
+    const int wd = inotify_add_watch( m_FD, path.Get(), mask );
+    if ( wd == -1 )
+    {
+        // Once the per-user limit is reached, changes can't be relied upon
+        if ( ( errno == ENOSPC ) || ( errno == ENOMEM ) )
+        {
+            m_WatchesIncomplete = true;
+        }
+        return false;
+    }
+
+    // The same directory can be added more than once, in which case the
+    // descriptor is the same
+    UnorderedMap<uint64_t, uint32_t>::KeyValue * existing = m_WatchesByDescriptor.Find( static_cast<uint64_t>( wd ) );
+    uint32_t index;
+    if ( existing && ( m_Watches[ existing->m_Value ].m_Path == path ) )
+    {
+        index = existing->m_Value;
+        if ( m_Watches[ index ].m_Active && ( m_Watches[ index ].m_Recursive || ( recursive == false ) ) )
+        {
+            return true; // Already watched
+        }
+    }
+    else
+    {
+        index = static_cast<uint32_t>( m_Watches.GetSize() );
+        m_Watches.EmplaceBack();
+        if ( existing )
+        {
+            existing->m_Value = index; // Descriptor of a removed watch was reused
+        }
+        else
+        {
+            m_WatchesByDescriptor.Insert( static_cast<uint64_t>( wd ), index );
+        }
+        UnorderedMap<AString, uint32_t>::KeyValue * existingPath = m_WatchesByPath.Find( path );
+        if ( existingPath )
+        {
+            existingPath->m_Value = index;
+        }
+        else
+        {
+            m_WatchesByPath.Insert( path, index );
+        }
+    }
+    m_Watches[ index ].m_Path = path;
+    m_Watches[ index ].m_Recursive = ( m_Watches[ index ].m_Recursive || recursive );
+    m_Watches[ index ].m_Active = true;
+
+    // Sub-directories (after the watch is added, so new ones aren't missed)
+    if ( recursive )
+    {
+        Array<AString> subDirs;
+        SubDirectoryLister lister( subDirs );
+        FileIO::GetFiles( path, lister );
+        for ( const AString & subDir : subDirs )
+        {
+            if ( ( AddWatch( subDir, true ) == false ) && FileIO::DirectoryExists( subDir ) )
+            {
+                m_WatchesIncomplete = true; // Changes in this sub-directory would be missed
+            }
+        }
+    }
+    return true;
+}
+
+// AddChange
+//------------------------------------------------------------------------------
+void FileSystemWatcher::AddChange( const AString & path )
+{
+    if ( m_ChangedPathsSet.Find( path ) )
+    {
+        return;
+    }
+    m_ChangedPathsSet.Insert( path, true );
+    m_ChangedPaths.EmplaceBack( path );
+}
+#endif
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,72 @@
+// FileSystemWatcher.h
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Containers/UnorderedMap.h"
+#include "Core/Env/Types.h"
+#include "Core/Strings/AString.h"
+
+// FileSystemWatcher - Notification of changes to files in a set of directories
+//  - Changes can be missed if the directories can't all be watched (there is a
+//    per-user limit), or if too many changes occur before they are collected.
+//    In both cases GetChanges reports that changes are unknown, and callers
+//    must check everything themselves.
+//  - Only implemented on Linux (with inotify). On other platforms, changes are
+//    always unknown.
+//------------------------------------------------------------------------------
+class FileSystemWatcher
+{
+public:
+    FileSystemWatcher();
+    ~FileSystemWatcher();
+
+    static bool IsSupported();
+
+    // Watch a directory (with trailing slash). If recursive, directories below
+    // it (including those created later) are watched too.
+    bool AddDirectory( const AString & path, bool recursive );
+    bool IsWatched( const AString & path );
+
+    // Collect pending notifications (without waiting). Notifications are
+    // queued by the OS in a limited buffer, so this should be called
+    // periodically if changes are not retrieved for a while.
+    void Update();
+
+    // Wait until there are changes to retrieve
+    bool WaitForChanges( uint32_t timeoutMS );
+
+    // Paths of files (and of directories, with trailing slash) changed since
+    // the previous call. Returns false if changes may have been missed.
+    bool GetChanges( Array<AString> & outChangedPaths );
+
+private:
+    FileSystemWatcher( const FileSystemWatcher & other ) = delete;
+    void operator=( const FileSystemWatcher & other ) = delete;
+
+#if defined( __LINUX__ )
+    bool AddWatch( const AString & path, bool recursive );
+    void AddChange( const AString & path );
+
+    class Watch
+    {
+    public:
+        AString m_Path; // With trailing slash
+        bool m_Recursive = false;
+        bool m_Active = false; // Directory was deleted (or moved) if not
+    };
+
+    int m_FD = -1;
+    Array<Watch> m_Watches;
+    UnorderedMap<uint64_t, uint32_t> m_WatchesByDescriptor; // Index in m_Watches
+    UnorderedMap<AString, uint32_t> m_WatchesByPath; // Index in m_Watches
+    Array<AString> m_ChangedPaths;
+    UnorderedMap<AString, bool> m_ChangedPathsSet; // To ignore repeated changes
+#endif
+    bool m_WatchesIncomplete = false; // A directory could not be watched
+    bool m_EventsLost = false; // Changes since the last call to GetChanges may be missing
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,129 @@
+// MemoryMappedFile
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "MemoryMappedFile.h"
+
+// Core
+#include "Core/Env/Assert.h"
+
+// system
+#if defined( __WINDOWS__ )
+    #include "Core/Env/WindowsHeader.h"
+#elif defined( __LINUX__ ) || defined( __APPLE__ )
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+MemoryMappedFile::MemoryMappedFile() = default;
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+MemoryMappedFile::~MemoryMappedFile()
+{
+    Close();
+}
+
+// Open
+//------------------------------------------------------------------------------
+bool MemoryMappedFile::Open( const char * fileName )
+{
+    ASSERT( IsOpen() == false );
+
+#if defined( __WINDOWS__ )
+    const HANDLE file = CreateFileA( fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+    if ( file == INVALID_HANDLE_VALUE )
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if ( GetFileSizeEx( file, &fileSize ) == FALSE )
+    {
+        CloseHandle( file );
+        return false;
+    }
+
+    // Empty files can't be mapped
+    if ( fileSize.QuadPart > 0 )
+    {
+        const HANDLE mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+        if ( mapping == nullptr )
+        {
+            CloseHandle( file );
+            return false;
+        }
+
+        // View remains valid after handles are closed
+        m_Memory = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+        CloseHandle( mapping );
+        if ( m_Memory == nullptr )
+        {
+            CloseHandle( file );
+            return false;
+        }
+    }
+    CloseHandle( file );
+    m_Size = static_cast<size_t>( fileSize.QuadPart );
+#elif defined( __LINUX__ ) || defined( __APPLE__ )
+    const int file = open( fileName, O_RDONLY | O_CLOEXEC );
+    if ( file == -1 )
+    {
+        return false;
+    }
+
+    struct stat st;
+    if ( fstat( file, &st ) != 0 )
+    {
+        close( file );
+        return false;
+    }
+
+    // Empty files can't be mapped
+    if ( st.st_size > 0 )
+    {
+        void * memory = mmap( nullptr, static_cast<size_t>( st.st_size ), PROT_READ, MAP_PRIVATE, file, 0 );
+        if ( memory == MAP_FAILED )
+        {
+            close( file );
+            return false;
+        }
+        m_Memory = memory;
+    }
+
+    // Mapping remains valid after file is closed
+    close( file );
+    m_Size = static_cast<size_t>( st.st_size );
+#else
+    #error Unknown Platform
+#endif
+
+    m_IsOpen = true;
+    return true;
+}
+
+// Close
+//------------------------------------------------------------------------------
+void MemoryMappedFile::Close()
+{
+    if ( m_Memory )
+    {
+#if defined( __WINDOWS__ )
+        VERIFY( UnmapViewOfFile( m_Memory ) );
+#elif defined( __LINUX__ ) || defined( __APPLE__ )
+        VERIFY( munmap( const_cast<void *>( m_Memory ), m_Size ) == 0 );
+#else
+    #error Unknown Platform
+#endif
+    }
+    m_Memory = nullptr;
+    m_Size = 0;
+    m_IsOpen = false;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,33 @@
+// MemoryMappedFile.h
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Env/Types.h"
+
+// MemoryMappedFile - read-only view of an entire file
+//------------------------------------------------------------------------------
+class MemoryMappedFile
+{
+public:
+    MemoryMappedFile();
+    ~MemoryMappedFile();
+
+    bool Open( const char * fileName );
+    void Close();
+
+    bool IsOpen() const { return m_IsOpen; }
+    const void * GetData() const { return m_Memory; }
+    size_t GetSize() const { return m_Size; }
+
+private:
+    MemoryMappedFile( const MemoryMappedFile & other ) = delete;
+    void operator=( const MemoryMappedFile & other ) = delete;
+
+    const void * m_Memory = nullptr; // nullptr if file is empty
+    size_t m_Size = 0;
+    bool m_IsOpen = false;
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,80 @@
+// GearHash - Rolling hash for content defined chunking
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "GearHash.h"
+
+// Core
+#include "Core/Env/Assert.h"
+
+// GearTable CONSTRUCTOR
+//------------------------------------------------------------------------------
+constexpr GearHash::GearTable::GearTable()
+    : m_Values()
+{
+    // Generated from a fixed seed (splitmix64)
+    uint64_t state = 0x464153544255494CULL;
+    for ( uint64_t & value : m_Values )
+    {
+        state += 0x9E3779B97F4A7C15ULL;
+        uint64_t z = state;
+        z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+        z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+        value = z ^ ( z >> 31 );
+    }
+}
+
+// FindChunkEnd
+//------------------------------------------------------------------------------
+/*static*/ size_t GearHash::FindChunkEnd( const void * data, size_t dataSize, size_t minSize, size_t avgSize, size_t maxSize )
+{
+    ASSERT( ( minSize < avgSize ) && ( avgSize < maxSize ) );
+    ASSERT( ( avgSize & ( avgSize - 1 ) ) == 0 ); // Power of 2
+
+    if ( dataSize <= minSize )
+    {
+        return dataSize;
+    }
+
+    // High bits of the rolling hash depend on the preceding 64 bytes only. A
+    // boundary is where they are all zero, requiring 2 more bits than would give
+    // the average size before it, and 2 fewer after it.
+    uint32_t avgBits = 0;
+    while ( ( static_cast<size_t>( 1 ) << avgBits ) < avgSize )
+    {
+        ++avgBits;
+    }
+    ASSERT( ( avgBits > 2 ) && ( avgBits < 62 ) );
+    const uint64_t maskBeforeAvg = ~( ~0ULL >> ( avgBits + 2 ) );
+    const uint64_t maskAfterAvg = ~( ~0ULL >> ( avgBits - 2 ) );
+
+    const uint8_t * bytes = static_cast<const uint8_t *>( data );
+    const size_t maxEnd = ( dataSize < maxSize ) ? dataSize : maxSize;
+    const size_t avgEnd = ( maxEnd < avgSize ) ? maxEnd : avgSize;
+    uint64_t hash = 0;
+    size_t i = minSize;
+    for ( ; i < avgEnd; ++i )
+    {
+        hash = Roll( hash, bytes[ i ] );
+        if ( ( hash & maskBeforeAvg ) == 0 )
+        {
+            return ( i + 1 );
+        }
+    }
+    for ( ; i < maxEnd; ++i )
+    {
+        hash = Roll( hash, bytes[ i ] );
+        if ( ( hash & maskAfterAvg ) == 0 )
+        {
+            return ( i + 1 );
+        }
+    }
+    return maxEnd;
+}
+
+// Static Data
+//------------------------------------------------------------------------------
+/*static*/ const GearHash::GearTable GearHash::s_GearTable; // Constant initialized
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,36 @@
+// GearHash - Rolling hash for content defined chunking
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Env/Types.h"
+
+// GearHash
+//  - Gear based rolling hash (as per FastCDC). Each byte shifts the hash, so
+//    the high bits depend on the preceding 64 bytes only.
+//  - Values are identical for all processes (and versions), so content is
+//    always split at the same points.
+//------------------------------------------------------------------------------
+class GearHash
+{
+public:
+    static uint64_t Roll( uint64_t hash, uint8_t byte ) { return ( hash << 1 ) + s_GearTable.m_Values[ byte ]; }
+
+    // Find the size of the content defined chunk at the start of data
+    //  - Boundaries are more likely after avgSize (a power of 2), which keeps
+    //    sizes close to the average while still being content defined
+    static size_t FindChunkEnd( const void * data, size_t dataSize, size_t minSize, size_t avgSize, size_t maxSize );
+
+private:
+    class GearTable
+    {
+    public:
+        constexpr GearTable();
+
+        uint64_t m_Values[ 256 ];
+    };
+    static const GearTable s_GearTable;
+};
+
+//------------------------------------------------------------------------------
@@ -8,6 +8,7 @@
 
 // Core
 #include "Core/Env/ErrorFormat.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Mem/Mem.h"
 #include "Core/Network/Network.h"
 #include "Core/Process/Atomic.h"
@@ -31,6 +32,11 @@
     #include <sys/socket.h>
     #include <sys/uio.h>
     #include <unistd.h>
+    #if defined( TCP_CONNECTION_POOL_USE_EPOLL )
+        #include <poll.h>
+        #include <sys/epoll.h>
+        #include <sys/eventfd.h>
+    #endif
     #define INVALID_SOCKET ( -1 )
     #define SOCKET_ERROR -1
 #else
@@ -127,6 +133,324 @@ protected:
     #define TCP_CONNECTION_POOL_PROFILE_SET_THREAD_NAME( threadType ) (void)0
 #endif
 
+#if defined( TCP_CONNECTION_POOL_USE_EPOLL )
+// TCPConnectionReactor
+//  - Services the connections of all pools on a small fixed number of threads
+//    instead of one thread per connection
+//  - Each connection belongs to a single reactor, so callbacks for a given
+//    connection never occur concurrently
+//  - Data which can't be sent without blocking is queued and flushed by the
+//    reactor when the socket becomes writable
+//------------------------------------------------------------------------------
+class TCPConnectionReactor
+{
+public:
+    // Reactors are shared by all pools, and exist while any pool does
+    static void AddPool();
+    static void RemovePool();
+
+    // Assign a new connection to a reactor
+    static void AddConnection( ConnectionInfo * ci );
+
+    // Wake reactor to process connection state changes
+    void Wake() const;
+
+    // Is the calling thread a reactor, in a callback for the given connection?
+    [[nodiscard]] static bool IsInCallback( const ConnectionInfo * ci ) { return ( s_CallbackConnection == ci ); }
+    static void SetCallbackConnection( const ConnectionInfo * ci ) { s_CallbackConnection = ci; }
+
+    // Senders block while this much is queued. Callbacks can't block (they
+    // may be needed for the remote end to make progress) so instead, reading
+    // from the connection is paused until the queue drains.
+    static const uint32_t kMaxQueuedSendBytes = ( 16 * 1024 * 1024 );
+
+    // Limit recv() calls for a connection per event, so a busy connection
+    // can't starve others (events are level triggered, so it will resume)
+    static const uint32_t kMaxReceivesPerEvent = 64;
+
+private:
+    TCPConnectionReactor();
+    ~TCPConnectionReactor();
+
+    static uint32_t ThreadWrapperFunction( void * data );
+    void ThreadFunction();
+    void AddNewConnections();
+    void UpdateConnections();
+
+    static const uint32_t kNumReactors = 4;
+    static const uint32_t kMaxEvents = 64;
+
+    int m_EpollFD;
+    int m_WakeFD;
+    Atomic<bool> m_Quit;
+    Thread m_Thread;
+    Mutex m_NewConnectionsMutex;
+    Array<ConnectionInfo *> m_NewConnections;
+    Array<ConnectionInfo *> m_Connections; // Only accessed by reactor thread
+
+    static Mutex s_Mutex;
+    static uint32_t s_NumPools;
+    static uint32_t s_NextReactor;
+    static TCPConnectionReactor * s_Reactors[ kNumReactors ];
+    static THREAD_LOCAL const ConnectionInfo * s_CallbackConnection;
+};
+/*static*/ Mutex TCPConnectionReactor::s_Mutex;
+/*static*/ uint32_t TCPConnectionReactor::s_NumPools = 0;
+/*static*/ uint32_t TCPConnectionReactor::s_NextReactor = 0;
+/*static*/ TCPConnectionReactor * TCPConnectionReactor::s_Reactors[ kNumReactors ] = { nullptr };
+/*static*/ THREAD_LOCAL const ConnectionInfo * TCPConnectionReactor::s_CallbackConnection = nullptr;
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+TCPConnectionReactor::TCPConnectionReactor()
+    : m_EpollFD( epoll_create1( EPOLL_CLOEXEC ) )
+    , m_WakeFD( eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK ) )
+    , m_Quit( false )
+{
+    VERIFY( m_EpollFD != -1 );
+    VERIFY( m_WakeFD != -1 );
+
+    // Wake events are identified by a null ptr
+    epoll_event event;
+    memset( &event, 0, sizeof( event ) );
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    VERIFY( epoll_ctl( m_EpollFD, EPOLL_CTL_ADD, m_WakeFD, &event ) == 0 );
+
+    m_Thread.Start( &ThreadWrapperFunction, "TCPReactor", this, ( 64 * KILOBYTE ) );
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+TCPConnectionReactor::~TCPConnectionReactor()
+{
+    m_Quit.Store( true );
+    Wake();
+    m_Thread.Join();
+
+    close( m_WakeFD );
+    close( m_EpollFD );
+}
+
+// AddPool
+//------------------------------------------------------------------------------
+/*static*/ void TCPConnectionReactor::AddPool()
+{
+    MutexHolder mh( s_Mutex );
+    ++s_NumPools;
+}
+
+// RemovePool
+//------------------------------------------------------------------------------
+/*static*/ void TCPConnectionReactor::RemovePool()
+{
+    MutexHolder mh( s_Mutex );
+    ASSERT( s_NumPools > 0 );
+    --s_NumPools;
+    if ( s_NumPools > 0 )
+    {
+        return;
+    }
+
+    // Last pool destroyed - stop threads
+    for ( TCPConnectionReactor *& reactor : s_Reactors )
+    {
+        FDELETE reactor;
+        reactor = nullptr;
+    }
+}
+
+// AddConnection
+//------------------------------------------------------------------------------
+/*static*/ void TCPConnectionReactor::AddConnection( ConnectionInfo * ci )
+{
+    TCPConnectionReactor * reactor;
+    {
+        MutexHolder mh( s_Mutex );
+        ASSERT( s_NumPools > 0 );
+
+        // Create reactors on first use
+        if ( s_Reactors[ 0 ] == nullptr )
+        {
+            for ( TCPConnectionReactor *& newReactor : s_Reactors )
+            {
+                newReactor = FNEW( TCPConnectionReactor() );
+            }
+        }
+
+        // Distribute connections evenly
+        reactor = s_Reactors[ s_NextReactor ];
+        s_NextReactor = ( s_NextReactor + 1 ) % kNumReactors;
+    }
+
+    ci->m_Reactor = reactor;
+    {
+        MutexHolder mh( reactor->m_NewConnectionsMutex );
+        reactor->m_NewConnections.Append( ci );
+    }
+    reactor->Wake();
+}
+
+// Wake
+//------------------------------------------------------------------------------
+void TCPConnectionReactor::Wake() const
+{
+    const uint64_t value = 1;
+    const ssize_t ret = write( m_WakeFD, &value, sizeof( value ) );
+    (void)ret; // Can only fail if counter is saturated, in which case a wake is pending anyway
+}
+
+// ThreadWrapperFunction
+//------------------------------------------------------------------------------
+/*static*/ uint32_t TCPConnectionReactor::ThreadWrapperFunction( void * data )
+{
+    TCP_CONNECTION_POOL_PROFILE_SET_THREAD_NAME( TCPConnectionPoolProfileHelper::THREAD_CONNECTION );
+    PROFILE_FUNCTION;
+
+    static_cast<TCPConnectionReactor *>( data )->ThreadFunction();
+    return 0;
+}
+
+// ThreadFunction
+//------------------------------------------------------------------------------
+void TCPConnectionReactor::ThreadFunction()
+{
+    epoll_event events[ kMaxEvents ];
+
+    while ( m_Quit.Load() == false )
+    {
+        // Wait for socket events or wake (the timeout is a safety net only)
+        const int num = epoll_wait( m_EpollFD, events, kMaxEvents, 100 );
+        for ( int i = 0; i < num; ++i )
+        {
+            ConnectionInfo * ci = static_cast<ConnectionInfo *>( events[ i ].data.ptr );
+            if ( ci == nullptr )
+            {
+                // Wake - state changes are handled below
+                uint64_t value;
+                const ssize_t ret = read( m_WakeFD, &value, sizeof( value ) );
+                (void)ret;
+                continue;
+            }
+
+            if ( ci->m_ThreadQuitNotification.Load() )
+            {
+                continue; // don't bother with pending data if closing
+            }
+
+            TCPConnectionPool * pool = ci->m_TCPConnectionPool;
+
+            // Writable - flush queued data (unless a sender is already doing so)
+            if ( events[ i ].events & EPOLLOUT )
+            {
+                TryMutexHolder tmh( ci->m_SendMutex );
+                if ( tmh.IsLocked() && ( pool->FlushSendQueue( ci ) == false ) )
+                {
+                    ci->m_ThreadQuitNotification.Store( true );
+                    continue;
+                }
+            }
+
+            // Readable (or closed/error, which is detected when reading)
+            if ( events[ i ].events & ( EPOLLIN | EPOLLHUP | EPOLLERR ) )
+            {
+                if ( pool->HandleReadAvailable( ci ) == false )
+                {
+                    ci->m_ThreadQuitNotification.Store( true );
+                }
+            }
+        }
+
+        AddNewConnections();
+        UpdateConnections();
+    }
+
+    // All pools must have been shut down
+    ASSERT( m_Connections.IsEmpty() );
+}
+
+// AddNewConnections
+//------------------------------------------------------------------------------
+void TCPConnectionReactor::AddNewConnections()
+{
+    Array<ConnectionInfo *> newConnections;
+    {
+        MutexHolder mh( m_NewConnectionsMutex );
+        newConnections.Swap( m_NewConnections );
+    }
+
+    for ( ConnectionInfo * ci : newConnections )
+    {
+        s_CallbackConnection = ci;
+        ci->m_TCPConnectionPool->OnConnected( ci ); // Do callback
+        s_CallbackConnection = nullptr;
+
+        epoll_event event;
+        memset( &event, 0, sizeof( event ) );
+        event.events = EPOLLIN;
+        event.data.ptr = ci;
+        if ( epoll_ctl( m_EpollFD, EPOLL_CTL_ADD, ci->m_Socket, &event ) == 0 )
+        {
+            ci->m_EpollEvents = EPOLLIN;
+        }
+        else
+        {
+            TCPDEBUG( "epoll_ctl(ADD) failed. Error: %s\n", ERROR_STR( errno ) );
+            ci->m_ThreadQuitNotification.Store( true );
+        }
+        m_Connections.Append( ci );
+    }
+}
+
+// UpdateConnections
+//------------------------------------------------------------------------------
+void TCPConnectionReactor::UpdateConnections()
+{
+    size_t index = 0;
+    while ( index < m_Connections.GetSize() )
+    {
+        ConnectionInfo * ci = m_Connections[ index ];
+
+        // Close connection?
+        if ( ci->m_ThreadQuitNotification.Load() )
+        {
+            if ( ci->m_EpollEvents != 0 )
+            {
+                epoll_event event; // Unused, but must be non-null on old kernels
+                VERIFY( epoll_ctl( m_EpollFD, EPOLL_CTL_DEL, ci->m_Socket, &event ) == 0 );
+                ci->m_EpollEvents = 0;
+            }
+            m_Connections.EraseIndex( index );
+            ci->m_TCPConnectionPool->CloseConnection( ci ); // NOTE: Frees ci
+            continue;
+        }
+
+        // Only watch for writability while there is queued data, and stop
+        // reading while too much is queued (replies would queue more)
+        uint32_t events = EPOLLIN;
+        if ( ci->m_SendQueueFull.Load() )
+        {
+            events = EPOLLOUT;
+        }
+        else if ( ci->m_SendQueuePending.Load() )
+        {
+            events = ( EPOLLIN | EPOLLOUT );
+        }
+        if ( events != ci->m_EpollEvents )
+        {
+            epoll_event event;
+            memset( &event, 0, sizeof( event ) );
+            event.events = events;
+            event.data.ptr = ci;
+            VERIFY( epoll_ctl( m_EpollFD, EPOLL_CTL_MOD, ci->m_Socket, &event ) == 0 );
+            ci->m_EpollEvents = events;
+        }
+
+        ++index;
+    }
+}
+#endif
+
 // CONSTRUCTOR - ConnectionInfo
 //------------------------------------------------------------------------------
 ConnectionInfo::ConnectionInfo( TCPConnectionPool * ownerPool )
@@ -147,6 +471,9 @@ TCPConnectionPool::TCPConnectionPool()
     , m_ShuttingDown( false )
 {
     m_Connections.SetCapacity( 8 );
+#if defined( TCP_CONNECTION_POOL_USE_EPOLL )
+    TCPConnectionReactor::AddPool();
+#endif
 }
 
 // DESTRUCTOR
@@ -158,6 +485,9 @@ TCPConnectionPool::~TCPConnectionPool()
     // By enforcing explicit shutdown, even when not strictly needed, we can
     // ensure no unsafe cases exist (and can assert below)
     ASSERT( AtomicLoadRelaxed( &m_ShuttingDown ) && "ShutdownAllConnections not called" );
+#if defined( TCP_CONNECTION_POOL_USE_EPOLL )
+    TCPConnectionReactor::RemovePool();
+#endif
 }
 
 // ShutdownAllConnections
@@ -464,6 +794,9 @@ void TCPConnectionPool::Disconnect( const ConnectionInfo * ci )
     if ( iter != nullptr )
     {
         ci->m_ThreadQuitNotification.Store( true );
+#if defined( TCP_CONNECTION_POOL_USE_EPOLL )
+        ci->m_Reactor->Wake();
+#endif
         return;
     }
 
@@ -531,6 +864,36 @@ bool TCPConnectionPool::Send( const ConnectionInfo * connection, const void * da
     return SendInternal( connection, buffers, 4, timeoutMS );
 }
 
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::Send( const ConnectionInfo * connection, const void * data, size_t size, const SendBuffer * payloadBuffers, uint32_t numPayloadBuffers, uint32_t timeoutMS )
+{
+    StackArray<SendBuffer> buffers; // size + data + payloadSize + payloadBuffers...
+    buffers.SetSize( 3 );
+
+    // size
+    const uint32_t sizeData = (uint32_t)size;
+    buffers[ 0 ].size = sizeof( sizeData );
+    buffers[ 0 ].data = &sizeData;
+
+    // data
+    buffers[ 1 ].size = (uint32_t)size;
+    buffers[ 1 ].data = data;
+
+    // payloadSize
+    uint32_t payloadSizeData = 0;
+    for ( uint32_t i = 0; i < numPayloadBuffers; ++i )
+    {
+        payloadSizeData += payloadBuffers[ i ].size;
+    }
+    buffers[ 2 ].size = sizeof( payloadSizeData );
+    buffers[ 2 ].data = &payloadSizeData;
+
+    // payloadData
+    buffers.Append( payloadBuffers, payloadBuffers + numPayloadBuffers );
+
+    return SendInternal( connection, buffers.Begin(), static_cast<uint32_t>( buffers.GetSize() ), timeoutMS );
+}
+
 // SendInternal
 //------------------------------------------------------------------------------
 bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const TCPConnectionPool::SendBuffer * buffers, uint32_t numBuffers, uint32_t timeoutMS )
@@ -545,11 +908,12 @@ bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const T
         return false;
     }
 
-    ASSERT( numBuffers <= 4 ); // Worst case = size + data + payloadSize + payload
+    // Buffers are sent in batches (payloads can be gathered from many buffers)
+    const uint32_t kMaxBuffersPerSend = 64;
 #if defined( __WINDOWS__ )
-    WSABUF sendBuffers[ 4 ];
+    WSABUF sendBuffers[ kMaxBuffersPerSend ];
 #else
-    struct iovec sendBuffers[ 4 ];
+    struct iovec sendBuffers[ kMaxBuffersPerSend ];
 #endif
 
     // Calculate total to send
@@ -566,15 +930,64 @@ bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const T
     connection->m_SendSocketInUseThreadId = Thread::GetCurrentThreadId();
 #endif
 
+#if defined( TCP_CONNECTION_POOL_USE_EPOLL )
+    // Serialize with flushing of queued data by the reactor
+    MutexHolder sendMH( connection->m_SendMutex );
+    if ( connection->m_Socket == INVALID_SOCKET )
+    {
+        // Closed by reactor since checked above
+    #if defined( ASSERTS_ENABLED )
+        connection->m_SendSocketInUseThreadId = INVALID_THREAD_ID;
+    #endif
+        return false;
+    }
+
+    // Callbacks for this connection must never block (the reactor may be
+    // needed for the remote end to make progress) so they queue anything which
+    // can't be sent, and the reactor stops reading if too much is queued
+    const bool canBlock = ( TCPConnectionReactor::IsInCallback( connection ) == false );
+#endif
+
     ASSERT( connection->m_Socket != INVALID_SOCKET );
 
     TCPDEBUG( "Send: %i (%x)\n", totalBytes, (uint32_t)( connection->m_Socket ) );
 
     bool sendOK = true;
+    bool queueRemaining = false;
+
+#if defined( TCP_CONNECTION_POOL_USE_EPOLL )
+    // Previously queued data must be sent first. If too much is queued, wait
+    // for it to drain before adding more.
+    while ( connection->m_SendQueuePending.Load() )
+    {
+        if ( FlushSendQueue( connection ) == false )
+        {
+            TCPDEBUG( "send() failed (Q). Error: %s (Socket: %x)\n", LAST_NETWORK_ERROR_STR, (uint32_t)( connection->m_Socket ) );
+            Disconnect( connection );
+            sendOK = false;
+            break;
+        }
+        const size_t queuedBytes = ( connection->m_SendQueue.GetSize() - connection->m_SendQueueOffset );
+        if ( queuedBytes == 0 )
+        {
+            break; // all flushed
+        }
+        if ( ( canBlock == false ) || ( ( queuedBytes + totalBytes ) <= TCPConnectionReactor::kMaxQueuedSendBytes ) )
+        {
+            queueRemaining = true;
+            break;
+        }
+        if ( WaitForWritable( connection, timer, timeoutMS ) == false )
+        {
+            sendOK = false;
+            break;
+        }
+    }
+#endif
 
     // Repeat until all bytes sent
     uint32_t bytesSent = 0;
-    while ( bytesSent < totalBytes )
+    while ( sendOK && ( queueRemaining == false ) && ( bytesSent < totalBytes ) )
     {
         // Fill buffers for any unsent data
         uint32_t numSendBuffers( 0 );
@@ -582,7 +995,7 @@ bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const T
         for ( uint32_t i = 0; i < numBuffers; ++i )
         {
             const uint32_t overlap = bytesSent > offset ? ( bytesSent - offset ) : 0;
-            if ( overlap < buffers[ i ].size )
+            if ( ( overlap < buffers[ i ].size ) && ( numSendBuffers < kMaxBuffersPerSend ) )
             {
                 // add remaining data for this buffer
                 const uint32_t remainder = ( buffers[ i ].size - overlap );
@@ -612,6 +1025,22 @@ bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const T
         {
             if ( WouldBlock() )
             {
+#if defined( TCP_CONNECTION_POOL_USE_EPOLL )
+                // Queue the remainder if it's small enough (or we can't block)
+                if ( ( canBlock == false ) || ( ( totalBytes - bytesSent ) <= TCPConnectionReactor::kMaxQueuedSendBytes ) )
+                {
+                    queueRemaining = true;
+                    break;
+                }
+
+                // Wait until socket can accept more data
+                if ( WaitForWritable( connection, timer, timeoutMS ) == false )
+                {
+                    sendOK = false;
+                    break;
+                }
+                continue;
+#else
                 if ( connection->m_ThreadQuitNotification.Load() || AtomicLoadRelaxed( &m_ShuttingDown ) )
                 {
                     sendOK = false;
@@ -627,6 +1056,7 @@ bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const T
 
                 Thread::Sleep( 1 );
                 continue;
+#endif
             }
             // error
             TCPDEBUG( "send() failed (A). Error: %s (Sent: %u, Socket: %x)\n", LAST_NETWORK_ERROR_STR, sent, (uint32_t)( connection->m_Socket ) );
@@ -637,12 +1067,145 @@ bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const T
         bytesSent += sent;
     }
 
+#if defined( TCP_CONNECTION_POOL_USE_EPOLL )
+    // Hand off anything unsent to the reactor
+    if ( sendOK && queueRemaining )
+    {
+        QueueSendData( connection, buffers, numBuffers, bytesSent );
+        connection->m_Reactor->Wake();
+    }
+#endif
+
 #if defined( ASSERTS_ENABLED )
     connection->m_SendSocketInUseThreadId = INVALID_THREAD_ID;
 #endif
     return sendOK;
 }
 
+#if defined( TCP_CONNECTION_POOL_USE_EPOLL )
+// WaitForWritable
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::WaitForWritable( const ConnectionInfo * connection, const Timer & timer, uint32_t timeoutMS )
+{
+    PROFILE_FUNCTION;
+
+    for ( ;; )
+    {
+        if ( connection->m_ThreadQuitNotification.Load() || AtomicLoadRelaxed( &m_ShuttingDown ) )
+        {
+            return false;
+        }
+
+        if ( timer.GetElapsedMS() > (float)timeoutMS )
+        {
+            Disconnect( connection );
+            return false;
+        }
+
+        // Wake periodically to check for quit and timeout
+        pollfd fd;
+        fd.fd = connection->m_Socket;
+        fd.events = POLLOUT;
+        fd.revents = 0;
+        const int ret = poll( &fd, 1, 10 );
+        if ( ret > 0 )
+        {
+            return true; // writable (or an error, which the caller will see when writing)
+        }
+        if ( ( ret < 0 ) && ( errno != EINTR ) )
+        {
+            TCPDEBUG( "poll() failed. Error: %s (Socket: %x)\n", LAST_NETWORK_ERROR_STR, (uint32_t)( connection->m_Socket ) );
+            Disconnect( connection );
+            return false;
+        }
+    }
+}
+
+// FlushSendQueue
+//  - Send as much queued data as possible without blocking (m_SendMutex must be held)
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::FlushSendQueue( const ConnectionInfo * connection ) const
+{
+    PROFILE_FUNCTION;
+
+    Array<uint8_t> & queue = connection->m_SendQueue;
+    while ( connection->m_SendQueueOffset < queue.GetSize() )
+    {
+        const ssize_t sent = send( connection->m_Socket,
+                                   queue.Begin() + connection->m_SendQueueOffset,
+                                   queue.GetSize() - connection->m_SendQueueOffset,
+                                   0 );
+        if ( sent <= 0 )
+        {
+            if ( ( sent < 0 ) && WouldBlock() )
+            {
+                // try again when writable
+                const size_t queuedBytes = ( queue.GetSize() - connection->m_SendQueueOffset );
+                connection->m_SendQueueFull.Store( queuedBytes > TCPConnectionReactor::kMaxQueuedSendBytes );
+                return true;
+            }
+            return false;
+        }
+        connection->m_SendQueueOffset += static_cast<size_t>( sent );
+    }
+
+    // Everything sent
+    queue.Clear();
+    connection->m_SendQueueOffset = 0;
+    connection->m_SendQueueFull.Store( false );
+    connection->m_SendQueuePending.Store( false );
+    return true;
+}
+
+// QueueSendData
+//  - Append unsent part of buffers to the send queue (m_SendMutex must be held)
+//------------------------------------------------------------------------------
+void TCPConnectionPool::QueueSendData( const ConnectionInfo * connection, const SendBuffer * buffers, uint32_t numBuffers, uint32_t bytesSent ) const
+{
+    Array<uint8_t> & queue = connection->m_SendQueue;
+
+    // Discard data which has already been flushed
+    if ( connection->m_SendQueueOffset > 0 )
+    {
+        const size_t queuedBytes = ( queue.GetSize() - connection->m_SendQueueOffset );
+        memmove( queue.Begin(), queue.Begin() + connection->m_SendQueueOffset, queuedBytes );
+        queue.SetSize( queuedBytes );
+        connection->m_SendQueueOffset = 0;
+    }
+
+    // Grow geometrically to avoid repeated re-allocation
+    uint32_t totalBytes = 0;
+    for ( uint32_t i = 0; i < numBuffers; ++i )
+    {
+        totalBytes += buffers[ i ].size;
+    }
+    const size_t requiredSize = ( queue.GetSize() + ( totalBytes - bytesSent ) );
+    if ( requiredSize > queue.GetCapacity() )
+    {
+        queue.SetCapacity( Math::Max( requiredSize, queue.GetCapacity() * 2 ) );
+    }
+
+    // Append remainder of each buffer
+    uint32_t offset = 0;
+    for ( uint32_t i = 0; i < numBuffers; ++i )
+    {
+        const uint32_t overlap = bytesSent > offset ? Math::Min( bytesSent - offset, buffers[ i ].size ) : 0;
+        const uint32_t remainder = ( buffers[ i ].size - overlap );
+        if ( remainder > 0 )
+        {
+            const size_t oldSize = queue.GetSize();
+            queue.SetSize( oldSize + remainder );
+            memcpy( queue.Begin() + oldSize, static_cast<const uint8_t *>( buffers[ i ].data ) + overlap, remainder );
+        }
+        offset += buffers[ i ].size;
+    }
+    ASSERT( queue.GetSize() == requiredSize );
+
+    connection->m_SendQueuePending.Store( true );
+    connection->m_SendQueueFull.Store( requiredSize > TCPConnectionReactor::kMaxQueuedSendBytes );
+}
+#endif
+
 // Broadcast
 //------------------------------------------------------------------------------
 bool TCPConnectionPool::Broadcast( const void * data, size_t size )
@@ -754,6 +1317,142 @@ bool TCPConnectionPool::HandleRead( ConnectionInfo * ci )
     return true;
 }
 
+#if defined( TCP_CONNECTION_POOL_USE_EPOLL )
+// HandleReadAvailable
+//  - Receive whatever data is available without blocking, dispatching any
+//    messages which are completed
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::HandleReadAvailable( ConnectionInfo * ci )
+{
+    PROFILE_FUNCTION;
+
+    for ( uint32_t i = 0; i < TCPConnectionReactor::kMaxReceivesPerEvent; ++i )
+    {
+        // work out how many bytes there are
+        if ( ci->m_ReceiveSizeBytes < sizeof( ci->m_ReceiveSize ) )
+        {
+            const ssize_t numBytes = recv( ci->m_Socket,
+                                           reinterpret_cast<char *>( &ci->m_ReceiveSize ) + ci->m_ReceiveSizeBytes,
+                                           sizeof( ci->m_ReceiveSize ) - ci->m_ReceiveSizeBytes,
+                                           0 );
+            if ( numBytes <= 0 )
+            {
+                if ( ( numBytes < 0 ) && WouldBlock() )
+                {
+                    return true; // wait for more data
+                }
+                TCPDEBUG( "recv() failed (A). Error: %s (Read: %i, Socket: %x)\n", LAST_NETWORK_ERROR_STR, (int)numBytes, (uint32_t)( ci->m_Socket ) );
+                return false;
+            }
+            ci->m_ReceiveSizeBytes += static_cast<uint32_t>( numBytes );
+            if ( ci->m_ReceiveSizeBytes < sizeof( ci->m_ReceiveSize ) )
+            {
+                continue;
+            }
+
+            TCPDEBUG( "Handle read: %i (%x)\n", ci->m_ReceiveSize, (uint32_t)( ci->m_Socket ) );
+
+            // get output location
+            ci->m_ReceiveBuffer = AllocBuffer( ci->m_ReceiveSize );
+            ASSERT( ci->m_ReceiveBuffer );
+            ci->m_ReceiveBytes = 0;
+        }
+
+        // read data into the user supplied buffer
+        if ( ci->m_ReceiveBytes < ci->m_ReceiveSize )
+        {
+            const ssize_t numBytes = recv( ci->m_Socket,
+                                           static_cast<char *>( ci->m_ReceiveBuffer ) + ci->m_ReceiveBytes,
+                                           ci->m_ReceiveSize - ci->m_ReceiveBytes,
+                                           0 );
+            if ( numBytes <= 0 )
+            {
+                if ( ( numBytes < 0 ) && WouldBlock() )
+                {
+                    return true; // wait for more data
+                }
+                TCPDEBUG( "recv() failed (B). Error: %s (Read: %i, Socket: %x)\n", LAST_NETWORK_ERROR_STR, (int)numBytes, (uint32_t)( ci->m_Socket ) );
+                return false;
+            }
+            ci->m_ReceiveBytes += static_cast<uint32_t>( numBytes );
+            if ( ci->m_ReceiveBytes < ci->m_ReceiveSize )
+            {
+                continue;
+            }
+        }
+
+        // message complete - reset for the next one
+        void * buffer = ci->m_ReceiveBuffer;
+        const uint32_t size = ci->m_ReceiveSize;
+        ci->m_ReceiveBuffer = nullptr;
+        ci->m_ReceiveSize = 0;
+        ci->m_ReceiveSizeBytes = 0;
+        ci->m_ReceiveBytes = 0;
+
+        // tell user the data is in their buffer
+        bool keepMemory = false;
+        TCPConnectionReactor::SetCallbackConnection( ci );
+        OnReceive( ci, buffer, size, keepMemory );
+        TCPConnectionReactor::SetCallbackConnection( nullptr );
+        if ( !keepMemory )
+        {
+            FreeBuffer( buffer );
+        }
+
+        if ( ci->m_ThreadQuitNotification.Load() )
+        {
+            return true; // don't process further messages if closing
+        }
+        if ( ci->m_SendQueueFull.Load() )
+        {
+            return true; // don't process further messages until replies are sent
+        }
+    }
+
+    return true; // more data may be available, but let other connections progress
+}
+
+// CloseConnection
+//------------------------------------------------------------------------------
+void TCPConnectionPool::CloseConnection( ConnectionInfo * ci )
+{
+    OnDisconnected( ci ); // Do callback
+
+    // close the socket, waiting for any in-progress Send to notice the
+    // connection is closing and abort
+    {
+        MutexHolder sendMH( ci->m_SendMutex );
+        CloseSocket( ci->m_Socket );
+        ci->m_Socket = INVALID_SOCKET;
+        ci->m_SendQueue.Destruct();
+        ci->m_SendQueueOffset = 0;
+        ci->m_SendQueueFull.Store( false );
+        ci->m_SendQueuePending.Store( false );
+    }
+
+    // free partially received message
+    if ( ci->m_ReceiveBuffer )
+    {
+        FreeBuffer( ci->m_ReceiveBuffer );
+        ci->m_ReceiveBuffer = nullptr;
+    }
+
+    {
+        MutexHolder mh( m_ConnectionsMutex );
+        ConnectionInfo ** iter = m_Connections.Find( ci );
+        ASSERT( iter );
+        m_Connections.Erase( iter );
+        FDELETE ci;
+        if ( AtomicLoadRelaxed( &m_ShuttingDown ) )
+        {
+            m_ShutdownSemaphore.Signal(); // Wake main thread which will be waiting on shutdown
+        }
+    }
+
+    TCPDEBUG( "connection closed\n" );
+}
+#endif
+
 // GetLastNetworkError
 //------------------------------------------------------------------------------
 int TCPConnectionPool::GetLastNetworkError() const
@@ -1041,12 +1740,17 @@ ConnectionInfo * TCPConnectionPool::CreateConnectionThread( TCPSocket socket, ui
     TCPDEBUG( "Connected to %s : %i (%x)\n", addr.Get(), port, (uint32_t)socket );
 #endif
 
+    m_Connections.Append( ci );
+
+#if defined( TCP_CONNECTION_POOL_USE_EPOLL )
+    // Hand socket to a reactor thread
+    TCPConnectionReactor::AddConnection( ci );
+#else
     // Spawn thread to handle socket
     Thread thread;
     thread.Start( &ConnectionThreadWrapperFunction, "TCPConnection", ci );
     thread.Detach(); // TODO:B Remove use of this unsafe API
-
-    m_Connections.Append( ci );
+#endif
 
     return ci;
 }
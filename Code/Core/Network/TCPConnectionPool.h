@@ -14,9 +14,20 @@
 #include "Core/Process/Thread.h"
 #include "Core/Strings/AString.h"
 
+// Defines
+//------------------------------------------------------------------------------
+#if defined( __LINUX__ )
+    // Connections are serviced by a small, shared set of epoll threads
+    #define TCP_CONNECTION_POOL_USE_EPOLL
+#endif
+
 // Forward Declarations
 //------------------------------------------------------------------------------
 class TCPConnectionPool;
+class Timer;
+#if defined( TCP_CONNECTION_POOL_USE_EPOLL )
+class TCPConnectionReactor;
+#endif
 
 #if defined( __WINDOWS__ )
 typedef uintptr_t TCPSocket;
@@ -49,6 +60,9 @@ public:
 
 private:
     friend class TCPConnectionPool;
+#if defined( TCP_CONNECTION_POOL_USE_EPOLL )
+    friend class TCPConnectionReactor;
+#endif
 
     TCPSocket m_Socket;
     uint32_t m_RemoteAddress;
@@ -61,6 +75,25 @@ private:
     // sanity check we aren't sending from multiple threads unsafely
     mutable Thread::ThreadId m_SendSocketInUseThreadId = INVALID_THREAD_ID;
 #endif
+
+#if defined( TCP_CONNECTION_POOL_USE_EPOLL )
+    // reactor servicing this connection
+    TCPConnectionReactor * m_Reactor = nullptr;
+    uint32_t m_EpollEvents = 0; // events currently registered (owned by reactor thread)
+
+    // partially received message (owned by reactor thread)
+    uint32_t m_ReceiveSize = 0;
+    uint32_t m_ReceiveSizeBytes = 0; // bytes of size received so far
+    uint32_t m_ReceiveBytes = 0; // bytes of message received so far
+    void * m_ReceiveBuffer = nullptr;
+
+    // data which could not be sent without blocking, flushed by the reactor
+    mutable Mutex m_SendMutex;
+    mutable Array<uint8_t> m_SendQueue;
+    mutable size_t m_SendQueueOffset = 0;
+    mutable Atomic<bool> m_SendQueuePending;
+    mutable Atomic<bool> m_SendQueueFull; // reading is paused while set
+#endif
 };
 
 // TCPConnectionPool
@@ -102,12 +135,27 @@ public:
                const void * payloadData,
                size_t payloadSize,
                uint32_t timeoutMS = kDefaultSendTimeoutMS );
+    struct SendBuffer
+    {
+        uint32_t size;
+        const void * data;
+    };
+    bool Send( const ConnectionInfo * connection,
+               const void * data,
+               size_t size,
+               const SendBuffer * payloadBuffers, // payload gathered from several buffers (without copying)
+               uint32_t numPayloadBuffers,
+               uint32_t timeoutMS = kDefaultSendTimeoutMS );
     bool Broadcast( const void * data, size_t size );
 
     static void GetAddressAsString( uint32_t addr, AString & address );
 
 protected:
     // network events - NOTE: these happen in another thread! (but never at the same time)
+    // With TCP_CONNECTION_POOL_USE_EPOLL, the thread is shared with other connections,
+    // so handlers must not block: no waiting on other threads or long running work.
+    // Sends to the connection being handled never block (reading is paused instead if
+    // too much is queued), but sends to other connections can.
     virtual void OnReceive( const ConnectionInfo *, void * /*data*/, uint32_t /*size*/, bool & /*keepMemory*/ )
     {
     }
@@ -119,6 +167,10 @@ protected:
     virtual void FreeBuffer( void * data );
 
 private:
+#if defined( TCP_CONNECTION_POOL_USE_EPOLL )
+    friend class TCPConnectionReactor;
+#endif
+
     // helper functions
     bool HandleRead( ConnectionInfo * ci );
 
@@ -137,13 +189,17 @@ private:
     TCPSocket CreateSocket() const;
     void FDSet( TCPSocket fd, void * set ) const;
 
-    struct SendBuffer
-    {
-        uint32_t size;
-        const void * data;
-    };
     bool SendInternal( const ConnectionInfo * connection, const SendBuffer * buffers, uint32_t numBuffers, uint32_t timeoutMS );
 
+#if defined( TCP_CONNECTION_POOL_USE_EPOLL )
+    // reactor helpers
+    bool HandleReadAvailable( ConnectionInfo * ci );
+    bool WaitForWritable( const ConnectionInfo * connection, const Timer & timer, uint32_t timeoutMS );
+    bool FlushSendQueue( const ConnectionInfo * connection ) const;
+    void QueueSendData( const ConnectionInfo * connection, const SendBuffer * buffers, uint32_t numBuffers, uint32_t bytesSent ) const;
+    void CloseConnection( ConnectionInfo * ci );
+#endif
+
     // thread management
     void CreateListenThread( TCPSocket socket, uint32_t host, uint16_t port );
     static uint32_t ListenThreadWrapperFunction( void * data );
@@ -98,6 +98,10 @@ template <typename T> inline T AtomicAdd( volatile T * x, T value )
 template <typename T> inline T AtomicSub( volatile T * x, T value )
 {
     return __sync_sub_and_fetch( x, value );
+}
+template <typename T> inline bool AtomicCompareExchange( volatile T * x, T comparand, T newValue )
+{
+    return __sync_bool_compare_and_swap( x, comparand, newValue );
 }
     #if defined( __WINDOWS__ )
 PRAGMA_DISABLE_POP_CLANG
@@ -165,6 +169,20 @@ IMPLEMENT_FUNCTIONS( uint64_t, __int64, _InterlockedIncrement64, _InterlockedDec
 IMPLEMENT_FUNCTIONS( int64_t, __int64, _InterlockedIncrement64, _InterlockedDecrement64, XInterlockedAdd64 );
 
     #undef IMPLEMENT_FUNCTIONS
+
+    // Compare and exchange (returns true if the exchange was made)
+    #define IMPLEMENT_FUNCTIONS( T, U, CASFUNC ) \
+        inline bool AtomicCompareExchange( volatile T * x, T comparand, T newValue ) \
+        { \
+            return ( CASFUNC( reinterpret_cast<volatile U *>( x ), static_cast<U>( newValue ), static_cast<U>( comparand ) ) == static_cast<U>( comparand ) ); \
+        }
+
+IMPLEMENT_FUNCTIONS( uint32_t, long, _InterlockedCompareExchange );
+IMPLEMENT_FUNCTIONS( int32_t, long, _InterlockedCompareExchange );
+IMPLEMENT_FUNCTIONS( uint64_t, __int64, _InterlockedCompareExchange64 );
+IMPLEMENT_FUNCTIONS( int64_t, __int64, _InterlockedCompareExchange64 );
+
+    #undef IMPLEMENT_FUNCTIONS
 #endif
 
 // AtomicLoadRelaxed
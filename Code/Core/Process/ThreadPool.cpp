@@ -6,6 +6,7 @@
 #include "ThreadPool.h"
 
 // Core
+#include "Core/Math/Conversions.h"
 #include "Core/Process/Thread.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
@@ -63,6 +64,74 @@ void ThreadPool::EnqueueJob( ThreadJobFunc func, void * userData )
     m_WakeSemaphore.Signal();
 }
 
+// ParallelForContext
+//------------------------------------------------------------------------------
+class ParallelForContext
+{
+public:
+    // Consume batches until there are none left
+    void Process()
+    {
+        for ( ;; )
+        {
+            const uint32_t end = AtomicAdd( &m_NextItem, m_BatchSize );
+            const uint32_t begin = ( end - m_BatchSize );
+            if ( begin >= m_Count )
+            {
+                return;
+            }
+            m_Function( begin, Math::Min( end, m_Count ), m_UserData );
+        }
+    }
+
+    // Process on ThreadPool thread
+    static void ThreadFunc( void * userData )
+    {
+        ParallelForContext * context = static_cast<ParallelForContext *>( userData );
+        context->Process();
+        context->m_ThreadCompleted.Signal();
+    }
+
+    ThreadPool::ParallelForFunc m_Function = nullptr;
+    void * m_UserData = nullptr;
+    uint32_t m_Count = 0;
+    uint32_t m_BatchSize = 0;
+    volatile uint32_t m_NextItem = 0;
+    Semaphore m_ThreadCompleted;
+};
+
+// ParallelFor
+//------------------------------------------------------------------------------
+void ThreadPool::ParallelFor( uint32_t count, uint32_t batchSize, ParallelForFunc func, void * userData )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( batchSize > 0 );
+
+    ParallelForContext context;
+    context.m_Function = func;
+    context.m_UserData = userData;
+    context.m_Count = count;
+    context.m_BatchSize = batchSize;
+
+    // Calling thread takes one batch, so only use pool threads for the rest
+    const uint32_t numBatches = ( ( count + batchSize - 1 ) / batchSize );
+    const uint32_t numJobs = Math::Min( m_NumThreads, ( numBatches > 0 ) ? ( numBatches - 1 ) : 0 );
+    for ( uint32_t i = 0; i < numJobs; ++i )
+    {
+        EnqueueJob( ParallelForContext::ThreadFunc, &context );
+    }
+
+    // Participate
+    context.Process();
+
+    // Wait for pool threads
+    for ( uint32_t i = 0; i < numJobs; ++i )
+    {
+        context.m_ThreadCompleted.Wait();
+    }
+}
+
 // ThreadFuncWrapper
 //------------------------------------------------------------------------------
 /*static*/ uint32_t ThreadPool::ThreadFuncWrapper( void * userData )
@@ -24,6 +24,12 @@ public:
     using ThreadJobFunc = void ( * )( void * param );
     void EnqueueJob( ThreadJobFunc func, void * userData = nullptr );
 
+    // Process items [0, count) in batches, spread over the pool and the
+    // calling thread. Blocks until all items are processed. The pool must
+    // not be occupied by long-running jobs.
+    using ParallelForFunc = void ( * )( uint32_t begin, uint32_t end, void * userData );
+    void ParallelFor( uint32_t count, uint32_t batchSize, ParallelForFunc func, void * userData = nullptr );
+
     uint32_t GetNumThreads() const { return m_NumThreads; }
 
 protected:
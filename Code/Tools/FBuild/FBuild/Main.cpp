@@ -57,13 +57,20 @@ struct SharedData
 // Global
 //------------------------------------------------------------------------------
 SharedMemory g_SharedMemory;
+bool g_WatchReloadRequired = false; // -watch: bff files changed
 
 // main
 //------------------------------------------------------------------------------
 int main( int argc, char * argv[] )
 {
     // This wrapper is purely for profiling scope
-    const int result = Main( argc, argv );
+    // (and to restart with a new configuration in -watch mode)
+    int result;
+    do
+    {
+        g_WatchReloadRequired = false;
+        result = Main( argc, argv );
+    } while ( g_WatchReloadRequired );
     PROFILE_SYNCHRONIZE; // make sure no tags are active and do one final sync
     return result;
 }
@@ -206,6 +213,10 @@ int Main( int argc, char * argv[] )
     {
         result = fBuild.GenerateCompilationDatabase( options.m_Targets );
     }
+    else if ( options.m_CacheIndex )
+    {
+        result = fBuild.CacheBuildIndex();
+    }
     else if ( options.m_CacheInfo )
     {
         result = fBuild.CacheOutputInfo();
@@ -217,6 +228,12 @@ int Main( int argc, char * argv[] )
     else
     {
         result = fBuild.Build( options.m_Targets );
+
+        // Stay resident, building again as files change
+        if ( options.m_WatchMode )
+        {
+            result = fBuild.Watch( options.m_Targets, result, g_WatchReloadRequired );
+        }
     }
 
     // Build Profiling enabled?
@@ -8,6 +8,8 @@
 // Core
 #include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/ThreadPool.h"
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
@@ -58,16 +60,57 @@ void BFFFileExists::Load( ConstMemoryStream & stream )
     VERIFY( stream.Read( m_FileExists ) );
 }
 
+// CheckForChangesContext
+//------------------------------------------------------------------------------
+class CheckForChangesContext
+{
+public:
+    enum Result : uint8_t
+    {
+        eNotChecked, // Skipped as a change was already found
+        eUnchanged,
+        eChanged,
+    };
+
+    static void CheckRange( uint32_t begin, uint32_t end, void * userData );
+
+    const Array<AString> * m_FileNames = nullptr;
+    const Array<bool> * m_FileExists = nullptr;
+    Array<Result> m_Results;
+    volatile bool m_FoundChange = false; // Allows other checks to early out
+};
+
 // CheckForChanges
 //------------------------------------------------------------------------------
-const AString * BFFFileExists::CheckForChanges( bool & outAdded ) const
+const AString * BFFFileExists::CheckForChanges( ThreadPool * threadPool, bool & outAdded ) const
 {
-    for ( size_t i = 0; i < m_FileNames.GetSize(); ++i )
+    const uint32_t numFiles = static_cast<uint32_t>( m_FileNames.GetSize() );
+
+    CheckForChangesContext context;
+    context.m_FileNames = &m_FileNames;
+    context.m_FileExists = &m_FileExists;
+    context.m_Results.SetSize( numFiles );
+    for ( CheckForChangesContext::Result & result : context.m_Results )
     {
-        const bool exists = FileIO::FileExists( m_FileNames[ i ].Get() );
-        if ( exists != m_FileExists[ i ] )
+        result = CheckForChangesContext::eNotChecked;
+    }
+
+    // Check files in parallel if there is a ThreadPool
+    if ( threadPool )
+    {
+        threadPool->ParallelFor( numFiles, 8, CheckForChangesContext::CheckRange, &context );
+    }
+    else
+    {
+        CheckForChangesContext::CheckRange( 0, numFiles, &context );
+    }
+
+    // Report first change in order so result is deterministic
+    for ( uint32_t i = 0; i < numFiles; ++i )
+    {
+        if ( context.m_Results[ i ] == CheckForChangesContext::eChanged )
         {
-            outAdded = exists;
+            outAdded = ( m_FileExists[ i ] == false );
             return &m_FileNames[ i ];
         }
     }
@@ -76,4 +119,29 @@ const AString * BFFFileExists::CheckForChanges( bool & outAdded ) const
     return nullptr;
 }
 
+// CheckForChangesContext::CheckRange
+//------------------------------------------------------------------------------
+/*static*/ void CheckForChangesContext::CheckRange( uint32_t begin, uint32_t end, void * userData )
+{
+    CheckForChangesContext & context = *static_cast<CheckForChangesContext *>( userData );
+
+    for ( uint32_t i = begin; i < end; ++i )
+    {
+        // Stop checking once any change is found
+        if ( AtomicLoadRelaxed( &context.m_FoundChange ) )
+        {
+            return;
+        }
+
+        const bool exists = FileIO::FileExists( ( *context.m_FileNames )[ i ].Get() );
+        if ( exists != ( *context.m_FileExists )[ i ] )
+        {
+            context.m_Results[ i ] = eChanged;
+            AtomicStoreRelaxed( &context.m_FoundChange, true );
+            continue;
+        }
+        context.m_Results[ i ] = eUnchanged;
+    }
+}
+
 //------------------------------------------------------------------------------
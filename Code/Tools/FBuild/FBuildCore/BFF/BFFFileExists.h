@@ -14,6 +14,7 @@
 class AString;
 class ConstMemoryStream;
 class IOStream;
+class ThreadPool;
 
 // BFFFileExists
 //------------------------------------------------------------------------------
@@ -29,7 +30,7 @@ public:
 
     // When loading an existing DB, we check if anything changed
     void Load( ConstMemoryStream & stream );
-    const AString * CheckForChanges( bool & outAdded ) const;
+    const AString * CheckForChanges( ThreadPool * threadPool, bool & outAdded ) const;
 
 private:
     Array<AString> m_FileNames;
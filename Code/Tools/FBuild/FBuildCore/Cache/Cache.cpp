@@ -6,12 +6,17 @@
 #include "Cache.h"
 
 // FBuild
+#include "Tools/FBuild/FBuildCore/Cache/CacheLockFile.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
 
 // Core
+#include "Core/Containers/Move.h"
 #include "Core/Containers/UniquePtr.h"
+#include "Core/Containers/UnorderedMap.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryMappedFile.h"
+#include "Core/FileIO/MemoryStream.h"
 #include "Core/FileIO/PathUtils.h"
 #include "Core/Mem/Mem.h"
 #include "Core/Profile/Profile.h"
@@ -20,6 +25,25 @@
 #include "Core/Time/Timer.h"
 #include "Core/Tracing/Tracing.h"
 
+// system
+#include <string.h> // for memcpy
+
+// Defines
+//------------------------------------------------------------------------------
+namespace
+{
+    // Entries at least this big are memory mapped when retrieved. Smaller entries
+    // are cheaper to read than to map and unmap.
+    const uint64_t kMinMappedEntrySize = ( 256 * 1024 );
+
+    // GetChunkKey
+    //--------------------------------------------------------------------------
+    uint64_t GetChunkKey( const CacheIndex::Chunk & chunk )
+    {
+        return ( chunk.m_Hash ^ ( static_cast<uint64_t>( chunk.m_Size ) * 0x9E3779B97F4A7C15ULL ) );
+    }
+}
+
 // CacheStats
 //------------------------------------------------------------------------------
 class CacheStats
@@ -29,24 +53,21 @@ public:
     uint64_t m_NumBytes = 0;
 };
 
-// OldestFileTimeSorter
-//------------------------------------------------------------------------------
-class OldestFileTimeSorter
-{
-public:
-    bool operator()( const FileIO::FileInfo & a, const FileIO::FileInfo & b ) const
-    {
-        return ( a.m_LastWriteTime < b.m_LastWriteTime );
-    }
-};
-
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 /*explicit*/ Cache::Cache() = default;
 
 // DESTRUCTOR
 //------------------------------------------------------------------------------
-/*virtual*/ Cache::~Cache() = default;
+/*virtual*/ Cache::~Cache()
+{
+    // All retrieved entries should have been freed
+    ASSERT( m_MappedEntries.IsEmpty() );
+    for ( MemoryMappedFile * mmf : m_MappedEntries )
+    {
+        FDELETE( mmf );
+    }
+}
 
 // Init
 //------------------------------------------------------------------------------
@@ -61,6 +82,9 @@ public:
 
     m_CachePath = cachePath;
     PathUtils::EnsureTrailingSlash( m_CachePath );
+    m_Index.Init( m_CachePath );
+    m_ShardIndex.Init( m_CachePath );
+    m_ChunkStore.Init( m_CachePath );
 
     // Check cache mount point if option is enabled
 #if defined( __WINDOWS__ )
@@ -89,13 +113,40 @@ public:
 //------------------------------------------------------------------------------
 /*virtual*/ void Cache::Shutdown()
 {
-    // Nothing to do
+    // Record accesses made during this build
+    m_Index.FlushAccessLog();
+
+    // Entries missing from the index would never be found, so remove any which
+    // couldn't be added
+    Array<AString> unindexedCacheIds;
+    m_ShardIndex.FlushPendingAdds( unindexedCacheIds );
+    AStackString fullPath;
+    for ( const AString & cacheId : unindexedCacheIds )
+    {
+        GetFullPathForCacheEntry( cacheId, fullPath );
+        FileIO::FileDelete( fullPath.Get() );
+        FLOG_WARN( "Failed to add entry to cache index. Entry removed: '%s'", cacheId.Get() );
+    }
 }
 
 // Publish
 //------------------------------------------------------------------------------
 /*virtual*/ bool Cache::Publish( const AString & cacheId, const void * data, size_t dataSize )
 {
+    // When deduplicating, store the chunks and publish the manifest in place
+    // of the data
+    MemoryStream manifest;
+    Array<CacheIndex::Chunk> chunks;
+    if ( m_ChunkStore.IsEnabled() )
+    {
+        if ( m_ChunkStore.WriteChunks( data, dataSize, manifest, chunks ) == false )
+        {
+            return false;
+        }
+        data = manifest.GetData();
+        dataSize = manifest.GetSize();
+    }
+
     AStackString fullPath;
     GetFullPathForCacheEntry( cacheId, fullPath );
 
@@ -140,6 +191,8 @@ public:
         }
     }
 
+    m_Index.RecordPublish( cacheId, dataSize, chunks );
+    m_ShardIndex.Add( cacheId, dataSize );
     return true;
 }
 
@@ -150,29 +203,65 @@ public:
     data = nullptr;
     dataSize = 0;
 
+    // Avoid accessing the cache directory if the entry is known not to exist
+    if ( m_ShardIndex.IsEnabled() && ( m_ShardIndex.MightContain( cacheId ) == false ) )
+    {
+        return false;
+    }
+
     AStackString fullPath;
     GetFullPathForCacheEntry( cacheId, fullPath );
+    if ( ReadEntryFile( fullPath, data, dataSize ) == false )
+    {
+        return false;
+    }
+    const size_t storedSize = dataSize;
 
-    FileStream cacheFile;
-    if ( cacheFile.Open( fullPath.Get(), FileStream::READ_ONLY ) )
+    // Reassemble deduplicated entries
+    if ( CacheChunkStore::IsManifest( data, dataSize ) )
     {
-        const size_t cacheFileSize = (size_t)cacheFile.GetFileSize();
-        UniquePtr<char, FreeDeletor> mem( (char *)ALLOC( cacheFileSize ) );
-        if ( cacheFile.Read( mem.Get(), cacheFileSize ) == cacheFileSize )
+        void * manifest = data;
+        const size_t manifestSize = dataSize;
+        const bool reassembled = m_ChunkStore.ReadChunks( manifest, manifestSize, data, dataSize );
+        FreeMemory( manifest, manifestSize );
+        if ( reassembled == false )
         {
-            dataSize = cacheFileSize;
-            data = mem.ReleaseOwnership();
-            return true;
+            data = nullptr;
+            dataSize = 0;
+            return false;
         }
     }
 
-    return false;
+    m_Index.RecordAccess( cacheId, storedSize );
+    return true;
 }
 
 // FreeMemory
 //------------------------------------------------------------------------------
-/*virtual*/ void Cache::FreeMemory( void * data, size_t /*dataSize*/ )
+/*virtual*/ void Cache::FreeMemory( void * data, size_t dataSize )
 {
+    if ( dataSize >= kMinMappedEntrySize )
+    {
+        MemoryMappedFile * mmf = nullptr;
+        {
+            MutexHolder mh( m_MappedEntriesMutex );
+            for ( MemoryMappedFile *& mappedEntry : m_MappedEntries )
+            {
+                if ( mappedEntry->GetData() == data )
+                {
+                    mmf = mappedEntry;
+                    m_MappedEntries.Erase( &mappedEntry );
+                    break;
+                }
+            }
+        }
+        if ( mmf )
+        {
+            FDELETE( mmf );
+            return;
+        }
+    }
+
     FREE( data );
 }
 
@@ -184,18 +273,31 @@ public:
     const uint32_t NUM_DAYS( 30 );
     CacheStats perDay[ NUM_DAYS ];
 
-    // Get all the files
-    Array<FileIO::FileInfo> allFiles;
-    allFiles.SetCapacity( 1000000 );
+    // Get all the entries, from the index if there is one
+    Array<CacheShardIndex::EntryInfo> allEntries;
+    allEntries.SetCapacity( 1000000 );
     uint64_t totalSize = 0;
-    GetCacheFiles( showProgress, allFiles, totalSize );
+    if ( m_ShardIndex.IsEnabled() )
+    {
+        m_ShardIndex.GetEntries( allEntries, totalSize );
+    }
+    else
+    {
+        Array<FileIO::FileInfo> allFiles;
+        allFiles.SetCapacity( 1000000 );
+        GetCacheFiles( showProgress, allFiles, totalSize );
+        for ( const FileIO::FileInfo & info : allFiles )
+        {
+            allEntries.Append( CacheShardIndex::EntryInfo{ info.m_Size, info.m_LastWriteTime } );
+        }
+    }
 
-    // Assign files into buckets
+    // Assign entries into buckets
     const uint64_t currentTime = Time::GetCurrentFileTime(); // Compare filetimes to now
-    for ( const FileIO::FileInfo & info : allFiles )
+    for ( const CacheShardIndex::EntryInfo & info : allEntries )
     {
         // Determine age bucket
-        const uint64_t age = currentTime - info.m_LastWriteTime;
+        const uint64_t age = ( currentTime > info.m_Time ) ? ( currentTime - info.m_Time ) : 0;
 #if defined( __WINDOWS__ )
         const uint64_t oneDay = ( 24 * 60 * 60 * (uint64_t)10000000 );
 #else
@@ -213,7 +315,7 @@ public:
     // Totals
     CacheStats total;
     total.m_NumBytes = totalSize;
-    total.m_NumFiles = (uint32_t)allFiles.GetSize();
+    total.m_NumFiles = (uint32_t)allEntries.GetSize();
 
     // Generate cache info string
     OUTPUT( "================================================================================\n" );
@@ -238,6 +340,34 @@ public:
     OUTPUT( " Total      | %8u | %10" PRIu64 " |\n", total.m_NumFiles, total.m_NumBytes / MEGABYTE );
     OUTPUT( "================================================================================\n" );
 
+    // Chunks shared by deduplicated entries. These are tracked by the index
+    // (as of the last trim), so only enumerated if there isn't one.
+    if ( m_ChunkStore.HasChunks() )
+    {
+        uint32_t numChunks = 0;
+        uint64_t chunksSize = 0;
+        if ( m_Index.Load() )
+        {
+            for ( const CacheIndex::ChunkInfo & chunk : m_Index.GetChunks() )
+            {
+                chunksSize += chunk.m_StoredSize;
+            }
+            numChunks = static_cast<uint32_t>( m_Index.GetChunks().GetSize() );
+        }
+        else
+        {
+            Array<FileIO::FileInfo> chunks;
+            m_ChunkStore.GetChunkFiles( chunks );
+            for ( const FileIO::FileInfo & chunk : chunks )
+            {
+                chunksSize += chunk.m_Size;
+            }
+            numChunks = static_cast<uint32_t>( chunks.GetSize() );
+        }
+        OUTPUT( " Chunks     | %8u | %10" PRIu64 " |\n", numChunks, chunksSize / MEGABYTE );
+        OUTPUT( "================================================================================\n" );
+    }
+
     return true;
 }
 
@@ -245,21 +375,43 @@ public:
 //------------------------------------------------------------------------------
 /*virtual*/ bool Cache::Trim( bool showProgress, uint32_t sizeMiB )
 {
-    // Get all the files
-    Array<FileIO::FileInfo> allFiles;
-    allFiles.SetCapacity( 1000000 );
+    // Hold the index until it has been saved
+    AStackString indexLockFileName;
+    m_Index.GetUpdateLockFileName( indexLockFileName );
+    CacheLockFile indexLock( indexLockFileName, CacheIndex::kUpdateLockStaleSecs );
+    if ( LockIndex( indexLock ) == false )
+    {
+        return false;
+    }
+
+    // Sort least recently used entries first
+    LoadIndex( showProgress );
+    m_Index.SortByLastAccessTime();
+
+    Array<CacheIndex::Entry> & entries = m_Index.GetEntries();
     uint64_t totalSize = 0;
-    GetCacheFiles( showProgress, allFiles, totalSize );
-    OUTPUT( " - Before: %u Files @ %u MiB\n", (uint32_t)allFiles.GetSize(), (uint32_t)( totalSize / MEGABYTE ) );
+    for ( const CacheIndex::Entry & entry : entries )
+    {
+        totalSize += entry.m_Size;
+    }
 
-    // Sort by age
-    OldestFileTimeSorter sorter;
-    allFiles.Sort( sorter );
+    // Chunks of deduplicated entries are freed with the last entry using them
+    ChunkUsage chunkUsage;
+    if ( m_ChunkStore.HasChunks() )
+    {
+        GetChunkUsage( entries, chunkUsage );
+        totalSize += chunkUsage.m_TotalSize;
+        OUTPUT( " - Chunks: %u Files @ %u MiB\n", (uint32_t)m_Index.GetChunks().GetSize(), (uint32_t)( chunkUsage.m_TotalSize / MEGABYTE ) );
+    }
+    OUTPUT( " - Before: %u Files @ %u MiB\n", (uint32_t)entries.GetSize(), (uint32_t)( totalSize / MEGABYTE ) );
 
     // Do we need to delete anything?
     OUTPUT( "Trimming to %u MiB:\n", sizeMiB );
     const uint64_t limit = ( (uint64_t)sizeMiB * MEGABYTE );
-    uint32_t numDeleted = 0;
+    Array<CacheIndex::Entry> remainingEntries;
+    remainingEntries.SetCapacity( entries.GetSize() );
+    Array<AString> removedCacheIds;
+    size_t numVisited = 0;
     if ( limit < totalSize )
     {
         const Timer timer;
@@ -270,34 +422,46 @@ public:
         }
         const uint64_t originalTotalSize = totalSize;
 
-        // Iterate over files, deleting oldest first
-        for ( const FileIO::FileInfo & info : allFiles )
+        // Iterate over entries, deleting least recently used first
+        AStackString fullPath;
+        for ( CacheIndex::Entry & entry : entries )
         {
-            // Try to delete (ok to fail if file is in use)
-            if ( FileIO::FileDelete( info.m_Name.Get() ) )
-            {
-                totalSize -= info.m_Size;
-                ++numDeleted;
+            ++numVisited;
 
-                // Are we under the limit now?
-                if ( totalSize <= limit )
+            // Try to delete (ok to fail if file is in use). Entries which no
+            // longer exist (trimmed elsewhere) are also removed from the index.
+            if ( entry.m_CacheId.GetLength() >= 4 )
+            {
+                GetFullPathForCacheEntry( entry.m_CacheId, fullPath );
+                if ( ( FileIO::FileDelete( fullPath.Get() ) == false ) &&
+                     FileIO::FileExists( fullPath.Get() ) )
                 {
-                    break;
+                    remainingEntries.Append( Move( entry ) );
+                    continue;
                 }
+            }
+            totalSize -= entry.m_Size;
+            totalSize -= ReleaseChunks( chunkUsage, numVisited - 1 );
+            removedCacheIds.Append( Move( entry.m_CacheId ) );
+
+            // Are we under the limit now?
+            if ( totalSize <= limit )
+            {
+                break;
+            }
 
-                // Progress
+            // Progress (throttled to avoid perf impact)
+            if ( ( timer.GetElapsed() - lastProgressTime ) > 0.5f )
+            {
                 if ( showProgress )
                 {
-                    // Throttled to avoid perf impact
-                    if ( ( timer.GetElapsed() - lastProgressTime ) > 0.5f )
-                    {
-                        const uint64_t toDeleteBytes = originalTotalSize - limit;
-                        const uint64_t deletedBytes = originalTotalSize - totalSize;
-                        const float perc = ( (float)deletedBytes / (float)toDeleteBytes ) * 100.0f;
-                        FLog::OutputProgress( timer.GetElapsed(), perc, 0, 0, 0, 0 );
-                        lastProgressTime = timer.GetElapsed();
-                    }
+                    const uint64_t toDeleteBytes = originalTotalSize - limit;
+                    const uint64_t deletedBytes = originalTotalSize - totalSize;
+                    const float perc = ( (float)deletedBytes / (float)toDeleteBytes ) * 100.0f;
+                    FLog::OutputProgress( timer.GetElapsed(), perc, 0, 0, 0, 0 );
                 }
+                indexLock.Refresh(); // Trimming a large cache can take a while
+                lastProgressTime = timer.GetElapsed();
             }
         }
 
@@ -307,10 +471,275 @@ public:
         }
     }
 
-    OUTPUT( " - After: %u Files @ %u MiB\n", (uint32_t)allFiles.GetSize() - numDeleted, (uint32_t)( totalSize / MEGABYTE ) );
+    // Remove deleted entries and persist the index for the next trim
+    for ( size_t i = numVisited; i < entries.GetSize(); ++i )
+    {
+        remainingEntries.Append( Move( entries[ i ] ) );
+    }
+    entries.Swap( remainingEntries );
+    RemoveDeletedChunks( chunkUsage );
+    m_Index.Save();
+    m_ShardIndex.Update( entries, removedCacheIds, false );
+
+    OUTPUT( " - After: %u Files @ %u MiB\n", (uint32_t)entries.GetSize(), (uint32_t)( totalSize / MEGABYTE ) );
     return true;
 }
 
+// BuildIndex
+//------------------------------------------------------------------------------
+/*virtual*/ bool Cache::BuildIndex( bool showProgress )
+{
+    AStackString indexLockFileName;
+    m_Index.GetUpdateLockFileName( indexLockFileName );
+    CacheLockFile indexLock( indexLockFileName, CacheIndex::kUpdateLockStaleSecs );
+    if ( LockIndex( indexLock ) == false )
+    {
+        return false;
+    }
+
+    if ( LoadIndex( showProgress ) )
+    {
+        AddUnindexedCacheFiles( showProgress );
+    }
+
+    // Track all chunks, including any left behind by failed publishes
+    if ( m_ChunkStore.HasChunks() )
+    {
+        AddUntrackedChunks();
+        ChunkUsage chunkUsage;
+        GetChunkUsage( m_Index.GetEntries(), chunkUsage );
+        RemoveDeletedChunks( chunkUsage );
+    }
+
+    const bool indexSaved = m_Index.Save();
+
+    // Create (or update) the shard index, enabling existence checks
+    const bool shardIndexSaved = m_ShardIndex.Update( m_Index.GetEntries(), Array<AString>(), true );
+
+    OUTPUT( " - Indexed: %u Files\n", (uint32_t)m_Index.GetEntries().GetSize() );
+    return ( indexSaved && shardIndexSaved );
+}
+
+// SetDeduplication
+//------------------------------------------------------------------------------
+void Cache::SetDeduplication( bool enabled, int16_t compressionLevel )
+{
+    m_ChunkStore.SetEnabled( enabled, compressionLevel );
+}
+
+// LoadIndex
+//------------------------------------------------------------------------------
+bool Cache::LoadIndex( bool showProgress )
+{
+    // Load the index, enumerating the cache only if there isn't one yet
+    const bool loaded = m_Index.Load();
+    if ( loaded == false )
+    {
+        BuildIndexFromCacheFiles( showProgress );
+    }
+
+    // Apply accesses recorded since the index was last saved
+    m_Index.MergeAccessLogs();
+    return loaded;
+}
+
+// LockIndex
+//------------------------------------------------------------------------------
+bool Cache::LockIndex( CacheLockFile & lock ) const
+{
+    // Concurrent trims would each save the index and delete the access logs
+    // they merged, losing the other's updates
+    AStackString indexPath;
+    CacheIndex::GetIndexPath( m_CachePath, indexPath );
+    if ( FileIO::EnsurePathExists( indexPath ) && lock.TryLock() )
+    {
+        return true;
+    }
+    FLOG_WARN( "Cache index is being updated by another process (Lock '%s')", lock.GetFileName().Get() );
+    return false;
+}
+
+// GetChunkUsage
+//------------------------------------------------------------------------------
+void Cache::GetChunkUsage( Array<CacheIndex::Entry> & entries, ChunkUsage & outUsage )
+{
+    PROFILE_FUNCTION;
+
+    // Map chunks known to the index
+    Array<CacheIndex::ChunkInfo> & chunks = m_Index.GetChunks();
+    UnorderedMap<uint64_t, uint32_t> chunkMap;
+    for ( size_t i = 0; i < chunks.GetSize(); ++i )
+    {
+        chunkMap.Insert( GetChunkKey( chunks[ i ].m_Chunk ), static_cast<uint32_t>( i ) );
+    }
+
+    // Determine which chunks each entry uses
+    outUsage.m_EntryChunksStart.SetCapacity( entries.GetSize() + 1 );
+    AStackString fullPath;
+    for ( CacheIndex::Entry & entry : entries )
+    {
+        outUsage.m_EntryChunksStart.Append( static_cast<uint32_t>( outUsage.m_EntryChunks.GetSize() ) );
+
+        // Entries found by enumerating the cache (or recorded by older versions)
+        // have their manifest read once, and are then tracked by the index
+        if ( entry.m_ChunksKnown == false )
+        {
+            entry.m_ChunksKnown = true;
+            entry.m_Chunks.Clear();
+            if ( entry.m_CacheId.GetLength() >= 4 )
+            {
+                GetFullPathForCacheEntry( entry.m_CacheId, fullPath );
+                ReadManifestChunks( fullPath, entry.m_Chunks );
+            }
+        }
+
+        for ( const CacheIndex::Chunk & chunk : entry.m_Chunks )
+        {
+            const uint64_t key = GetChunkKey( chunk );
+            const UnorderedMap<uint64_t, uint32_t>::KeyValue * existing = chunkMap.Find( key );
+            uint32_t chunkIndex;
+            if ( existing )
+            {
+                chunkIndex = existing->m_Value;
+            }
+            else
+            {
+                // Chunks new since the last trim
+                chunkIndex = static_cast<uint32_t>( chunks.GetSize() );
+                CacheIndex::ChunkInfo & chunkInfo = chunks.EmplaceBack();
+                chunkInfo.m_Chunk = chunk;
+                chunkInfo.m_StoredSize = m_ChunkStore.GetChunkStoredSize( chunk );
+                chunkMap.Insert( key, chunkIndex );
+            }
+            outUsage.m_EntryChunks.Append( chunkIndex );
+        }
+    }
+    outUsage.m_EntryChunksStart.Append( static_cast<uint32_t>( outUsage.m_EntryChunks.GetSize() ) );
+
+    outUsage.m_RefCounts.SetSize( chunks.GetSize() );
+    outUsage.m_Deleted.SetSize( chunks.GetSize() );
+    for ( size_t i = 0; i < chunks.GetSize(); ++i )
+    {
+        outUsage.m_RefCounts[ i ] = 0;
+        outUsage.m_Deleted[ i ] = false;
+    }
+    for ( const uint32_t chunkIndex : outUsage.m_EntryChunks )
+    {
+        ++outUsage.m_RefCounts[ chunkIndex ];
+    }
+
+    // Remove unused chunks (unless they were used recently)
+    outUsage.m_TotalSize = 0;
+    for ( size_t i = 0; i < chunks.GetSize(); ++i )
+    {
+        if ( ( outUsage.m_RefCounts[ i ] == 0 ) && m_ChunkStore.DeleteChunkIfUnused( chunks[ i ].m_Chunk ) )
+        {
+            outUsage.m_Deleted[ i ] = true;
+            continue;
+        }
+        outUsage.m_TotalSize += chunks[ i ].m_StoredSize;
+    }
+}
+
+// ReleaseChunks
+//------------------------------------------------------------------------------
+uint64_t Cache::ReleaseChunks( ChunkUsage & usage, size_t entryIndex )
+{
+    if ( usage.m_EntryChunksStart.IsEmpty() )
+    {
+        return 0; // No deduplicated entries
+    }
+
+    // Delete chunks no longer used by any entry
+    const Array<CacheIndex::ChunkInfo> & chunks = m_Index.GetChunks();
+    uint64_t freedSize = 0;
+    for ( uint32_t i = usage.m_EntryChunksStart[ entryIndex ]; i < usage.m_EntryChunksStart[ entryIndex + 1 ]; ++i )
+    {
+        const uint32_t chunkIndex = usage.m_EntryChunks[ i ];
+        ASSERT( usage.m_RefCounts[ chunkIndex ] > 0 );
+        if ( ( --usage.m_RefCounts[ chunkIndex ] == 0 ) &&
+             m_ChunkStore.DeleteChunkIfUnused( chunks[ chunkIndex ].m_Chunk ) )
+        {
+            usage.m_Deleted[ chunkIndex ] = true;
+            freedSize += chunks[ chunkIndex ].m_StoredSize;
+        }
+    }
+    return freedSize;
+}
+
+// RemoveDeletedChunks
+//------------------------------------------------------------------------------
+void Cache::RemoveDeletedChunks( const ChunkUsage & usage )
+{
+    // Unused chunks which couldn't be deleted yet remain, so they are deleted
+    // by a later trim
+    Array<CacheIndex::ChunkInfo> & chunks = m_Index.GetChunks();
+    Array<CacheIndex::ChunkInfo> remainingChunks;
+    remainingChunks.SetCapacity( chunks.GetSize() );
+    for ( size_t i = 0; i < chunks.GetSize(); ++i )
+    {
+        if ( ( i >= usage.m_Deleted.GetSize() ) || ( usage.m_Deleted[ i ] == false ) )
+        {
+            remainingChunks.Append( chunks[ i ] );
+        }
+    }
+    chunks.Swap( remainingChunks );
+}
+
+// AddUntrackedChunks
+//------------------------------------------------------------------------------
+void Cache::AddUntrackedChunks()
+{
+    PROFILE_FUNCTION;
+
+    Array<CacheIndex::ChunkInfo> & chunks = m_Index.GetChunks();
+    UnorderedMap<uint64_t, bool> chunkMap;
+    for ( const CacheIndex::ChunkInfo & chunk : chunks )
+    {
+        chunkMap.Insert( GetChunkKey( chunk.m_Chunk ), true );
+    }
+
+    Array<FileIO::FileInfo> chunkFiles;
+    m_ChunkStore.GetChunkFiles( chunkFiles );
+    for ( const FileIO::FileInfo & chunkFile : chunkFiles )
+    {
+        CacheIndex::Chunk chunk;
+        if ( CacheChunkStore::GetChunkFromFileName( chunkFile.m_Name, chunk ) &&
+             ( chunkMap.Find( GetChunkKey( chunk ) ) == nullptr ) )
+        {
+            chunkMap.Insert( GetChunkKey( chunk ), true );
+            CacheIndex::ChunkInfo & chunkInfo = chunks.EmplaceBack();
+            chunkInfo.m_Chunk = chunk;
+            chunkInfo.m_StoredSize = chunkFile.m_Size;
+        }
+    }
+}
+
+// ReadManifestChunks
+//------------------------------------------------------------------------------
+void Cache::ReadManifestChunks( const AString & fullPath, Array<CacheIndex::Chunk> & outChunks ) const
+{
+    // Check the start of the file first, to avoid reading regular entries
+    FileStream f;
+    char magic[ 4 ];
+    if ( ( f.Open( fullPath.Get(), FileStream::READ_ONLY ) == false ) ||
+         ( f.ReadBuffer( magic, sizeof( magic ) ) != sizeof( magic ) ) ||
+         ( CacheChunkStore::IsManifest( magic, sizeof( magic ) ) == false ) )
+    {
+        return;
+    }
+
+    const size_t manifestSize = static_cast<size_t>( f.GetFileSize() );
+    UniquePtr<char, FreeDeletor> manifest( static_cast<char *>( ALLOC( manifestSize ) ) );
+    memcpy( manifest.Get(), magic, sizeof( magic ) );
+    const size_t remainingSize = ( manifestSize - sizeof( magic ) );
+    if ( ( f.ReadBuffer( manifest.Get() + sizeof( magic ), remainingSize ) != remainingSize ) ||
+         ( CacheChunkStore::GetChunks( manifest.Get(), manifestSize, outChunks ) == false ) )
+    {
+        outChunks.Clear();
+    }
+}
+
 // GetCacheFiles
 //------------------------------------------------------------------------------
 void Cache::GetCacheFiles( bool showProgress,
@@ -368,6 +797,94 @@ void Cache::GetCacheFiles( bool showProgress,
     }
 }
 
+// BuildIndexFromCacheFiles
+//------------------------------------------------------------------------------
+void Cache::BuildIndexFromCacheFiles( bool showProgress )
+{
+    PROFILE_FUNCTION;
+
+    // Enumerate all files. Access times are unknown, so use the time they
+    // were written.
+    Array<FileIO::FileInfo> allFiles;
+    allFiles.SetCapacity( 1000000 );
+    uint64_t totalSize = 0;
+    GetCacheFiles( showProgress, allFiles, totalSize );
+    for ( const FileIO::FileInfo & info : allFiles )
+    {
+        const char * lastSlash = info.m_Name.FindLast( NATIVE_SLASH );
+        const AStackString cacheId( lastSlash ? ( lastSlash + 1 ) : info.m_Name.Get() );
+        m_Index.AddEntry( cacheId, info.m_Size, info.m_LastWriteTime );
+    }
+}
+
+// AddUnindexedCacheFiles
+//------------------------------------------------------------------------------
+void Cache::AddUnindexedCacheFiles( bool showProgress )
+{
+    PROFILE_FUNCTION;
+
+    // Entries written by versions which don't maintain the index (or by
+    // processes which died before flushing their accesses) are only found by
+    // enumerating the cache
+    UnorderedMap<AString, bool> indexedCacheIds;
+    for ( const CacheIndex::Entry & entry : m_Index.GetEntries() )
+    {
+        indexedCacheIds.Insert( entry.m_CacheId, true );
+    }
+
+    Array<FileIO::FileInfo> allFiles;
+    allFiles.SetCapacity( 1000000 );
+    uint64_t totalSize = 0;
+    GetCacheFiles( showProgress, allFiles, totalSize );
+    for ( const FileIO::FileInfo & info : allFiles )
+    {
+        const char * lastSlash = info.m_Name.FindLast( NATIVE_SLASH );
+        const AStackString cacheId( lastSlash ? ( lastSlash + 1 ) : info.m_Name.Get() );
+        if ( indexedCacheIds.Find( cacheId ) == nullptr )
+        {
+            m_Index.AddEntry( cacheId, info.m_Size, info.m_LastWriteTime );
+        }
+    }
+}
+
+// ReadEntryFile
+//------------------------------------------------------------------------------
+bool Cache::ReadEntryFile( const AString & fullPath, void *& data, size_t & dataSize )
+{
+    FileStream cacheFile;
+    if ( cacheFile.Open( fullPath.Get(), FileStream::READ_ONLY ) == false )
+    {
+        return false;
+    }
+    const size_t cacheFileSize = (size_t)cacheFile.GetFileSize();
+
+    // Map large entries, so they can be consumed without being copied. Entries
+    // are replaced via rename, so the mapped contents can't change under us.
+    if ( cacheFileSize >= kMinMappedEntrySize )
+    {
+        cacheFile.Close();
+        UniquePtr<MemoryMappedFile> mmf( FNEW( MemoryMappedFile ) );
+        if ( ( mmf->Open( fullPath.Get() ) == false ) || ( mmf->GetSize() == 0 ) )
+        {
+            return false;
+        }
+        dataSize = mmf->GetSize();
+        data = const_cast<void *>( mmf->GetData() );
+        MutexHolder mh( m_MappedEntriesMutex );
+        m_MappedEntries.Append( mmf.ReleaseOwnership() );
+        return true;
+    }
+
+    UniquePtr<char, FreeDeletor> mem( (char *)ALLOC( cacheFileSize ) );
+    if ( cacheFile.Read( mem.Get(), cacheFileSize ) != cacheFileSize )
+    {
+        return false;
+    }
+    dataSize = cacheFileSize;
+    data = mem.ReleaseOwnership();
+    return true;
+}
+
 // GetFullPathForCacheEntry
 //------------------------------------------------------------------------------
 void Cache::GetFullPathForCacheEntry( const AString & cacheId,
@@ -5,12 +5,21 @@
 // Includes
 //------------------------------------------------------------------------------
 // FBuildCore
+#include "Tools/FBuild/FBuildCore/Cache/CacheChunkStore.h"
+#include "Tools/FBuild/FBuildCore/Cache/CacheIndex.h"
+#include "Tools/FBuild/FBuildCore/Cache/CacheShardIndex.h"
 #include "Tools/FBuild/FBuildCore/Cache/ICache.h"
 
 // Core
 #include "Core/FileIO/FileIO.h"
+#include "Core/Process/Mutex.h"
 #include "Core/Strings/AString.h"
 
+// Forward Declarations
+//------------------------------------------------------------------------------
+class CacheLockFile;
+class MemoryMappedFile;
+
 // Cache
 //------------------------------------------------------------------------------
 class Cache : public ICache
@@ -31,12 +40,44 @@ public:
     virtual void FreeMemory( void * data, size_t dataSize ) override;
     virtual bool OutputInfo( bool showProgress ) override;
     virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override;
+    virtual bool BuildIndex( bool showProgress ) override;
+
+    // Store new entries as deduplicated chunks
+    void SetDeduplication( bool enabled, int16_t compressionLevel );
 
 private:
+    // Chunks used by entries, when trimming
+    class ChunkUsage
+    {
+    public:
+        Array<uint32_t> m_RefCounts; // For each chunk in the index
+        Array<bool> m_Deleted;
+        Array<uint32_t> m_EntryChunks; // Chunk indices used by all entries
+        Array<uint32_t> m_EntryChunksStart; // Index into m_EntryChunks for each entry
+        uint64_t m_TotalSize = 0;
+    };
+
     void GetCacheFiles( bool showProgress, Array<FileIO::FileInfo> & outInfo, uint64_t & outTotalSize ) const;
+    bool ReadEntryFile( const AString & fullPath, void *& data, size_t & dataSize );
     void GetFullPathForCacheEntry( const AString & cacheId, AString & outFullPath ) const;
+    bool LockIndex( CacheLockFile & lock ) const;
+    bool LoadIndex( bool showProgress ); // Returns false if the cache was enumerated
+    void BuildIndexFromCacheFiles( bool showProgress );
+    void AddUnindexedCacheFiles( bool showProgress );
+    void GetChunkUsage( Array<CacheIndex::Entry> & entries, ChunkUsage & outUsage );
+    uint64_t ReleaseChunks( ChunkUsage & usage, size_t entryIndex );
+    void RemoveDeletedChunks( const ChunkUsage & usage );
+    void AddUntrackedChunks();
+    void ReadManifestChunks( const AString & fullPath, Array<CacheIndex::Chunk> & outChunks ) const;
 
     AString m_CachePath;
+    CacheIndex m_Index;
+    CacheShardIndex m_ShardIndex;
+    CacheChunkStore m_ChunkStore;
+
+    // Large entries are retrieved by mapping them, rather than being read
+    Mutex m_MappedEntriesMutex;
+    Array<MemoryMappedFile *> m_MappedEntries;
 };
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,432 @@
+// CacheChunkStore - Deduplicated storage of cache entries
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CacheChunkStore.h"
+
+// FBuild
+#include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+
+// Core
+#include "Core/Containers/UniquePtr.h"
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/GearHash.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Network/Network.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Process.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Time.h"
+
+// system
+#include <string.h> // for memcmp, memcpy
+
+// Defines
+//------------------------------------------------------------------------------
+namespace
+{
+    const char kManifestMagic[ 4 ] = { 'F', 'C', 'M', 1 };
+
+    // Chunk sizes
+    const size_t kMinChunkSize = ( 16 * 1024 );
+    const size_t kAvgChunkSize = ( 64 * 1024 );
+    const size_t kMaxChunkSize = ( 256 * 1024 );
+
+    // Entries smaller than this are stored inline in their manifest
+    const size_t kMinChunkedEntrySize = ( 2 * kAvgChunkSize );
+
+    // Makes tmp file names unique within this process
+    Atomic<uint32_t> g_NumChunksWritten;
+
+    // Chunks written (or reused) more recently than this might belong to an
+    // entry which is being published, but isn't known to the index yet
+    const uint64_t kChunkInUseSecs = ( 60 * 60 );
+
+    // IsChunkFileInUse
+    //--------------------------------------------------------------------------
+    bool IsChunkFileInUse( const AString & fileName )
+    {
+        const uint64_t writeTime = FileIO::GetFileLastWriteTime( fileName );
+        const uint64_t now = Time::GetCurrentFileTime();
+        return ( ( now < writeTime ) ||
+                 ( ( Time::FileTimeToSeconds( now ) - Time::FileTimeToSeconds( writeTime ) ) < kChunkInUseSecs ) );
+    }
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CacheChunkStore::CacheChunkStore() = default;
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CacheChunkStore::~CacheChunkStore() = default;
+
+// Init
+//------------------------------------------------------------------------------
+void CacheChunkStore::Init( const AString & cachePath )
+{
+    GetChunksPath( cachePath, m_ChunksPath );
+}
+
+// SetEnabled
+//------------------------------------------------------------------------------
+void CacheChunkStore::SetEnabled( bool enabled, int16_t compressionLevel )
+{
+    m_Enabled = enabled;
+    m_CompressionLevel = compressionLevel;
+}
+
+// WriteChunks
+//------------------------------------------------------------------------------
+bool CacheChunkStore::WriteChunks( const void * data,
+                                   size_t dataSize,
+                                   MemoryStream & outManifest,
+                                   Array<CacheIndex::Chunk> & outChunks ) const
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( m_Enabled );
+
+    outManifest.WriteBuffer( kManifestMagic, sizeof( kManifestMagic ) );
+    outManifest.Write( static_cast<uint64_t>( dataSize ) );
+
+    // Small entries are stored inline
+    if ( dataSize < kMinChunkedEntrySize )
+    {
+        outManifest.Write( static_cast<uint32_t>( 0 ) );
+        Compressor c;
+        Compress( data, dataSize, c );
+        outManifest.WriteBuffer( c.GetResult(), c.GetResultSize() );
+        return true;
+    }
+
+    // Split into chunks, storing any which don't already exist
+    Array<CacheIndex::Chunk> & chunks = outChunks;
+    chunks.SetCapacity( ( dataSize / kAvgChunkSize ) + 1 );
+    AStackString chunkFileName;
+    const char * pos = static_cast<const char *>( data );
+    const char * const end = ( pos + dataSize );
+    while ( pos < end )
+    {
+        const size_t chunkSize = GearHash::FindChunkEnd( pos, static_cast<size_t>( end - pos ), kMinChunkSize, kAvgChunkSize, kMaxChunkSize );
+        CacheIndex::Chunk & chunk = chunks.EmplaceBack();
+        chunk.m_Hash = xxHash3::Calc64( pos, chunkSize );
+        chunk.m_Size = static_cast<uint32_t>( chunkSize );
+
+        // Touching an existing chunk protects it from being deleted by a trim
+        // which doesn't know about this entry yet. If the touch fails, the
+        // chunk doesn't exist (or is being deleted), so is written again.
+        GetChunkFileName( chunk, chunkFileName );
+        if ( FileIO::SetFileLastWriteTimeToNow( chunkFileName ) == false )
+        {
+            if ( WriteChunk( pos, chunkSize, chunkFileName ) == false )
+            {
+                return false;
+            }
+        }
+        pos += chunkSize;
+    }
+
+    outManifest.Write( static_cast<uint32_t>( chunks.GetSize() ) );
+    for ( const CacheIndex::Chunk & chunk : chunks )
+    {
+        outManifest.Write( chunk.m_Hash );
+        outManifest.Write( chunk.m_Size );
+    }
+    return true;
+}
+
+// IsManifest
+//------------------------------------------------------------------------------
+/*static*/ bool CacheChunkStore::IsManifest( const void * data, size_t dataSize )
+{
+    // Regular entries begin with a Compressor header, which can't match
+    return ( ( dataSize >= sizeof( kManifestMagic ) ) &&
+             ( memcmp( data, kManifestMagic, sizeof( kManifestMagic ) ) == 0 ) );
+}
+
+// ReadChunks
+//------------------------------------------------------------------------------
+bool CacheChunkStore::ReadChunks( const void * manifest, size_t manifestSize, void *& outData, size_t & outDataSize ) const
+{
+    PROFILE_FUNCTION;
+
+    uint64_t dataSize;
+    Array<CacheIndex::Chunk> chunks;
+    const void * inlineData;
+    size_t inlineDataSize;
+    if ( ParseManifest( manifest, manifestSize, dataSize, chunks, inlineData, inlineDataSize ) == false )
+    {
+        FLOG_WARN( "Cache entry manifest is invalid" );
+        return false;
+    }
+
+    // Data stored inline
+    if ( chunks.IsEmpty() )
+    {
+        Compressor c;
+        if ( ( Compressor::IsValidData( inlineData, inlineDataSize ) == false ) ||
+             ( c.Decompress( inlineData ) == false ) ||
+             ( c.GetResultSize() != dataSize ) )
+        {
+            return false;
+        }
+        outDataSize = c.GetResultSize();
+        outData = c.ReleaseResult();
+        return true;
+    }
+
+    // Reassemble from chunks
+    UniquePtr<char, FreeDeletor> data( static_cast<char *>( ALLOC( static_cast<size_t>( dataSize ) ) ) );
+    char * dst = data.Get();
+    AStackString chunkFileName;
+    for ( const CacheIndex::Chunk & chunk : chunks )
+    {
+        // A missing chunk (e.g. trimmed while the manifest was being published)
+        // is treated as a miss. Re-publishing the entry will restore it.
+        GetChunkFileName( chunk, chunkFileName );
+        FileStream f;
+        if ( f.Open( chunkFileName.Get(), FileStream::READ_ONLY ) == false )
+        {
+            return false;
+        }
+        const size_t chunkFileSize = static_cast<size_t>( f.GetFileSize() );
+        UniquePtr<char, FreeDeletor> compressedChunk( static_cast<char *>( ALLOC( chunkFileSize ) ) );
+        Compressor c;
+        if ( ( f.ReadBuffer( compressedChunk.Get(), chunkFileSize ) != chunkFileSize ) ||
+             ( Compressor::IsValidData( compressedChunk.Get(), chunkFileSize ) == false ) ||
+             ( c.Decompress( compressedChunk.Get() ) == false ) ||
+             ( c.GetResultSize() != chunk.m_Size ) ||
+             ( xxHash3::Calc64( c.GetResult(), c.GetResultSize() ) != chunk.m_Hash ) )
+        {
+            FLOG_WARN( "Cache chunk is invalid: '%s'", chunkFileName.Get() );
+            return false;
+        }
+        memcpy( dst, c.GetResult(), chunk.m_Size );
+        dst += chunk.m_Size;
+    }
+
+    outDataSize = static_cast<size_t>( dataSize );
+    outData = data.ReleaseOwnership();
+    return true;
+}
+
+// GetChunks
+//------------------------------------------------------------------------------
+/*static*/ bool CacheChunkStore::GetChunks( const void * manifest, size_t manifestSize, Array<CacheIndex::Chunk> & outChunks )
+{
+    uint64_t dataSize;
+    const void * inlineData;
+    size_t inlineDataSize;
+    return ParseManifest( manifest, manifestSize, dataSize, outChunks, inlineData, inlineDataSize );
+}
+
+// HasChunks
+//------------------------------------------------------------------------------
+bool CacheChunkStore::HasChunks() const
+{
+    return FileIO::DirectoryExists( m_ChunksPath );
+}
+
+// GetChunkStoredSize
+//------------------------------------------------------------------------------
+uint64_t CacheChunkStore::GetChunkStoredSize( const CacheIndex::Chunk & chunk ) const
+{
+    AStackString chunkFileName;
+    GetChunkFileName( chunk, chunkFileName );
+    FileIO::FileInfo info;
+    return FileIO::GetFileInfo( chunkFileName, info ) ? info.m_Size : 0;
+}
+
+// DeleteChunkIfUnused
+//------------------------------------------------------------------------------
+bool CacheChunkStore::DeleteChunkIfUnused( const CacheIndex::Chunk & chunk ) const
+{
+    AStackString chunkFileName;
+    GetChunkFileName( chunk, chunkFileName );
+    if ( IsChunkFileInUse( chunkFileName ) )
+    {
+        return false;
+    }
+
+    // Move the chunk aside before checking again. An entry being published
+    // either refreshed the chunk before it was moved (and it is restored) or
+    // fails to, and writes the chunk again.
+    AStackString trimFileName( chunkFileName );
+    trimFileName += ".trim";
+    if ( FileIO::FileMove( chunkFileName, trimFileName ) == false )
+    {
+        return ( FileIO::FileExists( chunkFileName.Get() ) == false ); // Already deleted
+    }
+    if ( IsChunkFileInUse( trimFileName ) )
+    {
+        FileIO::FileMove( trimFileName, chunkFileName );
+        return false;
+    }
+    FileIO::FileDelete( trimFileName.Get() );
+    return true;
+}
+
+// GetChunkFiles
+//------------------------------------------------------------------------------
+void CacheChunkStore::GetChunkFiles( Array<FileIO::FileInfo> & outFiles ) const
+{
+    PROFILE_FUNCTION;
+
+    FileIO::GetFilesEx( m_ChunksPath, nullptr, true, &outFiles );
+}
+
+// GetChunkFromFileName
+//------------------------------------------------------------------------------
+/*static*/ bool CacheChunkStore::GetChunkFromFileName( const AString & fileName, CacheIndex::Chunk & outChunk )
+{
+    // Ignore tmp files and anything else which isn't a chunk
+    const char * name = fileName.FindLast( NATIVE_SLASH );
+    name = name ? ( name + 1 ) : fileName.Get();
+    if ( AString::StrLen( name ) != ( 16 + 1 + 8 ) )
+    {
+        return false;
+    }
+    uint32_t hashHigh;
+    uint32_t hashLow;
+    if ( AString::ScanS( name, "%8x%8x_%8x", &hashHigh, &hashLow, &outChunk.m_Size ) != 3 )
+    {
+        return false;
+    }
+    outChunk.m_Hash = ( ( static_cast<uint64_t>( hashHigh ) << 32 ) | hashLow );
+    return true;
+}
+
+// GetChunksPath
+//------------------------------------------------------------------------------
+/*static*/ void CacheChunkStore::GetChunksPath( const AString & cachePath, AString & outPath )
+{
+    // Cache entries are stored in hex named sub-dirs, so this can't collide
+    outPath.Format( "%sChunks%c", cachePath.Get(), NATIVE_SLASH );
+}
+
+// GetChunkFileName
+//------------------------------------------------------------------------------
+void CacheChunkStore::GetChunkFileName( const CacheIndex::Chunk & chunk, AString & outFileName ) const
+{
+    // format example: N:\\fbuild.cache\\Chunks\\AA\\BB\\<AABB....>_<size>
+    outFileName.Format( "%s%02X%c%02X%c%016" PRIX64 "_%08X",
+                        m_ChunksPath.Get(),
+                        static_cast<uint32_t>( chunk.m_Hash >> 56 ),
+                        NATIVE_SLASH,
+                        static_cast<uint32_t>( ( chunk.m_Hash >> 48 ) & 0xFF ),
+                        NATIVE_SLASH,
+                        chunk.m_Hash,
+                        chunk.m_Size );
+}
+
+// WriteChunk
+//------------------------------------------------------------------------------
+bool CacheChunkStore::WriteChunk( const void * data, size_t dataSize, const AString & fileName ) const
+{
+    if ( FileIO::EnsurePathExistsForFile( fileName ) == false )
+    {
+        return false;
+    }
+
+    Compressor c;
+    Compress( data, dataSize, c );
+
+    // The same chunk can be written concurrently by different entries (from
+    // different threads or machines), so the tmp file name must be unique
+    AStackString hostName;
+    Network::GetHostName( hostName );
+    AStackString fileNameTmp;
+    fileNameTmp.Format( "%s.%s_%u_%u.tmp",
+                        fileName.Get(),
+                        hostName.Get(),
+                        Process::GetCurrentId(),
+                        g_NumChunksWritten.Increment() );
+
+    FileStream f;
+    if ( f.Open( fileNameTmp.Get(), FileStream::WRITE_ONLY ) == false )
+    {
+        return false;
+    }
+    const bool writeOk = ( f.WriteBuffer( c.GetResult(), c.GetResultSize() ) == c.GetResultSize() );
+    f.Close();
+    if ( writeOk && FileIO::FileMove( fileNameTmp, fileName ) )
+    {
+        return true;
+    }
+    FileIO::FileDelete( fileNameTmp.Get() );
+
+    // Another writer may have stored the same chunk first
+    return FileIO::FileExists( fileName.Get() );
+}
+
+// Compress
+//------------------------------------------------------------------------------
+void CacheChunkStore::Compress( const void * data, size_t dataSize, Compressor & outCompressor ) const
+{
+    // Compressed the same way as regular entries (See Compressor.h)
+    if ( m_CompressionLevel <= 0 )
+    {
+        outCompressor.Compress( data, dataSize, m_CompressionLevel );
+    }
+    else
+    {
+        outCompressor.CompressZstd( data, dataSize, m_CompressionLevel );
+    }
+}
+
+// ParseManifest
+//------------------------------------------------------------------------------
+/*static*/ bool CacheChunkStore::ParseManifest( const void * manifest,
+                                                size_t manifestSize,
+                                                uint64_t & outDataSize,
+                                                Array<CacheIndex::Chunk> & outChunks,
+                                                const void *& outInlineData,
+                                                size_t & outInlineDataSize )
+{
+    if ( IsManifest( manifest, manifestSize ) == false )
+    {
+        return false;
+    }
+
+    ConstMemoryStream stream( manifest, manifestSize );
+    stream.Seek( sizeof( kManifestMagic ) );
+    uint32_t numChunks = 0;
+    if ( ( stream.Read( outDataSize ) == false ) ||
+         ( stream.Read( numChunks ) == false ) ||
+         ( numChunks > ( ( manifestSize - stream.Tell() ) / ( sizeof( uint64_t ) + sizeof( uint32_t ) ) ) ) )
+    {
+        return false;
+    }
+
+    uint64_t totalSize = 0;
+    outChunks.SetCapacity( numChunks );
+    for ( uint32_t i = 0; i < numChunks; ++i )
+    {
+        CacheIndex::Chunk & chunk = outChunks.EmplaceBack();
+        if ( ( stream.Read( chunk.m_Hash ) == false ) ||
+             ( stream.Read( chunk.m_Size ) == false ) )
+        {
+            return false;
+        }
+        totalSize += chunk.m_Size;
+    }
+    if ( ( numChunks > 0 ) && ( totalSize != outDataSize ) )
+    {
+        return false;
+    }
+
+    outInlineData = static_cast<const char *>( manifest ) + stream.Tell();
+    outInlineDataSize = static_cast<size_t>( manifestSize - stream.Tell() );
+    return true;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,87 @@
+// CacheChunkStore - Deduplicated storage of cache entries
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Cache/CacheIndex.h"
+
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class Compressor;
+class MemoryStream;
+
+// CacheChunkStore
+//  - Optionally, entries can be split into content-defined chunks, each of
+//    which is compressed and stored (once) under its hash. The entry itself
+//    is then a small manifest listing its chunks.
+//  - Chunk boundaries depend only on local content, so entries which differ
+//    slightly (embedded paths, timestamps etc.) share most of their chunks.
+//  - Entries are always reassembled exactly, so the data returned when
+//    retrieving is identical to the data that was published.
+//  - Small entries aren't worth splitting, so their manifest holds the
+//    compressed data inline.
+//  - Chunks are shared, so are only deleted once no entry uses them (as
+//    tracked by the CacheIndex). Reusing a chunk refreshes its write time,
+//    and recently written chunks are never deleted, so chunks can't be
+//    deleted while an entry using them is being published.
+//------------------------------------------------------------------------------
+class CacheChunkStore
+{
+public:
+    explicit CacheChunkStore();
+    ~CacheChunkStore();
+
+    void Init( const AString & cachePath );
+
+    // Store new entries as chunks (reading manifests is always supported)
+    void SetEnabled( bool enabled, int16_t compressionLevel );
+    [[nodiscard]] bool IsEnabled() const { return m_Enabled; }
+
+    // Store any chunks not already in the cache, generating the manifest
+    bool WriteChunks( const void * data,
+                      size_t dataSize,
+                      MemoryStream & outManifest,
+                      Array<CacheIndex::Chunk> & outChunks ) const;
+
+    // Reassemble an entry from its manifest
+    [[nodiscard]] static bool IsManifest( const void * data, size_t dataSize );
+    bool ReadChunks( const void * manifest, size_t manifestSize, void *& outData, size_t & outDataSize ) const;
+
+    // Chunks referenced by a manifest (empty if the data is stored inline)
+    static bool GetChunks( const void * manifest, size_t manifestSize, Array<CacheIndex::Chunk> & outChunks );
+
+    // Chunks stored in the cache
+    [[nodiscard]] bool HasChunks() const;
+    [[nodiscard]] uint64_t GetChunkStoredSize( const CacheIndex::Chunk & chunk ) const;
+    bool DeleteChunkIfUnused( const CacheIndex::Chunk & chunk ) const;
+
+    // Enumerate all chunks (expensive)
+    void GetChunkFiles( Array<FileIO::FileInfo> & outFiles ) const;
+    static bool GetChunkFromFileName( const AString & fileName, CacheIndex::Chunk & outChunk );
+
+    static void GetChunksPath( const AString & cachePath, AString & outPath );
+
+private:
+    void GetChunkFileName( const CacheIndex::Chunk & chunk, AString & outFileName ) const;
+    bool WriteChunk( const void * data, size_t dataSize, const AString & fileName ) const;
+    void Compress( const void * data, size_t dataSize, Compressor & outCompressor ) const;
+    static bool ParseManifest( const void * manifest,
+                               size_t manifestSize,
+                               uint64_t & outDataSize,
+                               Array<CacheIndex::Chunk> & outChunks,
+                               const void *& outInlineData,
+                               size_t & outInlineDataSize );
+
+    AString m_ChunksPath;
+    bool m_Enabled = false;
+    int16_t m_CompressionLevel = 0;
+};
+
+//------------------------------------------------------------------------------
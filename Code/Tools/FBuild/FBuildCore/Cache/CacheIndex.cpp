@@ -0,0 +1,548 @@
+// CacheIndex - Persistent LRU index of cache entries
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CacheIndex.h"
+
+// FBuild
+#include "Tools/FBuild/FBuildCore/Cache/CacheLockFile.h"
+#include "Tools/FBuild/FBuildCore/FLog.h"
+
+// Core
+#include "Core/Containers/UnorderedMap.h"
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryMappedFile.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Network/Network.h"
+#include "Core/Process/Process.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Time.h"
+
+// system
+#include <string.h> // for memcmp
+
+// Defines
+//------------------------------------------------------------------------------
+namespace
+{
+    // Index of all entries
+    const char * const kIndexFileName = "LRU.idx";
+    const char kIndexMagic[ 3 ] = { 'F', 'C', 'I' };
+
+    // Per-process access logs
+    const char * const kAccessLogExtension = ".log";
+    const char kAccessLogMagic[ 3 ] = { 'F', 'C', 'L' };
+    const uint32_t kMaxPendingAccesses = 16 * 1024; // Flush periodically to bound memory use
+    const float kMaxPendingAccessSecs = ( 5 * 60 ); // Flush periodically so trims see chunks in use
+    const size_t kMaxAccessLogs = 64;               // Compact logs beyond this many between trims
+
+    // Held while updating the index or consuming access logs
+    const char * const kUpdateLockFileName = "Update.lock";
+
+    // Version of index and access logs (following the magic). Version 1 didn't
+    // record chunks.
+    const uint8_t kVersion = 2;
+    const uint8_t kMinVersion = 1;
+
+    // Cache ids are short - anything longer indicates a corrupt file
+    const uint32_t kMaxCacheIdLength = 256;
+
+    // Chunks are unknown for accesses other than publishing
+    const uint32_t kUnknownChunks = 0xFFFFFFFF;
+}
+
+// LastAccessTimeSorter
+//------------------------------------------------------------------------------
+class LastAccessTimeSorter
+{
+public:
+    bool operator()( const CacheIndex::Entry & a, const CacheIndex::Entry & b ) const
+    {
+        return ( a.m_LastAccessTime < b.m_LastAccessTime );
+    }
+};
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CacheIndex::CacheIndex() = default;
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CacheIndex::~CacheIndex() = default;
+
+// Init
+//------------------------------------------------------------------------------
+void CacheIndex::Init( const AString & cachePath )
+{
+    GetIndexPath( cachePath, m_IndexPath );
+}
+
+// RecordAccess
+//------------------------------------------------------------------------------
+void CacheIndex::RecordAccess( const AString & cacheId, uint64_t size )
+{
+    AddPendingAccess( cacheId, size, nullptr );
+}
+
+// RecordPublish
+//------------------------------------------------------------------------------
+void CacheIndex::RecordPublish( const AString & cacheId, uint64_t size, const Array<Chunk> & chunks )
+{
+    AddPendingAccess( cacheId, size, &chunks );
+}
+
+// AddPendingAccess
+//------------------------------------------------------------------------------
+void CacheIndex::AddPendingAccess( const AString & cacheId, uint64_t size, const Array<Chunk> * chunks )
+{
+    bool flush;
+    {
+        MutexHolder mh( m_AccessLogMutex );
+        Entry & entry = m_PendingAccesses.EmplaceBack();
+        entry.m_CacheId = cacheId;
+        entry.m_Size = size;
+        entry.m_LastAccessTime = Time::GetCurrentFileTime();
+        if ( chunks )
+        {
+            entry.m_ChunksKnown = true;
+            entry.m_Chunks = *chunks;
+        }
+
+        // Chunks of published entries are only protected from trimming for a
+        // limited time, so accesses can't be held indefinitely
+        flush = ( ( m_PendingAccesses.GetSize() >= kMaxPendingAccesses ) ||
+                  ( m_TimeSinceFlush.GetElapsed() > kMaxPendingAccessSecs ) );
+    }
+
+    if ( flush )
+    {
+        FlushAccessLog();
+    }
+}
+
+// FlushAccessLog
+//------------------------------------------------------------------------------
+void CacheIndex::FlushAccessLog()
+{
+    PROFILE_FUNCTION;
+
+    // Take pending accesses so other threads can continue to record them
+    Array<Entry> accesses;
+    {
+        MutexHolder mh( m_AccessLogMutex );
+        if ( m_PendingAccesses.IsEmpty() )
+        {
+            return;
+        }
+        accesses.Swap( m_PendingAccesses );
+        m_TimeSinceFlush.Restart();
+    }
+
+    if ( WriteAccessLog( accesses ) )
+    {
+        CompactAccessLogs();
+    }
+}
+
+// Load
+//------------------------------------------------------------------------------
+bool CacheIndex::Load()
+{
+    PROFILE_FUNCTION;
+
+    m_Entries.Clear();
+    m_Chunks.Clear();
+    m_MergedAccessLogs.Clear();
+
+    AStackString indexFile( m_IndexPath );
+    indexFile += kIndexFileName;
+
+    MemoryMappedFile mmf;
+    if ( mmf.Open( indexFile.Get() ) == false )
+    {
+        return false;
+    }
+
+    ConstMemoryStream stream( mmf.GetData(), mmf.GetSize() );
+    char magic[ 3 ];
+    uint8_t version = 0;
+    uint32_t numEntries = 0;
+    if ( ( stream.ReadBuffer( magic, sizeof( magic ) ) != sizeof( magic ) ) ||
+         ( memcmp( magic, kIndexMagic, sizeof( magic ) ) != 0 ) ||
+         ( stream.Read( version ) == false ) ||
+         ( version < kMinVersion ) || ( version > kVersion ) ||
+         ( stream.Read( numEntries ) == false ) )
+    {
+        FLOG_WARN( "Cache index is invalid and will be rebuilt: '%s'", indexFile.Get() );
+        return false;
+    }
+
+    m_Entries.SetCapacity( numEntries );
+    for ( uint32_t i = 0; i < numEntries; ++i )
+    {
+        if ( ReadEntry( stream, version, m_Entries.EmplaceBack() ) == false )
+        {
+            FLOG_WARN( "Cache index is invalid and will be rebuilt: '%s'", indexFile.Get() );
+            m_Entries.Clear();
+            return false;
+        }
+    }
+
+    // Chunks in use (or awaiting deletion)
+    if ( version >= 2 )
+    {
+        uint32_t numChunks = 0;
+        if ( stream.Read( numChunks ) == false )
+        {
+            numChunks = 0;
+        }
+        m_Chunks.SetCapacity( numChunks );
+        for ( uint32_t i = 0; i < numChunks; ++i )
+        {
+            ChunkInfo & chunk = m_Chunks.EmplaceBack();
+            if ( ( stream.Read( chunk.m_Chunk.m_Hash ) == false ) ||
+                 ( stream.Read( chunk.m_Chunk.m_Size ) == false ) ||
+                 ( stream.Read( chunk.m_StoredSize ) == false ) )
+            {
+                FLOG_WARN( "Cache index is invalid and will be rebuilt: '%s'", indexFile.Get() );
+                m_Entries.Clear();
+                m_Chunks.Clear();
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// AddEntry
+//------------------------------------------------------------------------------
+void CacheIndex::AddEntry( const AString & cacheId, uint64_t size, uint64_t lastAccessTime )
+{
+    Entry & entry = m_Entries.EmplaceBack();
+    entry.m_CacheId = cacheId;
+    entry.m_Size = size;
+    entry.m_LastAccessTime = lastAccessTime;
+}
+
+// MergeAccessLogs
+//------------------------------------------------------------------------------
+void CacheIndex::MergeAccessLogs()
+{
+    PROFILE_FUNCTION;
+
+    // Include our own accesses
+    FlushAccessLog();
+
+    ReadAccessLogs( m_Entries, m_MergedAccessLogs );
+}
+
+// SortByLastAccessTime
+//------------------------------------------------------------------------------
+void CacheIndex::SortByLastAccessTime()
+{
+    PROFILE_FUNCTION;
+
+    const LastAccessTimeSorter sorter;
+    m_Entries.Sort( sorter );
+}
+
+// Save
+//------------------------------------------------------------------------------
+bool CacheIndex::Save()
+{
+    PROFILE_FUNCTION;
+
+    MemoryStream ms;
+    ms.WriteBuffer( kIndexMagic, sizeof( kIndexMagic ) );
+    ms.Write( kVersion );
+    ms.Write( static_cast<uint32_t>( m_Entries.GetSize() ) );
+    for ( const Entry & entry : m_Entries )
+    {
+        WriteEntry( ms, entry );
+    }
+    ms.Write( static_cast<uint32_t>( m_Chunks.GetSize() ) );
+    for ( const ChunkInfo & chunk : m_Chunks )
+    {
+        ms.Write( chunk.m_Chunk.m_Hash );
+        ms.Write( chunk.m_Chunk.m_Size );
+        ms.Write( chunk.m_StoredSize );
+    }
+
+    AStackString indexFile( m_IndexPath );
+    indexFile += kIndexFileName;
+    if ( ( FileIO::EnsurePathExists( m_IndexPath ) == false ) ||
+         ( WriteFileAtomic( indexFile, ms.GetData(), ms.GetSize() ) == false ) )
+    {
+        FLOG_ERROR( "Failed to write cache index '%s'", indexFile.Get() );
+        return false;
+    }
+
+    // Merged logs are now redundant
+    for ( const AString & accessLog : m_MergedAccessLogs )
+    {
+        FileIO::FileDelete( accessLog.Get() );
+    }
+    m_MergedAccessLogs.Clear();
+    return true;
+}
+
+// GetUpdateLockFileName
+//------------------------------------------------------------------------------
+void CacheIndex::GetUpdateLockFileName( AString & outFileName ) const
+{
+    outFileName = m_IndexPath;
+    outFileName += kUpdateLockFileName;
+}
+
+// GetIndexPath
+//------------------------------------------------------------------------------
+/*static*/ void CacheIndex::GetIndexPath( const AString & cachePath, AString & outPath )
+{
+    // Cache entries are stored in hex named sub-dirs, so this can't collide
+    outPath.Format( "%sIndex%c", cachePath.Get(), NATIVE_SLASH );
+}
+
+// WriteAccessLog
+//------------------------------------------------------------------------------
+bool CacheIndex::WriteAccessLog( const Array<Entry> & entries )
+{
+    uint32_t logIndex;
+    {
+        MutexHolder mh( m_AccessLogMutex );
+        logIndex = m_NumAccessLogsWritten++;
+    }
+
+    MemoryStream ms;
+    ms.WriteBuffer( kAccessLogMagic, sizeof( kAccessLogMagic ) );
+    ms.Write( kVersion );
+    for ( const Entry & entry : entries )
+    {
+        WriteEntry( ms, entry );
+    }
+
+    // Name must be unique across all processes on all machines using the cache
+    AStackString hostName;
+    Network::GetHostName( hostName );
+    AStackString fileName;
+    fileName.Format( "%s%s_%u_%016" PRIX64 "_%u%s",
+                     m_IndexPath.Get(),
+                     hostName.Get(),
+                     Process::GetCurrentId(),
+                     Time::GetCurrentFileTime(),
+                     logIndex,
+                     kAccessLogExtension );
+
+    // Failure is not fatal (cache might be read-only), but entries will age
+    if ( ( FileIO::EnsurePathExists( m_IndexPath ) == false ) ||
+         ( WriteFileAtomic( fileName, ms.GetData(), ms.GetSize() ) == false ) )
+    {
+        FLOG_VERBOSE( "Failed to write cache access log '%s'", fileName.Get() );
+        return false;
+    }
+    return true;
+}
+
+// ReadAccessLogs
+//------------------------------------------------------------------------------
+void CacheIndex::ReadAccessLogs( Array<Entry> & inoutEntries, Array<AString> & outReadLogs ) const
+{
+    Array<AString> accessLogs;
+    FileIO::GetFiles( m_IndexPath, AStackString( "*.log" ), false, &accessLogs );
+    if ( accessLogs.IsEmpty() )
+    {
+        return;
+    }
+
+    // Map existing entries
+    UnorderedMap<AString, uint32_t> entryMap;
+    for ( size_t i = 0; i < inoutEntries.GetSize(); ++i )
+    {
+        entryMap.Insert( inoutEntries[ i ].m_CacheId, static_cast<uint32_t>( i ) );
+    }
+
+    for ( const AString & accessLog : accessLogs )
+    {
+        MemoryMappedFile mmf;
+        if ( mmf.Open( accessLog.Get() ) == false )
+        {
+            continue; // Retry next time
+        }
+
+        // Apply as many records as possible, but consume even invalid logs
+        // so they don't accumulate
+        ConstMemoryStream stream( mmf.GetData(), mmf.GetSize() );
+        char magic[ 3 ];
+        uint8_t version = 0;
+        if ( ( stream.ReadBuffer( magic, sizeof( magic ) ) == sizeof( magic ) ) &&
+             ( memcmp( magic, kAccessLogMagic, sizeof( magic ) ) == 0 ) &&
+             stream.Read( version ) && ( version >= kMinVersion ) && ( version <= kVersion ) )
+        {
+            Entry access;
+            while ( ReadEntry( stream, version, access ) )
+            {
+                UnorderedMap<AString, uint32_t>::KeyValue * existing = entryMap.Find( access.m_CacheId );
+                if ( existing )
+                {
+                    Entry & entry = inoutEntries[ existing->m_Value ];
+                    entry.m_Size = access.m_Size;
+                    entry.m_LastAccessTime = Math::Max( entry.m_LastAccessTime, access.m_LastAccessTime );
+
+                    // Publishing replaces the entry, releasing any chunks it
+                    // used before (which remain in the chunk list until deleted)
+                    if ( access.m_ChunksKnown )
+                    {
+                        entry.m_ChunksKnown = true;
+                        entry.m_Chunks.Swap( access.m_Chunks );
+                    }
+                }
+                else
+                {
+                    entryMap.Insert( access.m_CacheId, static_cast<uint32_t>( inoutEntries.GetSize() ) );
+                    inoutEntries.Append( access );
+                }
+            }
+        }
+        outReadLogs.Append( accessLog );
+    }
+}
+
+// CompactAccessLogs
+//------------------------------------------------------------------------------
+void CacheIndex::CompactAccessLogs()
+{
+    // Without trimming, every build adds a log, so replace them with a single
+    // log once there are too many
+    Array<AString> accessLogs;
+    FileIO::GetFiles( m_IndexPath, AStackString( "*.log" ), false, &accessLogs );
+    if ( accessLogs.GetSize() <= kMaxAccessLogs )
+    {
+        return;
+    }
+
+    PROFILE_FUNCTION;
+
+    // Skip if a trim (or another compaction) is consuming the logs
+    AStackString lockFileName;
+    GetUpdateLockFileName( lockFileName );
+    CacheLockFile lock( lockFileName, kUpdateLockStaleSecs );
+    if ( lock.TryLock() == false )
+    {
+        return;
+    }
+
+    // Logs hold only recent accesses, so they can't be turned into an index
+    // (which must contain every entry) and are merged into a log instead
+    Array<Entry> entries;
+    Array<AString> readLogs;
+    ReadAccessLogs( entries, readLogs );
+    if ( ( readLogs.GetSize() > 1 ) && WriteAccessLog( entries ) )
+    {
+        for ( const AString & accessLog : readLogs )
+        {
+            FileIO::FileDelete( accessLog.Get() );
+        }
+    }
+}
+
+// ReadEntry
+//------------------------------------------------------------------------------
+/*static*/ bool CacheIndex::ReadEntry( IOStream & stream, uint8_t version, Entry & outEntry )
+{
+    uint32_t len = 0;
+    if ( ( stream.Read( len ) == false ) || ( len == 0 ) || ( len > kMaxCacheIdLength ) )
+    {
+        return false;
+    }
+    outEntry.m_CacheId.SetLength( len );
+    if ( ( stream.ReadBuffer( outEntry.m_CacheId.Get(), len ) != len ) ||
+         ( stream.Read( outEntry.m_Size ) == false ) ||
+         ( stream.Read( outEntry.m_LastAccessTime ) == false ) )
+    {
+        return false;
+    }
+
+    outEntry.m_ChunksKnown = false;
+    outEntry.m_Chunks.Clear();
+    if ( version < 2 )
+    {
+        return true;
+    }
+    uint32_t numChunks = 0;
+    if ( stream.Read( numChunks ) == false )
+    {
+        return false;
+    }
+    if ( numChunks == kUnknownChunks )
+    {
+        return true;
+    }
+    const uint64_t chunkRecordSize = ( sizeof( uint64_t ) + sizeof( uint32_t ) );
+    if ( numChunks > ( ( stream.GetFileSize() - stream.Tell() ) / chunkRecordSize ) )
+    {
+        return false;
+    }
+    outEntry.m_ChunksKnown = true;
+    outEntry.m_Chunks.SetCapacity( numChunks );
+    for ( uint32_t i = 0; i < numChunks; ++i )
+    {
+        Chunk & chunk = outEntry.m_Chunks.EmplaceBack();
+        if ( ( stream.Read( chunk.m_Hash ) == false ) ||
+             ( stream.Read( chunk.m_Size ) == false ) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// WriteEntry
+//------------------------------------------------------------------------------
+/*static*/ bool CacheIndex::WriteEntry( IOStream & stream, const Entry & entry )
+{
+    ASSERT( entry.m_CacheId.GetLength() <= kMaxCacheIdLength );
+    bool ok = stream.Write( entry.m_CacheId );
+    ok &= stream.Write( entry.m_Size );
+    ok &= stream.Write( entry.m_LastAccessTime );
+    if ( entry.m_ChunksKnown == false )
+    {
+        ok &= stream.Write( kUnknownChunks );
+        return ok;
+    }
+    ok &= stream.Write( static_cast<uint32_t>( entry.m_Chunks.GetSize() ) );
+    for ( const Chunk & chunk : entry.m_Chunks )
+    {
+        ok &= stream.Write( chunk.m_Hash );
+        ok &= stream.Write( chunk.m_Size );
+    }
+    return ok;
+}
+
+// WriteFileAtomic
+//------------------------------------------------------------------------------
+/*static*/ bool CacheIndex::WriteFileAtomic( const AString & fileName, const void * data, size_t dataSize )
+{
+    // Write to a tmp file and rename, so readers never see partial files
+    AStackString fileNameTmp( fileName );
+    fileNameTmp += ".tmp";
+    FileStream f;
+    if ( f.Open( fileNameTmp.Get(), FileStream::WRITE_ONLY ) == false )
+    {
+        return false;
+    }
+    const bool writeOk = ( f.WriteBuffer( data, dataSize ) == dataSize );
+    f.Close();
+    if ( ( writeOk == false ) || ( FileIO::FileMove( fileNameTmp, fileName ) == false ) )
+    {
+        FileIO::FileDelete( fileNameTmp.Get() );
+        return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,117 @@
+// CacheIndex - Persistent LRU index of cache entries
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Strings/AString.h"
+#include "Core/Time/Timer.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class IOStream;
+
+// CacheIndex
+//  - Tracks when cache entries were last accessed (published or retrieved), so
+//    trimming can evict the least recently used entries without enumerating
+//    the cache.
+//  - Accesses are buffered in memory and written to an access log unique to
+//    this process. Many clients can therefore record accesses concurrently
+//    without any locking.
+//  - When trimming, access logs are merged into the index, which is then
+//    saved and the consumed logs deleted.
+//  - Publishing records the chunks used by deduplicated entries, so the
+//    index also tracks which chunks are in use without reading manifests.
+//  - Merging, saving and deleting logs is done under an update lock, so
+//    concurrent trims can't lose each other's updates. When many logs
+//    accumulate between trims, they are compacted into one by whichever
+//    process can take the lock.
+//------------------------------------------------------------------------------
+class CacheIndex
+{
+public:
+    explicit CacheIndex();
+    ~CacheIndex();
+
+    void Init( const AString & cachePath );
+
+    // A chunk of a deduplicated entry (See CacheChunkStore)
+    class Chunk
+    {
+    public:
+        uint64_t m_Hash;
+        uint32_t m_Size;
+    };
+
+    // Record accesses (thread-safe)
+    void RecordAccess( const AString & cacheId, uint64_t size );
+    void RecordPublish( const AString & cacheId, uint64_t size, const Array<Chunk> & chunks );
+    void FlushAccessLog();
+
+    // Entries known to the index
+    class Entry
+    {
+    public:
+        AString m_CacheId;
+        uint64_t m_Size = 0;
+        uint64_t m_LastAccessTime = 0;
+        bool m_ChunksKnown = false; // Only known for entries published since the index was created
+        Array<Chunk> m_Chunks;
+    };
+
+    // Chunks used by entries, plus unused chunks which are yet to be deleted
+    class ChunkInfo
+    {
+    public:
+        Chunk m_Chunk;
+        uint64_t m_StoredSize;
+    };
+
+    // Load the index, merging any outstanding access logs. Returns false if
+    // there is no existing index (the cache must then be enumerated).
+    [[nodiscard]] bool Load();
+    void AddEntry( const AString & cacheId, uint64_t size, uint64_t lastAccessTime );
+    void MergeAccessLogs();
+    void SortByLastAccessTime();
+
+    [[nodiscard]] Array<Entry> & GetEntries() { return m_Entries; }
+    [[nodiscard]] Array<ChunkInfo> & GetChunks() { return m_Chunks; }
+
+    // Write the index, removing access logs which were merged into it
+    bool Save();
+
+    // Lock which must be held while loading, merging and saving the index
+    void GetUpdateLockFileName( AString & outFileName ) const;
+    inline static const uint32_t kUpdateLockStaleSecs = ( 10 * 60 ); // Refreshed while held
+
+    // Files used by the index within the cache
+    static void GetIndexPath( const AString & cachePath, AString & outPath );
+
+private:
+    void AddPendingAccess( const AString & cacheId, uint64_t size, const Array<Chunk> * chunks );
+    bool WriteAccessLog( const Array<Entry> & entries );
+    void ReadAccessLogs( Array<Entry> & inoutEntries, Array<AString> & outReadLogs ) const;
+    void CompactAccessLogs();
+
+    static bool ReadEntry( IOStream & stream, uint8_t version, Entry & outEntry );
+    static bool WriteEntry( IOStream & stream, const Entry & entry );
+    static bool WriteFileAtomic( const AString & fileName, const void * data, size_t dataSize );
+
+    AString m_IndexPath;
+
+    // Pending accesses from this process
+    Mutex m_AccessLogMutex;
+    Array<Entry> m_PendingAccesses;
+    uint32_t m_NumAccessLogsWritten = 0;
+    Timer m_TimeSinceFlush;
+
+    // Index entries, used when trimming
+    Array<Entry> m_Entries;
+    Array<ChunkInfo> m_Chunks;
+    Array<AString> m_MergedAccessLogs;
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,134 @@
+// CacheLockFile - Lock shared by all processes using a cache
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CacheLockFile.h"
+
+// Core
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Time.h"
+#include "Core/Time/Timer.h"
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CacheLockFile::CacheLockFile( const AString & lockFileName, uint32_t staleSecs )
+    : m_LockFileName( lockFileName )
+    , m_StaleSecs( staleSecs )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CacheLockFile::~CacheLockFile()
+{
+    Unlock();
+}
+
+// TryLock
+//------------------------------------------------------------------------------
+bool CacheLockFile::TryLock()
+{
+    ASSERT( m_Locked == false );
+
+    FileStream f;
+    if ( f.Open( m_LockFileName.Get(), FileStream::CREATE_NEW_WRITE_ONLY ) )
+    {
+        m_Locked = true;
+        return true;
+    }
+
+    // Break locks left behind by processes which died while holding them
+    if ( BreakIfStale() && f.Open( m_LockFileName.Get(), FileStream::CREATE_NEW_WRITE_ONLY ) )
+    {
+        m_Locked = true;
+        return true;
+    }
+    return false;
+}
+
+// Lock
+//------------------------------------------------------------------------------
+bool CacheLockFile::Lock( float timeoutSecs )
+{
+    const Timer timer;
+    for ( ;; )
+    {
+        if ( TryLock() )
+        {
+            return true;
+        }
+        if ( timer.GetElapsed() >= timeoutSecs )
+        {
+            return false;
+        }
+        Thread::Sleep( 1 );
+    }
+}
+
+// Unlock
+//------------------------------------------------------------------------------
+void CacheLockFile::Unlock()
+{
+    if ( m_Locked )
+    {
+        FileIO::FileDelete( m_LockFileName.Get() );
+        m_Locked = false;
+    }
+}
+
+// Refresh
+//------------------------------------------------------------------------------
+void CacheLockFile::Refresh()
+{
+    ASSERT( m_Locked );
+    FileIO::SetFileLastWriteTimeToNow( m_LockFileName );
+}
+
+// BreakIfStale
+//------------------------------------------------------------------------------
+bool CacheLockFile::BreakIfStale()
+{
+    if ( IsStale( m_LockFileName ) == false )
+    {
+        return false;
+    }
+
+    // Only one process can break the lock. Without this, a process could
+    // delete the lock which another breaker has just re-created.
+    AStackString breakFileName( m_LockFileName );
+    breakFileName += ".break";
+    {
+        FileStream f;
+        if ( f.Open( breakFileName.Get(), FileStream::CREATE_NEW_WRITE_ONLY ) == false )
+        {
+            // The break lock is held only briefly, so a stale one was left
+            // by a process which died while breaking
+            if ( IsStale( breakFileName ) )
+            {
+                FileIO::FileDelete( breakFileName.Get() );
+            }
+            return false;
+        }
+    }
+
+    // The lock may have been broken and re-acquired since it was checked
+    const bool broken = IsStale( m_LockFileName ) && FileIO::FileDelete( m_LockFileName.Get() );
+    FileIO::FileDelete( breakFileName.Get() );
+    return broken;
+}
+
+// IsStale
+//------------------------------------------------------------------------------
+bool CacheLockFile::IsStale( const AString & fileName ) const
+{
+    const uint64_t lockTime = FileIO::GetFileLastWriteTime( fileName );
+    const uint64_t now = Time::GetCurrentFileTime();
+    return ( ( lockTime != 0 ) && ( now > lockTime ) &&
+             ( ( Time::FileTimeToSeconds( now ) - Time::FileTimeToSeconds( lockTime ) ) > m_StaleSecs ) );
+}
+
+//------------------------------------------------------------------------------
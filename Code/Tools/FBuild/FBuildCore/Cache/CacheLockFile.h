@@ -0,0 +1,43 @@
+// CacheLockFile - Lock shared by all processes using a cache
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Strings/AString.h"
+
+// CacheLockFile
+//  - Held by exclusively creating a lock file, which is deleted when released.
+//  - Locks left behind by processes which died while holding them are broken
+//    once older than the given age. Breaking is serialized by a second lock
+//    file, under which staleness is re-checked, so a lock which another
+//    process has just re-created is never deleted.
+//  - Holders of long lived locks must Refresh them to avoid being broken.
+//------------------------------------------------------------------------------
+class CacheLockFile
+{
+public:
+    explicit CacheLockFile( const AString & lockFileName, uint32_t staleSecs );
+    ~CacheLockFile();
+
+    // Acquire the lock, waiting up to the given time for other holders
+    [[nodiscard]] bool TryLock();
+    [[nodiscard]] bool Lock( float timeoutSecs );
+    void Unlock();
+    [[nodiscard]] bool IsLocked() const { return m_Locked; }
+    [[nodiscard]] const AString & GetFileName() const { return m_LockFileName; }
+
+    // Prevent a held lock from being considered stale
+    void Refresh();
+
+private:
+    bool BreakIfStale();
+    bool IsStale( const AString & fileName ) const;
+
+    AString m_LockFileName;
+    uint32_t m_StaleSecs;
+    bool m_Locked = false;
+};
+
+//------------------------------------------------------------------------------
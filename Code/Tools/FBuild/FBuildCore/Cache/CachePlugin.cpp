@@ -250,4 +250,18 @@ void * CachePlugin::GetFunction( const char * name, const char * mangledName, bo
     return false;
 }
 
+// BuildIndex
+//------------------------------------------------------------------------------
+/*virtual*/ bool CachePlugin::BuildIndex( bool /*showProgress*/ )
+{
+    if ( m_Valid == false )
+    {
+        return false;
+    }
+
+    // Not part of the plugin interface
+    OUTPUT( "CachePlugin does not support BuildIndex.\n" );
+    return false;
+}
+
 //------------------------------------------------------------------------------
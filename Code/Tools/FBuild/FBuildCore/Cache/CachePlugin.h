@@ -32,6 +32,7 @@ public:
     virtual void FreeMemory( void * data, size_t dataSize ) override;
     virtual bool OutputInfo( bool showProgress ) override;
     virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override;
+    virtual bool BuildIndex( bool showProgress ) override;
 
 private:
     void * GetFunction( const char * friendlyName, const char * mangledName = nullptr, bool optional = false );
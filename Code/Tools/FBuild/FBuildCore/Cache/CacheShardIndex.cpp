@@ -0,0 +1,658 @@
+// CacheShardIndex - Sharded index of cache entries for existence checks
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CacheShardIndex.h"
+
+// FBuild
+#include "Tools/FBuild/FBuildCore/Cache/CacheLockFile.h"
+#include "Tools/FBuild/FBuildCore/FLog.h"
+
+// Core
+#include "Core/Containers/Move.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Time.h"
+
+// system
+#include <stddef.h> // for offsetof
+#include <string.h> // for memcmp, memcpy
+
+// Defines
+//------------------------------------------------------------------------------
+namespace
+{
+    const char kShardMagic[ 4 ] = { 'F', 'C', 'S', 1 };
+    const uint32_t kMinShardCapacity = 1024;    // Slots
+    const uint64_t kDeletedSize = (uint64_t)-1; // Slot is left in place when removed
+    const float kRemapIntervalSecs = 10.0f;     // Bounds how stale mappings of shards on network shares can be
+    const float kLockTimeoutSecs = 5.0f;        // Give up on updating a shard after this long
+    const float kAddLockTimeoutSecs = 0.0f;     // Don't block publishing on other processes
+    const uint32_t kStaleLockSecs = 30;         // Locks older than this were abandoned by a crashed process
+}
+
+// ShardHeader
+//------------------------------------------------------------------------------
+class ShardHeader
+{
+public:
+    char m_Magic[ 4 ];
+    uint32_t m_Capacity;       // Number of slots (power of 2)
+    uint32_t m_NextGeneration; // Set when this shard has been replaced
+    uint32_t m_NumUsedSlots;   // Including removed entries
+};
+static_assert( sizeof( ShardHeader ) == 16, "Unexpected padding" );
+
+// Slot
+//------------------------------------------------------------------------------
+class CacheShardIndex::Slot
+{
+public:
+    uint64_t m_Key; // 0 if slot is empty
+    uint64_t m_Size;
+    uint64_t m_Time;
+};
+
+// SlotKeySorter
+//------------------------------------------------------------------------------
+template <class T>
+class SlotKeySorter
+{
+public:
+    bool operator()( const T & a, const T & b ) const
+    {
+        return ( a.m_Key < b.m_Key );
+    }
+};
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CacheShardIndex::CacheShardIndex() = default;
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CacheShardIndex::~CacheShardIndex() = default;
+
+// Init
+//------------------------------------------------------------------------------
+void CacheShardIndex::Init( const AString & cachePath )
+{
+    PROFILE_FUNCTION;
+
+    GetShardsPath( cachePath, m_ShardsPath );
+
+    // Find the latest generation of each shard. Shards are mapped on first use.
+    Array<AString> shardFiles;
+    FileIO::GetFiles( m_ShardsPath, AStackString( "*.idx" ), false, &shardFiles );
+    for ( const AString & shardFile : shardFiles )
+    {
+        const char * fileName = shardFile.FindLast( NATIVE_SLASH );
+        fileName = fileName ? ( fileName + 1 ) : shardFile.Get();
+        uint32_t shardIndex = 0;
+        uint32_t generation = 0;
+        if ( ( AString::ScanS( fileName, "%02X_%08X.idx", &shardIndex, &generation ) == 2 ) &&
+             ( shardIndex < kNumShards ) )
+        {
+            m_Shards[ shardIndex ].m_Generation = Math::Max( m_Shards[ shardIndex ].m_Generation, generation );
+            m_Enabled = true;
+        }
+    }
+}
+
+// MightContain
+//------------------------------------------------------------------------------
+bool CacheShardIndex::MightContain( const AString & cacheId )
+{
+    ASSERT( m_Enabled );
+
+    const uint64_t key = GetKey( cacheId );
+    const uint32_t shardIndex = GetShardIndex( key );
+    Shard & shard = m_Shards[ shardIndex ];
+
+    MutexHolder mh( shard.m_Mutex );
+
+    // Refresh the mapping if the shard has been replaced, or periodically as
+    // mappings of files on network shares may not see changes from other
+    // machines.
+    const ShardHeader * header = static_cast<const ShardHeader *>( shard.m_File.GetData() );
+    if ( ( header == nullptr ) ||
+         ( header->m_NextGeneration != 0 ) ||
+         ( shard.m_TimeSinceMapped.GetElapsed() > kRemapIntervalSecs ) )
+    {
+        if ( MapShard( shard, shardIndex ) == false )
+        {
+            return true; // Unknown
+        }
+    }
+
+    const Slot * slot = FindSlot( shard.m_File.GetData(), shard.m_File.GetSize(), key );
+    if ( slot == nullptr )
+    {
+        return true; // Unknown
+    }
+    return ( ( slot->m_Key == key ) && ( slot->m_Size != kDeletedSize ) );
+}
+
+// Add
+//------------------------------------------------------------------------------
+void CacheShardIndex::Add( const AString & cacheId, uint64_t size )
+{
+    if ( m_Enabled == false )
+    {
+        return;
+    }
+
+    PROFILE_FUNCTION;
+
+    if ( TryAdd( GetKey( cacheId ), size, kAddLockTimeoutSecs ) == false )
+    {
+        MutexHolder mh( m_PendingAddsMutex );
+        CacheIndex::Entry & entry = m_PendingAdds.EmplaceBack();
+        entry.m_CacheId = cacheId;
+        entry.m_Size = size;
+    }
+}
+
+// FlushPendingAdds
+//------------------------------------------------------------------------------
+void CacheShardIndex::FlushPendingAdds( Array<AString> & outFailedCacheIds )
+{
+    Array<CacheIndex::Entry> pendingAdds;
+    {
+        MutexHolder mh( m_PendingAddsMutex );
+        pendingAdds.Swap( m_PendingAdds );
+    }
+
+    PROFILE_FUNCTION;
+
+    for ( CacheIndex::Entry & entry : pendingAdds )
+    {
+        if ( TryAdd( GetKey( entry.m_CacheId ), entry.m_Size, kLockTimeoutSecs ) == false )
+        {
+            outFailedCacheIds.Append( Move( entry.m_CacheId ) );
+        }
+    }
+}
+
+// Update
+//------------------------------------------------------------------------------
+bool CacheShardIndex::Update( const Array<CacheIndex::Entry> & entries,
+                              const Array<AString> & removedCacheIds,
+                              bool create )
+{
+    if ( ( m_Enabled == false ) && ( create == false ) )
+    {
+        return true;
+    }
+
+    PROFILE_FUNCTION;
+
+    if ( FileIO::EnsurePathExists( m_ShardsPath ) == false )
+    {
+        FLOG_ERROR( "Failed to create cache index '%s'", m_ShardsPath.Get() );
+        return false;
+    }
+
+    // Split entries by shard
+    Array<Slot> added[ kNumShards ];
+    for ( const CacheIndex::Entry & entry : entries )
+    {
+        const uint64_t key = GetKey( entry.m_CacheId );
+        added[ GetShardIndex( key ) ].Append( Slot{ key, entry.m_Size, entry.m_LastAccessTime } );
+    }
+    Array<uint64_t> removed[ kNumShards ];
+    for ( const AString & cacheId : removedCacheIds )
+    {
+        const uint64_t key = GetKey( cacheId );
+        removed[ GetShardIndex( key ) ].Append( key );
+    }
+
+    // Files for previous generations which could not be deleted when they
+    // were replaced (mapped by other processes on Windows)
+    Array<AString> shardFiles;
+    FileIO::GetFiles( m_ShardsPath, AStackString( "*.idx" ), false, &shardFiles );
+
+    bool ok = true;
+    const SlotKeySorter<Slot> sorter;
+    for ( uint32_t shardIndex = 0; shardIndex < kNumShards; ++shardIndex )
+    {
+        AStackString lockFileName;
+        GetShardLockFileName( shardIndex, lockFileName );
+        CacheLockFile lock( lockFileName, kStaleLockSecs );
+        if ( lock.Lock( kLockTimeoutSecs ) == false )
+        {
+            FLOG_ERROR( "Failed to lock cache index shard '%s'", lockFileName.Get() );
+            ok = false;
+            continue;
+        }
+
+        // Get the existing entries
+        uint32_t generation;
+        {
+            MutexHolder mh( m_Shards[ shardIndex ].m_Mutex );
+            generation = m_Shards[ shardIndex ].m_Generation;
+        }
+        Array<Slot> existing;
+        if ( generation != 0 )
+        {
+            ReadShard( shardIndex, generation, existing ); // Rebuilt if corrupt
+        }
+
+        // Merge in sorted key order, preferring existing entries as they record
+        // when entries were added
+        existing.Sort( sorter );
+        added[ shardIndex ].Sort( sorter );
+        removed[ shardIndex ].Sort();
+        Array<Slot> merged;
+        merged.SetCapacity( existing.GetSize() + added[ shardIndex ].GetSize() );
+        const Slot * a = existing.Begin();
+        const Slot * b = added[ shardIndex ].Begin();
+        const uint64_t * r = removed[ shardIndex ].Begin();
+        while ( ( a != existing.End() ) || ( b != added[ shardIndex ].End() ) )
+        {
+            Slot slot;
+            if ( ( b == added[ shardIndex ].End() ) || ( ( a != existing.End() ) && ( a->m_Key <= b->m_Key ) ) )
+            {
+                slot = *a;
+                if ( ( b != added[ shardIndex ].End() ) && ( a->m_Key == b->m_Key ) )
+                {
+                    slot.m_Size = b->m_Size;
+                    ++b;
+                }
+                ++a;
+            }
+            else
+            {
+                slot = *b++;
+            }
+
+            while ( ( r != removed[ shardIndex ].End() ) && ( *r < slot.m_Key ) )
+            {
+                ++r;
+            }
+            if ( ( r != removed[ shardIndex ].End() ) && ( *r == slot.m_Key ) )
+            {
+                continue;
+            }
+            merged.Append( slot );
+        }
+
+        if ( WriteShard( shardIndex, generation, merged ) == false )
+        {
+            ok = false;
+            continue;
+        }
+
+        // Clean up older generations
+        AStackString shardPrefix;
+        shardPrefix.Format( "%s%02X_", m_ShardsPath.Get(), shardIndex );
+        AStackString currentFileName;
+        GetShardFileName( shardIndex, m_Shards[ shardIndex ].m_Generation, currentFileName );
+        for ( const AString & shardFile : shardFiles )
+        {
+            if ( shardFile.BeginsWith( shardPrefix ) && ( shardFile != currentFileName ) )
+            {
+                FileIO::FileDelete( shardFile.Get() );
+            }
+        }
+    }
+
+    m_Enabled = true;
+    return ok;
+}
+
+// GetEntries
+//------------------------------------------------------------------------------
+void CacheShardIndex::GetEntries( Array<EntryInfo> & outEntries, uint64_t & outTotalSize )
+{
+    PROFILE_FUNCTION;
+
+    outTotalSize = 0;
+    for ( uint32_t shardIndex = 0; shardIndex < kNumShards; ++shardIndex )
+    {
+        Shard & shard = m_Shards[ shardIndex ];
+        MutexHolder mh( shard.m_Mutex );
+        if ( MapShard( shard, shardIndex ) == false )
+        {
+            continue;
+        }
+        const ShardHeader * header = static_cast<const ShardHeader *>( shard.m_File.GetData() );
+        const Slot * slots = reinterpret_cast<const Slot *>( header + 1 );
+        for ( uint32_t i = 0; i < header->m_Capacity; ++i )
+        {
+            if ( ( slots[ i ].m_Key != 0 ) && ( slots[ i ].m_Size != kDeletedSize ) )
+            {
+                outEntries.Append( EntryInfo{ slots[ i ].m_Size, slots[ i ].m_Time } );
+                outTotalSize += slots[ i ].m_Size;
+            }
+        }
+    }
+}
+
+// GetShardsPath
+//------------------------------------------------------------------------------
+/*static*/ void CacheShardIndex::GetShardsPath( const AString & cachePath, AString & outPath )
+{
+    CacheIndex::GetIndexPath( cachePath, outPath );
+    outPath.AppendFormat( "Shards%c", NATIVE_SLASH );
+}
+
+// GetKey
+//------------------------------------------------------------------------------
+/*static*/ uint64_t CacheShardIndex::GetKey( const AString & cacheId )
+{
+    const uint64_t key = xxHash3::Calc64( cacheId );
+    return ( key != 0 ) ? key : 1; // 0 indicates an empty slot
+}
+
+// TryAdd
+//------------------------------------------------------------------------------
+bool CacheShardIndex::TryAdd( uint64_t key, uint64_t size, float lockTimeoutSecs )
+{
+    const uint32_t shardIndex = GetShardIndex( key );
+
+    AStackString lockFileName;
+    GetShardLockFileName( shardIndex, lockFileName );
+    CacheLockFile lock( lockFileName, kStaleLockSecs );
+    if ( lock.Lock( lockTimeoutSecs ) == false )
+    {
+        FLOG_VERBOSE( "Failed to lock cache index shard '%s'", lockFileName.Get() );
+        return false;
+    }
+
+    // Find the current generation
+    uint32_t generation;
+    {
+        MutexHolder mh( m_Shards[ shardIndex ].m_Mutex );
+        generation = m_Shards[ shardIndex ].m_Generation;
+    }
+    MemoryMappedFile mmf;
+    if ( OpenShard( shardIndex, generation, mmf ) == false )
+    {
+        return true; // Missing or corrupt shards can't answer lookups, so all entries are found
+    }
+    const Slot * slot = FindSlot( mmf.GetData(), mmf.GetSize(), key );
+    if ( slot == nullptr )
+    {
+        return true; // Full (should never happen), so all lookups are found
+    }
+    const ShardHeader header = *static_cast<const ShardHeader *>( mmf.GetData() );
+    const bool newSlot = ( slot->m_Key == 0 );
+
+    // Grow (or compact away removed entries) if too full
+    if ( newSlot && ( ( ( header.m_NumUsedSlots + 1 ) * 2 ) > header.m_Capacity ) )
+    {
+        mmf.Close();
+        Array<Slot> slots;
+        if ( ReadShard( shardIndex, generation, slots ) == false )
+        {
+            return false;
+        }
+        slots.Append( Slot{ key, size, Time::GetCurrentFileTime() } );
+        return WriteShard( shardIndex, generation, slots );
+    }
+
+    // Update in place. The key is written last (along with the rest of the
+    // slot) so readers never see a key without its data.
+    const uint64_t slotOffset = static_cast<uint64_t>( (const char *)slot - (const char *)mmf.GetData() );
+    mmf.Close();
+    AStackString fileName;
+    GetShardFileName( shardIndex, generation, fileName );
+    FileStream f;
+    if ( f.Open( fileName.Get(), FileStream::OPEN_OR_CREATE_READ_WRITE ) == false )
+    {
+        return false;
+    }
+    const Slot newValue{ key, size, Time::GetCurrentFileTime() };
+    bool ok = f.Seek( slotOffset + sizeof( uint64_t ) );
+    ok = ok && ( f.WriteBuffer( &newValue.m_Size, sizeof( Slot ) - sizeof( uint64_t ) ) == ( sizeof( Slot ) - sizeof( uint64_t ) ) );
+    if ( newSlot )
+    {
+        ok = ok && f.Seek( slotOffset ) && f.Write( newValue.m_Key );
+        ok = ok && f.Seek( offsetof( ShardHeader, m_NumUsedSlots ) ) && f.Write( header.m_NumUsedSlots + 1 );
+    }
+    return ok;
+}
+
+// GetShardFileName
+//------------------------------------------------------------------------------
+void CacheShardIndex::GetShardFileName( uint32_t shardIndex, uint32_t generation, AString & outFileName ) const
+{
+    outFileName.Format( "%s%02X_%08X.idx", m_ShardsPath.Get(), shardIndex, generation );
+}
+
+// GetShardLockFileName
+//------------------------------------------------------------------------------
+void CacheShardIndex::GetShardLockFileName( uint32_t shardIndex, AString & outFileName ) const
+{
+    outFileName.Format( "%s%02X.lock", m_ShardsPath.Get(), shardIndex );
+}
+
+// MapShard
+//------------------------------------------------------------------------------
+bool CacheShardIndex::MapShard( Shard & shard, uint32_t shardIndex )
+{
+    // Caller holds the shard mutex
+    shard.m_File.Close();
+    shard.m_TimeSinceMapped.Restart();
+    return OpenShard( shardIndex, shard.m_Generation, shard.m_File );
+}
+
+// OpenShard
+//------------------------------------------------------------------------------
+bool CacheShardIndex::OpenShard( uint32_t shardIndex, uint32_t & inOutGeneration, MemoryMappedFile & outFile ) const
+{
+    if ( inOutGeneration == 0 )
+    {
+        return false; // Shard doesn't exist
+    }
+
+    // Follow replaced generations to the latest
+    AStackString fileName;
+    for ( ;; )
+    {
+        GetShardFileName( shardIndex, inOutGeneration, fileName );
+        if ( outFile.Open( fileName.Get() ) == false )
+        {
+            // Generation may have been cleaned up - look for a newer one
+            const uint32_t latestGeneration = FindLatestGeneration( shardIndex );
+            if ( latestGeneration <= inOutGeneration )
+            {
+                return false;
+            }
+            inOutGeneration = latestGeneration;
+            continue;
+        }
+        if ( IsValid( outFile.GetData(), outFile.GetSize() ) == false )
+        {
+            outFile.Close();
+            return false;
+        }
+        const ShardHeader * header = static_cast<const ShardHeader *>( outFile.GetData() );
+        if ( header->m_NextGeneration == 0 )
+        {
+            return true;
+        }
+        inOutGeneration = header->m_NextGeneration;
+        outFile.Close();
+    }
+}
+
+// FindLatestGeneration
+//------------------------------------------------------------------------------
+uint32_t CacheShardIndex::FindLatestGeneration( uint32_t shardIndex ) const
+{
+    AStackString wildCard;
+    wildCard.Format( "%02X_*.idx", shardIndex );
+    Array<AString> shardFiles;
+    FileIO::GetFiles( m_ShardsPath, wildCard, false, &shardFiles );
+
+    uint32_t latestGeneration = 0;
+    for ( const AString & shardFile : shardFiles )
+    {
+        const char * fileName = shardFile.FindLast( NATIVE_SLASH );
+        fileName = fileName ? ( fileName + 1 ) : shardFile.Get();
+        uint32_t index = 0;
+        uint32_t generation = 0;
+        if ( ( AString::ScanS( fileName, "%02X_%08X.idx", &index, &generation ) == 2 ) && ( index == shardIndex ) )
+        {
+            latestGeneration = Math::Max( latestGeneration, generation );
+        }
+    }
+    return latestGeneration;
+}
+
+// IsValid
+//------------------------------------------------------------------------------
+/*static*/ bool CacheShardIndex::IsValid( const void * data, size_t dataSize )
+{
+    if ( dataSize < sizeof( ShardHeader ) )
+    {
+        return false;
+    }
+    const ShardHeader * header = static_cast<const ShardHeader *>( data );
+    return ( ( memcmp( header->m_Magic, kShardMagic, sizeof( kShardMagic ) ) == 0 ) &&
+             ( header->m_Capacity != 0 ) &&
+             ( ( header->m_Capacity & ( header->m_Capacity - 1 ) ) == 0 ) &&
+             ( dataSize >= ( sizeof( ShardHeader ) + ( (size_t)header->m_Capacity * sizeof( Slot ) ) ) ) );
+}
+
+// FindSlot
+//------------------------------------------------------------------------------
+/*static*/ const CacheShardIndex::Slot * CacheShardIndex::FindSlot( const void * data, size_t dataSize, uint64_t key )
+{
+    if ( IsValid( data, dataSize ) == false )
+    {
+        return nullptr;
+    }
+    const ShardHeader * header = static_cast<const ShardHeader *>( data );
+
+    // Linear probe for the key or the first empty slot
+    const Slot * slots = reinterpret_cast<const Slot *>( header + 1 );
+    const uint32_t mask = ( header->m_Capacity - 1 );
+    uint32_t index = static_cast<uint32_t>( key ) & mask;
+    for ( uint32_t i = 0; i < header->m_Capacity; ++i )
+    {
+        const Slot * slot = &slots[ index ];
+        if ( ( slot->m_Key == key ) || ( slot->m_Key == 0 ) )
+        {
+            return slot;
+        }
+        index = ( index + 1 ) & mask;
+    }
+    return nullptr; // Full (should never happen)
+}
+
+// ReadShard
+//------------------------------------------------------------------------------
+bool CacheShardIndex::ReadShard( uint32_t shardIndex, uint32_t & inOutGeneration, Array<Slot> & outSlots ) const
+{
+    // Caller holds the shard lock
+    MemoryMappedFile mmf;
+    if ( OpenShard( shardIndex, inOutGeneration, mmf ) == false )
+    {
+        return false;
+    }
+
+    // Take live entries
+    const ShardHeader * header = static_cast<const ShardHeader *>( mmf.GetData() );
+    const Slot * slots = reinterpret_cast<const Slot *>( header + 1 );
+    outSlots.SetCapacity( header->m_NumUsedSlots + 1 );
+    for ( uint32_t i = 0; i < header->m_Capacity; ++i )
+    {
+        if ( ( slots[ i ].m_Key != 0 ) && ( slots[ i ].m_Size != kDeletedSize ) )
+        {
+            outSlots.Append( slots[ i ] );
+        }
+    }
+    return true;
+}
+
+// WriteShard
+//------------------------------------------------------------------------------
+bool CacheShardIndex::WriteShard( uint32_t shardIndex, uint32_t oldGeneration, const Array<Slot> & slots )
+{
+    // Caller holds the shard lock
+
+    // Size for a low load factor, leaving room to add entries in place
+    uint32_t capacity = kMinShardCapacity;
+    while ( capacity < ( slots.GetSize() * 4 ) )
+    {
+        capacity *= 2;
+    }
+
+    // Build the new table
+    MemoryStream ms( sizeof( ShardHeader ) + ( capacity * sizeof( Slot ) ) );
+    ShardHeader header;
+    memcpy( header.m_Magic, kShardMagic, sizeof( kShardMagic ) );
+    header.m_Capacity = capacity;
+    header.m_NextGeneration = 0;
+    header.m_NumUsedSlots = static_cast<uint32_t>( slots.GetSize() );
+    ms.WriteBuffer( &header, sizeof( header ) );
+    const Slot empty{ 0, 0, 0 };
+    for ( uint32_t i = 0; i < capacity; ++i )
+    {
+        ms.WriteBuffer( &empty, sizeof( empty ) );
+    }
+    Slot * table = reinterpret_cast<Slot *>( static_cast<char *>( ms.GetDataMutable() ) + sizeof( ShardHeader ) );
+    const uint32_t mask = ( capacity - 1 );
+    for ( const Slot & slot : slots )
+    {
+        uint32_t index = static_cast<uint32_t>( slot.m_Key ) & mask;
+        while ( table[ index ].m_Key != 0 )
+        {
+            index = ( index + 1 ) & mask;
+        }
+        table[ index ] = slot;
+    }
+
+    // Write new generation. A new file is used rather than replacing the
+    // old one as replacing files which are mapped can fail on Windows.
+    const uint32_t newGeneration = ( oldGeneration + 1 );
+    AStackString fileName;
+    GetShardFileName( shardIndex, newGeneration, fileName );
+    AStackString fileNameTmp( fileName );
+    fileNameTmp += ".tmp";
+    FileStream f;
+    if ( f.Open( fileNameTmp.Get(), FileStream::WRITE_ONLY ) == false )
+    {
+        FLOG_ERROR( "Failed to write cache index shard '%s'", fileNameTmp.Get() );
+        return false;
+    }
+    const bool writeOk = ( f.WriteBuffer( ms.GetData(), ms.GetSize() ) == ms.GetSize() );
+    f.Close();
+    if ( ( writeOk == false ) || ( FileIO::FileMove( fileNameTmp, fileName ) == false ) )
+    {
+        FLOG_ERROR( "Failed to write cache index shard '%s'", fileName.Get() );
+        FileIO::FileDelete( fileNameTmp.Get() );
+        return false;
+    }
+
+    // Direct readers of the old generation to the new one. The old file is
+    // removed later by Update, once readers have had a chance to move on.
+    if ( oldGeneration != 0 )
+    {
+        AStackString oldFileName;
+        GetShardFileName( shardIndex, oldGeneration, oldFileName );
+        FileStream old;
+        if ( old.Open( oldFileName.Get(), FileStream::OPEN_OR_CREATE_READ_WRITE ) )
+        {
+            old.Seek( offsetof( ShardHeader, m_NextGeneration ) );
+            old.Write( newGeneration );
+            old.Close();
+        }
+    }
+
+    MutexHolder mh( m_Shards[ shardIndex ].m_Mutex );
+    m_Shards[ shardIndex ].m_Generation = Math::Max( m_Shards[ shardIndex ].m_Generation, newGeneration );
+    return true;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,102 @@
+// CacheShardIndex - Sharded index of cache entries for existence checks
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Cache/CacheIndex.h"
+
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/FileIO/MemoryMappedFile.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Strings/AString.h"
+#include "Core/Time/Timer.h"
+
+// CacheShardIndex
+//  - Optional index of the entries in the cache, allowing misses to be
+//    determined without accessing the (potentially remote) cache directories.
+//  - Entries are split into 256 shards by hash. Each shard is a file holding
+//    an open addressed hash table, which is memory mapped for lookups.
+//  - Readers take no file locks. Writers take a per-shard lock file and
+//    either update a slot in place (new slots are only ever filled) or write
+//    a new "generation" of the shard when it needs to grow or be compacted.
+//    Replaced shards are flagged so readers can follow to the new generation.
+//  - Lookups can't confirm an entry exists (only that it doesn't), so hits
+//    still open the entry.
+//------------------------------------------------------------------------------
+class CacheShardIndex
+{
+public:
+    explicit CacheShardIndex();
+    ~CacheShardIndex();
+
+    // Enable the index if it exists in the cache
+    void Init( const AString & cachePath );
+    [[nodiscard]] bool IsEnabled() const { return m_Enabled; }
+
+    // Returns false only if the entry is definitely not in the cache
+    [[nodiscard]] bool MightContain( const AString & cacheId );
+
+    // Add a newly published entry. Entries for shards locked by another
+    // process are queued rather than blocking the caller.
+    void Add( const AString & cacheId, uint64_t size );
+
+    // Add queued entries, waiting for locked shards. Entries which still can't
+    // be added are returned, as lookups would report them as missing.
+    void FlushPendingAdds( Array<AString> & outFailedCacheIds );
+
+    // Bring the index in line with the given entries, creating it if needed
+    bool Update( const Array<CacheIndex::Entry> & entries,
+                 const Array<AString> & removedCacheIds,
+                 bool create );
+
+    // Enumerate all entries
+    class EntryInfo
+    {
+    public:
+        uint64_t m_Size;
+        uint64_t m_Time; // When the entry was added
+    };
+    void GetEntries( Array<EntryInfo> & outEntries, uint64_t & outTotalSize );
+
+    static void GetShardsPath( const AString & cachePath, AString & outPath );
+
+private:
+    static const uint32_t kNumShards = 256;
+
+    class Shard
+    {
+    public:
+        Mutex m_Mutex; // Protects mapping
+        MemoryMappedFile m_File;
+        uint32_t m_Generation = 0;
+        Timer m_TimeSinceMapped;
+    };
+
+    class Slot;
+
+    static uint64_t GetKey( const AString & cacheId );
+    bool TryAdd( uint64_t key, uint64_t size, float lockTimeoutSecs );
+    static uint32_t GetShardIndex( uint64_t key ) { return static_cast<uint32_t>( key >> 56 ); }
+    void GetShardFileName( uint32_t shardIndex, uint32_t generation, AString & outFileName ) const;
+    void GetShardLockFileName( uint32_t shardIndex, AString & outFileName ) const;
+    bool MapShard( Shard & shard, uint32_t shardIndex );
+    bool OpenShard( uint32_t shardIndex, uint32_t & inOutGeneration, MemoryMappedFile & outFile ) const;
+    uint32_t FindLatestGeneration( uint32_t shardIndex ) const;
+    static bool IsValid( const void * data, size_t dataSize );
+    static const Slot * FindSlot( const void * data, size_t dataSize, uint64_t key );
+    bool ReadShard( uint32_t shardIndex, uint32_t & inOutGeneration, Array<Slot> & outSlots ) const;
+    bool WriteShard( uint32_t shardIndex, uint32_t oldGeneration, const Array<Slot> & slots );
+
+    AString m_ShardsPath;
+    bool m_Enabled = false;
+    Shard m_Shards[ kNumShards ];
+
+    // Entries which couldn't be added immediately
+    Mutex m_PendingAddsMutex;
+    Array<CacheIndex::Entry> m_PendingAdds;
+};
+
+//------------------------------------------------------------------------------
@@ -30,6 +30,7 @@ public:
     virtual void FreeMemory( void * data, size_t dataSize ) = 0;
     virtual bool OutputInfo( bool showProgress ) = 0;
     virtual bool Trim( bool showProgress, uint32_t sizeMiB ) = 0;
+    virtual bool BuildIndex( bool showProgress ) = 0;
 
     // Helper functions
     static void GetCacheId( const uint64_t preprocessedSourceKey,
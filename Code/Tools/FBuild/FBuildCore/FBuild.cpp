@@ -18,6 +18,10 @@
 #include "Graph/SettingsNode.h"
 #include "Helpers/BuildProfiler.h"
 #include "Helpers/CompilationDatabase.h"
+#include "Helpers/CompressionDictionary.h"
+#include "Helpers/DependencyGraphWriter.h"
+#include "Helpers/DirectorySnapshotCache.h"
+#include "Helpers/HeaderFragmentStore.h"
 #include "Protocol/Client.h"
 #include "Protocol/Protocol.h"
 #include "WorkerPool/JobQueue.h"
@@ -30,12 +34,14 @@
 #include "Core/FileIO/ChainedMemoryStream.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/FileSystemWatcher.h"
 #include "Core/Math/xxHash.h"
 #include "Core/Mem/SmallBlockAllocator.h"
 #include "Core/Network/NetworkStartupHelper.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Process/Process.h"
 #include "Core/Process/SystemMutex.h"
+#include "Core/Process/Thread.h"
 #include "Core/Process/ThreadPool.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
@@ -85,6 +91,21 @@ FBuild::FBuild( const FBuildOptions & options )
         m_ThreadPool = FNEW( ThreadPool( m_Options.m_NumWorkerThreads ) );
     }
 
+    // Train a dictionary for compressing distributed jobs from the first few
+    if ( m_Options.m_AllowDistributed && ( m_Options.m_DistributionDictionarySamples > 0 ) )
+    {
+        m_DistributionDictionaryBuilder = FNEW( CompressionDictionaryBuilder( m_Options.m_DistributionDictionarySamples ) );
+    }
+
+    // Store preprocessed output as fragments, to send workers only those they don't have
+    if ( m_Options.m_AllowDistributed && m_Options.m_DistributionDeduplication )
+    {
+        m_DistributionHeaderFragmentStore = FNEW( HeaderFragmentStore );
+    }
+
+    // Share directory contents between DirectoryListNodes
+    m_DirectorySnapshotCache = FNEW( DirectorySnapshotCache );
+
     // track the old working dir to restore if modified (mainly for unit tests)
     VERIFY( FileIO::GetCurrentDir( m_OldWorkingDir ) );
 
@@ -111,10 +132,18 @@ FBuild::~FBuild()
 {
     PROFILE_FUNCTION;
 
+    // Finish writing the DB before exiting (and before restoring the
+    // working dir which the DB path may be relative to)
+    m_DependencyGraphWriter.WaitForCompletion();
+
     Function::Destroy();
 
     FDELETE m_DependencyGraph;
     FDELETE m_Client;
+    FDELETE m_DistributionDictionaryBuilder;
+    FDELETE m_DistributionHeaderFragmentStore;
+    FDELETE m_DirectorySnapshotCache;
+    FDELETE m_FileSystemWatcher;
     FREE( m_EnvironmentString );
 
     if ( m_Cache )
@@ -195,15 +224,22 @@ bool FBuild::Initialize( const char * nodeGraphDBFile )
     const SettingsNode * settings = m_DependencyGraph->GetSettings();
 
     // if the cache is enabled, make sure the path is set and accessible
-    if ( m_Options.m_UseCacheRead || m_Options.m_UseCacheWrite || m_Options.m_CacheInfo || m_Options.m_CacheTrim )
+    if ( m_Options.m_UseCacheRead || m_Options.m_UseCacheWrite || m_Options.m_CacheIndex || m_Options.m_CacheInfo || m_Options.m_CacheTrim )
     {
         if ( !settings->GetCachePluginDLL().IsEmpty() )
         {
             m_Cache = FNEW( CachePlugin( settings->GetCachePluginDLL() ) );
+            if ( m_Options.m_CacheDedup )
+            {
+                FLOG_WARN( "-cachededup is not supported with a CachePlugin and will be ignored" );
+                m_Options.m_CacheDedup = false;
+            }
         }
         else
         {
-            m_Cache = FNEW( Cache() );
+            Cache * cache = FNEW( Cache() );
+            cache->SetDeduplication( m_Options.m_CacheDedup, m_Options.m_CacheCompressionLevel );
+            m_Cache = cache;
         }
 
         if ( m_Cache->Init( settings->GetCachePath(),
@@ -326,9 +362,21 @@ bool FBuild::SaveDependencyGraph( const char * nodeGraphDBFile ) const
 
     const Timer t;
 
+    // Changes are saved relative to what a previous (background) write put on disk
+    WaitForDependencyGraphSave();
+
+    // Append changes to the journal instead of rewriting the entire DB
+    // if possible. A full save is done if that fails for any reason.
+    if ( m_Options.m_DBJournal && SaveDependencyGraphJournal( nodeGraphDBFile, false ) )
+    {
+        FLOG_VERBOSE( "Saving DepGraph Complete in %2.3fs", (double)t.GetElapsed() );
+        return true;
+    }
+
     // serialize into memory first
-    ChainedMemoryStream memoryStream( 8 * 1024 * 1024 );
-    m_DependencyGraph->Save( memoryStream, nodeGraphDBFile );
+    ChainedMemoryStream * memoryStream = FNEW( ChainedMemoryStream( 8 * 1024 * 1024 ) );
+    Array<uint64_t> recordHashes;
+    m_DependencyGraph->Save( *memoryStream, nodeGraphDBFile, &recordHashes );
 
     // Ensure output dir exists where we'll save the DB
     AStackString fileName( nodeGraphDBFile );
@@ -340,36 +388,114 @@ bool FBuild::SaveDependencyGraph( const char * nodeGraphDBFile ) const
         if ( FileIO::EnsurePathExists( pathOnly ) == false )
         {
             FLOG_ERROR( "Failed to create directory for DepGraph saving '%s'", pathOnly.Get() );
+            FDELETE memoryStream;
             return false;
         }
     }
 
-    // try to open the file
-    FileStream fileStream;
-    if ( fileStream.Open( nodeGraphDBFile, FileStream::OPEN_OR_CREATE_READ_WRITE ) == false )
+    // Subsequent saves can be journaled relative to this one, once written
+    uint32_t headerPageSize = 0;
+    const NodeGraphHeader * header = reinterpret_cast<const NodeGraphHeader *>( memoryStream->GetPage( 0, headerPageSize ) );
+    m_DependencyGraph->StagePersistedBase( nodeGraphDBFile, header->GetContentHash(), memoryStream->Tell(), Move( recordHashes ) );
+
+    // Write to disk, removing any journal which has been merged into the DB
+    AStackString journalFile;
+    NodeGraph::GetJournalFileName( nodeGraphDBFile, journalFile );
+    if ( WriteDependencyGraph( memoryStream, DependencyGraphWriter::Mode::REPLACE, fileName, 0, journalFile ) == false )
     {
-        // failing to open the dep graph for saving is a serious problem
-        FLOG_ERROR( "Failed to open DepGraph for saving '%s'", nodeGraphDBFile );
         return false;
     }
 
-    // write in-memory serialized data to disk
-    for ( uint32_t i = 0; i < memoryStream.GetNumPages(); ++i )
+    FLOG_VERBOSE( "Saving DepGraph Complete in %2.3fs%s", (double)t.GetElapsed(), m_Options.m_DBSaveAsync ? " (writing in background)" : "" );
+    return true;
+}
+
+// SaveDependencyGraphJournal
+//------------------------------------------------------------------------------
+bool FBuild::SaveDependencyGraphJournal( const char * nodeGraphDBFile, bool buildInProgress ) const
+{
+    // Serialize changes since the last save
+    ChainedMemoryStream * memoryStream = FNEW( ChainedMemoryStream( 1024 * 1024 ) );
+    Array<uint64_t> recordHashes;
+    if ( m_DependencyGraph->SaveJournal( *memoryStream,
+                                         nodeGraphDBFile,
+                                         m_Options.m_DBJournalCompactRatio,
+                                         buildInProgress,
+                                         recordHashes ) == false )
     {
-        uint32_t dataSize = 0;
-        const char * const data = memoryStream.GetPage( i, dataSize );
-        if ( fileStream.Write( data, dataSize ) != dataSize )
-        {
-            FLOG_ERROR( "Saving DepGraph FAILED!" );
-            return false;
-        }
+        FDELETE memoryStream;
+        return false; // Full save is required
     }
 
-    // Truncate if new data is smaller than old data
-    fileStream.Truncate();
+    // Nothing changed?
+    if ( memoryStream->Tell() == 0 )
+    {
+        FDELETE memoryStream;
+        return true;
+    }
 
-    FLOG_VERBOSE( "Saving DepGraph Complete in %2.3fs", (double)t.GetElapsed() );
-    return true;
+    // Append after the last valid entry, overwriting anything partially written
+    const uint64_t journalPos = m_DependencyGraph->GetPersistedJournalSize();
+    m_DependencyGraph->StagePersistedJournal( journalPos + memoryStream->Tell(), Move( recordHashes ) );
+    AStackString journalFile;
+    NodeGraph::GetJournalFileName( nodeGraphDBFile, journalFile );
+    return WriteDependencyGraph( memoryStream, DependencyGraphWriter::Mode::APPEND, journalFile, journalPos, AString::GetEmpty() );
+}
+
+// SaveDependencyGraphCheckpoint
+//------------------------------------------------------------------------------
+void FBuild::SaveDependencyGraphCheckpoint( bool buildInProgress ) const
+{
+    // Don't stall the build waiting for a previous checkpoint to be written
+    if ( m_DependencyGraphWriter.IsWriting() )
+    {
+        return;
+    }
+
+    PROFILE_FUNCTION;
+    BuildProfilerScope buildProfileScope( "SaveDBCheckpoint" );
+
+    WaitForDependencyGraphSave();
+
+    // Checkpoints are journaled relative to a full save, which can only be
+    // done before the build starts
+    if ( ( SaveDependencyGraphJournal( m_DependencyGraphFile.Get(), buildInProgress ) == false ) &&
+         ( buildInProgress == false ) )
+    {
+        SaveDependencyGraph( m_DependencyGraphFile.Get() );
+    }
+
+    // BuildPassTags were used for serialization
+    m_DependencyGraph->SetBuildPassTagForAllNodes( 0 );
+}
+
+// WaitForDependencyGraphSave
+//------------------------------------------------------------------------------
+bool FBuild::WaitForDependencyGraphSave() const
+{
+    // What was saved only becomes the known on-disk state if it was written
+    const bool written = m_DependencyGraphWriter.WaitForCompletion();
+    m_DependencyGraph->CommitPersistedState( written );
+    return written;
+}
+
+// WriteDependencyGraph
+//------------------------------------------------------------------------------
+bool FBuild::WriteDependencyGraph( ChainedMemoryStream * data,
+                                   DependencyGraphWriter::Mode mode,
+                                   const AString & fileName,
+                                   uint64_t offset,
+                                   const AString & fileToDelete ) const
+{
+    const bool async = m_Options.m_DBSaveAsync;
+    const bool result = m_DependencyGraphWriter.Write( data, mode, fileName, offset, fileToDelete, async );
+
+    // Background writes are committed when they complete
+    if ( ( async == false ) || ( result == false ) )
+    {
+        m_DependencyGraph->CommitPersistedState( result );
+    }
+    return result;
 }
 
 // SaveDependencyGraph
@@ -388,6 +514,9 @@ void FBuild::SaveDependencyGraph( ChainedMemoryStream & stream, const char * nod
     AtomicStoreRelaxed( &s_StopBuild, false ); // allow multiple runs in same process
     AtomicStoreRelaxed( &s_AbortBuild, false ); // allow multiple runs in same process
 
+    // Directories may have changed since any previous run
+    m_DirectorySnapshotCache->Clear();
+
     // create worker threads
     m_JobQueue = FNEW( JobQueue( m_Options.m_NumWorkerThreads, m_ThreadPool ) );
 
@@ -420,6 +549,20 @@ void FBuild::SaveDependencyGraph( ChainedMemoryStream & stream, const char * nod
         BuildProfiler::Get().StartMetricsGathering();
     }
 
+    // Nodes waiting on dependencies are tracked during the build
+    if ( m_Options.m_EventDrivenScheduling )
+    {
+        m_DependencyGraph->ResetWaitingNodes();
+    }
+
+    // Checkpoints require the DB to be on disk before the build starts
+    const bool checkpoints = ( m_Options.m_DBCheckpointInterval > 0.0f );
+    if ( checkpoints )
+    {
+        SaveDependencyGraphCheckpoint( false );
+    }
+    Timer checkpointTimer;
+
     bool stopping( false );
 
     // keep doing build passes until completed/failed
@@ -469,6 +612,19 @@ void FBuild::SaveDependencyGraph( ChainedMemoryStream & stream, const char * nod
                 }
             }
 
+            // Periodically record progress, so it isn't lost if the build is killed
+            if ( !stopping && checkpoints && ( checkpointTimer.GetElapsed() >= m_Options.m_DBCheckpointInterval ) )
+            {
+                SaveDependencyGraphCheckpoint( true );
+                checkpointTimer.Restart();
+            }
+
+            // Pick up the result of a background DB write as soon as it completes
+            if ( m_Options.m_DBSaveAsync && ( m_DependencyGraphWriter.IsWriting() == false ) )
+            {
+                WaitForDependencyGraphSave();
+            }
+
             if ( !stopping )
             {
                 if ( m_Options.m_WrapperMode == FBuildOptions::WRAPPER_MODE_FINAL_PROCESS )
@@ -488,6 +644,12 @@ void FBuild::SaveDependencyGraph( ChainedMemoryStream & stream, const char * nod
                 break;
             }
 
+            // Don't let change notifications overflow during long builds
+            if ( m_FileSystemWatcher )
+            {
+                m_FileSystemWatcher->Update();
+            }
+
             // Wait until more work to process or time has elapsed
             m_JobQueue->MainThreadWait( 500 );
 
@@ -527,6 +689,125 @@ void FBuild::SaveDependencyGraph( ChainedMemoryStream & stream, const char * nod
     return ( nodeToBuild->GetState() == Node::UP_TO_DATE );
 }
 
+// Watch
+//------------------------------------------------------------------------------
+bool FBuild::Watch( const Array<AString> & targets, bool lastBuildResult, bool & outReloadRequired )
+{
+    outReloadRequired = false;
+    if ( StartWatching() == false )
+    {
+        return false;
+    }
+
+    OUTPUT( "FBuild: Watching for changes (Ctrl+C to stop)\n" );
+    bool result = lastBuildResult;
+    while ( GetStopBuild() == false )
+    {
+        if ( m_FileSystemWatcher->WaitForChanges( 500 ) == false )
+        {
+            continue;
+        }
+
+        // Let related changes (e.g. saving several files) be handled together
+        Thread::Sleep( 100 );
+
+        if ( BuildChanges( targets, result ) == WatchResult::RELOAD_REQUIRED )
+        {
+            outReloadRequired = true;
+            break;
+        }
+    }
+    return result;
+}
+
+// StartWatching
+//------------------------------------------------------------------------------
+bool FBuild::StartWatching()
+{
+    PROFILE_FUNCTION;
+
+    if ( FileSystemWatcher::IsSupported() == false )
+    {
+        FLOG_ERROR( "-watch is not supported on this platform" );
+        return false;
+    }
+
+    ASSERT( m_FileSystemWatcher == nullptr );
+    m_FileSystemWatcher = FNEW( FileSystemWatcher );
+
+    Array<AString> dirs;
+    Array<AString> recursiveDirs;
+    m_DependencyGraph->GetDirectoriesToWatch( dirs, recursiveDirs );
+    for ( const AString & dir : dirs )
+    {
+        m_FileSystemWatcher->AddDirectory( dir, false ); // Files in directories which can't be watched are always checked
+    }
+    for ( const AString & dir : recursiveDirs )
+    {
+        m_FileSystemWatcher->AddDirectory( dir, true );
+    }
+
+    // Discard anything which happened while the watches were added
+    Array<AString> changes;
+    if ( m_FileSystemWatcher->GetChanges( changes ) == false )
+    {
+        FLOG_WARN( "Not all directories could be watched (the limit is set by /proc/sys/fs/inotify/max_user_watches).\n"
+                   "All files will be checked on each build." );
+    }
+    return true;
+}
+
+// BuildChanges
+//------------------------------------------------------------------------------
+FBuild::WatchResult FBuild::BuildChanges( const Array<AString> & targets, bool & outBuildResult )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( m_FileSystemWatcher );
+
+    Array<AString> changes;
+    const bool changesKnown = m_FileSystemWatcher->GetChanges( changes );
+
+    // Ignore the DB (and its journal and temp files), which is saved after each build
+    AStackString dbFile;
+    NodeGraph::CleanPath( m_DependencyGraphFile, dbFile );
+    for ( size_t i = changes.GetSize(); i > 0; --i )
+    {
+        const AString & change = changes[ i - 1 ];
+        if ( change.BeginsWith( dbFile ) &&
+             ( ( change.GetLength() == dbFile.GetLength() ) || ( change[ dbFile.GetLength() ] == '.' ) ) )
+        {
+            changes.EraseIndex( i - 1 );
+        }
+    }
+
+    if ( changesKnown && changes.IsEmpty() )
+    {
+        return WatchResult::NO_CHANGES;
+    }
+
+    // The graph must be recreated if the configuration changed
+    for ( const AString & change : changes )
+    {
+        if ( m_DependencyGraph->IsUsedFile( change ) )
+        {
+            OUTPUT( "FBuild: '%s' changed. Reloading.\n", change.Get() );
+            return WatchResult::RELOAD_REQUIRED;
+        }
+    }
+
+    // Ignore changes that don't affect the build (e.g. to output files). If
+    // changes are unknown, everything is checked.
+    if ( m_DependencyGraph->ResetForRebuild( changesKnown ? m_FileSystemWatcher : nullptr, changes ) == false )
+    {
+        return WatchResult::NO_CHANGES;
+    }
+
+    m_BuildStats = FBuildStats();
+    outBuildResult = Build( targets );
+    return WatchResult::BUILT;
+}
+
 // SetEnvironmentString
 //------------------------------------------------------------------------------
 void FBuild::SetEnvironmentString( const char * envString, uint32_t size, const AString & libEnvVar )
@@ -893,6 +1174,20 @@ bool FBuild::GenerateCompilationDatabase( const Array<AString> & targets ) const
     return FileIO::GetTempDir( outTempDir );
 }
 
+// CacheBuildIndex
+//------------------------------------------------------------------------------
+bool FBuild::CacheBuildIndex() const
+{
+    OUTPUT( "CacheIndex:\n" );
+    if ( m_Cache )
+    {
+        return m_Cache->BuildIndex( m_Options.m_ShowProgress );
+    }
+
+    OUTPUT( "- Cache not configured\n" );
+    return false;
+}
+
 // CacheOutputInfo
 //------------------------------------------------------------------------------
 bool FBuild::CacheOutputInfo() const
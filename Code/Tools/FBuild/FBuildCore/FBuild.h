@@ -9,6 +9,7 @@
 #include "Tools/FBuild/FBuildCore/BFF/BFFUserFunctions.h"
 #include "Tools/FBuild/FBuildCore/FBuildOptions.h"
 #include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
+#include "Tools/FBuild/FBuildCore/Helpers/DependencyGraphWriter.h"
 
 #include "Core/Containers/Array.h"
 #include "Core/Containers/Singleton.h"
@@ -19,8 +20,12 @@
 // Forward Declarations
 //------------------------------------------------------------------------------
 class Client;
+class CompressionDictionaryBuilder;
 class Dependencies;
+class DirectorySnapshotCache;
 class FileStream;
+class FileSystemWatcher;
+class HeaderFragmentStore;
 class ICache;
 class MemoryStream;
 class JobQueue;
@@ -46,9 +51,21 @@ public:
     bool Build( const Array<AString> & targets );
     virtual bool Build( Node * nodeToBuild ); // Virtual to allow for testing
 
+    // -watch: stay resident after a build, building again as files change
+    enum class WatchResult : uint8_t
+    {
+        NO_CHANGES,
+        BUILT,
+        RELOAD_REQUIRED, // bff files changed
+    };
+    bool Watch( const Array<AString> & targets, bool lastBuildResult, bool & outReloadRequired );
+    bool StartWatching();
+    WatchResult BuildChanges( const Array<AString> & targets, bool & outBuildResult );
+
     // after a build we can store progress/parsed rules for next time
     bool SaveDependencyGraph( const char * nodeGraphDBFile ) const;
     void SaveDependencyGraph( ChainedMemoryStream & memorySteam, const char * nodeGraphDBFile ) const;
+    bool WaitForDependencyGraphSave() const; // Saves can complete in the background (-dbasync)
 
     const FBuildOptions & GetOptions() const { return m_Options; }
 
@@ -106,15 +123,28 @@ public:
     static volatile bool * GetAbortBuildPointer() { return &s_AbortBuild; }
 
     ICache * GetCache() const { return m_Cache; }
+    ThreadPool * GetThreadPool() const { return m_ThreadPool; }
+    CompressionDictionaryBuilder * GetDistributionDictionaryBuilder() const { return m_DistributionDictionaryBuilder; }
+    HeaderFragmentStore * GetDistributionHeaderFragmentStore() const { return m_DistributionHeaderFragmentStore; }
+    DirectorySnapshotCache * GetDirectorySnapshotCache() const { return m_DirectorySnapshotCache; }
 
     static bool GetTempDir( AString & outTempDir );
 
+    bool CacheBuildIndex() const;
     bool CacheOutputInfo() const;
     bool CacheTrim() const;
 
     uint32_t GetNumWorkerConnections() const;
 
 protected:
+    bool SaveDependencyGraphJournal( const char * nodeGraphDBFile, bool buildInProgress ) const;
+    bool WriteDependencyGraph( ChainedMemoryStream * data,
+                               DependencyGraphWriter::Mode mode,
+                               const AString & fileName,
+                               uint64_t offset,
+                               const AString & fileToDelete ) const;
+    void SaveDependencyGraphCheckpoint( bool buildInProgress ) const;
+
     bool GetTargets( const Array<AString> & targets, Dependencies & outDeps ) const;
 
     void UpdateBuildStatus( const Node * node );
@@ -138,7 +168,12 @@ protected:
     Client * m_Client; // manage connections to worker servers
 
     AString m_DependencyGraphFile;
+    mutable DependencyGraphWriter m_DependencyGraphWriter;
     ICache * m_Cache;
+    CompressionDictionaryBuilder * m_DistributionDictionaryBuilder = nullptr; // -distdictionary
+    HeaderFragmentStore * m_DistributionHeaderFragmentStore = nullptr; // -distdedup
+    DirectorySnapshotCache * m_DirectorySnapshotCache = nullptr;
+    FileSystemWatcher * m_FileSystemWatcher = nullptr; // -watch
 
     Timer m_Timer;
     float m_LastProgressOutputTime;
@@ -126,6 +126,16 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_UseCacheWrite = true;
                 continue;
             }
+            else if ( thisArg == "-cachededup" )
+            {
+                m_CacheDedup = true;
+                continue;
+            }
+            else if ( thisArg == "-cacheindex" )
+            {
+                m_CacheIndex = true;
+                continue;
+            }
             else if ( thisArg == "-cacheinfo" )
             {
                 m_CacheInfo = true;
@@ -193,6 +203,16 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_Args += argv[ sizeIndex ];
                 continue;
             }
+            else if ( thisArg == "-distdedup" )
+            {
+                m_DistributionDeduplication = true;
+                continue;
+            }
+            else if ( thisArg == "-distdictionary" )
+            {
+                m_DistributionDictionarySamples = kDefaultDistributionDictionarySamples;
+                continue;
+            }
             else if ( thisArg == "-clean" )
             {
                 m_ForceCleanBuild = true;
@@ -222,6 +242,30 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_Args += '"';
                 continue;
             }
+            else if ( thisArg == "-dbasync" )
+            {
+                m_DBSaveAsync = true;
+                continue;
+            }
+            else if ( thisArg == "-dbcheckpoint" )
+            {
+                const int sizeIndex = ( i + 1 );
+                uint32_t checkpointInterval;
+                if ( ( sizeIndex >= argc ) ||
+                     ( AString::ScanS( argv[ sizeIndex ], "%u", &checkpointInterval ) != 1 ) )
+                {
+                    OUTPUT( "FBuild: Error: Missing or bad <seconds> for '-dbcheckpoint' argument\n" );
+                    OUTPUT( "Try \"%s -help\"\n", programName.Get() );
+                    return OPTIONS_ERROR;
+                }
+                m_DBCheckpointInterval = static_cast<float>( checkpointInterval );
+                i++; // skip extra arg we've consumed
+
+                // add to args we might pass to subprocess
+                m_Args += ' ';
+                m_Args += argv[ sizeIndex ];
+                continue;
+            }
             else if ( thisArg == "-dbfile" )
             {
                 const int32_t pathIndex = ( i + 1 );
@@ -241,6 +285,31 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_Args += '"';
                 continue;
             }
+            else if ( thisArg == "-dbjournal" )
+            {
+                m_DBJournal = true;
+                continue;
+            }
+            else if ( thisArg == "-dbjournalcompact" )
+            {
+                const int sizeIndex = ( i + 1 );
+                uint32_t compactRatio;
+                if ( ( sizeIndex >= argc ) ||
+                     ( AString::ScanS( argv[ sizeIndex ], "%u", &compactRatio ) != 1 ) )
+                {
+                    OUTPUT( "FBuild: Error: Missing or bad <percent> for '-dbjournalcompact' argument\n" );
+                    OUTPUT( "Try \"%s -help\"\n", programName.Get() );
+                    return OPTIONS_ERROR;
+                }
+                m_DBJournal = true;
+                m_DBJournalCompactRatio = compactRatio;
+                i++; // skip extra arg we've consumed
+
+                // add to args we might pass to subprocess
+                m_Args += ' ';
+                m_Args += argv[ sizeIndex ];
+                continue;
+            }
 #if defined( __WINDOWS__ )
             else if ( thisArg == "-debug" )
             {
@@ -272,6 +341,11 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_GenerateDotGraphFull = true;
                 continue;
             }
+            else if ( thisArg == "-eventdriven" )
+            {
+                m_EventDrivenScheduling = true;
+                continue;
+            }
             else if ( thisArg == "-fastcancel" )
             {
                 // This is on by default now
@@ -442,6 +516,11 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_WaitMode = true;
                 continue;
             }
+            else if ( thisArg == "-watch" )
+            {
+                m_WatchMode = true;
+                continue;
+            }
             else if ( thisArg == "-why" )
             {
                 m_ShowBuildReason = true;
@@ -630,6 +709,8 @@ void FBuildOptions::DisplayHelp( const AString & programName ) const
             "                   - <= -1 : less compression, with -128 being the lowest\n"
             "                   - ==  0 : disable compression\n"
             "                   - >=  1 : more compression, with 12 being the highest\n"
+            " -cachededup       Store cache entries as deduplicated chunks.\n"
+            " -cacheindex       Create or update the cache index.\n"
             " -cacheinfo        Output cache statistics.\n"
             " -cachetrim <size> Trim the cache to the given size in MiB.\n"
             " -cacheverbose     Emit details about cache interactions.\n"
@@ -638,7 +719,17 @@ void FBuildOptions::DisplayHelp( const AString & programName ) const
             " -config <path>    Explicitly specify the config file to use.\n"
             " -continueafterdbmove\n"
             "       Allow builds after a DB move.\n"
+            " -dbasync          Write the dependency database in the background.\n"
+            " -dbcheckpoint <seconds>\n"
+            "                   Periodically save progress to the dependency database\n"
+            "                   during the build.\n"
             " -dbfile <path>    Explicitly specify the dependency database file to use.\n"
+            " -dbjournal        Save changes to the dependency database incrementally, by\n"
+            "                   appending to a journal instead of rewriting it.\n"
+            " -dbjournalcompact <percent>\n"
+            "                   Rewrite the dependency database once the journal exceeds\n"
+            "                   the given percentage of its size (default: 25).\n"
+            "                   Implies -dbjournal.\n"
             " -debug            (Windows) Break at startup, to attach debugger.\n"
             " -dist             Allow distributed compilation.\n"
             " -distverbose      Print detailed info for distributed compilation.\n"
@@ -647,8 +738,14 @@ void FBuildOptions::DisplayHelp( const AString & programName ) const
             "                   - <= -1 : less compression, with -128 being the lowest\n"
             "                   - ==  0 : disable compression\n"
             "                   - >=  1 : more compression, with 12 being the highest\n"
+            " -distdedup        Send workers only the parts of each distributed job's\n"
+            "                   preprocessed output (mostly headers) not already sent.\n"
+            " -distdictionary   Compress distributed jobs against a dictionary trained\n"
+            "                   from the first jobs of the build.\n"
             " -dot[full]        Emit known dependency tree info for specified targets to an\n"
             "                   fbuild.gv file in DOT format.\n"
+            " -eventdriven      (Experimental) Schedule jobs as their dependencies\n"
+            "                   complete, instead of sweeping the graph each pass.\n"
             " -fixuperrorpaths  Reformat error paths to be Visual Studio friendly.\n"
             " -forceremote      Force distributable jobs to only be built remotely.\n"
             " -help             Show this help.\n"
@@ -682,6 +779,8 @@ void FBuildOptions::DisplayHelp( const AString & programName ) const
             " -vs               VisualStudio mode. Same as -ide.\n"
             " -wait             Wait for a previous build to complete before starting.\n"
             "                   (Slower than building both targets in one invocation).\n"
+            " -watch            (Linux) Stay resident after the build, rebuilding when\n"
+            "                   source files change. Unchanged files aren't checked.\n"
             " -why              Show build reason for each item.\n"
             " -wrapper          (Windows) Spawn a sub-process to gracefully handle\n"
             "                   termination from Visual Studio.\n"
@@ -54,6 +54,7 @@ public:
     bool m_StopOnFirstError = true;
     bool m_FastCancel = true;
     bool m_WaitMode = false;
+    bool m_WatchMode = false;
     bool m_DisplayTargetList = false;
     bool m_ShowHiddenTargets = false;
     bool m_DisplayDependencyDB = false;
@@ -61,10 +62,13 @@ public:
     bool m_GenerateDotGraphFull = false;
     bool m_GenerateCompilationDatabase = false;
     bool m_NoUnity = false;
+    bool m_EventDrivenScheduling = false;
 
     // Cache
     bool m_UseCacheRead = false;
     bool m_UseCacheWrite = false;
+    bool m_CacheDedup = false;
+    bool m_CacheIndex = false;
     bool m_CacheInfo = false;
     bool m_CacheVerbose = false;
     uint32_t m_CacheTrim = 0;
@@ -77,6 +81,9 @@ public:
     bool m_AllowLocalRace = true;
     uint16_t m_DistributionPort = Protocol::kPort;
     int16_t m_DistributionCompressionLevel = -1; // See Compressor.h
+    static const uint32_t kDefaultDistributionDictionarySamples = 16;
+    uint32_t m_DistributionDictionarySamples = 0; // Jobs to train a compression dictionary from (0 = disabled)
+    bool m_DistributionDeduplication = false; // Send workers only the parts of preprocessed output they don't have
 
     // General Output
     bool m_ShowVerbose = false;
@@ -99,6 +106,10 @@ public:
     bool m_FixupErrorPaths = false;
     bool m_ForceDBMigration_Debug = false; // Force migration even if bff has not changed (for tests)
     bool m_ContinueAfterDBMove = false;
+    bool m_DBJournal = false;
+    uint32_t m_DBJournalCompactRatio = 25; // Journal size as a percentage of DB size
+    bool m_DBSaveAsync = false;
+    float m_DBCheckpointInterval = 0.0f; // Seconds between saves during the build (0 = disabled)
     AString m_DBFile;
 
     uint32_t m_NumWorkerThreads = 0; // True default detected in constructor
@@ -31,6 +31,8 @@ public:
     const Dependencies & GetAliasedNodes() const { return m_StaticDependencies; }
 
 private:
+    friend class TestGraph; // Creates synthetic graphs
+
     virtual BuildResult DoBuild( Job * job ) override;
 
     Array<AString> m_Targets;
@@ -8,6 +8,7 @@
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
+#include "Tools/FBuild/FBuildCore/Helpers/DirectorySnapshotCache.h"
 
 // Core
 #include "Core/FileIO/FileIO.h"
@@ -230,7 +231,15 @@ DirectoryListNode::~DirectoryListNode() = default;
                                                 m_ExcludePatterns,
                                                 m_Recursive,
                                                 m_IncludeDirs );
-        FileIO::GetFiles( m_Path, helper );
+        DirectorySnapshotCache * snapshotCache = FBuild::IsValid() ? FBuild::Get().GetDirectorySnapshotCache() : nullptr;
+        if ( snapshotCache )
+        {
+            snapshotCache->GetFiles( m_Path, helper ); // Shared with other DirectoryListNodes
+        }
+        else
+        {
+            FileIO::GetFiles( m_Path, helper );
+        }
 
         // Transfer ownership of filtered list
         m_Files = Move( helper.GetFiles() );
@@ -310,6 +319,77 @@ DirectoryListNode::~DirectoryListNode() = default;
     return BuildResult::eOk;
 }
 
+// IsInListing
+//  - Whether a file (or a directory, if path has a trailing slash) at the given
+//    path would be found by this listing, applying the same filtering as DoBuild
+//------------------------------------------------------------------------------
+bool DirectoryListNode::IsInListing( const AString & path ) const
+{
+    if ( PathUtils::PathBeginsWith( path, m_Path ) == false )
+    {
+        return false;
+    }
+
+    // Only items directly in the path are found by non-recursive listings
+    const bool isDir = path.EndsWith( NATIVE_SLASH );
+    const char * const slash = path.Find( NATIVE_SLASH, path.Get() + m_Path.GetLength() );
+    if ( ( m_Recursive == false ) && slash && ( slash != ( path.GetEnd() - 1 ) ) )
+    {
+        return false;
+    }
+
+    // Filter excluded paths
+    for ( const AString & excludedPath : m_ExcludePaths )
+    {
+        if ( PathUtils::PathBeginsWith( path, excludedPath ) )
+        {
+            return false;
+        }
+    }
+
+    // Directories can contain files which are found, or can be found themselves
+    if ( isDir )
+    {
+        return ( m_Recursive || m_IncludeDirs );
+    }
+
+    // Check wildcard patterns (which apply to the file name only)
+    if ( m_Patterns.IsEmpty() == false )
+    {
+        const char * const lastSlash = path.FindLast( NATIVE_SLASH );
+        const char * const fileName = lastSlash ? ( lastSlash + 1 ) : path.Get();
+        bool matched = false;
+        for ( const AString & pattern : m_Patterns )
+        {
+            matched |= PathUtils::IsWildcardMatch( pattern.Get(), fileName );
+        }
+        if ( matched == false )
+        {
+            return false;
+        }
+    }
+
+    // Filter excluded files
+    for ( const AString & fileToExclude : m_FilesToExclude )
+    {
+        if ( PathUtils::PathEndsWithFile( path, fileToExclude ) )
+        {
+            return false;
+        }
+    }
+
+    // Filter excluded patterns
+    for ( const AString & excludePattern : m_ExcludePatterns )
+    {
+        if ( PathUtils::IsWildcardMatch( excludePattern.Get(), path.Get() ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 // MakePrettyName
 //------------------------------------------------------------------------------
 void DirectoryListNode::MakePrettyName()
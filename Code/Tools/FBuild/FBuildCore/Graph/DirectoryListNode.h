@@ -20,8 +20,10 @@ public:
     virtual ~DirectoryListNode() override;
 
     const AString & GetPath() const { return m_Path; }
+    bool IsRecursive() const { return m_Recursive; }
     const Array<FileIO::FileInfo> & GetFiles() const { return m_Files; }
     const Array<AString> & GetDirectories() const { return m_Directories; }
+    bool IsInListing( const AString & path ) const;
 
     static Node::Type GetTypeS() { return Node::DIRECTORY_LIST_NODE; }
 
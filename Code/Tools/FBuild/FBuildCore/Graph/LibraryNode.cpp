@@ -145,6 +145,8 @@ LibraryNode::~LibraryNode()
 //------------------------------------------------------------------------------
 /*virtual*/ Node::BuildResult LibraryNode::DoBuild( Job * job )
 {
+    RecordUnityCompileTimes();
+
     // Delete library from previous build (if present) if:
     // - A clean build is being triggered
     // - A non-msvc librarian is used (librarians like ar can cause duplicate
@@ -180,6 +180,8 @@ public:
 
     virtual const AString & GetPrettyName() const { return GetName(); }
 
+    uint32_t GetIndex() const { return m_Index; }
+
     bool IsHidden() const { return m_Hidden; }
     uint8_t GetConcurrencyGroupIndex() const { return m_ConcurrencyGroupIndex; }
 
@@ -280,6 +282,7 @@ protected:
     uint32_t m_ProcessingTime = 0; // Time spent on this node during this build
     uint32_t m_CachingTime = 0; // Time spent caching this node
     mutable uint32_t m_ProgressAccumulator = 0; // Used to estimate build progress percentage
+    uint32_t m_Index = 0; // Index in the NodeGraph's list of all nodes
 
     Dependencies m_PreBuildDependencies;
     Dependencies m_StaticDependencies;
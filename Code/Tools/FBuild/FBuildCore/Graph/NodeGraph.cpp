@@ -45,14 +45,20 @@
 #include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/FileSystemWatcher.h"
+#include "Core/FileIO/MemoryMappedFile.h"
+#include "Core/FileIO/MemoryStream.h"
 #include "Core/FileIO/PathUtils.h"
 #include "Core/Math/xxHash.h"
 #include "Core/Mem/Mem.h"
+#include "Core/Process/Atomic.h"
 #include "Core/Process/Thread.h"
+#include "Core/Process/ThreadPool.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Reflection/ReflectedProperty.h"
 #include "Core/Strings/AStackString.h"
 #include "Core/Strings/LevenshteinDistance.h"
+#include "Core/Time/Timer.h"
 #include "Core/Tracing/Tracing.h"
 
 #include <string.h>
@@ -78,6 +84,20 @@ bool NodeGraphHeader::IsValid() const
     return true;
 }
 
+// NodeGraphJournalHeader::IsValid
+//------------------------------------------------------------------------------
+bool NodeGraphJournalHeader::IsValid() const
+{
+    // Check header token is valid
+    if ( ( m_Identifier[ 0 ] != 'N' ) ||
+         ( m_Identifier[ 1 ] != 'G' ) ||
+         ( m_Identifier[ 2 ] != 'J' ) )
+    {
+        return false;
+    }
+    return true;
+}
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 NodeGraph::NodeGraph( unsigned nodeMapHashBits )
@@ -241,29 +261,38 @@ bool NodeGraph::ParseFromRoot( const char * bffFile )
 //------------------------------------------------------------------------------
 NodeGraph::LoadResult NodeGraph::Load( const char * nodeGraphDBFile )
 {
-    // Open previously saved DB
-    FileStream fs;
-    if ( fs.Open( nodeGraphDBFile, FileStream::READ_ONLY ) == false )
+    PROFILE_FUNCTION;
+
+    const Timer t;
+    FLOG_VERBOSE( "Loading DepGraph '%s'", nodeGraphDBFile );
+
+    // Map previously saved DB into memory. Pages are only read as needed
+    // and can be consumed by multiple threads.
+    MemoryMappedFile mmf;
+    if ( mmf.Open( nodeGraphDBFile ) == false )
     {
         return LoadResult::MISSING_OR_INCOMPATIBLE;
     }
+    ConstMemoryStream ms( mmf.GetData(), mmf.GetSize() );
 
-    // Read it into memory to avoid lots of tiny disk accesses
-    const size_t fileSize = (size_t)fs.GetFileSize();
-    UniquePtr<char, FreeDeletor> memory( (char *)ALLOC( fileSize ) );
-    if ( fs.ReadBuffer( memory.Get(), fileSize ) != fileSize )
+    // Map the journal of incremental changes too, if there is one
+    AStackString journalFile;
+    GetJournalFileName( nodeGraphDBFile, journalFile );
+    MemoryMappedFile journal;
+    if ( FileIO::FileExists( journalFile.Get() ) )
     {
-        FLOG_ERROR( "Could not read Database. Error: %s File: '%s'", LAST_ERROR_STR, nodeGraphDBFile );
-        return LoadResult::LOAD_ERROR;
+        journal.Open( journalFile.Get() ); // Journal is ignored if it can't be opened
     }
-    ConstMemoryStream ms( memory.Get(), fileSize );
+    FLOG_VERBOSE( " - Map       : %2.3fs", (double)t.GetElapsed() );
 
     // Load the Old DB
-    const NodeGraph::LoadResult res = Load( ms, nodeGraphDBFile );
+    const NodeGraph::LoadResult res = Load( ms, nodeGraphDBFile, &journal );
     if ( res == LoadResult::LOAD_ERROR )
     {
         FLOG_ERROR( "Database corrupt (clean build will occur): '%s'", nodeGraphDBFile );
     }
+
+    FLOG_VERBOSE( "Loading DepGraph Complete in %2.3fs", (double)t.GetElapsed() );
     return res;
 }
 
@@ -271,6 +300,15 @@ NodeGraph::LoadResult NodeGraph::Load( const char * nodeGraphDBFile )
 //------------------------------------------------------------------------------
 NodeGraph::LoadResult NodeGraph::Load( ConstMemoryStream & stream, const char * nodeGraphDBFile )
 {
+    return Load( stream, nodeGraphDBFile, nullptr );
+}
+
+// Load
+//------------------------------------------------------------------------------
+NodeGraph::LoadResult NodeGraph::Load( ConstMemoryStream & stream, const char * nodeGraphDBFile, const MemoryMappedFile * journal )
+{
+    Timer t;
+
     bool compatibleDB;
     bool movedDB;
     Array<UsedFile> usedFiles;
@@ -278,6 +316,8 @@ NodeGraph::LoadResult NodeGraph::Load( ConstMemoryStream & stream, const char *
     {
         return movedDB ? LoadResult::LOAD_ERROR_MOVED : LoadResult::LOAD_ERROR;
     }
+    FLOG_VERBOSE( " - Header    : %2.3fs", (double)t.GetElapsed() );
+    t.Restart();
 
     // old or otherwise incompatible DB version?
     if ( !compatibleDB )
@@ -290,47 +330,10 @@ NodeGraph::LoadResult NodeGraph::Load( ConstMemoryStream & stream, const char *
     bool bffNeedsReparsing = false;
 
     // check if any files used have changed
-    for ( size_t i = 0; i < usedFiles.GetSize(); ++i )
+    bool usedFileTimeStampsUpdated = false;
+    if ( CheckUsedFilesForChanges( usedFiles, bffNeedsReparsing, usedFileTimeStampsUpdated ) == false )
     {
-        const AString & fileName = usedFiles[ i ].m_FileName;
-        const uint64_t timeStamp = FileIO::GetFileLastWriteTime( fileName );
-        if ( timeStamp == usedFiles[ i ].m_TimeStamp )
-        {
-            continue; // timestamps match, no need to check hashes
-        }
-
-        FileStream fs;
-        if ( fs.Open( fileName.Get(), FileStream::READ_ONLY ) == false )
-        {
-            if ( !bffNeedsReparsing )
-            {
-                FLOG_VERBOSE( "BFF file '%s' missing or unopenable (reparsing will occur).", fileName.Get() );
-                bffNeedsReparsing = true;
-            }
-            continue; // not opening the file is not an error, it could be not needed anymore
-        }
-
-        const size_t size = (size_t)fs.GetFileSize();
-        UniquePtr<void, FreeDeletor> mem( ALLOC( size ) );
-        if ( fs.Read( mem.Get(), size ) != size )
-        {
-            return LoadResult::LOAD_ERROR; // error reading
-        }
-
-        const uint64_t dataHash = xxHash3::Calc64( mem.Get(), size );
-        if ( dataHash == usedFiles[ i ].m_DataHash )
-        {
-            // file didn't change, update stored timestamp to save time on the next run
-            usedFiles[ i ].m_TimeStamp = timeStamp;
-            continue;
-        }
-
-        // Tell used reparsing will occur (Warn only about the first file)
-        if ( !bffNeedsReparsing )
-        {
-            FLOG_WARN( "BFF file '%s' has changed (reparsing will occur).", fileName.Get() );
-            bffNeedsReparsing = true;
-        }
+        return LoadResult::LOAD_ERROR; // error reading
     }
 
     m_UsedFiles = usedFiles;
@@ -403,17 +406,24 @@ NodeGraph::LoadResult NodeGraph::Load( ConstMemoryStream & stream, const char *
         }
     }
 
-    // Files use in file_exists checks
+    // Files use in file_exists checks (no need to check if already reparsing)
     BFFFileExists fileExistsInfo;
     fileExistsInfo.Load( stream );
-    bool added;
-    const AString * changedFile = fileExistsInfo.CheckForChanges( added );
-    if ( changedFile )
+    if ( !bffNeedsReparsing )
     {
-        FLOG_WARN( "File used in file_exists was %s '%s' - BFF will be re-parsed\n", added ? "added" : "removed", changedFile->Get() );
-        bffNeedsReparsing = true;
+        bool added;
+        ThreadPool * threadPool = FBuild::IsValid() ? FBuild::Get().GetThreadPool() : nullptr;
+        const AString * changedFile = fileExistsInfo.CheckForChanges( threadPool, added );
+        if ( changedFile )
+        {
+            FLOG_WARN( "File used in file_exists was %s '%s' - BFF will be re-parsed\n", added ? "added" : "removed", changedFile->Get() );
+            bffNeedsReparsing = true;
+        }
     }
 
+    FLOG_VERBOSE( " - UsedFiles : %2.3fs", (double)t.GetElapsed() );
+    t.Restart();
+
     ASSERT( m_AllNodes.IsEmpty() );
 
     // Create nodes
@@ -425,15 +435,31 @@ NodeGraph::LoadResult NodeGraph::Load( ConstMemoryStream & stream, const char *
         Node::Load( *this, stream ); // Create each node
         ASSERT( m_AllNodes[ i ] ); // Array is populated as loaded
     }
-    for ( Node * node : m_AllNodes )
+    FLOG_VERBOSE( " - Nodes     : %2.3fs (%u nodes)", (double)t.GetElapsed(), numNodes );
+    t.Restart();
+
+    // Locate extended data for each node
+    Array<ExtendedDataRecord> records;
+    if ( ReadExtendedDataTable( stream, records ) == false )
     {
-        // Load extended properties and dependencies
-        // (but not for FileNodes which have none)
-        if ( node->GetType() != Node::FILE_NODE )
-        {
-            Node::LoadExtended( *this, node, stream );
-        }
+        return LoadResult::LOAD_ERROR;
+    }
+
+    // Apply incremental changes saved since the DB was last written in full
+    const uint64_t baseHash = static_cast<const NodeGraphHeader *>( stream.GetData() )->GetContentHash();
+    uint64_t journalSize = 0;
+    if ( journal && journal->IsOpen() )
+    {
+        journalSize = ReplayJournal( *journal, baseHash, records );
+        FLOG_VERBOSE( " - Journal   : %2.3fs (%u nodes)", (double)t.GetElapsed(), (uint32_t)m_AllNodes.GetSize() );
+        t.Restart();
     }
+
+    // Load extended properties and dependencies
+    LoadExtendedData( records );
+    FLOG_VERBOSE( " - Extended  : %2.3fs", (double)t.GetElapsed() );
+    t.Restart();
+
     for ( Node * node : m_AllNodes )
     {
         // Dispatch post-load callback
@@ -442,6 +468,7 @@ NodeGraph::LoadResult NodeGraph::Load( ConstMemoryStream & stream, const char *
             node->PostLoad( *this ); // TODO:C Eliminate the need for this
         }
     }
+    FLOG_VERBOSE( " - PostLoad  : %2.3fs", (double)t.GetElapsed() );
 
     m_Settings = FindNode( AStackString( "$$Settings$$" ) )->CastTo<SettingsNode>();
     ASSERT( m_Settings );
@@ -463,12 +490,28 @@ NodeGraph::LoadResult NodeGraph::Load( ConstMemoryStream & stream, const char *
         FBuild::Get().SetEnvironmentString( envString.Get(), envStringSize, libEnvVar );
     }
 
+    // Track what is on disk so subsequent saves can be journaled. Updated
+    // timestamps for used files are only stored by a full save.
+    if ( journal && ( usedFileTimeStampsUpdated == false ) )
+    {
+        m_PersistedDBFile = nodeGraphDBFile;
+        NodeGraph::CleanPath( m_PersistedDBFile );
+        m_PersistedBaseHash = baseHash;
+        m_PersistedBaseSize = stream.GetSize();
+        m_PersistedJournalSize = journalSize;
+        m_PersistedRecordHashes.SetCapacity( records.GetSize() );
+        for ( const ExtendedDataRecord & record : records )
+        {
+            m_PersistedRecordHashes.Append( record.m_Hash );
+        }
+    }
+
     return LoadResult::OK;
 }
 
 // Save
 //------------------------------------------------------------------------------
-void NodeGraph::Save( ChainedMemoryStream & stream, const char * nodeGraphDBFile ) const
+void NodeGraph::Save( ChainedMemoryStream & stream, const char * nodeGraphDBFile, Array<uint64_t> * outRecordHashes ) const
 {
     // write header and version
     const NodeGraphHeader header;
@@ -533,16 +576,43 @@ void NodeGraph::Save( ChainedMemoryStream & stream, const char * nodeGraphDBFile
         Node::Save( stream, node );
         node->SetBuildPassTag( index++ ); // Save index for dependency serialization
     }
+    Array<uint64_t> extendedDataTable; // Offset and hash pairs
+    extendedDataTable.SetCapacity( numNodes * 2 );
+    MemoryStream record( 4096 );
     for ( const Node * node : m_AllNodes )
     {
         // Save extended properties and dependencies
         // (but not for FileNodes which have none)
         if ( node->GetType() != Node::FILE_NODE )
         {
-            Node::SaveExtended( stream, node );
+            // Hash each record so later saves can journal only changed nodes
+            record.Reset();
+            Node::SaveExtended( record, node );
+            extendedDataTable.Append( stream.Tell() );
+            extendedDataTable.Append( xxHash3::Calc64( record.GetData(), record.GetSize() ) );
+            stream.WriteBuffer( record.GetData(), record.GetSize() );
+        }
+        else
+        {
+            extendedDataTable.Append( 0 );
+            extendedDataTable.Append( 0 );
+        }
+    }
+    if ( outRecordHashes )
+    {
+        outRecordHashes->SetCapacity( numNodes );
+        for ( size_t i = 0; i < numNodes; ++i )
+        {
+            outRecordHashes->Append( extendedDataTable[ ( i * 2 ) + 1 ] );
         }
     }
 
+    // Write table of offsets to extended data (allows parallel loading)
+    // followed by the offset of the table itself
+    const uint64_t offsetTablePos = stream.Tell();
+    stream.Write( extendedDataTable.Begin(), extendedDataTable.GetSize() * sizeof( uint64_t ) );
+    stream.Write( offsetTablePos );
+
     // Calculate hash of stream excluding header
     {
         NodeGraphHeader * headerToUpdate = nullptr;
@@ -573,6 +643,256 @@ void NodeGraph::Save( ChainedMemoryStream & stream, const char * nodeGraphDBFile
     }
 }
 
+// SaveJournal
+//------------------------------------------------------------------------------
+bool NodeGraph::SaveJournal( ChainedMemoryStream & stream,
+                             const char * nodeGraphDBFile,
+                             uint32_t compactRatio,
+                             bool buildInProgress,
+                             Array<uint64_t> & outRecordHashes ) const
+{
+    PROFILE_FUNCTION;
+
+    // Changes can only be journaled if the DB on disk matches this graph
+    AStackString nodeGraphDBFileClean( nodeGraphDBFile );
+    NodeGraph::CleanPath( nodeGraphDBFileClean );
+    if ( m_PersistedDBFile.IsEmpty() || ( m_PersistedDBFile != nodeGraphDBFileClean ) )
+    {
+        return false;
+    }
+
+    // Nodes are only ever added, so previously saved indices remain valid
+    const uint32_t numPersistedNodes = static_cast<uint32_t>( m_PersistedRecordHashes.GetSize() );
+    ASSERT( m_AllNodes.GetSize() >= numPersistedNodes );
+    for ( uint32_t i = 0; i < m_AllNodes.GetSize(); ++i )
+    {
+        m_AllNodes[ i ]->SetBuildPassTag( i ); // Save index for dependency serialization
+    }
+
+    // Nodes being built can be modified by worker threads, so they are skipped
+    // if the build is still in progress. New nodes must always be saved though,
+    // so only those before the first unsaveable new node are included.
+    const uint32_t numNodes = buildInProgress ? GetNumNodesSaveableDuringBuild( numPersistedNodes )
+                                              : static_cast<uint32_t>( m_AllNodes.GetSize() );
+
+    // Entry contains nodes created since the last save
+    MemoryStream entry( 64 * 1024 );
+    entry.Write( numNodes );
+    for ( uint32_t i = numPersistedNodes; i < numNodes; ++i )
+    {
+        Node::Save( entry, m_AllNodes[ i ] );
+    }
+
+    // and extended data for all new or changed nodes
+    outRecordHashes = m_PersistedRecordHashes;
+    outRecordHashes.SetCapacity( numNodes );
+    MemoryStream records( 64 * 1024 );
+    MemoryStream record( 4096 );
+    uint32_t numRecords = 0;
+    for ( uint32_t i = 0; i < numNodes; ++i )
+    {
+        const Node * node = m_AllNodes[ i ];
+        if ( node->GetType() == Node::FILE_NODE )
+        {
+            if ( i >= numPersistedNodes )
+            {
+                outRecordHashes.Append( 0 ); // FileNodes have no extended data
+            }
+            continue;
+        }
+
+        // Previously saved nodes which can't be saved yet will be saved later
+        if ( buildInProgress && ( i < numPersistedNodes ) && ( IsSaveableDuringBuild( node, numNodes ) == false ) )
+        {
+            continue;
+        }
+
+        record.Reset();
+        Node::SaveExtended( record, node );
+        const uint64_t hash = xxHash3::Calc64( record.GetData(), record.GetSize() );
+        if ( i < numPersistedNodes )
+        {
+            if ( hash == m_PersistedRecordHashes[ i ] )
+            {
+                continue; // Unchanged
+            }
+            outRecordHashes[ i ] = hash;
+        }
+        else
+        {
+            outRecordHashes.Append( hash );
+        }
+
+        records.Write( i );
+        records.Write( static_cast<uint32_t>( record.GetSize() ) );
+        records.Write( hash );
+        records.WriteBuffer( record.GetData(), record.GetSize() );
+        ++numRecords;
+    }
+
+    // Nothing to write?
+    if ( ( numRecords == 0 ) && ( numNodes == numPersistedNodes ) )
+    {
+        return true;
+    }
+    entry.Write( numRecords );
+    entry.WriteBuffer( records.GetData(), records.GetSize() );
+
+    // Compact into a full save once the journal grows too large relative to
+    // the DB, to bound load times and disk usage. (A full save can't be done
+    // while building, so this is deferred until the end of the build.)
+    const uint64_t entrySize = ( sizeof( uint64_t ) * 2 ) + entry.GetSize();
+    const uint64_t journalSize = ( m_PersistedJournalSize ? m_PersistedJournalSize : sizeof( NodeGraphJournalHeader ) ) + entrySize;
+    if ( ( buildInProgress == false ) && ( ( journalSize * 100 ) > ( m_PersistedBaseSize * compactRatio ) ) )
+    {
+        FLOG_VERBOSE( " - Journal exceeds %u%% of DB size - compacting", compactRatio );
+        return false;
+    }
+
+    // Start a new journal if needed
+    if ( m_PersistedJournalSize == 0 )
+    {
+        const NodeGraphJournalHeader header( m_PersistedBaseHash );
+        stream.Write( (const void *)&header, sizeof( header ) );
+    }
+
+    // Entries are hashed so partially written entries can be detected
+    stream.Write( static_cast<uint64_t>( entry.GetSize() ) );
+    stream.Write( xxHash3::Calc64( entry.GetData(), entry.GetSize() ) );
+    stream.WriteBuffer( entry.GetData(), entry.GetSize() );
+
+    FLOG_VERBOSE( " - Journal   : %u new nodes, %u changed records", ( numNodes - numPersistedNodes ), numRecords );
+    return true;
+}
+
+// StagePersistedBase
+//------------------------------------------------------------------------------
+void NodeGraph::StagePersistedBase( const char * nodeGraphDBFile, uint64_t baseHash, uint64_t baseSize, Array<uint64_t> && recordHashes )
+{
+    ASSERT( recordHashes.GetSize() == m_AllNodes.GetSize() );
+
+    m_StagedPersistedState = StagedPersistedState::BASE;
+    m_StagedPersistedDBFile = nodeGraphDBFile;
+    NodeGraph::CleanPath( m_StagedPersistedDBFile );
+    m_StagedPersistedBaseHash = baseHash;
+    m_StagedPersistedBaseSize = baseSize;
+    m_StagedPersistedJournalSize = 0;
+    m_StagedPersistedRecordHashes = Move( recordHashes );
+}
+
+// StagePersistedJournal
+//------------------------------------------------------------------------------
+void NodeGraph::StagePersistedJournal( uint64_t journalSize, Array<uint64_t> && recordHashes )
+{
+    ASSERT( m_PersistedDBFile.IsEmpty() == false );
+    ASSERT( recordHashes.GetSize() <= m_AllNodes.GetSize() ); // Checkpoints can exclude new nodes
+
+    m_StagedPersistedState = StagedPersistedState::JOURNAL;
+    m_StagedPersistedJournalSize = journalSize;
+    m_StagedPersistedRecordHashes = Move( recordHashes );
+}
+
+// CommitPersistedState
+//------------------------------------------------------------------------------
+void NodeGraph::CommitPersistedState( bool written )
+{
+    // If a write failed, what is on disk is unknown
+    if ( written == false )
+    {
+        InvalidatePersistedState();
+    }
+    else if ( m_StagedPersistedState == StagedPersistedState::BASE )
+    {
+        m_PersistedDBFile = m_StagedPersistedDBFile;
+        m_PersistedBaseHash = m_StagedPersistedBaseHash;
+        m_PersistedBaseSize = m_StagedPersistedBaseSize;
+        m_PersistedJournalSize = 0;
+        m_PersistedRecordHashes = Move( m_StagedPersistedRecordHashes );
+    }
+    else if ( m_StagedPersistedState == StagedPersistedState::JOURNAL )
+    {
+        // The DB could have been replaced by a failed write since the journal was staged
+        if ( m_PersistedDBFile.IsEmpty() == false )
+        {
+            m_PersistedJournalSize = m_StagedPersistedJournalSize;
+            m_PersistedRecordHashes = Move( m_StagedPersistedRecordHashes );
+        }
+    }
+
+    m_StagedPersistedState = StagedPersistedState::NONE;
+    m_StagedPersistedRecordHashes.Destruct();
+}
+
+// InvalidatePersistedState
+//------------------------------------------------------------------------------
+void NodeGraph::InvalidatePersistedState()
+{
+    m_PersistedDBFile.Clear();
+    m_StagedPersistedState = StagedPersistedState::NONE;
+}
+
+// GetNumNodesSaveableDuringBuild
+//------------------------------------------------------------------------------
+uint32_t NodeGraph::GetNumNodesSaveableDuringBuild( uint32_t numPersistedNodes ) const
+{
+    // Nodes are saved up to the first new node which can't be saved. Excluding
+    // nodes can exclude earlier nodes which depend on them, so repeat until
+    // stable. (Node pointers in properties always refer to earlier nodes.)
+    uint32_t numNodes = static_cast<uint32_t>( m_AllNodes.GetSize() );
+    for ( ;; )
+    {
+        uint32_t i = numPersistedNodes;
+        for ( ; i < numNodes; ++i )
+        {
+            const Node * node = m_AllNodes[ i ];
+            if ( ( node->GetType() != Node::FILE_NODE ) && ( IsSaveableDuringBuild( node, numNodes ) == false ) )
+            {
+                break;
+            }
+        }
+        if ( i == numNodes )
+        {
+            return numNodes;
+        }
+        numNodes = i;
+    }
+}
+
+// IsSaveableDuringBuild
+//------------------------------------------------------------------------------
+/*static*/ bool NodeGraph::IsSaveableDuringBuild( const Node * node, uint32_t numNodes )
+{
+    // Worker threads can be modifying nodes being built
+    if ( node->GetState() == Node::BUILDING )
+    {
+        return false;
+    }
+
+    // All dependencies must be saved too (BuildPassTag holds the node index)
+    const Dependencies * allDeps[] = { &node->GetPreBuildDependencies(),
+                                       &node->GetStaticDependencies(),
+                                       &node->GetDynamicDependencies() };
+    for ( const Dependencies * deps : allDeps )
+    {
+        for ( const Dependency & dep : *deps )
+        {
+            if ( dep.GetNode()->GetBuildPassTag() >= numNodes )
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// GetJournalFileName
+//------------------------------------------------------------------------------
+/*static*/ void NodeGraph::GetJournalFileName( const char * nodeGraphDBFile, AString & outJournalFile )
+{
+    outJournalFile = nodeGraphDBFile;
+    outJournalFile += ".journal";
+}
+
 // SerializeToText
 //------------------------------------------------------------------------------
 void NodeGraph::SerializeToText( const Dependencies & deps, AString & outBuffer ) const
@@ -960,6 +1280,7 @@ void NodeGraph::AddNode( Node * node )
     m_NodeMap[ key ] = node;
 
     // add to list
+    node->m_Index = static_cast<uint32_t>( m_AllNodes.GetSize() );
     m_AllNodes.Append( node );
 }
 
@@ -969,8 +1290,14 @@ void NodeGraph::DoBuildPass( Node * nodeToBuild )
 {
     PROFILE_FUNCTION;
 
+    const Timer t;
     s_BuildPassTag++;
 
+    // Progress nodes whose dependencies completed since the last pass
+    ProcessReadyNodes();
+
+    JobQueue & jobQueue = JobQueue::Get();
+
     if ( nodeToBuild->GetType() == Node::PROXY_NODE )
     {
         const size_t total = nodeToBuild->GetStaticDependencies().GetSize();
@@ -979,9 +1306,9 @@ void NodeGraph::DoBuildPass( Node * nodeToBuild )
         for ( const Dependency & dep : nodeToBuild->GetStaticDependencies() )
         {
             Node * n = dep.GetNode();
-            if ( n->GetState() < Node::BUILDING )
+            if ( ( n->GetState() < Node::BUILDING ) && ( jobQueue.IsWaitingOnDependencies( n ) == false ) )
             {
-                BuildRecurse( n, 0 );
+                BuildRecurse( n, n->GetLastBuildTime() );
             }
 
             // check result of recursion (which may or may not be complete)
@@ -1004,9 +1331,9 @@ void NodeGraph::DoBuildPass( Node * nodeToBuild )
     }
     else
     {
-        if ( nodeToBuild->GetState() < Node::BUILDING )
+        if ( ( nodeToBuild->GetState() < Node::BUILDING ) && ( jobQueue.IsWaitingOnDependencies( nodeToBuild ) == false ) )
         {
-            BuildRecurse( nodeToBuild, 0 );
+            BuildRecurse( nodeToBuild, nodeToBuild->GetLastBuildTime() );
         }
     }
 
@@ -1018,17 +1345,70 @@ void NodeGraph::DoBuildPass( Node * nodeToBuild )
 
     // Make available all the jobs we discovered in this pass
     ASSERT( m_Settings );
-    JobQueue::Get().FlushJobBatch( *m_Settings );
+    jobQueue.FlushJobBatch( *m_Settings );
+
+    m_NumBuildPasses++;
+    m_BuildPassTime += t.GetElapsed();
+}
+
+// NotifyWaitingNodes
+//------------------------------------------------------------------------------
+void NodeGraph::NotifyWaitingNodes( Node * completedNode )
+{
+    ASSERT( ( completedNode->GetState() == Node::UP_TO_DATE ) ||
+            ( completedNode->GetState() == Node::FAILED ) );
+
+    // Nodes which become ready will be progressed in the next build pass
+    JobQueue::Get().OnNodeCompleted( completedNode, m_ReadyNodes );
+}
+
+// ResetWaitingNodes
+//------------------------------------------------------------------------------
+void NodeGraph::ResetWaitingNodes()
+{
+    // Discard any nodes left over from a previous (possibly aborted) build. The
+    // dependencies being waited on are tracked by the JobQueue of each build.
+    m_ReadyNodes.Clear();
+    JobQueue::Get().PrepareWaitingNodes( m_AllNodes.GetSize() );
+}
+
+// ProcessReadyNodes
+//------------------------------------------------------------------------------
+void NodeGraph::ProcessReadyNodes()
+{
+    PROFILE_FUNCTION;
+
+    // Nodes are only made ready when using -eventdriven. They are progressed
+    // directly, without sweeping from the root of the build.
+    while ( m_ReadyNodes.IsEmpty() == false )
+    {
+        Node * node = m_ReadyNodes.Top();
+        m_ReadyNodes.Pop();
+
+        // Node may have been progressed by another ready node recursing into it
+        if ( ( node->GetState() < Node::BUILDING ) && ( JobQueue::Get().IsWaitingOnDependencies( node ) == false ) )
+        {
+            node->SetBuildPassTag( s_BuildPassTag );
+            BuildRecurse( node, node->m_RecursiveCost );
+        }
+
+        // Nodes that did not need building (or failed) complete immediately
+        // and can in turn unblock the nodes waiting on them
+        if ( ( node->GetState() == Node::UP_TO_DATE ) ||
+             ( node->GetState() == Node::FAILED ) )
+        {
+            NotifyWaitingNodes( node );
+        }
+    }
 }
 
 // BuildRecurse
+//  - cost: recursive cost, including this node
 //------------------------------------------------------------------------------
 void NodeGraph::BuildRecurse( Node * nodeToBuild, uint32_t cost )
 {
     ASSERT( nodeToBuild );
-
-    // accumulate recursive cost
-    cost += nodeToBuild->GetLastBuildTime();
+    m_NumNodesVisited++;
 
     // False positive "Unannotated fallthrough between switch labels" (VS 2019 v14.29.30037)
 #if defined( _MSC_VER ) && ( _MSC_VER < 1935 )
@@ -1143,6 +1523,8 @@ bool NodeGraph::CheckDependencies( Node * nodeToBuild, const Dependencies & depe
     uint32_t numberNodesUpToDate = 0;
     uint32_t numberNodesFailed = 0;
     const bool stopOnFirstError = FBuild::Get().GetOptions().m_StopOnFirstError;
+    const bool eventDriven = FBuild::Get().GetOptions().m_EventDrivenScheduling;
+    JobQueue & jobQueue = JobQueue::Get();
 
     for ( const Dependency & dep : dependencies )
     {
@@ -1151,7 +1533,8 @@ bool NodeGraph::CheckDependencies( Node * nodeToBuild, const Dependencies & depe
         Node::State state = n->GetState();
 
         // recurse into nodes which have not been processed yet
-        if ( state < Node::BUILDING )
+        // (nodes waiting on their own dependencies will be progressed once those complete)
+        if ( ( state < Node::BUILDING ) && ( jobQueue.IsWaitingOnDependencies( n ) == false ) )
         {
             // early out if already seen
             if ( n->GetBuildPassTag() != passTag )
@@ -1159,7 +1542,7 @@ bool NodeGraph::CheckDependencies( Node * nodeToBuild, const Dependencies & depe
                 // prevent multiple recursions in this pass
                 n->SetBuildPassTag( passTag );
 
-                BuildRecurse( n, cost );
+                BuildRecurse( n, cost + n->GetLastBuildTime() );
             }
         }
 
@@ -1193,6 +1576,15 @@ bool NodeGraph::CheckDependencies( Node * nodeToBuild, const Dependencies & depe
                 break;
             }
         }
+        else if ( eventDriven )
+        {
+            // wait for dependency to complete instead of checking it again in later passes
+            jobQueue.AddWaitingNode( n, nodeToBuild );
+            if ( cost > nodeToBuild->m_RecursiveCost )
+            {
+                nodeToBuild->m_RecursiveCost = cost;
+            }
+        }
 
         // keep trying to progress other nodes...
     }
@@ -1211,6 +1603,217 @@ bool NodeGraph::CheckDependencies( Node * nodeToBuild, const Dependencies & depe
     return allDependenciesUpToDate;
 }
 
+// GetDirectoriesToWatch
+//------------------------------------------------------------------------------
+void NodeGraph::GetDirectoriesToWatch( Array<AString> & outDirs, Array<AString> & outRecursiveDirs ) const
+{
+    PROFILE_FUNCTION;
+
+    // Directories of source files (and of the bff files) are watched
+    // individually, but directory listings need their entire tree watched
+    UnorderedMap<AString, bool> dirs;
+    AStackString dir;
+    for ( const Node * node : m_AllNodes )
+    {
+        if ( node->GetType() == Node::DIRECTORY_LIST_NODE )
+        {
+            const DirectoryListNode * dln = node->CastTo<DirectoryListNode>();
+            if ( dln->IsRecursive() )
+            {
+                outRecursiveDirs.Append( dln->GetPath() );
+                continue;
+            }
+            dir = dln->GetPath();
+        }
+        else if ( node->GetType() == Node::FILE_NODE )
+        {
+            const char * lastSlash = node->GetName().FindLast( NATIVE_SLASH );
+            if ( lastSlash == nullptr )
+            {
+                continue;
+            }
+            dir.Assign( node->GetName().Get(), lastSlash + 1 );
+        }
+        else
+        {
+            continue;
+        }
+
+        if ( dirs.Find( dir ) == nullptr )
+        {
+            dirs.Insert( dir, true );
+            outDirs.Append( dir );
+        }
+    }
+    for ( const UsedFile & usedFile : m_UsedFiles )
+    {
+        const char * lastSlash = usedFile.m_FileName.FindLast( NATIVE_SLASH );
+        if ( lastSlash )
+        {
+            dir.Assign( usedFile.m_FileName.Get(), lastSlash + 1 );
+            if ( dirs.Find( dir ) == nullptr )
+            {
+                dirs.Insert( dir, true );
+                outDirs.Append( dir );
+            }
+        }
+    }
+}
+
+// IsUsedFile
+//------------------------------------------------------------------------------
+bool NodeGraph::IsUsedFile( const AString & fileName ) const
+{
+    for ( const UsedFile & usedFile : m_UsedFiles )
+    {
+        if ( usedFile.m_FileName == fileName )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ResetForRebuild
+//  - Prepare for another build in the same process (-watch). Source files and
+//    directory listings which were up-to-date and which aren't affected by any
+//    of the changedPaths keep their state, so aren't checked again.
+//  - If watcher is null, changes are unknown and everything is checked.
+//  - Returns false (and changes nothing) if no nodes are affected.
+//------------------------------------------------------------------------------
+bool NodeGraph::ResetForRebuild( FileSystemWatcher * watcher, const Array<AString> & changedPaths )
+{
+    PROFILE_FUNCTION;
+
+    const size_t numNodes = m_AllNodes.GetSize();
+    Array<bool> unchanged;
+    unchanged.SetSize( numNodes );
+    for ( bool & value : unchanged )
+    {
+        value = false;
+    }
+
+    if ( watcher )
+    {
+        // Changed files, and changed directories (created, deleted or moved)
+        UnorderedMap<AString, bool> changedFiles;
+        Array<const AString *> changedDirs;
+        Array<const AString *> relevantPaths;
+        for ( const AString & path : changedPaths )
+        {
+            if ( path.EndsWith( NATIVE_SLASH ) )
+            {
+                changedDirs.Append( &path );
+            }
+            else
+            {
+                // Ignore files written by the build itself, so that building
+                // doesn't trigger another build
+                const Node * outputNode = FindNodeExact( path );
+                if ( outputNode && ( outputNode->GetType() != Node::FILE_NODE ) && outputNode->IsAFile() )
+                {
+                    continue;
+                }
+                if ( changedFiles.Find( path ) != nullptr )
+                {
+                    continue;
+                }
+                changedFiles.Insert( path, true );
+            }
+            relevantPaths.Append( &path );
+        }
+
+        uint32_t numAffected = 0;
+        AStackString dir;
+        AStackString lastDir;
+        bool lastDirWatched = false;
+        for ( size_t i = 0; i < numNodes; ++i )
+        {
+            const Node * node = m_AllNodes[ i ];
+            if ( node->GetState() != Node::UP_TO_DATE )
+            {
+                continue; // Failed, or not part of the previous build
+            }
+
+            bool affected = false;
+            if ( node->GetType() == Node::FILE_NODE )
+            {
+                // Files in directories which aren't watched (e.g. which don't exist) are always checked
+                const AString & name = node->GetName();
+                const char * lastSlash = name.FindLast( NATIVE_SLASH );
+                if ( lastSlash == nullptr )
+                {
+                    continue;
+                }
+                dir.Assign( name.Get(), lastSlash + 1 );
+                if ( dir != lastDir )
+                {
+                    lastDir = dir;
+                    lastDirWatched = watcher->IsWatched( dir );
+                }
+                if ( lastDirWatched == false )
+                {
+                    continue;
+                }
+
+                affected = ( changedFiles.Find( name ) != nullptr );
+                for ( const AString * changedDir : changedDirs )
+                {
+                    affected |= name.BeginsWith( *changedDir );
+                }
+            }
+            else if ( node->GetType() == Node::DIRECTORY_LIST_NODE )
+            {
+                const DirectoryListNode * dln = node->CastTo<DirectoryListNode>();
+                const AString & path = dln->GetPath();
+                if ( watcher->IsWatched( path ) == false )
+                {
+                    continue;
+                }
+
+                for ( const AString * changedPath : relevantPaths )
+                {
+                    if ( dln->IsInListing( *changedPath ) )
+                    {
+                        affected = true; // Would be found (or was found before) by the listing
+                    }
+                    else if ( changedPath->EndsWith( NATIVE_SLASH ) && path.BeginsWith( *changedPath ) )
+                    {
+                        affected = true; // Parent directory was created, deleted or moved
+                    }
+                }
+            }
+            else
+            {
+                continue;
+            }
+
+            if ( affected )
+            {
+                ++numAffected;
+            }
+            else
+            {
+                unchanged[ i ] = true;
+            }
+        }
+
+        if ( numAffected == 0 )
+        {
+            return false;
+        }
+    }
+
+    // Forget the state of the previous build, as if the graph was just loaded
+    for ( size_t i = 0; i < numNodes; ++i )
+    {
+        Node * node = m_AllNodes[ i ];
+        node->m_State = unchanged[ i ] ? Node::UP_TO_DATE : Node::NOT_PROCESSED;
+        node->m_StatsFlags = 0;
+    }
+    return true;
+}
+
 //------------------------------------------------------------------------------
 void NodeGraph::SetBuildPassTagForAllNodes( uint32_t value ) const
 {
@@ -1708,6 +2311,375 @@ void NodeGraph::FindNearestNodesInternal( const AString & fullPath, Array<NodeWi
     return false;
 }
 
+// CheckUsedFilesContext
+//------------------------------------------------------------------------------
+class NodeGraph::CheckUsedFilesContext
+{
+public:
+    enum Result : uint8_t
+    {
+        eNotChecked, // Skipped as reparsing was already required
+        eUnchanged,
+        eTimeStampUpdated, // Contents unchanged
+        eMissing,
+        eChanged,
+        eReadError,
+    };
+
+    static void CheckRange( uint32_t begin, uint32_t end, void * userData );
+
+    Array<UsedFile> * m_Files = nullptr;
+    Array<Result> m_Results;
+    volatile bool m_NeedsReparsing = false; // Allows other checks to early out
+};
+
+// CheckUsedFilesContext::CheckRange
+//------------------------------------------------------------------------------
+/*static*/ void NodeGraph::CheckUsedFilesContext::CheckRange( uint32_t begin, uint32_t end, void * userData )
+{
+    CheckUsedFilesContext & context = *static_cast<CheckUsedFilesContext *>( userData );
+
+    for ( uint32_t i = begin; i < end; ++i )
+    {
+        // Stop checking once any file means reparsing will occur
+        if ( AtomicLoadRelaxed( &context.m_NeedsReparsing ) )
+        {
+            return;
+        }
+
+        UsedFile & usedFile = ( *context.m_Files )[ i ];
+        const uint64_t timeStamp = FileIO::GetFileLastWriteTime( usedFile.m_FileName );
+        if ( timeStamp == usedFile.m_TimeStamp )
+        {
+            context.m_Results[ i ] = eUnchanged; // timestamps match, no need to check hashes
+            continue;
+        }
+
+        FileStream fs;
+        if ( fs.Open( usedFile.m_FileName.Get(), FileStream::READ_ONLY ) == false )
+        {
+            // not opening the file is not an error, it could be not needed anymore
+            context.m_Results[ i ] = eMissing;
+            AtomicStoreRelaxed( &context.m_NeedsReparsing, true );
+            continue;
+        }
+
+        const size_t size = (size_t)fs.GetFileSize();
+        UniquePtr<void, FreeDeletor> mem( ALLOC( size ) );
+        if ( fs.Read( mem.Get(), size ) != size )
+        {
+            context.m_Results[ i ] = eReadError;
+            continue;
+        }
+
+        const uint64_t dataHash = xxHash3::Calc64( mem.Get(), size );
+        if ( dataHash == usedFile.m_DataHash )
+        {
+            // file didn't change, update stored timestamp to save time on the next run
+            usedFile.m_TimeStamp = timeStamp;
+            context.m_Results[ i ] = eTimeStampUpdated;
+            continue;
+        }
+
+        context.m_Results[ i ] = eChanged;
+        AtomicStoreRelaxed( &context.m_NeedsReparsing, true );
+    }
+}
+
+// CheckUsedFilesForChanges
+//------------------------------------------------------------------------------
+/*static*/ bool NodeGraph::CheckUsedFilesForChanges( Array<UsedFile> & files, bool & outNeedsReparsing, bool & outTimeStampsUpdated )
+{
+    PROFILE_FUNCTION;
+
+    const uint32_t numFiles = static_cast<uint32_t>( files.GetSize() );
+
+    CheckUsedFilesContext context;
+    context.m_Files = &files;
+    context.m_Results.SetSize( numFiles );
+    for ( CheckUsedFilesContext::Result & result : context.m_Results )
+    {
+        result = CheckUsedFilesContext::eNotChecked;
+    }
+
+    // Check files in parallel (one per batch as each can be slow on network
+    // drives) if there is a ThreadPool
+    ThreadPool * threadPool = FBuild::IsValid() ? FBuild::Get().GetThreadPool() : nullptr;
+    if ( threadPool )
+    {
+        threadPool->ParallelFor( numFiles, 1, CheckUsedFilesContext::CheckRange, &context );
+    }
+    else
+    {
+        CheckUsedFilesContext::CheckRange( 0, numFiles, &context );
+    }
+
+    // Report results in order so messages are deterministic
+    for ( uint32_t i = 0; i < numFiles; ++i )
+    {
+        switch ( context.m_Results[ i ] )
+        {
+            case CheckUsedFilesContext::eNotChecked:
+            case CheckUsedFilesContext::eUnchanged:
+            {
+                break;
+            }
+            case CheckUsedFilesContext::eTimeStampUpdated:
+            {
+                outTimeStampsUpdated = true;
+                break;
+            }
+            case CheckUsedFilesContext::eMissing:
+            {
+                if ( !outNeedsReparsing )
+                {
+                    FLOG_VERBOSE( "BFF file '%s' missing or unopenable (reparsing will occur).", files[ i ].m_FileName.Get() );
+                    outNeedsReparsing = true;
+                }
+                break;
+            }
+            case CheckUsedFilesContext::eChanged:
+            {
+                // Tell used reparsing will occur (Warn only about the first file)
+                if ( !outNeedsReparsing )
+                {
+                    FLOG_WARN( "BFF file '%s' has changed (reparsing will occur).", files[ i ].m_FileName.Get() );
+                    outNeedsReparsing = true;
+                }
+                break;
+            }
+            case CheckUsedFilesContext::eReadError:
+            {
+                return false; // error reading
+            }
+        }
+    }
+    return true;
+}
+
+// ReadExtendedDataTable
+//------------------------------------------------------------------------------
+bool NodeGraph::ReadExtendedDataTable( ConstMemoryStream & stream, Array<ExtendedDataRecord> & outRecords ) const
+{
+    const uint32_t numNodes = static_cast<uint32_t>( m_AllNodes.GetSize() );
+    const uint64_t size = stream.GetSize();
+    const uint64_t tableSize = ( numNodes * sizeof( uint64_t ) * 2 );
+
+    // Table of offset and hash pairs is at the end of the stream
+    uint64_t offsetTablePos = 0;
+    if ( size < ( tableSize + sizeof( uint64_t ) ) )
+    {
+        return false;
+    }
+    const char * data = static_cast<const char *>( stream.GetData() );
+    memcpy( &offsetTablePos, data + size - sizeof( uint64_t ), sizeof( uint64_t ) );
+    if ( ( offsetTablePos < stream.Tell() ) || ( ( offsetTablePos + tableSize + sizeof( uint64_t ) ) != size ) )
+    {
+        return false;
+    }
+
+    outRecords.SetSize( numNodes );
+    const char * table = ( data + offsetTablePos );
+    for ( uint32_t i = 0; i < numNodes; ++i )
+    {
+        uint64_t offsetAndHash[ 2 ];
+        memcpy( offsetAndHash, table + ( i * sizeof( offsetAndHash ) ), sizeof( offsetAndHash ) );
+        if ( offsetAndHash[ 0 ] > offsetTablePos )
+        {
+            return false;
+        }
+        ExtendedDataRecord & record = outRecords[ i ];
+        record.m_Data = ( data + offsetAndHash[ 0 ] );
+        record.m_Size = ( offsetTablePos - offsetAndHash[ 0 ] );
+        record.m_Hash = offsetAndHash[ 1 ];
+    }
+
+    // Everything has been consumed
+    VERIFY( stream.Seek( size ) );
+    return true;
+}
+
+// ReplayJournal
+//------------------------------------------------------------------------------
+uint64_t NodeGraph::ReplayJournal( const MemoryMappedFile & journal, uint64_t baseHash, Array<ExtendedDataRecord> & records )
+{
+    PROFILE_FUNCTION;
+
+    ConstMemoryStream stream( journal.GetData(), journal.GetSize() );
+    const char * data = static_cast<const char *>( stream.GetData() );
+
+    // Ignore journals from older versions or which belong to a previous DB
+    // (the DB was rewritten but the journal was not yet deleted)
+    NodeGraphJournalHeader header;
+    if ( ( stream.Read( &header, sizeof( header ) ) != sizeof( header ) ) ||
+         ( header.IsValid() == false ) ||
+         ( header.IsCompatibleVersion() == false ) ||
+         ( header.GetBaseContentHash() != baseHash ) )
+    {
+        FLOG_VERBOSE( "Ignoring stale DB journal" );
+        return 0;
+    }
+
+    // Changed records are only applied once the whole journal is known to be
+    // consistent with the DB
+    class ChangedRecord
+    {
+    public:
+        uint32_t m_Index;
+        ExtendedDataRecord m_Record;
+    };
+    Array<ChangedRecord> changedRecords;
+    const uint32_t numBaseNodes = static_cast<uint32_t>( m_AllNodes.GetSize() );
+    bool corrupt = false;
+
+    uint64_t validSize = stream.Tell();
+    while ( corrupt == false )
+    {
+        // Stop at the end or at an entry which was not completely written
+        uint64_t entrySize = 0;
+        uint64_t entryHash = 0;
+        if ( ( stream.Read( entrySize ) == false ) || ( stream.Read( entryHash ) == false ) )
+        {
+            break;
+        }
+        const uint64_t entryPos = stream.Tell();
+        if ( ( entrySize > ( stream.GetSize() - entryPos ) ) ||
+             ( xxHash3::Calc64( data + entryPos, (size_t)entrySize ) != entryHash ) )
+        {
+            FLOG_VERBOSE( "Ignoring incomplete DB journal entry" );
+            break;
+        }
+        ConstMemoryStream entry( data + entryPos, (size_t)entrySize );
+
+        // Create nodes added by this entry
+        uint32_t numNodes = 0;
+        if ( ( entry.Read( numNodes ) == false ) || ( numNodes < m_AllNodes.GetSize() ) )
+        {
+            corrupt = true;
+            break;
+        }
+        for ( uint32_t i = static_cast<uint32_t>( m_AllNodes.GetSize() ); i < numNodes; ++i )
+        {
+            Node::Load( *this, entry );
+        }
+
+        // Extended data for new or changed nodes replaces previous data
+        uint32_t numRecords = 0;
+        if ( entry.Read( numRecords ) == false )
+        {
+            corrupt = true;
+            break;
+        }
+        for ( uint32_t i = 0; i < numRecords; ++i )
+        {
+            uint32_t index = 0;
+            uint32_t recordSize = 0;
+            uint64_t recordHash = 0;
+            if ( ( entry.Read( index ) == false ) ||
+                 ( entry.Read( recordSize ) == false ) ||
+                 ( entry.Read( recordHash ) == false ) ||
+                 ( index >= numNodes ) ||
+                 ( recordSize > ( entry.GetSize() - entry.Tell() ) ) )
+            {
+                corrupt = true;
+                break;
+            }
+            ChangedRecord & changedRecord = changedRecords.EmplaceBack();
+            changedRecord.m_Index = index;
+            changedRecord.m_Record.m_Data = ( static_cast<const char *>( entry.GetData() ) + entry.Tell() );
+            changedRecord.m_Record.m_Size = recordSize;
+            changedRecord.m_Record.m_Hash = recordHash;
+            VERIFY( entry.Seek( entry.Tell() + recordSize ) );
+        }
+
+        VERIFY( stream.Seek( entryPos + entrySize ) );
+        validSize = stream.Tell();
+    }
+
+    // A journal which doesn't match the DB is dropped entirely, removing the
+    // nodes it created (most recently created first, to unlink from the map)
+    if ( corrupt )
+    {
+        FLOG_WARN( "DB journal is corrupt and will be ignored" );
+        while ( m_AllNodes.GetSize() > numBaseNodes )
+        {
+            Node * node = m_AllNodes.Top();
+            const size_t key = ( node->GetNameHash() & m_NodeMapMaxKey );
+            ASSERT( m_NodeMap[ key ] == node );
+            m_NodeMap[ key ] = node->m_Next;
+            m_AllNodes.Pop();
+            FDELETE node;
+        }
+        return 0;
+    }
+
+    records.SetSize( m_AllNodes.GetSize() );
+    for ( const ChangedRecord & changedRecord : changedRecords )
+    {
+        records[ changedRecord.m_Index ] = changedRecord.m_Record;
+    }
+    return validSize;
+}
+
+// LoadExtendedDataContext
+//------------------------------------------------------------------------------
+class NodeGraph::LoadExtendedDataContext
+{
+public:
+    static void LoadRange( uint32_t begin, uint32_t end, void * userData );
+
+    NodeGraph * m_NodeGraph = nullptr;
+    const Array<ExtendedDataRecord> * m_Records = nullptr;
+};
+
+// LoadExtendedDataContext::LoadRange
+//------------------------------------------------------------------------------
+/*static*/ void NodeGraph::LoadExtendedDataContext::LoadRange( uint32_t begin, uint32_t end, void * userData )
+{
+    const LoadExtendedDataContext & context = *static_cast<const LoadExtendedDataContext *>( userData );
+
+    for ( uint32_t i = begin; i < end; ++i )
+    {
+        // FileNodes have no extended data
+        Node * node = context.m_NodeGraph->GetNodeByIndex( i );
+        if ( node->GetType() == Node::FILE_NODE )
+        {
+            continue;
+        }
+
+        // Data is in the DB or the journal
+        const ExtendedDataRecord & record = ( *context.m_Records )[ i ];
+        ConstMemoryStream stream( record.m_Data, (size_t)record.m_Size );
+        Node::LoadExtended( *context.m_NodeGraph, node, stream );
+    }
+}
+
+// LoadExtendedData
+//------------------------------------------------------------------------------
+void NodeGraph::LoadExtendedData( const Array<ExtendedDataRecord> & records )
+{
+    PROFILE_FUNCTION;
+
+    const uint32_t numNodes = static_cast<uint32_t>( m_AllNodes.GetSize() );
+    ASSERT( records.GetSize() == numNodes );
+
+    LoadExtendedDataContext context;
+    context.m_NodeGraph = this;
+    context.m_Records = &records;
+
+    // Spread work over the ThreadPool if there is one
+    const uint32_t kNodesPerBatch = 256;
+    ThreadPool * threadPool = FBuild::IsValid() ? FBuild::Get().GetThreadPool() : nullptr;
+    if ( threadPool )
+    {
+        threadPool->ParallelFor( numNodes, kNodesPerBatch, LoadExtendedDataContext::LoadRange, &context );
+    }
+    else
+    {
+        LoadExtendedDataContext::LoadRange( 0, numNodes, &context );
+    }
+}
+
 // ReadHeaderAndUsedFiles
 //------------------------------------------------------------------------------
 bool NodeGraph::ReadHeaderAndUsedFiles( ConstMemoryStream & nodeGraphStream, const char * nodeGraphDBFile, Array<UsedFile> & files, bool & compatibleDB, bool & movedDB ) const
@@ -31,10 +31,12 @@ class DLLNode;
 class ExeNode;
 class ExecNode;
 class FileNode;
+class FileSystemWatcher;
 class IOStream;
 class LibraryNode;
 class LinkerNode;
 class ListDependenciesNode;
+class MemoryMappedFile;
 class Node;
 class ObjectListNode;
 class ObjectNode;
@@ -66,7 +68,7 @@ public:
     }
     ~NodeGraphHeader() = default;
 
-    inline static const uint8_t kCurrentVersion = 181;
+    inline static const uint8_t kCurrentVersion = 186;
 
     bool IsValid() const;
     bool IsCompatibleVersion() const { return m_Version == kCurrentVersion; }
@@ -81,6 +83,36 @@ private:
     uint64_t m_ContentHash; // Hash of data excluding this header
 };
 
+// NodeGraphJournalHeader
+//  - Header of the journal of incremental changes (-dbjournal) which is
+//    appended to instead of rewriting the entire DB
+//------------------------------------------------------------------------------
+class NodeGraphJournalHeader
+{
+public:
+    explicit NodeGraphJournalHeader( uint64_t baseContentHash = 0 )
+    {
+        m_Identifier[ 0 ] = 'N';
+        m_Identifier[ 1 ] = 'G';
+        m_Identifier[ 2 ] = 'J';
+        m_Version = NodeGraphHeader::kCurrentVersion;
+        m_Padding = 0;
+        m_BaseContentHash = baseContentHash;
+    }
+    ~NodeGraphJournalHeader() = default;
+
+    bool IsValid() const;
+    bool IsCompatibleVersion() const { return m_Version == NodeGraphHeader::kCurrentVersion; }
+
+    uint64_t GetBaseContentHash() const { return m_BaseContentHash; }
+
+private:
+    char m_Identifier[ 3 ];
+    uint8_t m_Version;
+    uint32_t m_Padding; // Unused
+    uint64_t m_BaseContentHash; // Content hash of the DB this journal applies to
+};
+
 // NodeGraph
 //------------------------------------------------------------------------------
 class NodeGraph
@@ -102,7 +134,20 @@ public:
     NodeGraph::LoadResult Load( const char * nodeGraphDBFile );
 
     LoadResult Load( ConstMemoryStream & stream, const char * nodeGraphDBFile );
-    void Save( ChainedMemoryStream & stream, const char * nodeGraphDBFile ) const;
+    void Save( ChainedMemoryStream & stream, const char * nodeGraphDBFile, Array<uint64_t> * outRecordHashes = nullptr ) const;
+
+    // Incremental saving (-dbjournal)
+    bool SaveJournal( ChainedMemoryStream & stream,
+                      const char * nodeGraphDBFile,
+                      uint32_t compactRatio,
+                      bool buildInProgress,
+                      Array<uint64_t> & outRecordHashes ) const;
+    void StagePersistedBase( const char * nodeGraphDBFile, uint64_t baseHash, uint64_t baseSize, Array<uint64_t> && recordHashes );
+    void StagePersistedJournal( uint64_t journalSize, Array<uint64_t> && recordHashes );
+    void CommitPersistedState( bool written ); // Once the staged save's write completes
+    void InvalidatePersistedState();
+    uint64_t GetPersistedJournalSize() const { return m_PersistedJournalSize; }
+    static void GetJournalFileName( const char * nodeGraphDBFile, AString & outJournalFile );
     void SerializeToText( const Dependencies & dependencies, AString & outBuffer ) const;
     void SerializeToDotFormat( const Dependencies & deps, const bool fullGraph, AString & outBuffer ) const;
 
@@ -133,6 +178,20 @@ public:
 
     void DoBuildPass( Node * nodeToBuild );
 
+    // Event-driven scheduling (-eventdriven)
+    void NotifyWaitingNodes( Node * completedNode );
+    void ResetWaitingNodes();
+
+    // Scheduling overhead, accumulated over all builds of this graph
+    uint32_t GetNumBuildPasses() const { return m_NumBuildPasses; }
+    uint64_t GetNumNodesVisited() const { return m_NumNodesVisited; }
+    float GetBuildPassTime() const { return m_BuildPassTime; }
+
+    // Watch mode (-watch)
+    void GetDirectoriesToWatch( Array<AString> & outDirs, Array<AString> & outRecursiveDirs ) const;
+    bool IsUsedFile( const AString & fileName ) const;
+    bool ResetForRebuild( FileSystemWatcher * watcher, const Array<AString> & changedPaths );
+
     // Non-build operations that use the BuildPassTag can set it to a known value
     void SetBuildPassTagForAllNodes( uint32_t value ) const;
 
@@ -152,11 +211,13 @@ private:
     friend class FBuild;
 
     bool ParseFromRoot( const char * bffFile );
+    LoadResult Load( ConstMemoryStream & stream, const char * nodeGraphDBFile, const MemoryMappedFile * journal );
 
     void AddNode( Node * node );
 
     void BuildRecurse( Node * nodeToBuild, uint32_t cost );
     bool CheckDependencies( Node * nodeToBuild, const Dependencies & dependencies, uint32_t cost );
+    void ProcessReadyNodes();
     static void UpdateBuildStatusRecurse( const Node * node,
                                           uint32_t & nodesBuiltTime,
                                           uint32_t & totalNodeTime );
@@ -191,8 +252,24 @@ private:
                                  Array<UsedFile> & files,
                                  bool & compatibleDB,
                                  bool & movedDB ) const;
+    class CheckUsedFilesContext;
+    static bool CheckUsedFilesForChanges( Array<UsedFile> & files, bool & outNeedsReparsing, bool & outTimeStampsUpdated );
     uint32_t GetLibEnvVarHash() const;
 
+    // Location of the extended data for a node (in the DB or the journal)
+    struct ExtendedDataRecord
+    {
+        const char * m_Data = nullptr;
+        uint64_t m_Size = 0;
+        uint64_t m_Hash = 0;
+    };
+    bool ReadExtendedDataTable( ConstMemoryStream & stream, Array<ExtendedDataRecord> & outRecords ) const;
+    uint64_t ReplayJournal( const MemoryMappedFile & journal, uint64_t baseHash, Array<ExtendedDataRecord> & records );
+    class LoadExtendedDataContext;
+    uint32_t GetNumNodesSaveableDuringBuild( uint32_t numPersistedNodes ) const;
+    static bool IsSaveableDuringBuild( const Node * node, uint32_t numNodes );
+    void LoadExtendedData( const Array<ExtendedDataRecord> & records );
+
     void RegisterSourceToken( const Node * node, const BFFToken * sourceToken );
 
     // load/save helpers
@@ -223,6 +300,10 @@ private:
     Node ** m_NodeMap;
     uint32_t m_NodeMapMaxKey; // Always equals to some power of 2 minus 1, can be used as mask.
     Array<Node *> m_AllNodes;
+    Array<Node *> m_ReadyNodes; // Nodes whose waited on dependencies have all completed (-eventdriven)
+    uint32_t m_NumBuildPasses = 0; // Calls to DoBuildPass
+    uint64_t m_NumNodesVisited = 0; // Calls to BuildRecurse
+    float m_BuildPassTime = 0.0f; // Time spent in DoBuildPass
 
     Timer m_Timer;
 
@@ -246,6 +327,29 @@ private:
 
     const SettingsNode * m_Settings;
 
+    // On-disk state of the DB, allowing changes to be journaled (-dbjournal).
+    // m_PersistedDBFile is empty if the graph doesn't match the DB on disk.
+    AString m_PersistedDBFile;
+    uint64_t m_PersistedBaseHash = 0;
+    uint64_t m_PersistedBaseSize = 0;
+    uint64_t m_PersistedJournalSize = 0; // Size of valid data in journal
+    Array<uint64_t> m_PersistedRecordHashes; // Hash of extended data for each node
+
+    // State of a save which is being written. It only becomes the on-disk
+    // state once the write succeeds.
+    enum class StagedPersistedState : uint8_t
+    {
+        NONE,
+        BASE, // Entire DB
+        JOURNAL, // Entries appended to the journal
+    };
+    StagedPersistedState m_StagedPersistedState = StagedPersistedState::NONE;
+    AString m_StagedPersistedDBFile;
+    uint64_t m_StagedPersistedBaseHash = 0;
+    uint64_t m_StagedPersistedBaseSize = 0;
+    uint64_t m_StagedPersistedJournalSize = 0;
+    Array<uint64_t> m_StagedPersistedRecordHashes;
+
     static uint32_t s_BuildPassTag;
 };
 
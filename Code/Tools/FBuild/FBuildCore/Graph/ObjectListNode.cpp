@@ -570,6 +570,8 @@ ObjectListNode::~ObjectListNode() = default;
 //------------------------------------------------------------------------------
 /*virtual*/ Node::BuildResult ObjectListNode::DoBuild( Job * /*job*/ )
 {
+    RecordUnityCompileTimes();
+
     // Generate stamp
     if ( m_DynamicDependencies.IsEmpty() )
     {
@@ -591,6 +593,25 @@ ObjectListNode::~ObjectListNode() = default;
     return BuildResult::eOk;
 }
 
+// RecordUnityCompileTimes
+//  - Feed compile times back to Unities balanced by cost, for future builds
+//------------------------------------------------------------------------------
+void ObjectListNode::RecordUnityCompileTimes()
+{
+    for ( const Dependency & dep : m_StaticDependencies )
+    {
+        if ( dep.GetNode()->GetType() != Node::UNITY_NODE )
+        {
+            continue;
+        }
+        UnityNode * un = dep.GetNode()->CastTo<UnityNode>();
+        if ( un->IsBalancedByCost() )
+        {
+            un->RecordCompileTimes( m_DynamicDependencies );
+        }
+    }
+}
+
 // GetInputFiles
 //------------------------------------------------------------------------------
 void ObjectListNode::GetInputFiles( bool objectsInsteadOfLibs, Array<AString> & outInputs ) const
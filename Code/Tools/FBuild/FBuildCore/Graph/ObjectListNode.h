@@ -54,6 +54,7 @@ protected:
     virtual BuildResult DoBuild( Job * job ) override;
 
     // internal helpers
+    void RecordUnityCompileTimes();
     bool CreateDynamicObjectNode( NodeGraph & nodeGraph,
                                   const AString & inputFileName,
                                   const AString & baseDir,
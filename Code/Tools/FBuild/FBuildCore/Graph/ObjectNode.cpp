@@ -29,7 +29,9 @@
 #include "Tools/FBuild/FBuildCore/Helpers/Args.h"
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
 #include "Tools/FBuild/FBuildCore/Helpers/CIncludeParser.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompressionDictionary.h"
 #include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/HeaderFragmentStore.h"
 #include "Tools/FBuild/FBuildCore/Helpers/MultiBuffer.h"
 #include "Tools/FBuild/FBuildCore/Helpers/ResponseFile.h"
 #include "Tools/FBuild/FBuildCore/Helpers/ToolManifest.h"
@@ -517,9 +519,39 @@ Node::BuildResult ObjectNode::DoBuildWithPreProcessor( Job * job, bool useDeopti
     const bool belowMemoryLimit = ( ( Job::GetTotalLocalDataMemoryUsage() / MEGABYTE ) < FBuild::Get().GetSettings()->GetDistributableJobMemoryLimitMiB() );
     if ( canDistribute && belowMemoryLimit )
     {
+        const int16_t compressionLevel = FBuild::Get().GetOptions().m_DistributionCompressionLevel;
+
+        // split job data into fragments, so workers are only sent those they don't have
+        if ( HeaderFragmentStore * fragmentStore = FBuild::Get().GetDistributionHeaderFragmentStore() )
+        {
+            Array<const HeaderFragment *> fragments;
+            fragmentStore->AddPreprocessedOutput( job->GetData(), job->GetDataSize(), compressionLevel, fragments );
+            job->SetHeaderFragments( Move( fragments ) );
+        }
+
         // compress job data
         Compressor c;
-        c.Compress( job->GetData(), job->GetDataSize(), FBuild::Get().GetOptions().m_DistributionCompressionLevel );
+        CompressionDictionary * dictionary = nullptr;
+        if ( CompressionDictionaryBuilder * dictionaryBuilder = FBuild::Get().GetDistributionDictionaryBuilder() )
+        {
+            // The first jobs are used to train the dictionary
+            dictionary = dictionaryBuilder->GetDictionary();
+            if ( dictionary == nullptr )
+            {
+                dictionaryBuilder->AddSample( job->GetData(), job->GetDataSize() );
+                dictionary = dictionaryBuilder->GetDictionary();
+            }
+        }
+        if ( dictionary && ( compressionLevel != 0 ) )
+        {
+            // Dictionary compression requires Zstd (using at least the lowest level)
+            c.CompressZstd( job->GetData(), job->GetDataSize(), Math::Max<int32_t>( compressionLevel, 1 ), *dictionary );
+            job->SetCompressionDictionary( dictionary );
+        }
+        else
+        {
+            c.Compress( job->GetData(), job->GetDataSize(), compressionLevel );
+        }
         const size_t compressedSize = c.GetResultSize();
         job->OwnData( c.ReleaseResult(), compressedSize, true );
 
@@ -1444,47 +1476,43 @@ bool ObjectNode::RetrieveFromCache( Job * job )
             pchKey = xxHash3::Calc64( cacheData, cacheDataSize );
         }
 
-        const uint32_t startDecompress = uint32_t( t.GetElapsedMS() );
-
-        MultiBuffer buffer( cacheData, cacheDataSize );
-
-        // do decompression
-        if ( buffer.Decompress() == false )
-        {
-            FLOG_WARN( "Cache returned invalid data\n"
-                       " - File: '%s'\n"
-                       " - Key : %s\n",
-                       m_Name.Get(),
-                       cacheFileName.Get() );
-            cache->FreeMemory( cacheData, cacheDataSize );
-            return false;
-        }
-        const size_t uncompressedDataSize = buffer.GetDataSize();
-        const uint32_t stopDecompress = uint32_t( t.GetElapsedMS() );
+        const uint32_t startExtract = uint32_t( t.GetElapsedMS() );
 
         StackArray<AString> fileNames;
         fileNames.Append( m_Name );
 
         GetExtraCacheFilePaths( job, fileNames );
 
-        // Extract the files
-        const size_t numFiles = fileNames.GetSize();
-        for ( size_t i = 0; i < numFiles; ++i )
+        // Decompress directly into the files, avoiding holding the entire
+        // decompressed result in memory
+        const MultiBuffer buffer( cacheData, cacheDataSize );
+        size_t problemFileIndex = fileNames.GetSize();
+        if ( buffer.DecompressToFiles( fileNames, &problemFileIndex ) == false )
         {
-            if ( !buffer.ExtractFile( i, fileNames[ i ] ) )
+            if ( problemFileIndex < fileNames.GetSize() )
             {
-                FLOG_ERROR( "Failed to write local file during cache retrieval '%s'", fileNames[ i ].Get() );
-                cache->FreeMemory( cacheData, cacheDataSize );
-                return false;
+                FLOG_ERROR( "Failed to write local file during cache retrieval '%s'", fileNames[ problemFileIndex ].Get() );
             }
+            else
+            {
+                FLOG_WARN( "Cache returned invalid data\n"
+                           " - File: '%s'\n"
+                           " - Key : %s\n",
+                           m_Name.Get(),
+                           cacheFileName.Get() );
+            }
+            cache->FreeMemory( cacheData, cacheDataSize );
+            return false;
+        }
+        const size_t uncompressedDataSize = Compressor::GetUncompressedSize( cacheData, cacheDataSize );
+        const uint32_t stopExtract = uint32_t( t.GetElapsedMS() );
 
-            // Update file modification time
-            const bool timeSetOK = FileIO::SetFileLastWriteTimeToNow( fileNames[ i ] );
-
-            // set the time on the local file
-            if ( timeSetOK == false )
+        // Update file modification times
+        for ( const AString & fileName : fileNames )
+        {
+            if ( FileIO::SetFileLastWriteTimeToNow( fileName ) == false )
             {
-                FLOG_ERROR( "Failed to set timestamp after cache hit. Error: %s Target: '%s'", LAST_ERROR_STR, fileNames[ i ].Get() );
+                FLOG_ERROR( "Failed to set timestamp after cache hit. Error: %s Target: '%s'", LAST_ERROR_STR, fileName.Get() );
                 cache->FreeMemory( cacheData, cacheDataSize );
                 return false;
             }
@@ -1506,7 +1534,7 @@ bool ObjectNode::RetrieveFromCache( Job * job )
             output.Format( "Obj: %s <CACHE>\n", GetName().Get() );
             if ( FBuild::Get().GetOptions().m_CacheVerbose )
             {
-                output.AppendFormat( " - Cache Hit: %u ms (Retrieve: %u ms - Decompress: %u ms) (Compressed: %zu - Uncompressed: %zu) '%s'\n", uint32_t( t.GetElapsedMS() ), retrieveTime, stopDecompress - startDecompress, cacheDataSize, uncompressedDataSize, cacheFileName.Get() );
+                output.AppendFormat( " - Cache Hit: %u ms (Retrieve: %u ms - Extract: %u ms) (Compressed: %zu - Uncompressed: %zu) '%s'\n", uint32_t( t.GetElapsedMS() ), retrieveTime, stopExtract - startExtract, cacheDataSize, uncompressedDataSize, cacheFileName.Get() );
             }
             FLOG_OUTPUT( output );
         }
@@ -1589,7 +1617,9 @@ void ObjectNode::WriteToCache_FromUncompressedData( Job * job,
     const Timer t;
     const uint32_t startCompress( (uint32_t)t.GetElapsedMS() );
     Compressor c;
-    const int16_t compressionLevel = FBuild::Get().GetOptions().m_CacheCompressionLevel;
+    // Deduplicated entries are compressed per chunk by the cache, after
+    // splitting (compressed data dedupes poorly)
+    const int16_t compressionLevel = FBuild::Get().GetOptions().m_CacheDedup ? 0 : FBuild::Get().GetOptions().m_CacheCompressionLevel;
     if ( compressionLevel <= 0 )
     {
         // Use LZ4 for low compression levels (level < 0)
@@ -2208,7 +2238,7 @@ bool ObjectNode::WriteTmpFile( Job * job, AString & tmpDirectory, AString & tmpF
     Compressor c; // scoped here so we can access decompression buffer
     if ( job->IsDataCompressed() )
     {
-        if ( c.Decompress( dataToWrite ) == false )
+        if ( c.Decompress( dataToWrite, job->GetCompressionDictionary() ) == false )
         {
             // Decompression failure would indicate a bug
             job->Error( "Decompression failed. Target: '%s'", GetName().Get() );
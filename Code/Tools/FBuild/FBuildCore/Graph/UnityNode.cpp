@@ -15,12 +15,15 @@
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 
 // Core
+#include "Core/Containers/Move.h"
 #include "Core/Containers/UniquePtr.h"
+#include "Core/Containers/UnorderedMap.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/PathUtils.h"
 #include "Core/Math/xxHash.h"
 #include "Core/Process/Process.h"
+#include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
 
 // Reflection
@@ -45,10 +48,13 @@ REFLECT_NODE_BEGIN( UnityNode, Node, MetaNone() )
     REFLECT_ARRAY( m_PreBuildDependencyNames,   "PreBuildDependencies",         MetaOptional() + MetaFile() + MetaAllowNonFile() )
     REFLECT( m_Hidden,                  "Hidden",                               MetaOptional() )
     REFLECT( m_UseRelativePaths_Experimental, "UseRelativePaths_Experimental",  MetaOptional() )
+    REFLECT( m_BalanceByCost,           "UnityBalanceByCost",                   MetaOptional() )
+    REFLECT( m_StablePartitioning,      "UnityStablePartitioning",              MetaOptional() )
 
     // Internal state
     REFLECT_ARRAY( m_UnityFileNames,    "UnityFileNames",                       MetaHidden() + MetaIgnoreForComparison() )
     REFLECT_ARRAY_OF_STRUCT( m_IsolatedFiles, "IsolatedFiles", UnityIsolatedFile, MetaHidden() + MetaIgnoreForComparison() )
+    REFLECT_ARRAY_OF_STRUCT( m_FileCosts, "FileCosts", UnityFileCost, MetaHidden() + MetaIgnoreForComparison() )
 REFLECT_END( UnityNode )
 
 REFLECT_STRUCT_BEGIN( UnityIsolatedFile, Struct, MetaNone() )
@@ -56,6 +62,13 @@ REFLECT_STRUCT_BEGIN( UnityIsolatedFile, Struct, MetaNone() )
     REFLECT( m_DirListOriginPath,       "DirListOriginPath",                    MetaHidden() )
 REFLECT_END( UnityIsolatedFile )
 
+REFLECT_STRUCT_BEGIN( UnityFileCost, Struct, MetaNone() )
+    REFLECT( m_FileName,                "FileName",                             MetaHidden() )
+    REFLECT( m_FileSize,                "FileSize",                             MetaHidden() )
+    REFLECT( m_CostMS,                  "CostMS",                               MetaHidden() )
+    REFLECT( m_UnityIndex,              "UnityIndex",                           MetaHidden() )
+REFLECT_END( UnityFileCost )
+
 // CONSTRUCTOR (UnityIsolatedFile)
 //------------------------------------------------------------------------------
 UnityIsolatedFile::UnityIsolatedFile() = default;
@@ -72,6 +85,29 @@ UnityIsolatedFile::UnityIsolatedFile( const AString & fileName, const DirectoryL
 //------------------------------------------------------------------------------
 UnityIsolatedFile::~UnityIsolatedFile() = default;
 
+// CONSTRUCTOR (UnityFileCost)
+//------------------------------------------------------------------------------
+UnityFileCost::UnityFileCost()
+    : m_FileSize( 0 )
+    , m_CostMS( 0 )
+    , m_UnityIndex( kNotInUnity )
+{
+}
+
+// CONSTRUCTOR (UnityFileCost)
+//------------------------------------------------------------------------------
+UnityFileCost::UnityFileCost( const AString & fileName, uint64_t fileSize, uint32_t costMS, uint32_t unityIndex )
+    : m_FileName( fileName )
+    , m_FileSize( fileSize )
+    , m_CostMS( costMS )
+    , m_UnityIndex( unityIndex )
+{
+}
+
+// DESTRUCTOR (UnityFileCost)
+//------------------------------------------------------------------------------
+UnityFileCost::~UnityFileCost() = default;
+
 // CONSTRUCTOR (UnityFileAndOrigin)
 //------------------------------------------------------------------------------
 UnityNode::UnityFileAndOrigin::UnityFileAndOrigin() = default;
@@ -168,6 +204,8 @@ UnityNode::UnityNode()
     , m_IsolateWritableFiles( false )
     , m_MaxIsolatedFiles( 0 )
     , m_UseRelativePaths_Experimental( false )
+    , m_BalanceByCost( false )
+    , m_StablePartitioning( false )
 {
     m_InputPattern.EmplaceBack( "*.cpp" );
     m_LastBuildTimeMs = 100; // higher default than a file node
@@ -302,8 +340,10 @@ UnityNode::~UnityNode()
         FLOG_OUTPUT( buffer );
     }
 
-    // Clear lists of files as we'll regenerate them
-    m_UnityFileNames.Destruct();
+    // Clear lists of files as we'll regenerate them (keeping the previous
+    // unities, to remove those which are no longer generated)
+    Array<AString> previousUnityFileNames;
+    previousUnityFileNames.Swap( m_UnityFileNames );
     m_IsolatedFiles.Destruct();
 
     // Ensure dest path exists
@@ -316,8 +356,6 @@ UnityNode::~UnityNode()
         return BuildResult::eFailed; // EnsurePathExistsForFile will have emitted error
     }
 
-    m_UnityFileNames.SetCapacity( m_NumUnityFilesToCreate );
-
     // get the files
     Array<UnityFileAndOrigin> files;
     files.SetCapacity( 4096 );
@@ -338,9 +376,39 @@ UnityNode::~UnityNode()
 
     // how many files should go in each unity file?
     const size_t numFiles = files.GetSize();
-    const float numFilesPerUnity = (float)numFiles / (float)m_NumUnityFilesToCreate;
+    size_t numUnities = m_NumUnityFilesToCreate;
+    const float numFilesPerUnity = (float)numFiles / (float)numUnities;
     float remainingInThisUnity( 0.0 );
 
+    // or, which unity should each file go in to balance the compile cost?
+    StackArray<uint32_t> unityIndices;
+    StackArray<float> costs;
+    Array<UnityFileCost> fileCosts;
+    m_PredictedCostsMS.Clear();
+    m_ActualCostsMS.Clear();
+    if ( m_BalanceByCost )
+    {
+        AssignUnitiesByCost( files, unityIndices, costs );
+        fileCosts.SetCapacity( numFiles );
+    }
+
+    // or, which unity should each file go in so adding or removing files
+    // only affects the unities around them? (takes precedence over cost)
+    StackArray<uint32_t> unityIds;
+    if ( m_StablePartitioning )
+    {
+        AssignUnitiesByName( files, unityIndices, unityIds );
+        numUnities = unityIds.GetSize();
+    }
+    const bool useUnityIndices = ( m_BalanceByCost || m_StablePartitioning );
+
+    m_UnityFileNames.SetCapacity( numUnities );
+    Array<AString> generatedUnityFileNames; // including those which are not compiled
+    if ( m_StablePartitioning )
+    {
+        generatedUnityFileNames.SetCapacity( numUnities );
+    }
+
 #if defined( ASSERTS_ENABLED )
     uint32_t numFilesWritten( 0 );
 #endif
@@ -353,7 +421,7 @@ UnityNode::~UnityNode()
     output.SetReserved( 32 * 1024 );
 
     StackArray<uint64_t> stamps;
-    stamps.SetCapacity( m_NumUnityFilesToCreate );
+    stamps.SetCapacity( numUnities );
 
     // Includes will be relative to root
     AStackString includeBasePath;
@@ -364,7 +432,7 @@ UnityNode::~UnityNode()
     }
 
     // create each unity file
-    for ( size_t i = 0; i < m_NumUnityFilesToCreate; ++i )
+    for ( size_t i = 0; i < numUnities; ++i )
     {
         // add allocation to this unity
         remainingInThisUnity += numFilesPerUnity;
@@ -395,8 +463,10 @@ UnityNode::~UnityNode()
         // determine allocation of includes for this unity file
         StackArray<UnityFileAndOrigin> filesInThisUnity;
         uint32_t numIsolated( 0 );
-        const bool lastUnity = ( i == ( m_NumUnityFilesToCreate - 1 ) );
-        while ( ( remainingInThisUnity > 0.0f ) || lastUnity )
+        const bool lastUnity = ( i == ( numUnities - 1 ) );
+        const size_t firstIndexInThisUnity = index;
+        while ( useUnityIndices ? ( ( index < numFiles ) && ( unityIndices[ index ] == i ) )
+                                : ( ( remainingInThisUnity > 0.0f ) || lastUnity ) )
         {
             remainingInThisUnity -= 1.0f; // reduce allocation, but leave rounding
 
@@ -442,6 +512,8 @@ UnityNode::~UnityNode()
 
         // write allocation of includes for this unity file
         size_t numFilesActuallyIsolatedInThisUnity( 0 );
+        float predictedCostOfThisUnity( 0.0f );
+        size_t fileIndex = firstIndexInThisUnity;
         for ( const UnityFileAndOrigin & file : filesInThisUnity )
         {
             // files which are modified can optionally be excluded from the unity
@@ -505,6 +577,19 @@ UnityNode::~UnityNode()
                 output += file.GetName();
             }
             output += "\"\r\n\r\n";
+
+            // Track costs (Unity index is set below for files in the unity)
+            if ( m_BalanceByCost )
+            {
+                const float cost = costs[ fileIndex ];
+                fileCosts.EmplaceBack( file.GetName(), file.GetSize(), (uint32_t)cost, UnityFileCost::kNotInUnity );
+                if ( ( isolateThisFile == false ) && ( noUnity == false ) )
+                {
+                    predictedCostOfThisUnity += cost;
+                    fileCosts.Top().m_UnityIndex = (uint32_t)m_UnityFileNames.GetSize(); // index of this unity, if it's not empty
+                }
+            }
+            ++fileIndex;
         }
         output += "\r\n";
 
@@ -513,9 +598,20 @@ UnityNode::~UnityNode()
         unityName += m_OutputPattern;
         {
             AStackString tmp;
-            tmp.Format( "%u", (uint32_t)i + 1 ); // number from 1
+            if ( m_StablePartitioning )
+            {
+                tmp.Format( "%08x", unityIds[ i ] ); // named by content, so names don't shift
+            }
+            else
+            {
+                tmp.Format( "%u", (uint32_t)i + 1 ); // number from 1
+            }
             unityName.Replace( "*", tmp.Get() );
         }
+        if ( m_StablePartitioning )
+        {
+            generatedUnityFileNames.Append( unityName );
+        }
 
         // only keep track of non-empty unity files (to avoid link errors with empty objects)
         // additionally, if -nounity is in use we also don't want to link these objects
@@ -523,6 +619,10 @@ UnityNode::~UnityNode()
              ( noUnity == false ) )
         {
             m_UnityFileNames.Append( unityName );
+            if ( m_BalanceByCost )
+            {
+                m_PredictedCostsMS.Append( (uint32_t)predictedCostOfThisUnity );
+            }
         }
 
         stamps.Append( xxHash3::Calc64( output.Get(), output.GetLength() ) );
@@ -593,9 +693,35 @@ UnityNode::~UnityNode()
     // Sanity check that all files were written
     ASSERT( numFilesWritten == numFiles );
 
+    // Unities named by content would accumulate as files are added and removed,
+    // so delete those which are no longer generated
+    if ( m_StablePartitioning )
+    {
+        for ( const AString & previousUnityFileName : previousUnityFileNames )
+        {
+            if ( generatedUnityFileNames.Find( previousUnityFileName ) == nullptr )
+            {
+                FileIO::FileDelete( previousUnityFileName.Get() );
+            }
+        }
+    }
+
+    // Keep the costs, to be updated with compile times
+    if ( m_BalanceByCost )
+    {
+        MutexHolder mh( m_CostsMutex );
+        m_FileCosts = Move( fileCosts );
+        m_ActualCostsMS.SetSize( m_PredictedCostsMS.GetSize() );
+        for ( uint32_t & actualCost : m_ActualCostsMS )
+        {
+            actualCost = 0;
+        }
+    }
+
     // Calculate final hash to represent generation of Unity files
-    ASSERT( stamps.GetSize() == m_NumUnityFilesToCreate );
-    m_Stamp = xxHash3::Calc64( &stamps[ 0 ], stamps.GetSize() * sizeof( uint64_t ) );
+    // NOTE: With stable partitioning, there are no unities if there are no files
+    ASSERT( stamps.GetSize() == numUnities );
+    m_Stamp = xxHash3::Calc64( stamps.Begin(), stamps.GetSize() * sizeof( uint64_t ) );
 
     // Track "nounity" status in the lest significant bit
     if ( noUnity )
@@ -628,6 +754,268 @@ UnityNode::~UnityNode()
     const UnityNode * oldUnityNode = oldNode.CastTo<UnityNode>();
     m_IsolatedFiles = oldUnityNode->m_IsolatedFiles;
     m_UnityFileNames = oldUnityNode->m_UnityFileNames;
+    m_FileCosts = oldUnityNode->m_FileCosts;
+}
+
+// RecordCompileTimes
+//  - Called with the ObjectNodes of an ObjectList using this Unity, once they are built
+//------------------------------------------------------------------------------
+void UnityNode::RecordCompileTimes( const Dependencies & objectNodes )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( m_BalanceByCost );
+
+    MutexHolder mh( m_CostsMutex );
+
+    // Files built individually are found by name
+    UnorderedMap<AString, uint32_t> isolatedFiles;
+    bool isolatedFilesMapped = false;
+
+    for ( const Dependency & dep : objectNodes )
+    {
+        // Only objects compiled in this build have a meaningful time
+        const ObjectNode * on = dep.GetNode()->CastTo<ObjectNode>();
+        if ( ( on->GetStatFlag( Node::STATS_BUILT ) == false ) ||
+             on->GetStatFlag( Node::STATS_CACHE_HIT ) ||
+             on->GetStatFlag( Node::STATS_FAILED ) )
+        {
+            continue;
+        }
+        const uint32_t timeMS = Math::Max( on->GetLastBuildTime(), 1u );
+        const AString & sourceFile = on->GetSourceFile()->GetName();
+
+        if ( on->IsUnity() )
+        {
+            const AString * unityFileName = m_UnityFileNames.Find( sourceFile );
+            if ( unityFileName == nullptr )
+            {
+                continue; // Not our Unity
+            }
+            const uint32_t unityIndex = (uint32_t)( unityFileName - m_UnityFileNames.Begin() );
+            if ( unityIndex < m_ActualCostsMS.GetSize() )
+            {
+                m_ActualCostsMS[ unityIndex ] = timeMS;
+            }
+
+            // Share the time between the files in this unity by size
+            uint64_t totalSize = 0;
+            uint32_t numFiles = 0;
+            for ( const UnityFileCost & fileCost : m_FileCosts )
+            {
+                if ( fileCost.m_UnityIndex == unityIndex )
+                {
+                    totalSize += fileCost.m_FileSize;
+                    ++numFiles;
+                }
+            }
+            for ( UnityFileCost & fileCost : m_FileCosts )
+            {
+                if ( fileCost.m_UnityIndex == unityIndex )
+                {
+                    const double share = ( totalSize > 0 ) ? ( (double)fileCost.m_FileSize / (double)totalSize )
+                                                           : ( 1.0 / (double)numFiles );
+                    fileCost.m_CostMS = Math::Max( (uint32_t)( (double)timeMS * share ), 1u );
+                }
+            }
+        }
+        else if ( on->IsIsolatedFromUnity() )
+        {
+            if ( isolatedFilesMapped == false )
+            {
+                for ( size_t i = 0; i < m_FileCosts.GetSize(); ++i )
+                {
+                    if ( m_FileCosts[ i ].m_UnityIndex == UnityFileCost::kNotInUnity )
+                    {
+                        isolatedFiles.Insert( m_FileCosts[ i ].m_FileName, (uint32_t)i );
+                    }
+                }
+                isolatedFilesMapped = true;
+            }
+            const UnorderedMap<AString, uint32_t>::KeyValue * isolatedFile = isolatedFiles.Find( sourceFile );
+            if ( isolatedFile )
+            {
+                m_FileCosts[ isolatedFile->m_Value ].m_CostMS = timeMS;
+            }
+        }
+    }
+}
+
+// GetPredictedCostSpread
+//------------------------------------------------------------------------------
+bool UnityNode::GetPredictedCostSpread( uint32_t & outMinMS, uint32_t & outMaxMS ) const
+{
+    MutexHolder mh( m_CostsMutex );
+    if ( m_PredictedCostsMS.IsEmpty() )
+    {
+        return false;
+    }
+    outMinMS = 0xFFFFFFFF;
+    outMaxMS = 0;
+    for ( const uint32_t cost : m_PredictedCostsMS )
+    {
+        outMinMS = Math::Min( outMinMS, cost );
+        outMaxMS = Math::Max( outMaxMS, cost );
+    }
+    return true;
+}
+
+// GetActualCostSpread
+//------------------------------------------------------------------------------
+bool UnityNode::GetActualCostSpread( uint32_t & outMinMS, uint32_t & outMaxMS ) const
+{
+    MutexHolder mh( m_CostsMutex );
+    outMinMS = 0xFFFFFFFF;
+    outMaxMS = 0;
+    for ( const uint32_t cost : m_ActualCostsMS )
+    {
+        if ( cost != 0 ) // Compiled in this build
+        {
+            outMinMS = Math::Min( outMinMS, cost );
+            outMaxMS = Math::Max( outMaxMS, cost );
+        }
+    }
+    return ( outMaxMS != 0 );
+}
+
+// AssignUnitiesByName
+//  - Similar to content-defined chunking: a unity starts at each file whose
+//    name hashes to an "anchor" value, so adding or removing a file only
+//    changes the unity containing it (or two, if the file is an anchor).
+//  - Each unity is identified by the name of its first file, so unities
+//    which don't change keep their name (and their cache entries).
+//------------------------------------------------------------------------------
+void UnityNode::AssignUnitiesByName( const Array<UnityFileAndOrigin> & files,
+                                     Array<uint32_t> & outUnityIndices,
+                                     Array<uint32_t> & outUnityIds ) const
+{
+    PROFILE_FUNCTION;
+
+    const size_t numFiles = files.GetSize();
+    outUnityIndices.SetSize( numFiles );
+    outUnityIds.Clear();
+
+    // Average files per unity is a power of two, so it doesn't change as
+    // files are added or removed unless the number of files changes a lot
+    const float targetFilesPerUnity = ( (float)numFiles / (float)m_NumUnityFilesToCreate );
+    uint32_t filesPerUnity = 1;
+    while ( ( (float)filesPerUnity * 2.0f ) <= ( targetFilesPerUnity * 1.41421356f ) )
+    {
+        filesPerUnity *= 2;
+    }
+    const uint32_t anchorMask = ( filesPerUnity - 1 );
+    const uint32_t maxFilesPerUnity = ( filesPerUnity * 4 ); // Limit size if anchors are sparse
+
+    UnorderedMap<uint64_t, uint32_t> usedIds;
+    uint32_t filesInThisUnity = 0;
+    for ( size_t i = 0; i < numFiles; ++i )
+    {
+        // Hash the file name only (case insensitive) so the result is the
+        // same on every machine, regardless of where the source is
+        const AString & fileName = files[ i ].GetName();
+        const char * lastSlash = fileName.FindLast( NATIVE_SLASH );
+        AStackString name( lastSlash ? ( lastSlash + 1 ) : fileName.Get() );
+        name.ToLower();
+        const uint64_t hash = xxHash3::Calc64( name );
+        const uint32_t anchor = (uint32_t)( hash >> 32 );
+
+        // Start a new unity?
+        if ( outUnityIds.IsEmpty() ||
+             ( ( anchor & anchorMask ) == 0 ) ||
+             ( filesInThisUnity == maxFilesPerUnity ) )
+        {
+            // Ids must be unique (files in different directories can have
+            // the same name)
+            uint32_t id = (uint32_t)hash;
+            while ( usedIds.Find( id ) )
+            {
+                ++id;
+            }
+            usedIds.Insert( id, (uint32_t)outUnityIds.GetSize() );
+            outUnityIds.Append( id );
+            filesInThisUnity = 0;
+        }
+
+        outUnityIndices[ i ] = (uint32_t)( outUnityIds.GetSize() - 1 );
+        ++filesInThisUnity;
+    }
+}
+
+// AssignUnitiesByCost
+//  - Files are kept in order (so related files stay together) but split
+//    so each Unity has a similar expected compile time.
+//------------------------------------------------------------------------------
+void UnityNode::AssignUnitiesByCost( const Array<UnityFileAndOrigin> & files,
+                                     Array<uint32_t> & outUnityIndices,
+                                     Array<float> & outCosts ) const
+{
+    PROFILE_FUNCTION;
+
+    const size_t numFiles = files.GetSize();
+    outUnityIndices.SetSize( numFiles );
+    outCosts.SetSize( numFiles );
+
+    // Costs from previous builds, scaled by any change in size
+    {
+        UnorderedMap<AString, uint32_t> previousCosts;
+        for ( size_t i = 0; i < m_FileCosts.GetSize(); ++i )
+        {
+            if ( m_FileCosts[ i ].m_CostMS > 0 )
+            {
+                previousCosts.Insert( m_FileCosts[ i ].m_FileName, (uint32_t)i );
+            }
+        }
+
+        double knownCost = 0.0;
+        double knownSize = 0.0;
+        for ( size_t i = 0; i < numFiles; ++i )
+        {
+            const UnorderedMap<AString, uint32_t>::KeyValue * previous = previousCosts.Find( files[ i ].GetName() );
+            if ( previous == nullptr )
+            {
+                outCosts[ i ] = -1.0f; // Unknown
+                continue;
+            }
+            const UnityFileCost & previousCost = m_FileCosts[ previous->m_Value ];
+            const uint64_t size = files[ i ].GetSize();
+            float cost = (float)previousCost.m_CostMS;
+            if ( ( previousCost.m_FileSize > 0 ) && ( size > 0 ) )
+            {
+                cost *= (float)( (double)size / (double)previousCost.m_FileSize );
+            }
+            outCosts[ i ] = cost;
+            knownCost += (double)cost;
+            knownSize += (double)size;
+        }
+
+        // New files are estimated by size, at the average rate of the others
+        const double costPerByte = ( ( knownCost > 0.0 ) && ( knownSize > 0.0 ) ) ? ( knownCost / knownSize ) : 1.0;
+        for ( size_t i = 0; i < numFiles; ++i )
+        {
+            if ( outCosts[ i ] < 0.0f )
+            {
+                outCosts[ i ] = (float)( (double)files[ i ].GetSize() * costPerByte );
+            }
+        }
+    }
+
+    // Split at equal intervals of cumulative cost, placing each file in the
+    // unity containing its mid-point
+    double totalCost = 0.0;
+    for ( const float cost : outCosts )
+    {
+        totalCost += (double)cost;
+    }
+    const bool useCount = ( totalCost <= 0.0 ); // Only empty files
+    const double costPerUnity = ( useCount ? (double)numFiles : totalCost ) / (double)m_NumUnityFilesToCreate;
+    double cumulativeCost = 0.0;
+    for ( size_t i = 0; i < numFiles; ++i )
+    {
+        const double cost = useCount ? 1.0 : (double)outCosts[ i ];
+        const double midPoint = ( cumulativeCost + ( cost * 0.5 ) );
+        outUnityIndices[ i ] = Math::Min( (uint32_t)( midPoint / costPerUnity ), m_NumUnityFilesToCreate - 1 );
+        cumulativeCost += cost;
+    }
 }
 
 // GetFiles
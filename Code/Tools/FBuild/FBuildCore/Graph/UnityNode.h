@@ -10,6 +10,7 @@
 // Core
 #include "Core/Containers/Array.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/Process/Mutex.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
@@ -35,6 +36,25 @@ protected:
     AString m_DirListOriginPath;
 };
 
+// UnityFileCost
+//  - Compile cost of a file, learned from previous builds
+//------------------------------------------------------------------------------
+class UnityFileCost : public Struct
+{
+    REFLECT_STRUCT_DECLARE( UnityFileCost )
+public:
+    UnityFileCost();
+    UnityFileCost( const AString & fileName, uint64_t fileSize, uint32_t costMS, uint32_t unityIndex );
+    ~UnityFileCost();
+
+    inline static const uint32_t kNotInUnity = 0xFFFFFFFF;
+
+    AString m_FileName;
+    uint64_t m_FileSize; // Size when the cost was measured
+    uint32_t m_CostMS; // Measured in a previous build, or estimated
+    uint32_t m_UnityIndex; // Index into Unity file names (or kNotInUnity)
+};
+
 // UnityNode
 //------------------------------------------------------------------------------
 class UnityNode : public Node
@@ -54,6 +74,12 @@ public:
 
     void EnumerateInputFiles( void ( *callback )( const AString & inputFile, const AString & baseDir, void * userData ), void * userData ) const;
 
+    // Compile cost balancing
+    bool IsBalancedByCost() const { return m_BalanceByCost; }
+    void RecordCompileTimes( const Dependencies & objectNodes );
+    bool GetPredictedCostSpread( uint32_t & outMinMS, uint32_t & outMaxMS ) const;
+    bool GetActualCostSpread( uint32_t & outMinMS, uint32_t & outMaxMS ) const;
+
 protected:
     virtual bool DetermineNeedToBuildStatic() const override;
     virtual BuildResult DoBuild( Job * job ) override;
@@ -68,6 +94,7 @@ protected:
         UnityFileAndOrigin( FileIO::FileInfo * info, DirectoryListNode * dirListOrigin );
 
         const AString & GetName() const { return m_Info->m_Name; }
+        uint64_t GetSize() const { return m_Info->m_Size; }
         bool IsReadOnly() const { return m_Info->IsReadOnly(); }
         const DirectoryListNode * GetDirListOrigin() const { return m_DirListOrigin; }
 
@@ -86,6 +113,8 @@ protected:
     bool GetFiles( Array<UnityFileAndOrigin> & files );
     bool GetIsolatedFilesFromList( Array<AString> & files ) const;
     void FilterForceIsolated( Array<UnityFileAndOrigin> & files, Array<UnityIsolatedFile> & isolatedFiles );
+    void AssignUnitiesByCost( const Array<UnityFileAndOrigin> & files, Array<uint32_t> & outUnityIndices, Array<float> & outCosts ) const;
+    void AssignUnitiesByName( const Array<UnityFileAndOrigin> & files, Array<uint32_t> & outUnityIndices, Array<uint32_t> & outUnityIds ) const;
 
     // Exposed properties
     Array<AString> m_InputPaths;
@@ -106,13 +135,19 @@ protected:
     Array<AString> m_ExcludePatterns;
     Array<AString> m_PreBuildDependencyNames;
     bool m_UseRelativePaths_Experimental;
+    bool m_BalanceByCost;
+    bool m_StablePartitioning;
 
     // Temporary data
     Array<FileIO::FileInfo *> m_FilesInfo;
+    mutable Mutex m_CostsMutex; // Compile times are recorded by the ObjectLists using this Unity
+    Array<uint32_t> m_PredictedCostsMS; // Per Unity file, for this build
+    Array<uint32_t> m_ActualCostsMS; // Per Unity file, for this build (0 if not compiled)
 
     // Internal data persisted between builds
     Array<UnityIsolatedFile> m_IsolatedFiles;
     Array<AString> m_UnityFileNames;
+    Array<UnityFileCost> m_FileCosts;
 };
 
 //------------------------------------------------------------------------------
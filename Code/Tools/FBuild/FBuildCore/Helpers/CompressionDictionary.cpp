@@ -0,0 +1,308 @@
+// CompressionDictionary - Shared context for Zstd compression of similar data
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CompressionDictionary.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+
+// External
+#include "zstd.h"
+
+// system
+#include <string.h> // for memcpy, memchr
+
+// Defines
+//------------------------------------------------------------------------------
+namespace
+{
+    // Only the start of each sample is used for training. Common headers are
+    // included first, so this holds most of what samples have in common.
+    const size_t kMaxSampleSize = ( 2 * 1024 * 1024 );
+
+    // Size of trained dictionaries. Dictionary content is only useful within
+    // the Zstd window, which is at least 512 KiB for all levels.
+    const size_t kMaxDictionarySize = ( 256 * 1024 );
+
+    // Segments end after lines whose hash has these bits clear (about 1 in 8 lines)
+    const uint32_t kSegmentBoundaryMask = 0x7;
+    const size_t kMinSegmentSize = 64;
+    const size_t kMaxSegmentSize = ( 8 * 1024 );
+}
+
+// Segment
+//------------------------------------------------------------------------------
+class CompressionDictionaryBuilder::Segment
+{
+public:
+    bool operator<( const Segment & other ) const
+    {
+        // Group identical segments, ordered by sample
+        if ( m_Hash != other.m_Hash )
+        {
+            return ( m_Hash < other.m_Hash );
+        }
+        return ( m_SampleIndex < other.m_SampleIndex );
+    }
+
+    uint64_t m_Hash;
+    const char * m_Data;
+    uint32_t m_Size;
+    uint32_t m_SampleIndex;
+};
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CompressionDictionary::CompressionDictionary( void * data, size_t dataSize )
+    : m_Data( data )
+    , m_DataSize( dataSize )
+    , m_Id( CalcId( data, dataSize ) )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CompressionDictionary::~CompressionDictionary()
+{
+    ZSTD_freeCDict( m_CDict );
+    ZSTD_freeDDict( m_DDict );
+    FREE( m_Data );
+}
+
+// Release
+//------------------------------------------------------------------------------
+void CompressionDictionary::Release()
+{
+    ASSERT( m_RefCount.Load() > 0 );
+    if ( m_RefCount.Decrement() == 0 )
+    {
+        FDELETE this;
+    }
+}
+
+// CalcId
+//------------------------------------------------------------------------------
+/*static*/ uint32_t CompressionDictionary::CalcId( const void * data, size_t dataSize )
+{
+    return xxHash::Calc32( data, dataSize );
+}
+
+// GetCompressionDictionary
+//------------------------------------------------------------------------------
+ZSTD_CDict_s * CompressionDictionary::GetCompressionDictionary( int32_t compressionLevel ) const
+{
+    MutexHolder mh( m_Mutex );
+
+    // The compression level is fixed when the dictionary is prepared
+    if ( m_CDict && ( m_CDictCompressionLevel != compressionLevel ) )
+    {
+        ZSTD_freeCDict( m_CDict );
+        m_CDict = nullptr;
+    }
+    if ( m_CDict == nullptr )
+    {
+        PROFILE_SECTION( "CreateCDict" );
+        m_CDict = ZSTD_createCDict( m_Data, m_DataSize, compressionLevel );
+        m_CDictCompressionLevel = compressionLevel;
+    }
+    return m_CDict;
+}
+
+// GetDecompressionDictionary
+//------------------------------------------------------------------------------
+ZSTD_DDict_s * CompressionDictionary::GetDecompressionDictionary() const
+{
+    MutexHolder mh( m_Mutex );
+    if ( m_DDict == nullptr )
+    {
+        PROFILE_SECTION( "CreateDDict" );
+        m_DDict = ZSTD_createDDict( m_Data, m_DataSize );
+    }
+    return m_DDict;
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CompressionDictionaryBuilder::CompressionDictionaryBuilder( uint32_t numSamples )
+    : m_NumSamples( numSamples )
+{
+    m_Samples.SetCapacity( numSamples );
+    m_SampleSizes.SetCapacity( numSamples );
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CompressionDictionaryBuilder::~CompressionDictionaryBuilder()
+{
+    for ( const char * sample : m_Samples )
+    {
+        FREE( const_cast<char *>( sample ) );
+    }
+    if ( m_Dictionary )
+    {
+        m_Dictionary->Release();
+    }
+}
+
+// AddSample
+//------------------------------------------------------------------------------
+void CompressionDictionaryBuilder::AddSample( const void * data, size_t dataSize )
+{
+    PROFILE_FUNCTION;
+
+    MutexHolder mh( m_Mutex );
+    if ( m_Trained )
+    {
+        return;
+    }
+
+    // Keep the start of the sample
+    const size_t sampleSize = Math::Min( dataSize, kMaxSampleSize );
+    char * sample = static_cast<char *>( ALLOC( Math::Max<size_t>( sampleSize, 1 ) ) );
+    memcpy( sample, data, sampleSize );
+    m_Samples.Append( sample );
+    m_SampleSizes.Append( sampleSize );
+    if ( m_Samples.GetSize() < m_NumSamples )
+    {
+        return;
+    }
+
+    // Train once enough samples are available. If the samples have nothing
+    // in common, there will be no dictionary.
+    m_Dictionary = Train( m_Samples, m_SampleSizes );
+    m_Trained = true;
+
+    for ( const char * s : m_Samples )
+    {
+        FREE( const_cast<char *>( s ) );
+    }
+    m_Samples.Destruct();
+    m_SampleSizes.Destruct();
+}
+
+// GetDictionary
+//------------------------------------------------------------------------------
+CompressionDictionary * CompressionDictionaryBuilder::GetDictionary() const
+{
+    MutexHolder mh( m_Mutex );
+    return m_Dictionary;
+}
+
+// Train
+//------------------------------------------------------------------------------
+/*static*/ CompressionDictionary * CompressionDictionaryBuilder::Train( const Array<const char *> & samples, const Array<size_t> & sampleSizes )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( samples.GetSize() == sampleSizes.GetSize() );
+
+    // Split samples into segments
+    Array<Segment> segments;
+    for ( size_t sampleIndex = 0; sampleIndex < samples.GetSize(); ++sampleIndex )
+    {
+        const char * pos = samples[ sampleIndex ];
+        const char * const end = ( pos + sampleSizes[ sampleIndex ] );
+        const char * segmentStart = pos;
+        while ( pos < end )
+        {
+            // Find end of line
+            const char * lineEnd = static_cast<const char *>( memchr( pos, '\n', static_cast<size_t>( end - pos ) ) );
+            lineEnd = lineEnd ? ( lineEnd + 1 ) : end;
+
+            // End the segment after this line?
+            const size_t segmentSize = static_cast<size_t>( lineEnd - segmentStart );
+            const uint32_t lineHash = xxHash::Calc32( pos, static_cast<size_t>( lineEnd - pos ) );
+            if ( ( ( ( lineHash & kSegmentBoundaryMask ) == 0 ) && ( segmentSize >= kMinSegmentSize ) ) ||
+                 ( segmentSize >= kMaxSegmentSize ) ||
+                 ( lineEnd == end ) )
+            {
+                Segment & segment = segments.EmplaceBack();
+                segment.m_Hash = xxHash::Calc64( segmentStart, segmentSize );
+                segment.m_Data = segmentStart;
+                segment.m_Size = static_cast<uint32_t>( segmentSize );
+                segment.m_SampleIndex = static_cast<uint32_t>( sampleIndex );
+                segmentStart = lineEnd;
+            }
+            pos = lineEnd;
+        }
+    }
+    segments.Sort();
+
+    // Score each distinct segment by the bytes saved if it were in the dictionary
+    class Candidate
+    {
+    public:
+        bool operator<( const Candidate & other ) const { return ( m_Score > other.m_Score ); } // Best first
+
+        const Segment * m_Segment;
+        uint64_t m_Score;
+    };
+    Array<Candidate> candidates;
+    size_t i = 0;
+    while ( i < segments.GetSize() )
+    {
+        const Segment & segment = segments[ i ];
+        uint32_t numSamplesUsingSegment = 0;
+        uint32_t lastSampleIndex = 0;
+        for ( ; ( i < segments.GetSize() ) && ( segments[ i ].m_Hash == segment.m_Hash ); ++i )
+        {
+            if ( ( numSamplesUsingSegment == 0 ) || ( segments[ i ].m_SampleIndex != lastSampleIndex ) )
+            {
+                ++numSamplesUsingSegment;
+                lastSampleIndex = segments[ i ].m_SampleIndex;
+            }
+        }
+
+        // Content in only one sample is unlikely to be common
+        if ( numSamplesUsingSegment > 1 )
+        {
+            Candidate & candidate = candidates.EmplaceBack();
+            candidate.m_Segment = &segment;
+            candidate.m_Score = ( static_cast<uint64_t>( numSamplesUsingSegment ) * segment.m_Size );
+        }
+    }
+    if ( candidates.IsEmpty() )
+    {
+        return nullptr;
+    }
+    candidates.Sort();
+
+    // Select the best segments which fit
+    size_t dictionarySize = 0;
+    size_t numSelected = 0;
+    for ( const Candidate & candidate : candidates )
+    {
+        if ( ( dictionarySize + candidate.m_Segment->m_Size ) > kMaxDictionarySize )
+        {
+            break; // full
+        }
+        dictionarySize += candidate.m_Segment->m_Size;
+        ++numSelected;
+    }
+    if ( dictionarySize == 0 )
+    {
+        return nullptr;
+    }
+
+    // Place the most valuable segments last, as the end of the dictionary is
+    // closest to the data (so cheapest to reference)
+    char * dictionary = static_cast<char *>( ALLOC( dictionarySize ) );
+    char * dst = dictionary;
+    for ( size_t j = numSelected; j > 0; --j )
+    {
+        const Segment * segment = candidates[ j - 1 ].m_Segment;
+        memcpy( dst, segment->m_Data, segment->m_Size );
+        dst += segment->m_Size;
+    }
+    ASSERT( dst == ( dictionary + dictionarySize ) );
+
+    return FNEW( CompressionDictionary( dictionary, dictionarySize ) );
+}
+
+//------------------------------------------------------------------------------
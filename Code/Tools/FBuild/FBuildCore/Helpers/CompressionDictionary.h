@@ -0,0 +1,91 @@
+// CompressionDictionary - Shared context for Zstd compression of similar data
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Mutex.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+struct ZSTD_CDict_s;
+struct ZSTD_DDict_s;
+
+// CompressionDictionary
+//  - Raw content which compressed data can reference, so content common to
+//    many buffers (such as headers in preprocessed translation units) doesn't
+//    need to be sent with each one.
+//  - Identified by a hash of the content, so data compressed against one
+//    dictionary is never decompressed with another.
+//  - Shared by jobs and connections, so lifetime is reference counted.
+//------------------------------------------------------------------------------
+class CompressionDictionary
+{
+public:
+    // Takes ownership of data
+    explicit CompressionDictionary( void * data, size_t dataSize );
+
+    void AddRef() { m_RefCount.Increment(); }
+    void Release();
+
+    uint32_t GetId() const { return m_Id; }
+    const void * GetData() const { return m_Data; }
+    size_t GetDataSize() const { return m_DataSize; }
+
+    static uint32_t CalcId( const void * data, size_t dataSize );
+
+    // Prepared forms, created on first use
+    ZSTD_CDict_s * GetCompressionDictionary( int32_t compressionLevel ) const;
+    ZSTD_DDict_s * GetDecompressionDictionary() const;
+
+private:
+    ~CompressionDictionary();
+
+    void * m_Data;
+    size_t m_DataSize;
+    uint32_t m_Id;
+    Atomic<uint32_t> m_RefCount{ 1 };
+
+    mutable Mutex m_Mutex; // Protects creation of prepared dictionaries
+    mutable ZSTD_CDict_s * m_CDict = nullptr;
+    mutable int32_t m_CDictCompressionLevel = 0;
+    mutable ZSTD_DDict_s * m_DDict = nullptr;
+};
+
+// CompressionDictionaryBuilder
+//  - Trains a dictionary from the first few buffers to be compressed, by
+//    selecting the content which they have in common.
+//  - Buffers are split at line boundaries chosen by the content of each line,
+//    so common text aligns regardless of what precedes it.
+//------------------------------------------------------------------------------
+class CompressionDictionaryBuilder
+{
+public:
+    explicit CompressionDictionaryBuilder( uint32_t numSamples );
+    ~CompressionDictionaryBuilder();
+
+    // Offer data to train on (ignored once trained)
+    void AddSample( const void * data, size_t dataSize );
+
+    // Trained dictionary, or null if not (yet) available
+    CompressionDictionary * GetDictionary() const;
+
+    // Train directly from samples
+    static CompressionDictionary * Train( const Array<const char *> & samples, const Array<size_t> & sampleSizes );
+
+private:
+    class Segment;
+
+    mutable Mutex m_Mutex;
+    uint32_t m_NumSamples;
+    bool m_Trained = false;
+    Array<const char *> m_Samples;
+    Array<size_t> m_SampleSizes;
+    CompressionDictionary * m_Dictionary = nullptr;
+};
+
+//------------------------------------------------------------------------------
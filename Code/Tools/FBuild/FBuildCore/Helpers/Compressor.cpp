@@ -7,11 +7,13 @@
 
 // FBuildCore
 #include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompressionDictionary.h"
 
 // Core
 #include "Core/Containers/UniquePtr.h"
 #include "Core/Env/Assert.h"
 #include "Core/Env/Types.h"
+#include "Core/FileIO/IOStream.h"
 #include "Core/Math/Conversions.h"
 #include "Core/Mem/Mem.h"
 #include "Core/Profile/Profile.h"
@@ -43,7 +45,7 @@ Compressor::~Compressor()
 {
     ASSERT( data );
     const Header * header = (const Header *)data;
-    if ( header->m_CompressionType > eZstd )
+    if ( header->m_CompressionType > eZstdDictionary )
     {
         return false;
     }
@@ -135,7 +137,7 @@ bool Compressor::Compress( const void * data, size_t dataSize, int32_t compressi
 
 // Decompress
 //------------------------------------------------------------------------------
-bool Compressor::Decompress( const void * data )
+bool Compressor::Decompress( const void * data, const CompressionDictionary * dictionary )
 {
     PROFILE_FUNCTION;
 
@@ -173,10 +175,8 @@ bool Compressor::Decompress( const void * data )
             return true;
         }
     }
-    else
+    else if ( header->m_CompressionType == eZstd )
     {
-        ASSERT( header->m_CompressionType == eZstd );
-
         // decompress
         const size_t bytesDecompressed = ZSTD_decompress( m_Result,
                                                           uncompressedSize,
@@ -187,6 +187,33 @@ bool Compressor::Decompress( const void * data )
             return true;
         }
     }
+    else
+    {
+        ASSERT( header->m_CompressionType == eZstdDictionary );
+
+        // Dictionary must be the one used to compress
+        uint32_t dictionaryId = 0;
+        if ( dictionary && ( header->m_CompressedSize >= sizeof( dictionaryId ) ) )
+        {
+            memcpy( &dictionaryId, compressedData, sizeof( dictionaryId ) );
+        }
+        ZSTD_DCtx * context = ( dictionary && ( dictionaryId == dictionary->GetId() ) ) ? ZSTD_createDCtx() : nullptr;
+        if ( context )
+        {
+            // decompress
+            const size_t bytesDecompressed = ZSTD_decompress_usingDDict( context,
+                                                                         m_Result,
+                                                                         uncompressedSize,
+                                                                         compressedData + sizeof( dictionaryId ),
+                                                                         header->m_CompressedSize - sizeof( dictionaryId ),
+                                                                         dictionary->GetDecompressionDictionary() );
+            ZSTD_freeDCtx( context );
+            if ( bytesDecompressed == uncompressedSize )
+            {
+                return true;
+            }
+        }
+    }
 
     // Data is corrupt
     FREE( m_Result );
@@ -195,6 +222,79 @@ bool Compressor::Decompress( const void * data )
     return false;
 }
 
+// DecompressToStream
+//------------------------------------------------------------------------------
+/*static*/ bool Compressor::DecompressToStream( const void * data, IOStream & output )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( data );
+
+    const Header * header = (const Header *)data;
+    const char * compressedData = ( (const char *)data + sizeof( Header ) );
+    const uint32_t uncompressedSize = header->m_UncompressedSize;
+
+    // handle uncompressed case - write directly from the source
+    if ( header->m_CompressionType == eUncompressed )
+    {
+        return ( output.WriteBuffer( compressedData, uncompressedSize ) == uncompressedSize );
+    }
+
+    if ( header->m_CompressionType == eLZ4 )
+    {
+        // LZ4 blocks can't be partially decoded, so use the regular path
+        Compressor c;
+        if ( c.Decompress( data ) == false )
+        {
+            return false;
+        }
+        return ( output.WriteBuffer( c.GetResult(), c.GetResultSize() ) == c.GetResultSize() );
+    }
+
+    if ( header->m_CompressionType == eZstdDictionary )
+    {
+        return false; // Dictionary is not available
+    }
+
+    ASSERT( header->m_CompressionType == eZstd );
+
+    // Decompress through a fixed size buffer. Zstd additionally only needs to
+    // keep the frame's window (a few MiB at most) to resolve back references.
+    ZSTD_DCtx * context = ZSTD_createDCtx();
+    if ( context == nullptr )
+    {
+        return false;
+    }
+    const size_t outputBufferSize = Math::Min<size_t>( kStreamBufferSize, uncompressedSize );
+    UniquePtr<char, FreeDeletor> outputBuffer( (char *)ALLOC( Math::Max<size_t>( outputBufferSize, 1 ) ) );
+
+    ZSTD_inBuffer in = { compressedData, header->m_CompressedSize, 0 };
+    uint64_t totalWritten = 0;
+    bool ok = true;
+    size_t remaining = 1; // Non-zero until the frame is complete
+    while ( ok && ( remaining != 0 ) )
+    {
+        ZSTD_outBuffer out = { outputBuffer.Get(), outputBufferSize, 0 };
+        const size_t inPos = in.pos;
+        remaining = ZSTD_decompressStream( context, &out, &in );
+        if ( ZSTD_isError( remaining ) ||
+             ( totalWritten + out.pos > uncompressedSize ) ||
+             ( ( remaining != 0 ) && ( out.pos == 0 ) && ( in.pos == inPos ) ) ) // no progress (truncated data)
+        {
+            ok = false;
+            break;
+        }
+        if ( out.pos > 0 )
+        {
+            ok = ( output.WriteBuffer( out.dst, out.pos ) == out.pos );
+            totalWritten += out.pos;
+        }
+    }
+    ZSTD_freeDCtx( context );
+
+    return ( ok && ( in.pos == in.size ) && ( totalWritten == uncompressedSize ) );
+}
+
 // CompressZstd
 //------------------------------------------------------------------------------
 bool Compressor::CompressZstd( const void * data,
@@ -254,4 +354,70 @@ bool Compressor::CompressZstd( const void * data,
     return compressed;
 }
 
+// CompressZstd
+//------------------------------------------------------------------------------
+bool Compressor::CompressZstd( const void * data,
+                               size_t dataSize,
+                               int32_t compressionLevel,
+                               const CompressionDictionary & dictionary )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( data );
+    ASSERT( m_Result == nullptr );
+    ASSERT( compressionLevel > 0 );
+
+    // allocate worst case output size for Zstd
+    const size_t worstCaseSize = ZSTD_compressBound( dataSize );
+    UniquePtr<char, FreeDeletor> output( (char *)ALLOC( worstCaseSize ) );
+
+    // The dictionary id is stored before the compressed data
+    const uint32_t dictionaryId = dictionary.GetId();
+
+    // do compression
+    size_t compressedSize = worstCaseSize; // Act as if compression achieved nothing on failure
+    ZSTD_CCtx * context = ZSTD_createCCtx();
+    if ( context )
+    {
+        const size_t result = ZSTD_compress_usingCDict( context,
+                                                        output.Get(),
+                                                        worstCaseSize,
+                                                        data,
+                                                        dataSize,
+                                                        dictionary.GetCompressionDictionary( compressionLevel ) );
+        if ( ZSTD_isError( result ) == false )
+        {
+            compressedSize = ( result + sizeof( dictionaryId ) );
+        }
+        ZSTD_freeCCtx( context );
+    }
+
+    // did the compression yield any benefit?
+    const bool compressed = ( compressedSize < dataSize );
+
+    if ( compressed )
+    {
+        // trim memory usage to compressed size
+        m_Result = ALLOC( compressedSize + sizeof( Header ) );
+        memcpy( (char *)m_Result + sizeof( Header ), &dictionaryId, sizeof( dictionaryId ) );
+        memcpy( (char *)m_Result + sizeof( Header ) + sizeof( dictionaryId ), output.Get(), compressedSize - sizeof( dictionaryId ) );
+        m_ResultSize = compressedSize + sizeof( Header );
+    }
+    else
+    {
+        // compression failed, so just copy the old data
+        m_Result = ALLOC( dataSize + sizeof( Header ) );
+        memcpy( (char *)m_Result + sizeof( Header ), data, dataSize );
+        m_ResultSize = dataSize + sizeof( Header );
+    }
+
+    // fill out header
+    Header * header = (Header *)m_Result;
+    header->m_CompressionType = compressed ? eZstdDictionary : eUncompressed;   // compression type
+    header->m_UncompressedSize = (uint32_t)dataSize;    // input size
+    header->m_CompressedSize = compressed ? (uint32_t)compressedSize : (uint32_t)dataSize; // output size
+
+    return compressed;
+}
+
 //------------------------------------------------------------------------------
@@ -6,6 +6,11 @@
 //------------------------------------------------------------------------------
 #include "Core/Env/Types.h"
 
+// Forward Declarations
+//------------------------------------------------------------------------------
+class CompressionDictionary;
+class IOStream;
+
 // Compressor
 //------------------------------------------------------------------------------
 class Compressor
@@ -26,8 +31,17 @@ public:
     // Zstd
     bool CompressZstd( const void * data, size_t dataSize, int32_t compressionLevel = -1 ); // -1 = default Zstd compression level
 
+    // Zstd, referencing content in a dictionary (which must also be used to decompress)
+    bool CompressZstd( const void * data, size_t dataSize, int32_t compressionLevel, const CompressionDictionary & dictionary );
+
     // Decompress (handled all formats including uncompressed)
-    bool Decompress( const void * data );
+    // - data compressed with a dictionary fails to decompress without the same dictionary
+    bool Decompress( const void * data, const CompressionDictionary * dictionary = nullptr );
+
+    // Decompress directly into a stream, without holding the entire result in
+    // memory when the format allows (uncompressed and Zstd). LZ4 data is a single
+    // block, so it must still be decompressed in one go.
+    static bool DecompressToStream( const void * data, IOStream & output );
 
     const void * GetResult() const { return m_Result; }
     size_t GetResultSize() const { return m_ResultSize; }
@@ -41,11 +55,14 @@ public:
     }
 
 private:
+    inline static const size_t kStreamBufferSize = ( 1024 * 1024 );
+
     enum CompressionType : uint32_t
     {
         eUncompressed = 0,
         eLZ4 = 1,
         eZstd = 2,
+        eZstdDictionary = 3, // Followed by uint32_t dictionary id, then Zstd data
     };
     struct Header
     {
@@ -53,6 +70,7 @@ private:
         uint32_t m_UncompressedSize;
         uint32_t m_CompressedSize;
     };
+
     void * m_Result;
     size_t m_ResultSize;
 };
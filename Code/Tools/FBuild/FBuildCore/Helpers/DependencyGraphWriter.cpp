@@ -0,0 +1,183 @@
+// DependencyGraphWriter - Write the serialized dependency graph DB to disk
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "DependencyGraphWriter.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/FLog.h"
+
+// Core
+#include "Core/Env/ErrorFormat.h"
+#include "Core/FileIO/ChainedMemoryStream.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+DependencyGraphWriter::DependencyGraphWriter() = default;
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+DependencyGraphWriter::~DependencyGraphWriter()
+{
+    WaitForCompletion();
+}
+
+// Write
+//------------------------------------------------------------------------------
+bool DependencyGraphWriter::Write( ChainedMemoryStream * data,
+                                   Mode mode,
+                                   const AString & fileName,
+                                   uint64_t offset,
+                                   const AString & fileToDelete,
+                                   bool async )
+{
+    ASSERT( data );
+
+    // Only one write can be in flight
+    WaitForCompletion();
+
+    m_Data = data;
+    m_Mode = mode;
+    m_FileName = fileName;
+    m_Offset = offset;
+    m_FileToDelete = fileToDelete;
+
+    if ( async )
+    {
+        AtomicStoreRelaxed( &m_Writing, true );
+        m_Thread.Start( ThreadFunc, "DBWriter", this );
+        return true;
+    }
+
+    return DoWrite();
+}
+
+// WaitForCompletion
+//------------------------------------------------------------------------------
+bool DependencyGraphWriter::WaitForCompletion()
+{
+    if ( m_Thread.IsRunning() )
+    {
+        PROFILE_SECTION( "WaitForDBWrite" );
+        m_Thread.Join();
+    }
+    const bool result = m_Result;
+    m_Result = true; // Failure is only reported once
+    return result;
+}
+
+// IsWriting
+//------------------------------------------------------------------------------
+bool DependencyGraphWriter::IsWriting() const
+{
+    return AtomicLoadAcquire( &m_Writing );
+}
+
+// ThreadFunc
+//------------------------------------------------------------------------------
+/*static*/ uint32_t DependencyGraphWriter::ThreadFunc( void * userData )
+{
+    PROFILE_SET_THREAD_NAME( "DBWriter" );
+
+    DependencyGraphWriter * writer = static_cast<DependencyGraphWriter *>( userData );
+    writer->DoWrite();
+    AtomicStoreRelease( &writer->m_Writing, false );
+    return 0;
+}
+
+// DoWrite
+//------------------------------------------------------------------------------
+bool DependencyGraphWriter::DoWrite()
+{
+    PROFILE_FUNCTION;
+
+    m_Result = ( m_Mode == Mode::REPLACE ) ? DoWriteReplace() : DoWriteAppend();
+
+    if ( m_Result && ( m_FileToDelete.IsEmpty() == false ) && FileIO::FileExists( m_FileToDelete.Get() ) )
+    {
+        FileIO::FileDelete( m_FileToDelete.Get() );
+    }
+
+    FDELETE m_Data;
+    m_Data = nullptr;
+    return m_Result;
+}
+
+// DoWriteReplace
+//------------------------------------------------------------------------------
+bool DependencyGraphWriter::DoWriteReplace() const
+{
+    // Write to a temp file and then replace the DB, so the DB is never
+    // partially written if the process is killed
+    AStackString tmpFileName( m_FileName );
+    tmpFileName += ".tmp";
+    {
+        FileStream fileStream;
+        if ( fileStream.Open( tmpFileName.Get(), FileStream::WRITE_ONLY ) == false )
+        {
+            // failing to open the dep graph for saving is a serious problem
+            FLOG_ERROR( "Failed to open DepGraph for saving '%s'", tmpFileName.Get() );
+            return false;
+        }
+
+        // write in-memory serialized data to disk
+        for ( uint32_t i = 0; i < m_Data->GetNumPages(); ++i )
+        {
+            uint32_t dataSize = 0;
+            const char * const data = m_Data->GetPage( i, dataSize );
+            if ( fileStream.Write( data, dataSize ) != dataSize )
+            {
+                FLOG_ERROR( "Saving DepGraph FAILED!" );
+                return false;
+            }
+        }
+    }
+
+    if ( FileIO::FileMove( tmpFileName, m_FileName ) == false )
+    {
+        FLOG_ERROR( "Failed to replace DepGraph '%s'. Error: %s", m_FileName.Get(), LAST_ERROR_STR );
+        FileIO::FileDelete( tmpFileName.Get() );
+        return false;
+    }
+    return true;
+}
+
+// DoWriteAppend
+//------------------------------------------------------------------------------
+bool DependencyGraphWriter::DoWriteAppend() const
+{
+    FileStream fileStream;
+    if ( fileStream.Open( m_FileName.Get(), FileStream::OPEN_OR_CREATE_READ_WRITE ) == false )
+    {
+        FLOG_WARN( "Failed to open DepGraph journal for saving '%s'", m_FileName.Get() );
+        return false;
+    }
+
+    // Overwrite anything beyond the offset (i.e. partially written data)
+    if ( fileStream.Seek( m_Offset ) == false )
+    {
+        FLOG_WARN( "Failed to seek in DepGraph journal '%s'", m_FileName.Get() );
+        return false;
+    }
+    for ( uint32_t i = 0; i < m_Data->GetNumPages(); ++i )
+    {
+        uint32_t dataSize = 0;
+        const char * const data = m_Data->GetPage( i, dataSize );
+        if ( fileStream.Write( data, dataSize ) != dataSize )
+        {
+            FLOG_WARN( "Saving DepGraph journal FAILED!" );
+            return false;
+        }
+    }
+    fileStream.Truncate();
+    return true;
+}
+
+//------------------------------------------------------------------------------
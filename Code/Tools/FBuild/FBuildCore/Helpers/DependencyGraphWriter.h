@@ -0,0 +1,64 @@
+// DependencyGraphWriter - Write the serialized dependency graph DB to disk
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Env/Types.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class ChainedMemoryStream;
+
+// DependencyGraphWriter
+//  - Writes are crash safe: the DB is replaced via a temp file, and journal
+//    entries which are partially written are discarded when loading
+//  - Writes can optionally occur on a background thread (-dbasync)
+//------------------------------------------------------------------------------
+class DependencyGraphWriter
+{
+public:
+    enum class Mode : uint8_t
+    {
+        REPLACE, // Replace entire file
+        APPEND, // Write at the given offset, discarding anything beyond it
+    };
+
+    DependencyGraphWriter();
+    ~DependencyGraphWriter();
+
+    // Takes ownership of data. For async writes, returns true if the write
+    // was started and the result is available from WaitForCompletion.
+    bool Write( ChainedMemoryStream * data,
+                Mode mode,
+                const AString & fileName,
+                uint64_t offset,
+                const AString & fileToDelete,
+                bool async );
+
+    // Wait for any background write. Returns false if it failed.
+    bool WaitForCompletion();
+    bool IsWriting() const;
+
+private:
+    static uint32_t ThreadFunc( void * userData );
+    bool DoWrite();
+    bool DoWriteReplace() const;
+    bool DoWriteAppend() const;
+
+    Thread m_Thread;
+    volatile bool m_Writing = false;
+    bool m_Result = true;
+
+    // Current write
+    ChainedMemoryStream * m_Data = nullptr;
+    Mode m_Mode = Mode::REPLACE;
+    AString m_FileName;
+    uint64_t m_Offset = 0;
+    AString m_FileToDelete; // Deleted after the write (i.e. journal merged into the DB)
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,442 @@
+// DirectorySnapshotCache - Directory contents shared by all directory walks
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "DirectorySnapshotCache.h"
+
+// Core
+#include "Core/Containers/Move.h"
+#include "Core/Env/Assert.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Process/ThreadPool.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+
+// DirectorySnapshotReader
+//  - Reads the entries of a single directory into a snapshot
+//------------------------------------------------------------------------------
+class DirectorySnapshotReader : public GetFilesHelper
+{
+public:
+    explicit DirectorySnapshotReader( DirectorySnapshot & snapshot )
+        : GetFilesHelper( 0 )
+        , m_Snapshot( snapshot )
+    {
+        m_Recurse = false;
+    }
+
+    virtual bool OnDirectory( const AString & dirPath ) override
+    {
+        m_Snapshot.m_SubDirs.EmplaceBack( dirPath );
+        return false; // Each directory has its own snapshot
+    }
+
+    virtual bool ShouldIncludeFile( const char * fileName ) override
+    {
+#if defined( __WINDOWS__ )
+        // Attributes are part of the directory listing
+        (void)fileName;
+        return true;
+#else
+        // Attributes require a stat, so are retrieved on first use
+        m_Snapshot.m_FileNames.EmplaceBack( fileName );
+        FileIO::FileInfo & info = m_Snapshot.m_Files.EmplaceBack();
+        info.m_Name = m_Snapshot.m_Path;
+        info.m_Name += fileName;
+        m_Snapshot.m_HasFileInfo.Append( false );
+        return false;
+#endif
+    }
+
+    virtual void OnFile( FileIO::FileInfo && fileInfo ) override
+    {
+        ASSERT( fileInfo.m_Name.BeginsWith( m_Snapshot.m_Path ) );
+        m_Snapshot.m_FileNames.EmplaceBack( fileInfo.m_Name.Get() + m_Snapshot.m_Path.GetLength() );
+        m_Snapshot.m_Files.EmplaceBack( Move( fileInfo ) );
+        m_Snapshot.m_HasFileInfo.Append( true );
+    }
+
+    DirectorySnapshotReader & operator=( const DirectorySnapshotReader & ) = delete;
+
+private:
+    DirectorySnapshot & m_Snapshot;
+};
+
+// CONSTRUCTOR (DirectorySnapshot)
+//------------------------------------------------------------------------------
+DirectorySnapshot::DirectorySnapshot( const AString & path, bool exists, uint64_t lastWriteTime )
+    : m_Path( path )
+    , m_Exists( exists )
+    , m_LastWriteTime( lastWriteTime )
+{
+}
+
+// DESTRUCTOR (DirectorySnapshot)
+//------------------------------------------------------------------------------
+DirectorySnapshot::~DirectorySnapshot() = default;
+
+// DirectorySnapshotCache::GetSnapshotsContext
+//------------------------------------------------------------------------------
+class DirectorySnapshotCache::GetSnapshotsContext
+{
+public:
+    static void GetRange( uint32_t begin, uint32_t end, void * userData );
+
+    DirectorySnapshotCache * m_Cache = nullptr;
+    const Array<AString> * m_Paths = nullptr;
+    Array<DirectorySnapshot *> * m_Snapshots = nullptr;
+};
+
+// DirectorySnapshotCache::GetSnapshotsContext::GetRange
+//------------------------------------------------------------------------------
+/*static*/ void DirectorySnapshotCache::GetSnapshotsContext::GetRange( uint32_t begin, uint32_t end, void * userData )
+{
+    GetSnapshotsContext & context = *static_cast<GetSnapshotsContext *>( userData );
+    for ( uint32_t i = begin; i < end; ++i )
+    {
+        ( *context.m_Snapshots )[ i ] = context.m_Cache->GetSnapshot( ( *context.m_Paths )[ i ] );
+    }
+}
+
+// DirectorySnapshotCache::GetFileInfosContext
+//  - Attributes of files in the same directory are retrieved in batches
+//------------------------------------------------------------------------------
+class DirectorySnapshotCache::GetFileInfosContext
+{
+public:
+    static void GetRange( uint32_t begin, uint32_t end, void * userData );
+
+    class Batch
+    {
+    public:
+        const DirectorySnapshot * m_Snapshot;
+        uint32_t m_Begin; // Range in m_FileIndices
+        uint32_t m_End;
+    };
+
+    static const uint32_t kMaxBatchSize = 64;
+
+    Array<uint32_t> m_FileIndices; // Index in snapshot of each file needing attributes
+    Array<FileIO::FileInfo> m_FileInfos;
+    Array<bool> m_Found; // False if deleted since the directory was read
+    Array<Batch> m_Batches;
+};
+
+// DirectorySnapshotCache::GetFileInfosContext::GetRange
+//------------------------------------------------------------------------------
+/*static*/ void DirectorySnapshotCache::GetFileInfosContext::GetRange( uint32_t begin, uint32_t end, void * userData )
+{
+    GetFileInfosContext & context = *static_cast<GetFileInfosContext *>( userData );
+    for ( uint32_t i = begin; i < end; ++i )
+    {
+        const Batch & batch = context.m_Batches[ i ];
+
+        // Names don't change once the snapshot is read, so no lock is needed
+        const char * fileNames[ kMaxBatchSize ];
+        const uint32_t count = ( batch.m_End - batch.m_Begin );
+        for ( uint32_t j = 0; j < count; ++j )
+        {
+            fileNames[ j ] = batch.m_Snapshot->m_FileNames[ context.m_FileIndices[ batch.m_Begin + j ] ].Get();
+        }
+        FileIO::GetFileInfos( batch.m_Snapshot->m_Path,
+                              fileNames,
+                              count,
+                              &context.m_FileInfos[ batch.m_Begin ],
+                              &context.m_Found[ batch.m_Begin ] );
+    }
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+DirectorySnapshotCache::DirectorySnapshotCache( uint32_t numThreads )
+    : m_NumThreads( numThreads )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+DirectorySnapshotCache::~DirectorySnapshotCache()
+{
+    Clear();
+    FDELETE m_ThreadPool;
+}
+
+// GetFiles
+//------------------------------------------------------------------------------
+void DirectorySnapshotCache::GetFiles( const AString & path, GetFilesHelper & helper )
+{
+    PROFILE_FUNCTION;
+
+    Array<AString> dirs;
+    PathUtils::EnsureTrailingSlash( dirs.EmplaceBack( path ) );
+
+    Array<AString> subDirs;
+    Array<DirectorySnapshot *> snapshots;
+    while ( dirs.IsEmpty() == false )
+    {
+        GetSnapshots( dirs, snapshots );
+
+        // Files (the same filtering as FileIO::GetFiles, but in memory)
+        GetMatchingFiles( snapshots, helper );
+
+        // Sub-directories (which don't change once the snapshot is read)
+        subDirs.Clear();
+        for ( const DirectorySnapshot * snapshot : snapshots )
+        {
+            for ( const AString & subDir : snapshot->m_SubDirs )
+            {
+                if ( helper.OnDirectory( subDir ) )
+                {
+                    subDirs.Append( subDir );
+                }
+            }
+        }
+        dirs.Swap( subDirs );
+    }
+}
+
+// Clear
+//------------------------------------------------------------------------------
+void DirectorySnapshotCache::Clear()
+{
+    MutexHolder mh( m_Mutex );
+    m_SnapshotMap.Destruct();
+    for ( DirectorySnapshot * snapshot : m_Snapshots )
+    {
+        FDELETE snapshot;
+    }
+    m_Snapshots.Clear();
+}
+
+// OnFileWritten
+//------------------------------------------------------------------------------
+void DirectorySnapshotCache::OnFileWritten( const AString & fileName )
+{
+    const char * const lastSlash = fileName.FindLast( NATIVE_SLASH );
+    if ( lastSlash == nullptr )
+    {
+        return;
+    }
+    AStackString dirPath;
+    dirPath.Assign( fileName.Get(), lastSlash + 1 );
+
+    // The snapshot is kept, as other walks may be using it
+    MutexHolder mh( m_Mutex );
+    UnorderedMap<AString, DirectorySnapshot *>::KeyValue * existing = m_SnapshotMap.Find( dirPath );
+    if ( existing )
+    {
+        existing->m_Value = nullptr;
+    }
+}
+
+// GetSnapshots
+//------------------------------------------------------------------------------
+void DirectorySnapshotCache::GetSnapshots( const Array<AString> & paths, Array<DirectorySnapshot *> & outSnapshots )
+{
+    const uint32_t numPaths = static_cast<uint32_t>( paths.GetSize() );
+    outSnapshots.SetSize( numPaths );
+
+    GetSnapshotsContext context;
+    context.m_Cache = this;
+    context.m_Paths = &paths;
+    context.m_Snapshots = &outSnapshots;
+
+    // One directory per batch, as each read can be slow on network drives
+    ThreadPool * threadPool = ( numPaths > 1 ) ? GetThreadPool() : nullptr;
+    if ( threadPool )
+    {
+        threadPool->ParallelFor( numPaths, 1, GetSnapshotsContext::GetRange, &context );
+    }
+    else
+    {
+        GetSnapshotsContext::GetRange( 0, numPaths, &context );
+    }
+}
+
+// GetMatchingFiles
+//------------------------------------------------------------------------------
+void DirectorySnapshotCache::GetMatchingFiles( const Array<DirectorySnapshot *> & snapshots, GetFilesHelper & helper )
+{
+    // Find files to include, noting those which need attributes
+    Array<uint32_t> matches; // Index in snapshot
+    Array<uint32_t> matchesEnd; // Per snapshot
+    Array<uint32_t> fileInfosEnd; // Per snapshot
+    GetFileInfosContext context;
+    for ( DirectorySnapshot * snapshot : snapshots )
+    {
+        MutexHolder mh( snapshot->m_Mutex ); // Attributes may be being stored
+        const uint32_t numFiles = static_cast<uint32_t>( snapshot->m_Files.GetSize() );
+        for ( uint32_t i = 0; i < numFiles; ++i )
+        {
+            if ( helper.ShouldIncludeFile( snapshot->m_FileNames[ i ].Get() ) == false )
+            {
+                continue;
+            }
+            matches.Append( i );
+
+            if ( snapshot->m_HasFileInfo[ i ] )
+            {
+                m_NumFileInfosReused.Increment();
+                continue;
+            }
+
+            // Start a new batch if needed
+            const uint32_t fileIndex = static_cast<uint32_t>( context.m_FileIndices.GetSize() );
+            if ( context.m_Batches.IsEmpty() ||
+                 ( context.m_Batches.Top().m_Snapshot != snapshot ) ||
+                 ( ( fileIndex - context.m_Batches.Top().m_Begin ) == GetFileInfosContext::kMaxBatchSize ) )
+            {
+                context.m_Batches.Append( GetFileInfosContext::Batch{ snapshot, fileIndex, fileIndex } );
+            }
+            context.m_FileIndices.Append( i );
+            ++context.m_Batches.Top().m_End;
+        }
+        matchesEnd.Append( static_cast<uint32_t>( matches.GetSize() ) );
+        fileInfosEnd.Append( static_cast<uint32_t>( context.m_FileIndices.GetSize() ) );
+    }
+
+    // Retrieve missing attributes, without holding any locks (in parallel
+    // if there are enough)
+    const uint32_t numFileInfos = static_cast<uint32_t>( context.m_FileIndices.GetSize() );
+    if ( numFileInfos > 0 )
+    {
+        m_NumFileInfosRead.Add( numFileInfos );
+        context.m_FileInfos.SetSize( numFileInfos );
+        context.m_Found.SetSize( numFileInfos );
+
+        const uint32_t numBatches = static_cast<uint32_t>( context.m_Batches.GetSize() );
+        ThreadPool * threadPool = ( numBatches > 1 ) ? GetThreadPool() : nullptr;
+        if ( threadPool )
+        {
+            threadPool->ParallelFor( numBatches, 1, GetFileInfosContext::GetRange, &context );
+        }
+        else
+        {
+            GetFileInfosContext::GetRange( 0, numBatches, &context );
+        }
+    }
+
+    // Store the attributes and report files, in order
+    uint32_t matchIndex = 0;
+    uint32_t fileInfoIndex = 0;
+    const size_t numSnapshots = snapshots.GetSize();
+    for ( size_t s = 0; s < numSnapshots; ++s )
+    {
+        DirectorySnapshot * snapshot = snapshots[ s ];
+        MutexHolder mh( snapshot->m_Mutex );
+
+        for ( ; fileInfoIndex < fileInfosEnd[ s ]; ++fileInfoIndex )
+        {
+            if ( context.m_Found[ fileInfoIndex ] )
+            {
+                const uint32_t i = context.m_FileIndices[ fileInfoIndex ];
+                snapshot->m_Files[ i ] = Move( context.m_FileInfos[ fileInfoIndex ] );
+                snapshot->m_HasFileInfo[ i ] = true;
+            }
+        }
+
+        for ( ; matchIndex < matchesEnd[ s ]; ++matchIndex )
+        {
+            const uint32_t i = matches[ matchIndex ];
+            if ( snapshot->m_HasFileInfo[ i ] == false )
+            {
+                continue; // Deleted since the directory was read
+            }
+            FileIO::FileInfo info( snapshot->m_Files[ i ] );
+            helper.OnFile( Move( info ) );
+        }
+    }
+}
+
+// GetSnapshot
+//------------------------------------------------------------------------------
+DirectorySnapshot * DirectorySnapshotCache::GetSnapshot( const AString & path )
+{
+    // Current state of the directory, to check if a previous snapshot is
+    // still valid (this is the only syscall needed if it is)
+    FileIO::FileInfo dirInfo;
+    const bool exists = FileIO::GetFileInfo( path, dirInfo );
+    const uint64_t lastWriteTime = exists ? dirInfo.m_LastWriteTime : 0;
+
+    // Find or create snapshot
+    DirectorySnapshot * snapshot;
+    {
+        MutexHolder mh( m_Mutex );
+        UnorderedMap<AString, DirectorySnapshot *>::KeyValue * existing = m_SnapshotMap.Find( path );
+        if ( existing &&
+             existing->m_Value &&
+             ( existing->m_Value->m_Exists == exists ) &&
+             ( existing->m_Value->m_LastWriteTime == lastWriteTime ) )
+        {
+            snapshot = existing->m_Value;
+        }
+        else
+        {
+            // Previous snapshots are kept, as other walks may be using them
+            snapshot = FNEW( DirectorySnapshot( path, exists, lastWriteTime ) );
+            m_Snapshots.Append( snapshot );
+            if ( existing )
+            {
+                existing->m_Value = snapshot;
+            }
+            else
+            {
+                m_SnapshotMap.Insert( path, snapshot );
+            }
+        }
+    }
+
+    // Read the directory if this is the first use. Concurrent walks of the same
+    // directory wait here instead of reading it again.
+    MutexHolder mh( snapshot->m_Mutex );
+    if ( snapshot->m_Read )
+    {
+        m_NumDirectoriesReused.Increment();
+    }
+    else
+    {
+        if ( exists )
+        {
+            ReadSnapshot( *snapshot );
+        }
+        snapshot->m_Read = true;
+        m_NumDirectoriesRead.Increment();
+    }
+    return snapshot;
+}
+
+// ReadSnapshot
+//------------------------------------------------------------------------------
+/*static*/ void DirectorySnapshotCache::ReadSnapshot( DirectorySnapshot & snapshot )
+{
+    PROFILE_FUNCTION;
+
+    DirectorySnapshotReader reader( snapshot );
+    FileIO::GetFiles( snapshot.m_Path, reader );
+
+    // Walk sub-directories in a consistent order, regardless of the file system
+    snapshot.m_SubDirs.Sort();
+}
+
+// GetThreadPool
+//------------------------------------------------------------------------------
+ThreadPool * DirectorySnapshotCache::GetThreadPool()
+{
+    if ( m_NumThreads == 0 )
+    {
+        return nullptr;
+    }
+
+    // A separate pool is used as walks are performed by jobs which occupy
+    // the threads of the main ThreadPool
+    MutexHolder mh( m_Mutex );
+    if ( m_ThreadPool == nullptr )
+    {
+        m_ThreadPool = FNEW( ThreadPool( m_NumThreads ) );
+    }
+    return m_ThreadPool;
+}
+
+//------------------------------------------------------------------------------
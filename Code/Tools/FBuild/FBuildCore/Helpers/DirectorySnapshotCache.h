@@ -0,0 +1,105 @@
+// DirectorySnapshotCache - Directory contents shared by all directory walks
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Containers/UnorderedMap.h"
+#include "Core/Env/Types.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class ThreadPool;
+
+// DirectorySnapshot
+//  - The contents of one directory (not recursive)
+//------------------------------------------------------------------------------
+class DirectorySnapshot
+{
+public:
+    explicit DirectorySnapshot( const AString & path, bool exists, uint64_t lastWriteTime );
+    ~DirectorySnapshot();
+
+    DirectorySnapshot & operator=( const DirectorySnapshot & ) = delete;
+
+    const AString m_Path; // With trailing slash
+    const bool m_Exists;
+    const uint64_t m_LastWriteTime; // Of the directory, which changes when entries are added or removed
+
+    // Everything below is protected by m_Mutex until m_Read is set. After
+    // that, only the file attributes are modified (under m_Mutex).
+    Mutex m_Mutex;
+    bool m_Read = false;
+    Array<AString> m_SubDirs; // Full paths, with trailing slash
+    Array<AString> m_FileNames; // Names only, as passed to GetFilesHelper::ShouldIncludeFile
+    Array<FileIO::FileInfo> m_Files; // Full paths, with attributes if m_HasFileInfo is set
+    Array<bool> m_HasFileInfo; // Attributes are retrieved on first use (where not free)
+};
+
+// DirectorySnapshotCache
+//  - Many DirectoryListNodes walk the same directories (e.g. with different
+//    patterns or exclusions). Each directory is read once per build and
+//    the filtering of each walk is applied to the snapshot in memory.
+//  - A snapshot is re-read if the last write time of the directory changes,
+//    so files generated during the build are found. Last write times can be
+//    too coarse to notice a change (and don't change when file attributes do),
+//    so snapshots of directories written by the build are also forgotten.
+//  - Directories are walked breadth-first. The directories of each level
+//    (and the attributes of the files found) are read in parallel.
+//  - Thread-safe.
+//------------------------------------------------------------------------------
+class DirectorySnapshotCache
+{
+public:
+    // Directory reads are bound by I/O latency (especially on network file
+    // systems) rather than CPU, so the number of threads is independent of
+    // the number of cores. 0 reads on the calling thread only.
+    static const uint32_t kDefaultNumThreads = 8;
+
+    explicit DirectorySnapshotCache( uint32_t numThreads = kDefaultNumThreads );
+    ~DirectorySnapshotCache();
+
+    // Walk a directory, as with FileIO::GetFiles
+    void GetFiles( const AString & path, GetFilesHelper & helper );
+
+    // Forget all snapshots (before each build)
+    void Clear();
+
+    // Forget the snapshot of the directory containing a file written by the
+    // build, so the next walk reads it again
+    void OnFileWritten( const AString & fileName );
+
+    // Stats
+    uint32_t GetNumDirectoriesRead() const { return m_NumDirectoriesRead.Load(); }
+    uint32_t GetNumDirectoriesReused() const { return m_NumDirectoriesReused.Load(); }
+    uint32_t GetNumFileInfosRead() const { return m_NumFileInfosRead.Load(); }
+    uint32_t GetNumFileInfosReused() const { return m_NumFileInfosReused.Load(); }
+
+private:
+    class GetSnapshotsContext;
+    class GetFileInfosContext;
+
+    void GetSnapshots( const Array<AString> & paths, Array<DirectorySnapshot *> & outSnapshots );
+    void GetMatchingFiles( const Array<DirectorySnapshot *> & snapshots, GetFilesHelper & helper );
+    DirectorySnapshot * GetSnapshot( const AString & path );
+    static void ReadSnapshot( DirectorySnapshot & snapshot );
+    ThreadPool * GetThreadPool();
+
+    const uint32_t m_NumThreads;
+    ThreadPool * m_ThreadPool = nullptr; // Created on first use
+    Mutex m_Mutex;
+    UnorderedMap<AString, DirectorySnapshot *> m_SnapshotMap; // Latest snapshot of each directory (or null if forgotten)
+    Array<DirectorySnapshot *> m_Snapshots; // All snapshots, including replaced ones still in use
+    Atomic<uint32_t> m_NumDirectoriesRead;
+    Atomic<uint32_t> m_NumDirectoriesReused;
+    Atomic<uint32_t> m_NumFileInfosRead;
+    Atomic<uint32_t> m_NumFileInfosReused;
+};
+
+//------------------------------------------------------------------------------
@@ -8,6 +8,8 @@
 // FBuild
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
+#include "Tools/FBuild/FBuildCore/Graph/UnityNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/DirectorySnapshotCache.h"
 #include "Tools/FBuild/FBuildCore/Helpers/Report/Report.h"
 
 // Core
@@ -195,6 +197,49 @@ void FBuildStats::OutputSummary() const
         output.AppendFormat( " - Stores     : %u\n", stores );
     }
 
+    // Directory listings shared between DirectoryListNodes. Reading a directory
+    // takes at least 4 syscalls (lstat, open, getdents, close), but reusing
+    // it takes 1 (a stat to check it hasn't changed). File attributes are
+    // only retrieved once.
+    const DirectorySnapshotCache * snapshotCache = FBuild::IsValid() ? FBuild::Get().GetDirectorySnapshotCache() : nullptr;
+    if ( snapshotCache && ( snapshotCache->GetNumDirectoriesRead() > 0 ) )
+    {
+        const uint32_t dirsReused = snapshotCache->GetNumDirectoriesReused();
+        const uint32_t fileStatsReused = snapshotCache->GetNumFileInfosReused();
+        output += "Directories:\n";
+        output.AppendFormat( " - Read       : %u (%u reused)\n", snapshotCache->GetNumDirectoriesRead(), dirsReused );
+        output.AppendFormat( " - File Stats : %u (%u reused)\n", snapshotCache->GetNumFileInfosRead(), fileStatsReused );
+        output.AppendFormat( " - Syscalls   : %u avoided\n", ( dirsReused * 3 ) + fileStatsReused );
+    }
+
+    // Spread of Unity compile times (shortest to longest)
+    if ( m_BalancedUnities.IsEmpty() == false )
+    {
+        output += "Unity Balance:          Predicted               Actual\n";
+        for ( const UnityNode * un : m_BalancedUnities )
+        {
+            AStackString predicted( "-" );
+            AStackString actual( "-" );
+            uint32_t minMS;
+            uint32_t maxMS;
+            AStackString minTime;
+            AStackString maxTime;
+            if ( un->GetPredictedCostSpread( minMS, maxMS ) )
+            {
+                FormatTime( (float)minMS / 1000.0f, minTime );
+                FormatTime( (float)maxMS / 1000.0f, maxTime );
+                predicted.Format( "%s - %s", minTime.Get(), maxTime.Get() );
+            }
+            if ( un->GetActualCostSpread( minMS, maxMS ) )
+            {
+                FormatTime( (float)minMS / 1000.0f, minTime );
+                FormatTime( (float)maxMS / 1000.0f, maxTime );
+                actual.Format( "%s - %s", minTime.Get(), maxTime.Get() );
+            }
+            output.AppendFormat( " - %-20s : %-24s%s\n", un->GetName().Get(), predicted.Get(), actual.Get() );
+        }
+    }
+
     AStackString buffer;
     FormatTime( m_TotalBuildTime, buffer );
     output += "Time:\n";
@@ -250,6 +295,11 @@ void FBuildStats::GatherPostBuildStatisticsRecurse( Node * node )
         if ( node->GetStatFlag( Node::STATS_BUILT ) )
         {
             stats.m_NumBuilt++;
+
+            if ( ( nodeType == Node::UNITY_NODE ) && node->CastTo<UnityNode>()->IsBalancedByCost() )
+            {
+                m_BalancedUnities.Append( node->CastTo<UnityNode>() );
+            }
         }
         if ( node->GetStatFlag( Node::STATS_FAILED ) )
         {
@@ -12,6 +12,7 @@
 class Dependencies;
 class Node;
 class NodeGraph;
+class UnityNode;
 
 // FBuildStats
 //------------------------------------------------------------------------------
@@ -86,6 +87,7 @@ private:
 
     Node * m_RootNode;
     Array<const Node *> m_NodesByTime;
+    Array<const UnityNode *> m_BalancedUnities; // Unities balanced by cost, rebuilt this build
 
     Stats m_PerTypeStats[ Node::NUM_NODE_TYPES ];
     Stats m_Totals;
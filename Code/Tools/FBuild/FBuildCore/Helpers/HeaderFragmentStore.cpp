@@ -0,0 +1,284 @@
+// HeaderFragmentStore - Deduplicated storage of preprocessed output
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "HeaderFragmentStore.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+
+// Core
+#include "Core/Containers/UniquePtr.h"
+#include "Core/Env/Assert.h"
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/IOStream.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+
+// system
+#include <string.h> // for memcpy, memchr
+
+// Defines
+//------------------------------------------------------------------------------
+namespace
+{
+    // Does the line start with a line directive where the file changes? i.e.
+    //    # 12 "file.h" 1  (GCC/Clang - entering file.h, flag 1)
+    //    # 12 "file.h" 2  (GCC/Clang - returning to file.h, flag 2)
+    //    #line 12 "file.h" (MSVC - no flags, so all line directives)
+    // Other GCC/Clang line directives only skip blank lines, so don't change
+    // which file the content is from.
+    bool IsFileChangeDirective( const char * pos, const char * end )
+    {
+        const size_t len = static_cast<size_t>( end - pos );
+        if ( ( len >= 6 ) && ( memcmp( pos, "#line ", 6 ) == 0 ) )
+        {
+            return true;
+        }
+        if ( ( len < 3 ) || ( pos[ 0 ] != '#' ) || ( pos[ 1 ] != ' ' ) || ( pos[ 2 ] < '0' ) || ( pos[ 2 ] > '9' ) )
+        {
+            return false;
+        }
+
+        // Flags follow the (quoted) file name
+        const char * lineEnd = static_cast<const char *>( memchr( pos, '\n', len ) );
+        lineEnd = lineEnd ? lineEnd : end;
+        const char * fileNameEnd = lineEnd;
+        while ( ( fileNameEnd > pos ) && ( *( fileNameEnd - 1 ) != '"' ) )
+        {
+            --fileNameEnd;
+        }
+        return ( ( ( lineEnd - fileNameEnd ) >= 2 ) &&
+                 ( fileNameEnd[ 0 ] == ' ' ) &&
+                 ( ( fileNameEnd[ 1 ] == '1' ) || ( fileNameEnd[ 1 ] == '2' ) ) );
+    }
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+HeaderFragmentStore::HeaderFragmentStore() = default;
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+HeaderFragmentStore::~HeaderFragmentStore()
+{
+    for ( HeaderFragment * fragment : m_Fragments )
+    {
+        FREE( fragment->m_CompressedData );
+        FDELETE fragment;
+    }
+}
+
+// AddPreprocessedOutput
+//------------------------------------------------------------------------------
+void HeaderFragmentStore::AddPreprocessedOutput( const void * data,
+                                                 size_t dataSize,
+                                                 int16_t compressionLevel,
+                                                 Array<const HeaderFragment *> & outFragments )
+{
+    PROFILE_FUNCTION;
+
+    const char * pos = static_cast<const char *>( data );
+    const char * const end = ( pos + dataSize );
+    while ( pos < end )
+    {
+        const size_t fragmentSize = FindFragmentEnd( pos, static_cast<size_t>( end - pos ) );
+        const uint64_t hash = xxHash3::Calc64( pos, fragmentSize );
+
+        // Already stored?
+        const HeaderFragment * fragment = nullptr;
+        {
+            MutexHolder mh( m_Mutex );
+            const UnorderedMap<uint64_t, HeaderFragment *>::KeyValue * found = m_FragmentMap.Find( hash );
+            fragment = found ? found->m_Value : nullptr;
+        }
+
+        // Compress new fragments outside of the lock
+        if ( fragment == nullptr )
+        {
+            Compressor c;
+            c.Compress( pos, fragmentSize, compressionLevel );
+            const uint32_t compressedSize = static_cast<uint32_t>( c.GetResultSize() );
+            fragment = AddFragment( hash, static_cast<uint32_t>( fragmentSize ), c.ReleaseResult(), compressedSize );
+        }
+
+        outFragments.Append( fragment );
+        m_NumFragmentReferences.Increment();
+        pos += fragmentSize;
+    }
+}
+
+// WriteFragments
+//------------------------------------------------------------------------------
+/*static*/ uint32_t HeaderFragmentStore::WriteFragments( const Array<const HeaderFragment *> & fragments,
+                                                         Array<uint64_t> & sentFragments,
+                                                         IOStream & outManifest,
+                                                         Array<const HeaderFragment *> & outFragmentsToSend )
+{
+    const uint64_t manifestStart = outManifest.Tell();
+    uint32_t dataSize = 0;
+
+    outManifest.Write( static_cast<uint32_t>( fragments.GetSize() ) );
+    for ( const HeaderFragment * fragment : fragments )
+    {
+        // Has the fragment been sent before?
+        const size_t word = ( fragment->m_Index / 64 );
+        const uint64_t bit = ( 1ULL << ( fragment->m_Index % 64 ) );
+        while ( sentFragments.GetSize() <= word )
+        {
+            sentFragments.Append( 0 );
+        }
+        const bool send = ( ( sentFragments[ word ] & bit ) == 0 );
+        if ( send )
+        {
+            sentFragments[ word ] |= bit;
+            outFragmentsToSend.Append( fragment );
+            dataSize += fragment->m_CompressedSize;
+        }
+
+        outManifest.Write( fragment->m_Hash );
+        outManifest.Write( fragment->m_Size );
+        outManifest.Write( send ? fragment->m_CompressedSize : 0u ); // Size of data sent (0 = already sent)
+    }
+
+    return static_cast<uint32_t>( outManifest.Tell() - manifestStart ) + dataSize;
+}
+
+// ReadFragments
+//------------------------------------------------------------------------------
+bool HeaderFragmentStore::ReadFragments( ConstMemoryStream & stream, void *& outData, size_t & outDataSize )
+{
+    PROFILE_FUNCTION;
+
+    // Read the manifest
+    uint32_t numFragments = 0;
+    if ( stream.Read( numFragments ) == false )
+    {
+        return false;
+    }
+    class Entry
+    {
+    public:
+        uint64_t m_Hash;
+        uint32_t m_Size;
+        uint32_t m_SentSize;
+    };
+    Array<Entry> entries;
+    entries.SetCapacity( numFragments );
+    uint64_t dataSize = 0;
+    for ( uint32_t i = 0; i < numFragments; ++i )
+    {
+        Entry & entry = entries.EmplaceBack();
+        if ( ( stream.Read( entry.m_Hash ) == false ) ||
+             ( stream.Read( entry.m_Size ) == false ) ||
+             ( stream.Read( entry.m_SentSize ) == false ) )
+        {
+            return false;
+        }
+        dataSize += entry.m_Size;
+    }
+    if ( dataSize > 0xFFFFFFFF )
+    {
+        return false; // Job data is limited to 32bit
+    }
+
+    // Reassemble, storing new fragments as we go
+    UniquePtr<char, FreeDeletor> data( static_cast<char *>( ALLOC( Math::Max<size_t>( static_cast<size_t>( dataSize ), 1 ) ) ) );
+    char * dst = data.Get();
+    for ( const Entry & entry : entries )
+    {
+        const HeaderFragment * fragment = nullptr;
+        if ( entry.m_SentSize > 0 )
+        {
+            // New fragment follows
+            const size_t remaining = static_cast<size_t>( stream.GetSize() - stream.Tell() );
+            if ( ( remaining < entry.m_SentSize ) ||
+                 ( Compressor::IsValidData( static_cast<const char *>( stream.GetData() ) + stream.Tell(), entry.m_SentSize ) == false ) )
+            {
+                return false;
+            }
+            void * compressedData = ALLOC( entry.m_SentSize );
+            stream.ReadBuffer( compressedData, entry.m_SentSize );
+            fragment = AddFragment( entry.m_Hash, entry.m_Size, compressedData, entry.m_SentSize );
+        }
+        else
+        {
+            // Previously sent fragment
+            MutexHolder mh( m_Mutex );
+            const UnorderedMap<uint64_t, HeaderFragment *>::KeyValue * found = m_FragmentMap.Find( entry.m_Hash );
+            fragment = found ? found->m_Value : nullptr;
+        }
+        if ( ( fragment == nullptr ) || ( fragment->m_Size != entry.m_Size ) )
+        {
+            return false;
+        }
+        m_NumFragmentReferences.Increment();
+
+        Compressor c;
+        if ( ( c.Decompress( fragment->m_CompressedData ) == false ) ||
+             ( c.GetResultSize() != fragment->m_Size ) )
+        {
+            return false;
+        }
+        memcpy( dst, c.GetResult(), fragment->m_Size );
+        dst += fragment->m_Size;
+    }
+
+    outData = data.ReleaseOwnership();
+    outDataSize = static_cast<size_t>( dataSize );
+    return true;
+}
+
+// FindFragmentEnd
+//------------------------------------------------------------------------------
+/*static*/ size_t HeaderFragmentStore::FindFragmentEnd( const char * data, size_t dataSize )
+{
+    // A fragment continues until the file changes, so boundaries depend only
+    // on the content itself
+    const char * const end = ( data + dataSize );
+    const char * pos = data;
+    for ( ;; )
+    {
+        const char * lineEnd = static_cast<const char *>( memchr( pos, '\n', static_cast<size_t>( end - pos ) ) );
+        if ( lineEnd == nullptr )
+        {
+            return dataSize;
+        }
+        pos = ( lineEnd + 1 );
+        if ( IsFileChangeDirective( pos, end ) )
+        {
+            return static_cast<size_t>( pos - data );
+        }
+    }
+}
+
+// AddFragment
+//------------------------------------------------------------------------------
+const HeaderFragment * HeaderFragmentStore::AddFragment( uint64_t hash, uint32_t size, void * compressedData, uint32_t compressedSize )
+{
+    MutexHolder mh( m_Mutex );
+
+    // Another thread may have added the same fragment
+    const UnorderedMap<uint64_t, HeaderFragment *>::KeyValue * found = m_FragmentMap.Find( hash );
+    if ( found )
+    {
+        FREE( compressedData );
+        return found->m_Value;
+    }
+
+    HeaderFragment * fragment = FNEW( HeaderFragment );
+    fragment->m_Hash = hash;
+    fragment->m_Size = size;
+    fragment->m_Index = static_cast<uint32_t>( m_Fragments.GetSize() );
+    fragment->m_CompressedSize = compressedSize;
+    fragment->m_CompressedData = compressedData;
+    m_Fragments.Append( fragment );
+    m_FragmentMap.Insert( hash, fragment );
+    m_NumFragments.Increment();
+    return fragment;
+}
+
+//------------------------------------------------------------------------------
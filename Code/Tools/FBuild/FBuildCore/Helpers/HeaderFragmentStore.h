@@ -0,0 +1,83 @@
+// HeaderFragmentStore - Deduplicated storage of preprocessed output
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Containers/UnorderedMap.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Mutex.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class ConstMemoryStream;
+class IOStream;
+
+// HeaderFragment
+//  - A piece of preprocessed output, stored compressed
+//------------------------------------------------------------------------------
+class HeaderFragment
+{
+public:
+    uint64_t m_Hash; // Of the uncompressed content
+    uint32_t m_Size; // Uncompressed
+    uint32_t m_Index; // Order of addition to the store
+    uint32_t m_CompressedSize;
+    void * m_CompressedData; // Compressor format
+};
+
+// HeaderFragmentStore
+//  - Preprocessed output is split at line directives where the file changes
+//    (i.e. where the content of each header starts and resumes), so the
+//    output of headers included by many translation units is split into the
+//    same fragments.
+//  - On the client, all fragments of the build are stored once. Each job
+//    references its fragments, and a worker is only sent the fragments it
+//    hasn't been sent before.
+//  - On the worker, each connection has a store of the fragments received,
+//    from which jobs are reassembled.
+//------------------------------------------------------------------------------
+class HeaderFragmentStore
+{
+public:
+    explicit HeaderFragmentStore();
+    ~HeaderFragmentStore();
+
+    // Client: Split preprocessed output into fragments, storing any new ones
+    void AddPreprocessedOutput( const void * data,
+                                size_t dataSize,
+                                int16_t compressionLevel,
+                                Array<const HeaderFragment *> & outFragments );
+
+    // Client: Write a job's fragments for sending. Fragments not yet sent (as
+    // tracked by sentFragments) are returned, and must follow the manifest.
+    static uint32_t WriteFragments( const Array<const HeaderFragment *> & fragments,
+                                    Array<uint64_t> & sentFragments,
+                                    IOStream & outManifest,
+                                    Array<const HeaderFragment *> & outFragmentsToSend );
+
+    // Worker: Reassemble preprocessed output, storing any fragments it included
+    bool ReadFragments( ConstMemoryStream & stream, void *& outData, size_t & outDataSize );
+
+    // Fragment boundaries
+    static size_t FindFragmentEnd( const char * data, size_t dataSize );
+
+    // Stats
+    uint32_t GetNumFragments() const { return m_NumFragments.Load(); }
+    uint64_t GetNumFragmentReferences() const { return m_NumFragmentReferences.Load(); }
+
+private:
+    // Takes ownership of compressedData (and frees it if the fragment already exists)
+    const HeaderFragment * AddFragment( uint64_t hash, uint32_t size, void * compressedData, uint32_t compressedSize );
+
+    Mutex m_Mutex;
+    UnorderedMap<uint64_t, HeaderFragment *> m_FragmentMap;
+    Array<HeaderFragment *> m_Fragments; // Indexed by HeaderFragment::m_Index
+    Atomic<uint32_t> m_NumFragments;
+    Atomic<uint64_t> m_NumFragmentReferences;
+};
+
+//------------------------------------------------------------------------------
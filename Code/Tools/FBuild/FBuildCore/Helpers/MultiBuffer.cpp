@@ -13,8 +13,152 @@
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Strings/AString.h"
 
+// system
+#include <string.h> // for memcpy
+
+// MultiBufferFileWriter
+//  - Consumes decompressed MultiBuffer data as it is produced, parsing the
+//    header and writing the contents of each file directly to disk
+//------------------------------------------------------------------------------
+class MultiBufferFileWriter : public IOStream
+{
+public:
+    explicit MultiBufferFileWriter( const Array<AString> & fileNames )
+        : m_FileNames( fileNames )
+    {
+    }
+
+    [[nodiscard]] bool HasWriteFailed() const { return m_WriteFailed; }
+    [[nodiscard]] size_t GetCurrentFileIndex() const { return m_CurrentFile; }
+    [[nodiscard]] bool IsComplete() const { return m_HeaderParsed && ( m_CurrentFile == m_FileNames.GetSize() ); }
+
+    virtual uint64_t WriteBuffer( const void * buffer, uint64_t bytesToWrite ) override
+    {
+        const char * src = static_cast<const char *>( buffer );
+        uint64_t remaining = bytesToWrite;
+        while ( remaining > 0 )
+        {
+            // Accumulate the header (file count and sizes)
+            if ( m_HeaderParsed == false )
+            {
+                const size_t headerBytes = GetHeaderSize() - m_HeaderBytes;
+                const size_t bytesToCopy = static_cast<size_t>( Math::Min<uint64_t>( headerBytes, remaining ) );
+                memcpy( m_Header + m_HeaderBytes, src, bytesToCopy );
+                m_HeaderBytes += bytesToCopy;
+                src += bytesToCopy;
+                remaining -= bytesToCopy;
+                if ( ( m_HeaderBytes == GetHeaderSize() ) && ( ParseHeader() == false ) )
+                {
+                    return 0; // Data is invalid
+                }
+                continue;
+            }
+
+            // Data beyond the files we want (or beyond the end) is ignored
+            if ( m_CurrentFile >= m_FileNames.GetSize() )
+            {
+                m_BytesWritten += remaining;
+                return bytesToWrite;
+            }
+
+            // Write as much of the current file as we have
+            const uint64_t bytesToCopy = Math::Min<uint64_t>( m_FileSizes[ m_CurrentFile ] - m_CurrentFileBytes, remaining );
+            if ( m_CurrentFileStream.WriteBuffer( src, bytesToCopy ) != bytesToCopy )
+            {
+                m_WriteFailed = true;
+                return 0;
+            }
+            m_CurrentFileBytes += bytesToCopy;
+            src += bytesToCopy;
+            remaining -= bytesToCopy;
+            if ( ( m_CurrentFileBytes == m_FileSizes[ m_CurrentFile ] ) && ( NextFile() == false ) )
+            {
+                return 0;
+            }
+        }
+        m_BytesWritten += bytesToWrite;
+        return bytesToWrite;
+    }
+
+    virtual uint64_t ReadBuffer( void * /*buffer*/, uint64_t /*bytesToRead*/ ) override { return 0; }
+    virtual void Flush() override {}
+    virtual uint64_t Tell() const override { return m_BytesWritten; }
+    virtual bool Seek( uint64_t /*pos*/ ) const override { return false; }
+    virtual uint64_t GetFileSize() const override { return m_BytesWritten; }
+
+private:
+    size_t GetHeaderSize() const
+    {
+        // File count, then sizes once the count is known
+        return ( m_HeaderBytes < sizeof( uint32_t ) ) ? sizeof( uint32_t )
+                                                      : sizeof( uint32_t ) + ( sizeof( uint64_t ) * m_NumFiles );
+    }
+
+    bool ParseHeader()
+    {
+        if ( m_HeaderBytes == sizeof( uint32_t ) )
+        {
+            memcpy( &m_NumFiles, m_Header, sizeof( uint32_t ) );
+
+            // Caller and MultiBuffer are out of sync, or data is corrupt
+            if ( ( m_NumFiles < m_FileNames.GetSize() ) || ( m_NumFiles > MultiBuffer::kMaxFiles ) )
+            {
+                return false;
+            }
+            if ( m_NumFiles > 0 )
+            {
+                return true; // Sizes follow
+            }
+        }
+        memcpy( m_FileSizes, m_Header + sizeof( uint32_t ), sizeof( uint64_t ) * m_NumFiles );
+        m_HeaderParsed = true;
+        return OpenFile();
+    }
+
+    bool OpenFile()
+    {
+        // Open the next file, handling empty files (which receive no data)
+        while ( m_CurrentFile < m_FileNames.GetSize() )
+        {
+            if ( MultiBuffer::OpenFileForExtraction( m_FileNames[ m_CurrentFile ], m_CurrentFileStream ) == false )
+            {
+                m_WriteFailed = true;
+                return false;
+            }
+            if ( m_FileSizes[ m_CurrentFile ] > 0 )
+            {
+                break;
+            }
+            m_CurrentFileStream.Close();
+            ++m_CurrentFile;
+        }
+        return true;
+    }
+
+    bool NextFile()
+    {
+        m_CurrentFileStream.Close();
+        ++m_CurrentFile;
+        m_CurrentFileBytes = 0;
+        return OpenFile();
+    }
+
+    const Array<AString> & m_FileNames;
+    char m_Header[ sizeof( uint32_t ) + ( sizeof( uint64_t ) * MultiBuffer::kMaxFiles ) ];
+    size_t m_HeaderBytes = 0;
+    uint32_t m_NumFiles = 0;
+    uint64_t m_FileSizes[ MultiBuffer::kMaxFiles ];
+    bool m_HeaderParsed = false;
+    bool m_WriteFailed = false;
+    size_t m_CurrentFile = 0;
+    uint64_t m_CurrentFileBytes = 0;
+    FileStream m_CurrentFileStream;
+    uint64_t m_BytesWritten = 0;
+};
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 MultiBuffer::MultiBuffer()
@@ -133,7 +277,23 @@ bool MultiBuffer::ExtractFile( size_t index, const AString & fileName ) const
     const void * fileData = (void *)( (size_t)m_ReadStream->GetData() + offset );
 
     FileStream fs;
-    if ( !fs.Open( fileName.Get(), FileStream::WRITE_ONLY ) )
+    if ( !OpenFileForExtraction( fileName, fs ) )
+    {
+        return false;
+    }
+    if ( fs.WriteBuffer( fileData, fileSize ) != fileSize )
+    {
+        return false;
+    }
+
+    return true;
+}
+
+// OpenFileForExtraction
+//------------------------------------------------------------------------------
+/*static*/ bool MultiBuffer::OpenFileForExtraction( const AString & fileName, FileStream & outFileStream )
+{
+    if ( !outFileStream.Open( fileName.Get(), FileStream::WRITE_ONLY ) )
     {
         // On Windows, we can occasionally fail to open the file with error 1224 (ERROR_USER_MAPPED_FILE), due to
         // things like anti-virus etc. Simply retry if that happens
@@ -142,16 +302,11 @@ bool MultiBuffer::ExtractFile( size_t index, const AString & fileName ) const
         FileIO::WorkAroundForWindowsFilePermissionProblem( fileName, FileStream::WRITE_ONLY, 15 ); // 15 secs max wait
 
         // Try again
-        if ( !fs.Open( fileName.Get(), FileStream::WRITE_ONLY ) )
+        if ( !outFileStream.Open( fileName.Get(), FileStream::WRITE_ONLY ) )
         {
             return false;
         }
     }
-    if ( fs.WriteBuffer( fileData, fileSize ) != fileSize )
-    {
-        return false;
-    }
-
     return true;
 }
 
@@ -200,6 +355,31 @@ bool MultiBuffer::Decompress()
     return true;
 }
 
+// DecompressToFiles
+//------------------------------------------------------------------------------
+bool MultiBuffer::DecompressToFiles( const Array<AString> & fileNames, size_t * outProblemFileIndex ) const
+{
+    ASSERT( m_ReadStream ); // Data needs to be populated
+    ASSERT( fileNames.GetSize() <= kMaxFiles );
+
+    if ( Compressor::IsValidData( m_ReadStream->GetData(), m_ReadStream->GetSize() ) == false )
+    {
+        return false;
+    }
+
+    MultiBufferFileWriter writer( fileNames );
+    const bool decompressed = Compressor::DecompressToStream( m_ReadStream->GetData(), writer );
+    if ( writer.HasWriteFailed() )
+    {
+        if ( outProblemFileIndex )
+        {
+            *outProblemFileIndex = writer.GetCurrentFileIndex();
+        }
+        return false;
+    }
+    return ( decompressed && writer.IsComplete() );
+}
+
 // GetData
 //------------------------------------------------------------------------------
 const void * MultiBuffer::GetData() const
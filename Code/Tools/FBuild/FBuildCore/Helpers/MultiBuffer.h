@@ -12,6 +12,7 @@
 //------------------------------------------------------------------------------
 class AString;
 class ConstMemoryStream;
+class FileStream;
 class MemoryStream;
 
 // MultiBuffer
@@ -29,12 +30,21 @@ public:
     void Compress( int32_t compressionLevel, bool allowZstdUse );
     bool Decompress();
 
+    // Decompress and extract files in a single pass, without holding all the
+    // decompressed data in memory. On failure, outProblemFileIndex is set if a
+    // file could not be written (otherwise the data was invalid).
+    bool DecompressToFiles( const Array<AString> & fileNames, size_t * outProblemFileIndex = nullptr ) const;
+
     const void * GetData() const;
     uint64_t GetDataSize() const;
 
     void * Release( size_t & outSize );
 
 private:
+    friend class MultiBufferFileWriter;
+
+    static bool OpenFileForExtraction( const AString & fileName, FileStream & outFileStream );
+
     inline static const uint32_t kMaxFiles = 4;
 
     ConstMemoryStream * m_ReadStream;
@@ -0,0 +1,118 @@
+// ToolChunkStore - Toolchain content split into reusable chunks
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "ToolChunkStore.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+
+// Core
+#include "Core/Containers/UniquePtr.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/Math/GearHash.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+
+// system
+#include <memory.h> // memcpy
+
+// FindChunks
+//------------------------------------------------------------------------------
+/*static*/ void ToolChunkStore::FindChunks( const void * data, size_t dataSize, Array<uint32_t> & outChunkSizes )
+{
+    PROFILE_FUNCTION;
+
+    const uint8_t * const bytes = static_cast<const uint8_t *>( data );
+    size_t pos = 0;
+    while ( pos < dataSize )
+    {
+        const size_t chunkSize = GearHash::FindChunkEnd( bytes + pos, dataSize - pos, kMinChunkSize, kAvgChunkSize, kMaxChunkSize );
+        outChunkSizes.Append( static_cast<uint32_t>( chunkSize ) );
+        pos += chunkSize;
+    }
+}
+
+// LoadChunk
+//------------------------------------------------------------------------------
+/*static*/ bool ToolChunkStore::LoadChunk( uint64_t hash, uint32_t size, void * outData )
+{
+    AStackString path;
+    GetChunkPath( hash, path );
+
+    // Read compressed chunk
+    UniquePtr<void, FreeDeletor> compressedData;
+    uint64_t compressedDataSize = 0;
+    {
+        FileStream fs;
+        if ( fs.Open( path.Get(), FileStream::READ_ONLY ) == false )
+        {
+            return false; // Not in store
+        }
+        compressedDataSize = fs.GetFileSize();
+        compressedData.Replace( ALLOC( (size_t)compressedDataSize ) );
+        if ( fs.ReadBuffer( compressedData.Get(), compressedDataSize ) != compressedDataSize )
+        {
+            return false;
+        }
+    }
+
+    // Chunks can be incomplete (if the worker was terminated while writing
+    // them), so everything is verified
+    Compressor c;
+    if ( ( Compressor::IsValidData( compressedData.Get(), (size_t)compressedDataSize ) == false ) ||
+         ( Compressor::GetUncompressedSize( compressedData.Get(), (size_t)compressedDataSize ) != size ) ||
+         ( c.Decompress( compressedData.Get() ) == false ) ||
+         ( xxHash3::Calc64( c.GetResult(), c.GetResultSize() ) != hash ) )
+    {
+        FileIO::FileDelete( path.Get() );
+        return false;
+    }
+
+    memcpy( outData, c.GetResult(), size );
+    return true;
+}
+
+// StoreChunk
+//------------------------------------------------------------------------------
+/*static*/ bool ToolChunkStore::StoreChunk( uint64_t hash, const void * compressedData, size_t compressedDataSize )
+{
+    AStackString path;
+    GetChunkPath( hash, path );
+    if ( FileIO::FileExists( path.Get() ) )
+    {
+        return true; // Already stored (while synchronizing another toolchain)
+    }
+
+    if ( FileIO::EnsurePathExistsForFile( path ) == false )
+    {
+        return false;
+    }
+    FileStream fs;
+    if ( fs.Open( path.Get(), FileStream::WRITE_ONLY ) == false )
+    {
+        return false;
+    }
+    return ( fs.WriteBuffer( compressedData, compressedDataSize ) == compressedDataSize );
+}
+
+// GetChunkPath
+//------------------------------------------------------------------------------
+/*static*/ void ToolChunkStore::GetChunkPath( uint64_t hash, AString & outPath )
+{
+    VERIFY( FBuild::GetTempDir( outPath ) );
+    AStackString subPath;
+#if defined( __WINDOWS__ )
+    subPath.Format( ".fbuild.tmp\\worker\\chunks\\%02x\\%016" PRIx64, static_cast<uint32_t>( hash >> 56 ), hash );
+#else
+    subPath.Format( "_fbuild.tmp/worker/chunks/%02x/%016" PRIx64, static_cast<uint32_t>( hash >> 56 ), hash );
+#endif
+    outPath += subPath;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,41 @@
+// ToolChunkStore - Toolchain content split into reusable chunks
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class AString;
+
+// ToolChunkStore
+//  - Toolchain files are split at content-defined boundaries, so a change
+//    in one part of a file (or a new version of a toolchain) only changes
+//    the chunks around it.
+//  - On the worker, chunks received for any toolchain are kept (compressed)
+//    in a store shared by all toolchains, so only chunks which have never
+//    been received need to be sent.
+//------------------------------------------------------------------------------
+class ToolChunkStore
+{
+public:
+    // Chunk boundaries
+    static void FindChunks( const void * data, size_t dataSize, Array<uint32_t> & outChunkSizes );
+
+    // Worker: Access the store
+    static bool LoadChunk( uint64_t hash, uint32_t size, void * outData );
+    static bool StoreChunk( uint64_t hash, const void * compressedData, size_t compressedDataSize );
+
+    inline static const uint32_t kMinChunkSize = ( 16 * 1024 );
+    inline static const uint32_t kAvgChunkSize = ( 64 * 1024 );
+    inline static const uint32_t kMaxChunkSize = ( 256 * 1024 );
+
+private:
+    static void GetChunkPath( uint64_t hash, AString & outPath );
+};
+
+//------------------------------------------------------------------------------
@@ -22,6 +22,7 @@
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Graph/FileNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ToolChunkStore.h"
 
 // system
 #include <memory.h> // memcpy
@@ -50,7 +51,7 @@ ToolManifestFile::ToolManifestFile() = default;
 
 // CONSTRUCTOR (ToolManifestFile)
 //------------------------------------------------------------------------------
-ToolManifestFile::ToolManifestFile( const AString & name, uint64_t stamp, uint32_t hash, uint32_t size )
+ToolManifestFile::ToolManifestFile( const AString & name, uint64_t stamp, uint64_t hash, uint32_t size )
     : m_Name( name )
     , m_TimeStamp( stamp )
     , m_Hash( hash )
@@ -63,6 +64,7 @@ ToolManifestFile::ToolManifestFile( const AString & name, uint64_t stamp, uint32
 ToolManifestFile::~ToolManifestFile()
 {
     FREE( m_CompressedContent );
+    FREE( m_CompressedChunks );
     FDELETE( m_FileLock );
 }
 
@@ -72,6 +74,7 @@ ToolManifest::ToolManifest()
     : m_ToolId( 0 )
     , m_TimeStamp( 0 )
     , m_Synchronized( false )
+    , m_HasChunks( false )
     , m_RemoteEnvironmentString( nullptr )
     , m_UserData( nullptr )
 {
@@ -83,6 +86,7 @@ ToolManifest::ToolManifest( uint64_t toolId )
     : m_ToolId( toolId )
     , m_TimeStamp( 0 )
     , m_Synchronized( false )
+    , m_HasChunks( false )
     , m_RemoteEnvironmentString( nullptr )
     , m_UserData( nullptr )
 {
@@ -107,6 +111,40 @@ void ToolManifestFile::StoreCompressedContent( const void * uncompressedData, co
     m_CompressedContent = c.ReleaseResult();
 }
 
+// StoreCompressedChunks (ToolManifestFile)
+//------------------------------------------------------------------------------
+void ToolManifestFile::StoreCompressedChunks( const void * uncompressedData, const uint32_t uncompressedDataSize ) const
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( m_ChunksPrepared == false );
+
+    StackArray<uint32_t> chunkSizes;
+    ToolChunkStore::FindChunks( uncompressedData, uncompressedDataSize, chunkSizes );
+
+    // Compress each chunk separately, so they can be sent individually
+    MemoryStream compressedChunks;
+    m_Chunks.SetCapacity( chunkSizes.GetSize() );
+    const char * pos = static_cast<const char *>( uncompressedData );
+    for ( const uint32_t chunkSize : chunkSizes )
+    {
+        Compressor c;
+        c.Compress( pos, chunkSize );
+
+        ToolManifestChunk & chunk = m_Chunks.EmplaceBack();
+        chunk.m_Hash = xxHash3::Calc64( pos, chunkSize );
+        chunk.m_Size = chunkSize;
+        chunk.m_CompressedOffset = static_cast<uint32_t>( compressedChunks.GetSize() );
+        chunk.m_CompressedSize = static_cast<uint32_t>( c.GetResultSize() );
+        compressedChunks.WriteBuffer( c.GetResult(), c.GetResultSize() );
+
+        pos += chunkSize;
+    }
+    m_UncompressedContentSize = uncompressedDataSize;
+    m_CompressedChunks = compressedChunks.Release();
+    m_ChunksPrepared = true;
+}
+
 // DoBuild
 //------------------------------------------------------------------------------
 bool ToolManifestFile::DoBuild()
@@ -141,13 +179,13 @@ bool ToolManifestFile::DoBuild()
     m_UncompressedContentSize = uncompressedContentSize;
 
     // Store the hash and timestamp
-    m_Hash = xxHash::Calc32( uncompressedContent, uncompressedContentSize ); // TODO:C Switch to 64 bit hash
+    m_Hash = xxHash3::Calc64( uncompressedContent, uncompressedContentSize );
     m_TimeStamp = FileIO::GetFileLastWriteTime( m_Name );
 
-    // Compress and keep the data if it might be useful
+    // Split, compress and keep the data if it might be useful
     if ( FBuild::Get().GetOptions().m_AllowDistributed )
     {
-        StoreCompressedContent( uncompressedContent, uncompressedContentSize );
+        StoreCompressedChunks( uncompressedContent, uncompressedContentSize );
     }
 
     FREE( uncompressedContent );
@@ -176,7 +214,7 @@ void ToolManifest::Initialize( const AString & mainExecutableRoot, const Depende
     m_Files.SetCapacity( dependencies.GetSize() );
     for ( const Dependency & dep : dependencies )
     {
-        m_Files.EmplaceBack( dep.GetNode()->GetName(), (uint64_t)0, (uint32_t)0, (uint32_t)0 );
+        m_Files.EmplaceBack( dep.GetNode()->GetName(), (uint64_t)0, (uint64_t)0, (uint32_t)0 );
     }
 }
 
@@ -200,9 +238,9 @@ bool ToolManifest::DoBuild( const Dependencies & dependencies )
 
     // create a hash for the whole tool chain
     const size_t numFiles( m_Files.GetSize() );
-    const size_t memSize( numFiles * sizeof( uint32_t ) * 2 );
-    uint32_t * mem = (uint32_t *)ALLOC( memSize );
-    uint32_t * pos = mem;
+    const size_t memSize( numFiles * sizeof( uint64_t ) * 2 );
+    uint64_t * mem = (uint64_t *)ALLOC( memSize );
+    uint64_t * pos = mem;
     for ( size_t i = 0; i < numFiles; ++i )
     {
         const ToolManifestFile & f = m_Files[ i ];
@@ -214,7 +252,7 @@ bool ToolManifest::DoBuild( const Dependencies & dependencies )
         // file name & sub-path (relative to remote folder)
         AStackString relativePath;
         GetRelativePath( m_MainExecutableRootPath, f.GetName(), relativePath );
-        *pos = xxHash::Calc32( relativePath );
+        *pos = xxHash3::Calc64( relativePath );
         ++pos;
     }
     m_ToolId = xxHash3::Calc64( mem, memSize );
@@ -249,8 +287,23 @@ void ToolManifest::Migrate( const ToolManifest & oldManifest )
 
 // SerializeForRemote
 //------------------------------------------------------------------------------
-void ToolManifest::SerializeForRemote( IOStream & ms ) const
+bool ToolManifest::SerializeForRemote( IOStream & ms, bool withChunks ) const
 {
+    PROFILE_FUNCTION;
+
+    // File data may need to be loaded again (if the manifest was from a
+    // previous build), and manifests can be sent on several connections at once
+    {
+        MutexHolder mh( m_Mutex );
+        for ( const ToolManifestFile & f : m_Files )
+        {
+            if ( ( withChunks ? f.PrepareChunks() : f.PrepareLegacyHash() ) == false )
+            {
+                return false; // PrepareChunks/PrepareLegacyHash will have emitted an error
+            }
+        }
+    }
+
     ms.Write( m_ToolId );
     ms.Write( m_MainExecutableRootPath );
 
@@ -262,8 +315,24 @@ void ToolManifest::SerializeForRemote( IOStream & ms ) const
         const ToolManifestFile & f = m_Files[ i ];
         ms.Write( f.GetName() );
         ms.Write( f.GetTimeStamp() );
-        ms.Write( f.GetHash() );
-        ms.Write( f.GetUncompressedContentSize() );
+        if ( withChunks )
+        {
+            ms.Write( f.GetHash() );
+            ms.Write( f.GetUncompressedContentSize() );
+
+            const Array<ToolManifestChunk> & chunks = f.GetChunks();
+            ms.Write( static_cast<uint32_t>( chunks.GetSize() ) );
+            for ( const ToolManifestChunk & chunk : chunks )
+            {
+                ms.Write( chunk.m_Hash );
+                ms.Write( chunk.m_Size );
+            }
+        }
+        else
+        {
+            ms.Write( f.GetLegacyHash() );
+            ms.Write( f.GetUncompressedContentSize() );
+        }
     }
 
     const size_t numEnvVars( m_CustomEnvironmentVariables.GetSize() );
@@ -272,11 +341,13 @@ void ToolManifest::SerializeForRemote( IOStream & ms ) const
     {
         ms.Write( m_CustomEnvironmentVariables[ i ] );
     }
+
+    return true;
 }
 
 // DeserializeFromRemote
 //------------------------------------------------------------------------------
-bool ToolManifest::DeserializeFromRemote( IOStream & ms )
+bool ToolManifest::DeserializeFromRemote( IOStream & ms, bool withChunks )
 {
     // NOTE: In clients prior to v1.07 a bug could cause ToolManifests to be
     //       corrupt so we try to read this stream in a way that allows us to
@@ -311,19 +382,50 @@ bool ToolManifest::DeserializeFromRemote( IOStream & ms )
     {
         AStackString name;
         uint64_t timeStamp( 0 );
-        uint32_t hash( 0 );
+        uint64_t hash( 0 );
+        uint32_t legacyHash( 0 );
         uint32_t uncompressedContentSize( 0 );
         if ( !ms.Read( name ) ||
              !ms.Read( timeStamp ) ||
-             !ms.Read( hash ) ||
+             ( withChunks ? !ms.Read( hash ) : !ms.Read( legacyHash ) ) ||
              !ms.Read( uncompressedContentSize ) ||
              ( AString::StrLen( name.Get() ) != name.GetLength() ) ||
              ( timeStamp == 0 ) ||
-             ( hash == 0 ) )
+             ( ( hash | legacyHash ) == 0 ) )
         {
             return false; // Corrupt stream (likely old broken worker)
         }
-        files.EmplaceBack( name, timeStamp, hash, uncompressedContentSize );
+        ToolManifestFile & file = files.EmplaceBack( name, timeStamp, withChunks ? hash : legacyHash, uncompressedContentSize );
+
+        // Chunks must exactly cover the file
+        if ( withChunks )
+        {
+            uint32_t numChunks( 0 );
+            if ( !ms.Read( numChunks ) ||
+                 ( numChunks > uncompressedContentSize ) )
+            {
+                return false; // Corrupt stream
+            }
+            Array<ToolManifestChunk> chunks;
+            chunks.SetCapacity( numChunks );
+            uint64_t chunksSize = 0;
+            for ( size_t j = 0; j < (size_t)numChunks; ++j )
+            {
+                ToolManifestChunk & chunk = chunks.EmplaceBack();
+                if ( !ms.Read( chunk.m_Hash ) ||
+                     !ms.Read( chunk.m_Size ) ||
+                     ( chunk.m_Size == 0 ) )
+                {
+                    return false; // Corrupt stream
+                }
+                chunksSize += chunk.m_Size;
+            }
+            if ( chunksSize != uncompressedContentSize )
+            {
+                return false; // Corrupt stream
+            }
+            file.SetChunks( Move( chunks ) );
+        }
     }
 
     // Custom env vars
@@ -346,6 +448,7 @@ bool ToolManifest::DeserializeFromRemote( IOStream & ms )
     m_MainExecutableRootPath = mainExecutablePath;
     m_Files = Move( files );
     m_CustomEnvironmentVariables = Move( customEnvironmentVariables );
+    m_HasChunks = withChunks;
 
     // determine if any files are remaining from a previous run
     size_t numFilesAlreadySynchronized = 0;
@@ -363,30 +466,22 @@ bool ToolManifest::DeserializeFromRemote( IOStream & ms )
         FileIO::SetFileLastWriteTimeToNow( localFile );
 
         // is this file already present?
-        UniquePtr<FileStream> fileStream( FNEW( FileStream ) );
-        FileStream & f = *( fileStream.Get() );
-        if ( f.Open( localFile.Get() ) == false )
-        {
-            continue; // file not found
-        }
-        if ( f.GetFileSize() != m_Files[ i ].GetUncompressedContentSize() )
-        {
-            continue; // file is not complete
-        }
-        UniquePtr<char, FreeDeletor> mem( (char *)ALLOC( (size_t)f.GetFileSize() ) );
-        if ( f.Read( mem.Get(), (size_t)f.GetFileSize() ) != f.GetFileSize() )
+        if ( IsFilePresent( (uint32_t)i, localFile ) )
         {
-            continue; // problem reading file
+            numFilesAlreadySynchronized++;
+            continue;
         }
-        if ( xxHash::Calc32( mem.Get(), (size_t)f.GetFileSize() ) != m_Files[ i ].GetHash() )
+
+        // can the file be assembled from chunks received for other toolchains?
+        if ( withChunks )
         {
-            continue; // file contents unexpected
+            const Array<const void *> noReceivedChunks;
+            bool corruptData = false;
+            if ( AssembleFileFromChunks( (uint32_t)i, noReceivedChunks, corruptData ) )
+            {
+                numFilesAlreadySynchronized++;
+            }
         }
-
-        // file present and ok
-        m_Files[ i ].SetFileLock( fileStream.ReleaseOwnership() ); // NOTE: keep file open to prevent deletions
-        m_Files[ i ].SetSyncState( ToolManifestFile::SYNCHRONIZED );
-        numFilesAlreadySynchronized++;
     }
 
     // Generate Environment
@@ -545,6 +640,68 @@ const void * ToolManifest::GetFileData( uint32_t fileId, size_t & dataSize ) con
     return m_Files[ fileId ].GetFileData( dataSize );
 }
 
+// PrepareChunks (ToolManifestFile)
+//------------------------------------------------------------------------------
+bool ToolManifestFile::PrepareChunks() const
+{
+    if ( m_ChunksPrepared )
+    {
+        return true;
+    }
+
+    // Load the file content
+    void * uncompressedContent;
+    uint32_t uncompressedContentSize;
+    if ( LoadFile( uncompressedContent, uncompressedContentSize ) == false )
+    {
+        return false; // LoadFile emits an error
+    }
+
+    // We should have previously recorded the uncompressed size
+    ASSERT( uncompressedContentSize == m_UncompressedContentSize );
+
+    StoreCompressedChunks( uncompressedContent, uncompressedContentSize );
+    FREE( uncompressedContent );
+    return true;
+}
+
+// GetChunkData (ToolManifestFile)
+//------------------------------------------------------------------------------
+const void * ToolManifestFile::GetChunkData( uint32_t chunkIndex, size_t & outDataSize ) const
+{
+    // Chunks are prepared when the manifest is sent
+    if ( m_ChunksPrepared == false )
+    {
+        return nullptr;
+    }
+
+    const ToolManifestChunk & chunk = m_Chunks[ chunkIndex ];
+    outDataSize = chunk.m_CompressedSize;
+    return ( static_cast<const char *>( m_CompressedChunks ) + chunk.m_CompressedOffset );
+}
+
+// PrepareLegacyHash (ToolManifestFile)
+//------------------------------------------------------------------------------
+bool ToolManifestFile::PrepareLegacyHash() const
+{
+    if ( m_LegacyHash != 0 )
+    {
+        return true;
+    }
+
+    // Load the file content
+    void * uncompressedContent;
+    uint32_t uncompressedContentSize;
+    if ( LoadFile( uncompressedContent, uncompressedContentSize ) == false )
+    {
+        return false; // LoadFile emits an error
+    }
+    m_LegacyHash = xxHash::Calc32( uncompressedContent, uncompressedContentSize );
+    m_LegacyHash = ( m_LegacyHash != 0 ) ? m_LegacyHash : 1; // Older workers reject 0 (in this unlikely case, they will re-fetch the file)
+    FREE( uncompressedContent );
+    return true;
+}
+
 // GetFileData (ToolManifestFile)
 //------------------------------------------------------------------------------
 const void * ToolManifestFile::GetFileData( size_t & outDataSize ) const
@@ -614,8 +771,182 @@ bool ToolManifest::ReceiveFileData( uint32_t fileId,
         outCorruptData = true;
         return false;
     }
-    const void * uncompressedData = c.GetResult();
-    const size_t uncompressedDataSize = c.GetResultSize();
+    return StoreFile( fileId, c.GetResult(), c.GetResultSize() );
+}
+
+// ReceiveFileChunks
+//------------------------------------------------------------------------------
+bool ToolManifest::ReceiveFileChunks( uint32_t fileId,
+                                      const void * data,
+                                      size_t dataSize,
+                                      bool & outCorruptData )
+{
+    PROFILE_FUNCTION;
+
+    MutexHolder mh( m_Mutex );
+
+    ToolManifestFile & f = m_Files[ fileId ];
+
+    // gracefully handle multiple receipts of the same data
+    if ( f.GetSyncState() == ToolManifestFile::SYNCHRONIZED )
+    {
+        return true;
+    }
+
+    ASSERT( f.GetSyncState() == ToolManifestFile::SYNCHRONIZING );
+
+    // Chunks received, by index within the file
+    const Array<ToolManifestChunk> & chunks = f.GetChunks();
+    Array<const void *> receivedChunks;
+    receivedChunks.SetSize( chunks.GetSize() );
+    for ( const void *& receivedChunk : receivedChunks )
+    {
+        receivedChunk = nullptr;
+    }
+    Array<UniquePtr<void, FreeDeletor>> receivedChunkData;
+
+    outCorruptData = true; // until proven otherwise
+    ConstMemoryStream ms( data, dataSize );
+    uint32_t numChunks = 0;
+    if ( ( ms.Read( numChunks ) == false ) || ( numChunks > chunks.GetSize() ) )
+    {
+        return false;
+    }
+    receivedChunkData.SetCapacity( numChunks );
+    for ( uint32_t i = 0; i < numChunks; ++i )
+    {
+        uint32_t chunkIndex = 0;
+        uint32_t compressedSize = 0;
+        if ( ( ms.Read( chunkIndex ) == false ) ||
+             ( ms.Read( compressedSize ) == false ) ||
+             ( chunkIndex >= chunks.GetSize() ) ||
+             ( compressedSize > ( ms.GetSize() - (size_t)ms.Tell() ) ) )
+        {
+            return false;
+        }
+        const void * compressedData = ( static_cast<const char *>( ms.GetData() ) + ms.Tell() );
+        ms.Seek( ms.Tell() + compressedSize );
+
+        // Chunk must have the expected content
+        const ToolManifestChunk & chunk = chunks[ chunkIndex ];
+        Compressor c;
+        if ( ( Compressor::IsValidData( compressedData, compressedSize ) == false ) ||
+             ( Compressor::GetUncompressedSize( compressedData, compressedSize ) != chunk.m_Size ) ||
+             ( c.Decompress( compressedData ) == false ) ||
+             ( xxHash3::Calc64( c.GetResult(), c.GetResultSize() ) != chunk.m_Hash ) )
+        {
+            return false;
+        }
+
+        // Keep for other toolchains (failure only prevents reuse)
+        ToolChunkStore::StoreChunk( chunk.m_Hash, compressedData, compressedSize );
+
+        receivedChunks[ chunkIndex ] = c.GetResult();
+        receivedChunkData.EmplaceBack( c.ReleaseResult() );
+    }
+
+    return AssembleFileFromChunks( fileId, receivedChunks, outCorruptData );
+}
+
+// IsFilePresent
+//  - Check for a file remaining from a previous run, locking it if present
+//------------------------------------------------------------------------------
+bool ToolManifest::IsFilePresent( uint32_t fileId, const AString & localFile )
+{
+    ToolManifestFile & file = m_Files[ fileId ];
+
+    UniquePtr<FileStream> fileStream( FNEW( FileStream ) );
+    FileStream & f = *( fileStream.Get() );
+    if ( f.Open( localFile.Get() ) == false )
+    {
+        return false; // file not found
+    }
+    if ( f.GetFileSize() != file.GetUncompressedContentSize() )
+    {
+        return false; // file is not complete
+    }
+    UniquePtr<char, FreeDeletor> mem( (char *)ALLOC( (size_t)f.GetFileSize() ) );
+    if ( f.Read( mem.Get(), (size_t)f.GetFileSize() ) != f.GetFileSize() )
+    {
+        return false; // problem reading file
+    }
+    const uint64_t hash = m_HasChunks ? xxHash3::Calc64( mem.Get(), (size_t)f.GetFileSize() )
+                                      : xxHash::Calc32( mem.Get(), (size_t)f.GetFileSize() );
+    if ( hash != file.GetHash() )
+    {
+        return false; // file contents unexpected
+    }
+
+    // file present and ok
+    file.SetFileLock( fileStream.ReleaseOwnership() ); // NOTE: keep file open to prevent deletions
+    file.SetSyncState( ToolManifestFile::SYNCHRONIZED );
+    return true;
+}
+
+// AssembleFileFromChunks
+//  - Chunks not received are taken from the ToolChunkStore. If any are not
+//    available, they are noted as missing (to be requested).
+//------------------------------------------------------------------------------
+bool ToolManifest::AssembleFileFromChunks( uint32_t fileId,
+                                           const Array<const void *> & receivedChunks,
+                                           bool & outCorruptData )
+{
+    PROFILE_FUNCTION;
+
+    outCorruptData = false;
+
+    ToolManifestFile & f = m_Files[ fileId ];
+    const Array<ToolManifestChunk> & chunks = f.GetChunks();
+    ASSERT( receivedChunks.IsEmpty() || ( receivedChunks.GetSize() == chunks.GetSize() ) );
+
+    const size_t fileSize = f.GetUncompressedContentSize();
+    UniquePtr<char, FreeDeletor> mem( (char *)ALLOC( Math::Max<size_t>( fileSize, 1 ) ) );
+    Array<uint32_t> & missingChunks = f.GetMissingChunks();
+    missingChunks.Clear();
+    size_t offset = 0;
+    const size_t numChunks = chunks.GetSize();
+    for ( size_t i = 0; i < numChunks; ++i )
+    {
+        const ToolManifestChunk & chunk = chunks[ i ];
+        const void * receivedChunk = receivedChunks.IsEmpty() ? nullptr : receivedChunks[ i ];
+        if ( receivedChunk )
+        {
+            memcpy( mem.Get() + offset, receivedChunk, chunk.m_Size );
+        }
+        else if ( ToolChunkStore::LoadChunk( chunk.m_Hash, chunk.m_Size, mem.Get() + offset ) == false )
+        {
+            missingChunks.Append( static_cast<uint32_t>( i ) );
+        }
+        offset += chunk.m_Size;
+    }
+    if ( missingChunks.IsEmpty() == false )
+    {
+        return false;
+    }
+
+    // Chunks are individually verified, so a mismatch means the manifest is inconsistent
+    if ( xxHash3::Calc64( mem.Get(), fileSize ) != f.GetHash() )
+    {
+        outCorruptData = true;
+    }
+    else if ( StoreFile( fileId, mem.Get(), fileSize ) )
+    {
+        return true;
+    }
+
+    // Everything must be requested (if we try again)
+    for ( size_t i = 0; i < numChunks; ++i )
+    {
+        missingChunks.Append( static_cast<uint32_t>( i ) );
+    }
+    return false;
+}
+
+// StoreFile
+//------------------------------------------------------------------------------
+bool ToolManifest::StoreFile( uint32_t fileId, const void * data, size_t dataSize )
+{
+    ToolManifestFile & f = m_Files[ fileId ];
 
     // prepare name for this file
     AStackString fileName;
@@ -634,7 +965,7 @@ bool ToolManifest::ReceiveFileData( uint32_t fileId,
     {
         return false; // FAILED
     }
-    if ( fs.Write( uncompressedData, uncompressedDataSize ) != uncompressedDataSize )
+    if ( fs.WriteBuffer( data, dataSize ) != dataSize )
     {
         return false; // FAILED
     }
@@ -12,12 +12,27 @@ class Node;
 // Includes
 //------------------------------------------------------------------------------
 #include "Core/Containers/Array.h"
+#include "Core/Containers/Move.h"
 #include "Core/Env/Types.h"
 #include "Core/Process/Mutex.h"
 #include "Core/Reflection/ReflectionMacros.h"
 #include "Core/Reflection/Struct.h"
 #include "Core/Strings/AString.h"
 
+// ToolManifestChunk
+//  - Part of a ToolManifestFile (see ToolChunkStore)
+//------------------------------------------------------------------------------
+class ToolManifestChunk
+{
+public:
+    uint64_t m_Hash = 0; // Of the uncompressed content
+    uint32_t m_Size = 0; // Uncompressed
+
+    // "local" members
+    uint32_t m_CompressedOffset = 0; // Within ToolManifestFile's compressed chunks
+    uint32_t m_CompressedSize = 0;
+};
+
 // ToolManifestFile
 //------------------------------------------------------------------------------
 class ToolManifestFile : public Struct
@@ -25,7 +40,7 @@ class ToolManifestFile : public Struct
     REFLECT_STRUCT_DECLARE( ToolManifestFile )
 public:
     ToolManifestFile();
-    explicit ToolManifestFile( const AString & name, uint64_t stamp, uint32_t hash, uint32_t size );
+    explicit ToolManifestFile( const AString & name, uint64_t stamp, uint64_t hash, uint32_t size );
     ~ToolManifestFile();
 
     enum SyncState
@@ -37,20 +52,29 @@ public:
 
     bool DoBuild();
     void StoreCompressedContent( const void * uncompressedData, const uint32_t uncompressedDataSize ) const;
+    void StoreCompressedChunks( const void * uncompressedData, const uint32_t uncompressedDataSize ) const;
     void Migrate( const ToolManifestFile & oldFile );
 
     const void * GetFileData( size_t & outDataSize ) const;
+    bool PrepareChunks() const;
+    const void * GetChunkData( uint32_t chunkIndex, size_t & outDataSize ) const;
+    bool PrepareLegacyHash() const;
 
     // Access state
     const AString & GetName() const { return m_Name; }
     uint64_t GetTimeStamp() const { return m_TimeStamp; }
-    uint32_t GetHash() const { return m_Hash; }
+    uint64_t GetHash() const { return m_Hash; }
+    uint32_t GetLegacyHash() const { return m_LegacyHash; }
     uint32_t GetUncompressedContentSize() const { return m_UncompressedContentSize; }
     SyncState GetSyncState() const { return m_SyncState; }
+    const Array<ToolManifestChunk> & GetChunks() const { return m_Chunks; }
+    const Array<uint32_t> & GetMissingChunks() const { return m_MissingChunks; }
 
     // Modify state
     void SetSyncState( SyncState state ) { m_SyncState = state; }
     void SetFileLock( FileStream * fileLock ) { m_FileLock = fileLock; }
+    void SetChunks( Array<ToolManifestChunk> && chunks ) { m_Chunks = Move( chunks ); }
+    Array<uint32_t> & GetMissingChunks() { return m_MissingChunks; }
 
 protected:
     bool LoadFile( void *& uncompressedContent, uint32_t & uncompressedContentSize ) const;
@@ -58,16 +82,21 @@ protected:
     // common members
     AString m_Name;
     uint64_t m_TimeStamp = 0;
-    uint32_t m_Hash = 0;
+    uint64_t m_Hash = 0;
     mutable uint32_t m_UncompressedContentSize = 0;
     mutable uint32_t m_CompressedContentSize = 0;
+    mutable Array<ToolManifestChunk> m_Chunks;
 
     // "local" members
     mutable void * m_CompressedContent = nullptr;
+    mutable void * m_CompressedChunks = nullptr;
+    mutable bool m_ChunksPrepared = false;
+    mutable uint32_t m_LegacyHash = 0; // 32-bit hash for workers prior to v22.11
 
     // "remote" members
     SyncState m_SyncState = NOT_SYNCHRONIZED;
     FileStream * m_FileLock = nullptr; // keep the file locked when sync'd
+    Array<uint32_t> m_MissingChunks; // not in the worker's ToolChunkStore
 };
 
 // ToolManifest
@@ -87,8 +116,10 @@ public:
     uint64_t GetToolId() const { return m_ToolId; }
     uint64_t GetTimeStamp() const { return m_TimeStamp; }
 
-    void SerializeForRemote( IOStream & ms ) const;
-    bool DeserializeFromRemote( IOStream & ms );
+    // withChunks: peer supports 64-bit hashes and file chunks (v22.11 or later)
+    bool SerializeForRemote( IOStream & ms, bool withChunks ) const;
+    bool DeserializeFromRemote( IOStream & ms, bool withChunks );
+    bool HasChunks() const { return m_HasChunks; }
 
     bool IsSynchronized() const { return m_Synchronized; }
     bool GetSynchronizationStatus( uint32_t & syncDone, uint32_t & syncTotal ) const;
@@ -112,6 +143,7 @@ public:
 
     const void * GetFileData( uint32_t fileId, size_t & dataSize ) const;
     bool ReceiveFileData( uint32_t fileId, const void * data, size_t & dataSize, bool & outCorruptData );
+    bool ReceiveFileChunks( uint32_t fileId, const void * data, size_t dataSize, bool & outCorruptData );
 
     void GetRemotePath( AString & path ) const;
     void GetRemoteFilePath( uint32_t fileId, AString & exe ) const;
@@ -124,6 +156,10 @@ public:
 #endif
 
 private:
+    bool IsFilePresent( uint32_t fileId, const AString & localFile );
+    bool AssembleFileFromChunks( uint32_t fileId, const Array<const void *> & receivedChunks, bool & outCorruptData );
+    bool StoreFile( uint32_t fileId, const void * data, size_t dataSize );
+
     mutable Mutex m_Mutex;
 
     // Reflected
@@ -135,6 +171,7 @@ private:
 
     // Internal state
     bool m_Synchronized;
+    bool m_HasChunks; // Files described with chunks
     const char * m_RemoteEnvironmentString;
     void * m_UserData;
 };
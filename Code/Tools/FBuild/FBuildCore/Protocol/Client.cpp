@@ -13,6 +13,8 @@
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompressionDictionary.h"
+#include "Tools/FBuild/FBuildCore/Helpers/HeaderFragmentStore.h"
 #include "Tools/FBuild/FBuildCore/Helpers/MultiBuffer.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
@@ -27,11 +29,20 @@
 #include "Core/Process/Atomic.h"
 #include "Core/Profile/Profile.h"
 
+// system
+#include <string.h> // for memcpy
+
 // Defines
 //------------------------------------------------------------------------------
 #define CLIENT_STATUS_UPDATE_FREQUENCY_SECONDS ( 0.1f )
 #define CONNECTION_REATTEMPT_DELAY_TIME ( 10.0f )
 #define SYSTEM_ERROR_ATTEMPT_COUNT ( 3u )
+#define SERVER_STATUS_REFRESH_SECONDS ( 1.0f )
+#define TOOLCHAIN_PREPARE_INTERVAL_SECONDS ( 0.5f ) // Limit rate of speculative toolchain synchronization
+#define TOOLCHAIN_PREPARE_MAX_PER_WORKER ( 4u )
+#define WORKER_RECYCLE_INTERVAL_SECONDS ( 10.0f )
+#define WORKER_RTT_SCALE_MS ( 20.0f ) // Round trip time at which a worker is half as attractive
+#define WORKER_LOW_MEMORY_MIB ( 1024u ) // Free memory below which a worker is half as attractive
 #define DIST_INFO( ... ) do { if ( m_DetailedLogging ) { FLOG_OUTPUT( __VA_ARGS__ ); } } while ( false )
 
 //------------------------------------------------------------------------------
@@ -47,6 +58,17 @@ public:
     bool m_DenyListed = false; // Misbehaving workers are disabled for the rest of the build
     uint32_t m_UniqueId = 0; // Index for profiling purposes
 
+    // Load and latency, as last reported by (or measured for) the worker. This
+    // persists between connections to inform which workers to prefer.
+    Atomic<bool> m_HasServerStatus{ false }; // Have we ever received a MsgServerStatus?
+    Atomic<uint32_t> m_NumCPUsAvailable{ 0 }; // CPUs not in use by other Clients
+    Atomic<uint32_t> m_FreeMemoryMiB{ 0 };
+    Atomic<uint32_t> m_IdlePercent{ 0 };
+    Atomic<uint32_t> m_RoundTripTimeUS{ 0 }; // Smoothed (0 = not measured yet)
+
+    void RecordRoundTripTime( int64_t startTime, int64_t endTime );
+    [[nodiscard]] float GetScore() const;
+
     // Static Data
     static inline Atomic<uint32_t> s_NumConnections{ 0 }; // Track current number of connections
 };
@@ -70,6 +92,15 @@ public:
     {
         VERIFY( m_Message.WriteBuffer( &msg, msg.GetSize() ) == msg.GetSize() );
     }
+    explicit ClientSendQueueItem( const Protocol::IMessage & msg,
+                                  ConstMemoryStream && payload,
+                                  Array<TCPConnectionPool::SendBuffer> && payloadInserts,
+                                  Array<uint32_t> && payloadInsertOffsets )
+        : ClientSendQueueItem( msg, Move( payload ) )
+    {
+        m_PayloadInserts = Move( payloadInserts );
+        m_PayloadInsertOffsets = Move( payloadInsertOffsets );
+    }
 
     // non copyable
     explicit ClientSendQueueItem( const ClientSendQueueItem & other ) = delete;
@@ -79,9 +110,31 @@ public:
     explicit ClientSendQueueItem( ClientSendQueueItem && other ) = default;
     ClientSendQueueItem & operator=( ClientSendQueueItem && other ) = default;
 
+    // Gather the payload, with each insert placed at its offset
+    void GetPayloadBuffers( Array<TCPConnectionPool::SendBuffer> & outBuffers ) const
+    {
+        const uint8_t * payload = static_cast<const uint8_t *>( m_Payload.GetData() );
+        uint32_t offset = 0;
+        for ( size_t i = 0; i < m_PayloadInserts.GetSize(); ++i )
+        {
+            const uint32_t insertOffset = m_PayloadInsertOffsets[ i ];
+            ASSERT( insertOffset >= offset );
+            outBuffers.Append( { insertOffset - offset, payload + offset } );
+            outBuffers.Append( m_PayloadInserts[ i ] );
+            offset = insertOffset;
+        }
+        outBuffers.Append( { static_cast<uint32_t>( m_Payload.GetSize() ) - offset, payload + offset } );
+    }
+
     MemoryStream m_Message;
     bool m_HasPayload = false;
     ConstMemoryStream m_Payload;
+
+    // Data sent from where it is rather than being copied into the payload
+    // (which must remain valid until sent). Each insert goes at the matching
+    // offset of the payload.
+    Array<TCPConnectionPool::SendBuffer> m_PayloadInserts;
+    Array<uint32_t> m_PayloadInsertOffsets;
 };
 
 //------------------------------------------------------------------------------
@@ -102,11 +155,23 @@ public:
     ClientWorkerInfo * GetWorker() const { return m_Worker; }
 
     Atomic<uint32_t> m_NumJobsAvailableSentToClient{ 0 }; // num jobs we've told this server we have available
+    Atomic<uint32_t> m_NumCPUsReservedForBetterWorkers{ 0 }; // spare CPUs of workers to prefer when jobs are scarce
+    Atomic<bool> m_HasServerStatus{ false }; // Status received for this connection (and still connected)
+    Timer m_StatusRequestTimer; // Time since MsgStatus last queued (Client thread only)
+    Timer m_PrepareToolchainTimer; // Time since MsgPrepareToolchain last queued (Client thread only)
+
+    [[nodiscard]] uint32_t GetNumJobsInFlight() const;
+    void PrepareToolchain( const Array<const ToolManifest *> & manifests );
 
     template <class T>
     void EnqueueSend( const T & msg );
     template <class T>
     void EnqueueSend( const T & msg, ConstMemoryStream && payload );
+    template <class T>
+    void EnqueueSend( const T & msg,
+                      ConstMemoryStream && payload,
+                      Array<TCPConnectionPool::SendBuffer> && payloadInserts,
+                      Array<uint32_t> && payloadInsertOffsets );
     void EnqueueSendJobAvailability( uint32_t numAvailable );
 
 private:
@@ -114,14 +179,22 @@ private:
     virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory ) override;
 
     void Process( const Protocol::MsgRequestJob * msg );
+    void Process( const Protocol::MsgRequestJobs * msg );
     void Process( const Protocol::MsgJobResult *, const void * payload, size_t payloadSize );
     void Process( const Protocol::MsgJobResultCompressed * msg, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgRequestManifest * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgRequestFile * msg );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgRequestFileChunks * msg, const void * payload, size_t payloadSize );
     void Process( const Protocol::MsgConnectionAck * msg );
+    void Process( const Protocol::MsgServerStatus * msg );
 
     void ProcessJobResultCommon( bool isCompressed, const void * payload, size_t payloadSize );
 
+    const Job * GetJobToSend( MemoryStream & outStream,
+                              Array<TCPConnectionPool::SendBuffer> & outData,
+                              uint64_t & outToolId,
+                              int16_t & outResultCompressionLevel );
+
     const ToolManifest * FindManifest( uint64_t toolId ) const;
     bool WriteFileToDisk( const AString & fileName, const MultiBuffer & multiBuffer, size_t index ) const;
 
@@ -138,6 +211,9 @@ private:
     mutable Mutex m_Mutex;
     const Protocol::IMessage * m_CurrentMessage = nullptr;
     Array<Job *> m_Jobs; // jobs we've sent to this server
+    const CompressionDictionary * m_SentDictionary = nullptr; // dictionary this server has for decompressing jobs
+    Array<uint64_t> m_SentHeaderFragments; // bit per HeaderFragment::m_Index sent to this server
+    Array<const ToolManifest *> m_PreparedToolManifests; // toolchains this server was asked to synchronize ahead of jobs
 
     // Send Thread
     Thread m_SendThread;
@@ -149,12 +225,49 @@ private:
     Atomic<uint16_t> m_WorkerVersion;
     Atomic<uint8_t> m_ProtocolVersionMinor;
 
+    // Round trip time measurement. MsgConnection and each MsgStatus are
+    // answered in order with a MsgServerStatus, so replies can be matched by
+    // counting. Only one message is timed at a time.
+    Atomic<int64_t> m_ConnectionSendTime; // For the MsgConnectionAck
+    Atomic<uint32_t> m_NumStatusSent; // Send thread
+    Atomic<uint32_t> m_NumServerStatusReceived; // Receive thread
+    Atomic<uint32_t> m_TimedStatusIndex{ 0xFFFFFFFF };
+    Atomic<int64_t> m_TimedStatusSendTime;
+
     // Queue of messages to send
     Mutex m_SendQueueMutex;
     ClientSendQueueItem m_MsgStatus;
     Array<ClientSendQueueItem> m_SendQueue;
 };
 
+// RecordRoundTripTime
+//------------------------------------------------------------------------------
+void ClientWorkerInfo::RecordRoundTripTime( int64_t startTime, int64_t endTime )
+{
+    const float rttMS = ( static_cast<float>( endTime - startTime ) * Timer::GetFrequencyInvFloatMS() );
+    const uint32_t rttUS = Math::Max( static_cast<uint32_t>( rttMS * 1000.0f ), 1u );
+
+    // Smooth out the odd slow response
+    const uint32_t previousRttUS = m_RoundTripTimeUS.Load();
+    m_RoundTripTimeUS.Store( previousRttUS ? static_cast<uint32_t>( ( ( static_cast<uint64_t>( previousRttUS ) * 7 ) + rttUS ) / 8 ) : rttUS );
+}
+
+// GetScore
+//  - How attractive a worker is: Many available CPUs, idle and close by
+//------------------------------------------------------------------------------
+float ClientWorkerInfo::GetScore() const
+{
+    float score = static_cast<float>( m_NumCPUsAvailable.Load() );
+    score *= ( 0.5f + ( static_cast<float>( m_IdlePercent.Load() ) * 0.005f ) );
+    if ( m_FreeMemoryMiB.Load() < WORKER_LOW_MEMORY_MIB )
+    {
+        score *= 0.5f;
+    }
+    const float rttMS = ( static_cast<float>( m_RoundTripTimeUS.Load() ) / 1000.0f );
+    score /= ( 1.0f + ( rttMS / WORKER_RTT_SCALE_MS ) );
+    return score;
+}
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 Client::Client( const Array<AString> & explicitWorkerList,
@@ -193,17 +306,9 @@ uint32_t Client::GetNumConnections() const
 {
     MutexHolder mh( m_Mutex );
     DIST_INFO( "Disconnected: %s\n", m_Worker->m_Address.Get() );
-    if ( m_Jobs.IsEmpty() == false )
-    {
-        for ( Job * job : m_Jobs )
-        {
-            FLOG_MONITOR( "FINISH_JOB TIMEOUT %s \"%s\" \n",
-                          m_Worker->m_Address.Get(),
-                          job->GetNode()->GetName().Get() );
-            JobQueue::Get().ReturnUnfinishedDistributableJob( job );
-        }
-        m_Jobs.Clear();
-    }
+
+    // No longer a candidate for jobs
+    m_HasServerStatus.Store( false );
 
     // This is usually null here, but might need to be freed if
     // we had the connection drop between message and payload
@@ -221,6 +326,20 @@ uint32_t Client::GetNumConnections() const
     {
         Thread::Sleep( 1 );
     }
+
+    // Return in-flight jobs. This must happen after the send thread is done
+    // as job data is sent directly from the jobs.
+    if ( m_Jobs.IsEmpty() == false )
+    {
+        for ( Job * job : m_Jobs )
+        {
+            FLOG_MONITOR( "FINISH_JOB TIMEOUT %s \"%s\" \n",
+                          m_Worker->m_Address.Get(),
+                          job->GetNode()->GetName().Get() );
+            JobQueue::Get().ReturnUnfinishedDistributableJob( job );
+        }
+        m_Jobs.Clear();
+    }
 }
 
 // ThreadFuncStatic
@@ -256,6 +375,9 @@ void Client::ThreadFunc()
             break;
         }
 
+        // Decide which workers to prefer when jobs are scarce
+        UpdateWorkerPreference();
+
         // Ensure workers are updated with the state of available work
         CommunicateJobAvailability();
         if ( m_ShouldExit.Load() )
@@ -263,6 +385,9 @@ void Client::ThreadFunc()
             break;
         }
 
+        // Start toolchain synchronization before jobs are sent
+        PrepareToolchains();
+
         Thread::Sleep( 1 );
         if ( m_ShouldExit.Load() )
         {
@@ -298,7 +423,7 @@ void Client::FindPotentialWorkers()
         // check for workers through brokerage or environment
         StackArray<AString> discoveredWorkers;
         m_WorkerBrokerage.FindWorkers( discoveredWorkers );
-        RegisterFoundWorkers( discoveredWorkers, &m_WorkerBrokerage.GetBrokerageRootPaths() );
+        RegisterFoundWorkers( discoveredWorkers, &m_WorkerBrokerage.GetWorkerSource() );
     }
 }
 
@@ -363,25 +488,64 @@ void Client::ConnectToWorkers()
         }
     }
 
+    // Make room for a better worker if we're at the connection limit
+    if ( numConnections >= m_WorkerConnectionLimit )
+    {
+        RecycleWorstConnection( numConnections );
+        return;
+    }
+
     // Find someone to connect to
-    for ( size_t i = 0; i < m_WorkerPool.GetSize(); i++ )
+    while ( ( numConnections < m_WorkerConnectionLimit ) &&
+            ( numConnections < m_WorkerPool.GetSize() ) )
     {
-        // Limit maximum concurrent connections
-        if ( numConnections >= m_WorkerConnectionLimit )
+        ClientWorkerInfo * worker = FindWorkerToConnectTo();
+        if ( worker == nullptr )
         {
-            return;
+            return; // nobody available
         }
 
-        // If we're connected to every possible worker already
-        if ( numConnections >= m_WorkerPool.GetSize() )
+        // Initiate new connection
+        m_ActiveConnections.EmplaceBack( FNEW( ClientToWorkerConnection( this,
+                                                                         m_DetailedLogging,
+                                                                         worker ) ) );
+
+        // Mark worker as in use
+        worker->m_InUse = true;
+
+        // Track add
+        numConnections++;
+    }
+}
+
+// FindWorkerToConnectTo
+//  - Prefer workers which were the most attractive when last connected.
+//    Workers we know nothing about yet are ranked as an average worker, and
+//    ties are broken by the randomized order, to spread Clients across workers.
+//------------------------------------------------------------------------------
+ClientWorkerInfo * Client::FindWorkerToConnectTo()
+{
+    // Average score of workers we know about
+    float totalScore = 0.0f;
+    uint32_t numScores = 0;
+    for ( const UniquePtr<ClientWorkerInfo> & worker : m_WorkerPool )
+    {
+        if ( worker->m_HasServerStatus.Load() )
         {
-            return;
+            totalScore += worker->GetScore();
+            ++numScores;
         }
+    }
+    const float averageScore = numScores ? ( totalScore / static_cast<float>( numScores ) ) : 0.0f;
 
-        // Get the next worker to potentially connect to, using the offset
-        // into the list and wrapping around
-        ClientWorkerInfo & worker = *m_WorkerPool[ m_NextWorkerIndex++ ].Get();
-        m_NextWorkerIndex = ( m_NextWorkerIndex % m_WorkerPool.GetSize() );
+    const size_t numWorkers = m_WorkerPool.GetSize();
+    size_t bestIndex = numWorkers;
+    float bestScore = -1.0f;
+    for ( size_t i = 0; i < numWorkers; ++i )
+    {
+        // Start at the offset into the list and wrap around
+        const size_t index = ( ( m_NextWorkerIndex + i ) % numWorkers );
+        const ClientWorkerInfo & worker = *m_WorkerPool[ index ].Get();
 
         // Already connected? (or still in the process of connecting)
         if ( worker.m_InUse == true )
@@ -401,16 +565,140 @@ void Client::ConnectToWorkers()
             continue;
         }
 
-        // Initiate new connection
-        m_ActiveConnections.EmplaceBack( FNEW( ClientToWorkerConnection( this,
-                                                                         m_DetailedLogging,
-                                                                         &worker ) ) );
+        const float score = worker.m_HasServerStatus.Load() ? worker.GetScore() : averageScore;
+        if ( score > bestScore )
+        {
+            bestScore = score;
+            bestIndex = index;
+        }
+    }
 
-        // Mark worker as in use
-        worker.m_InUse = true;
+    if ( bestIndex == numWorkers )
+    {
+        return nullptr;
+    }
 
-        // Track add
-        numConnections++;
+    // Continue from the next worker for subsequent connections
+    m_NextWorkerIndex = static_cast<uint32_t>( ( bestIndex + 1 ) % numWorkers );
+    return m_WorkerPool[ bestIndex ].Get();
+}
+
+// RecycleWorstConnection
+//  - When at the connection limit, drop the least attractive idle connection
+//    if a much better (or untried) worker could be connected to instead.
+//------------------------------------------------------------------------------
+void Client::RecycleWorstConnection( size_t numConnections )
+{
+    // Only if there are other workers, and not too often
+    if ( ( numConnections >= m_WorkerPool.GetSize() ) ||
+         ( m_WorkerRecycleTimer.GetElapsed() < WORKER_RECYCLE_INTERVAL_SECONDS ) )
+    {
+        return;
+    }
+    m_WorkerRecycleTimer.Restart();
+
+    // Find the least attractive connection with no jobs in flight
+    ClientToWorkerConnection * worst = nullptr;
+    float worstScore = 0.0f;
+    for ( UniquePtr<ClientToWorkerConnection> & connection : m_ActiveConnections )
+    {
+        if ( ( connection->m_HasServerStatus.Load() == false ) ||
+             ( connection->GetNumJobsInFlight() > 0 ) )
+        {
+            continue;
+        }
+        const float score = connection->GetWorker()->GetScore();
+        if ( ( worst == nullptr ) || ( score < worstScore ) )
+        {
+            worst = connection.Get();
+            worstScore = score;
+        }
+    }
+    if ( worst == nullptr )
+    {
+        return;
+    }
+
+    // Is there a worker worth replacing it with?
+    const uint32_t nextWorkerIndex = m_NextWorkerIndex;
+    const ClientWorkerInfo * candidate = FindWorkerToConnectTo();
+    m_NextWorkerIndex = nextWorkerIndex; // Don't disturb the order of connection attempts
+    if ( candidate == nullptr )
+    {
+        return;
+    }
+    if ( candidate->m_HasServerStatus.Load() )
+    {
+        if ( candidate->GetScore() <= ( worstScore * 2.0f ) )
+        {
+            return; // Not enough better to be worth it
+        }
+    }
+    else if ( worstScore > 0.0f )
+    {
+        return; // Only give up a usable worker to try an unknown one
+    }
+
+    // Disconnect (the connection is cleaned up when complete) and don't
+    // reconnect to it for a while
+    DIST_INFO( "Disconnecting from %s to connect to a better worker\n", worst->GetWorker()->m_Address.Get() );
+    worst->GetWorker()->m_ConnectionDelayTimer.Restart();
+    worst->ShutdownAllConnections();
+}
+
+// UpdateWorkerPreference
+//  - While jobs are scarce, jobs requested by a worker are held back for
+//    better workers with spare CPUs, instead of being handed out in whatever
+//    order workers ask for them.
+//------------------------------------------------------------------------------
+void Client::UpdateWorkerPreference()
+{
+    if ( m_WorkerPreferenceTimer.GetElapsed() < CLIENT_STATUS_UPDATE_FREQUENCY_SECONDS )
+    {
+        return;
+    }
+    m_WorkerPreferenceTimer.Restart();
+
+    PROFILE_FUNCTION;
+
+    // Score and spare CPUs of each connection with a known status
+    const size_t numConnections = m_ActiveConnections.GetSize();
+    StackArray<float> scores;
+    StackArray<uint32_t> spareCPUs;
+    scores.SetSize( numConnections );
+    spareCPUs.SetSize( numConnections );
+    for ( size_t i = 0; i < numConnections; ++i )
+    {
+        const ClientToWorkerConnection & connection = *m_ActiveConnections[ i ].Get();
+        if ( connection.m_HasServerStatus.Load() == false )
+        {
+            scores[ i ] = -1.0f;
+            spareCPUs[ i ] = 0;
+            continue;
+        }
+        const uint32_t numCPUs = connection.GetWorker()->m_NumCPUsAvailable.Load();
+        const uint32_t numJobsInFlight = connection.GetNumJobsInFlight();
+        scores[ i ] = connection.GetWorker()->GetScore();
+        spareCPUs[ i ] = ( numCPUs > numJobsInFlight ) ? ( numCPUs - numJobsInFlight ) : 0;
+    }
+
+    // Reserve the spare CPUs of all better workers
+    for ( size_t i = 0; i < numConnections; ++i )
+    {
+        uint32_t reserved = 0;
+        if ( scores[ i ] >= 0.0f ) // Workers without a status are unaffected
+        {
+            for ( size_t j = 0; j < numConnections; ++j )
+            {
+                const bool better = ( scores[ j ] > scores[ i ] ) ||
+                                    ( ( scores[ j ] == scores[ i ] ) && ( j < i ) );
+                if ( better )
+                {
+                    reserved += spareCPUs[ j ];
+                }
+            }
+        }
+        m_ActiveConnections[ i ]->m_NumCPUsReservedForBetterWorkers.Store( reserved );
     }
 }
 
@@ -456,9 +744,18 @@ void Client::CommunicateJobAvailability()
             sendAvailabilityToWorker = true;
         }
 
+        // Workers reply with their load, which we want to keep up to date
+        // even when our state doesn't change
+        if ( ( ss->m_HasServerStatus.Load() ) &&
+             ( ss->m_StatusRequestTimer.GetElapsed() >= SERVER_STATUS_REFRESH_SECONDS ) )
+        {
+            sendAvailabilityToWorker = true;
+        }
+
         if ( sendAvailabilityToWorker )
         {
             ss->EnqueueSendJobAvailability( numJobsAvailable );
+            ss->m_StatusRequestTimer.Restart();
         }
     }
 
@@ -469,6 +766,42 @@ void Client::CommunicateJobAvailability()
     }
 }
 
+// PrepareToolchains
+//------------------------------------------------------------------------------
+void Client::PrepareToolchains()
+{
+    PROFILE_FUNCTION;
+
+    // Workers only learn about a toolchain when a job which needs it arrives,
+    // so the first jobs on each worker would wait for the whole toolchain to
+    // be transferred (often losing the race to be built locally). Instead,
+    // workers are asked to synchronize the toolchains with the most jobs
+    // waiting as soon as they are connected.
+    Array<const ToolManifest *> manifests;
+    bool manifestsGathered = false;
+    for ( UniquePtr<ClientToWorkerConnection> & ss : m_ActiveConnections )
+    {
+        // One toolchain at a time per worker. The check is also rate limited
+        // when there's nothing to prepare, as gathering manifests locks the
+        // JobQueue.
+        if ( ss->m_PrepareToolchainTimer.GetElapsed() < TOOLCHAIN_PREPARE_INTERVAL_SECONDS )
+        {
+            continue;
+        }
+        ss->m_PrepareToolchainTimer.Restart();
+
+        if ( manifestsGathered == false )
+        {
+            JobQueue::Get().GetToolManifestsForDistributableJobs( manifests );
+            manifestsGathered = true;
+        }
+        if ( manifests.IsEmpty() == false )
+        {
+            ss->PrepareToolchain( manifests );
+        }
+    }
+}
+
 // OnReceive
 //------------------------------------------------------------------------------
 /*virtual*/ void ClientToWorkerConnection::OnReceive( const ConnectionInfo * connection,
@@ -512,6 +845,12 @@ void Client::CommunicateJobAvailability()
             Process( msg );
             break;
         }
+        case Protocol::MSG_REQUEST_JOBS:
+        {
+            const Protocol::MsgRequestJobs * msg = static_cast<const Protocol::MsgRequestJobs *>( imsg );
+            Process( msg );
+            break;
+        }
         case Protocol::MSG_JOB_RESULT:
         {
             const Protocol::MsgJobResult * msg = static_cast<const Protocol::MsgJobResult *>( imsg );
@@ -536,12 +875,24 @@ void Client::CommunicateJobAvailability()
             Process( connection, msg );
             break;
         }
+        case Protocol::MSG_REQUEST_FILE_CHUNKS:
+        {
+            const Protocol::MsgRequestFileChunks * msg = static_cast<const Protocol::MsgRequestFileChunks *>( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
         case Protocol::MSG_CONNECTION_ACK:
         {
             const Protocol::MsgConnectionAck * msg = static_cast<const Protocol::MsgConnectionAck *>( imsg );
             Process( msg );
             break;
         }
+        case Protocol::MSG_SERVER_STATUS:
+        {
+            const Protocol::MsgServerStatus * msg = static_cast<const Protocol::MsgServerStatus *>( imsg );
+            Process( msg );
+            break;
+        }
         default:
         {
             // unknown message type
@@ -564,13 +915,109 @@ void ClientToWorkerConnection::Process( const Protocol::MsgRequestJob * )
 {
     PROFILE_SECTION( "MsgRequestJob" );
 
-    // no jobs for deny listed workers
-    if ( m_Worker->m_DenyListed )
+    MemoryStream stream;
+    Array<TCPConnectionPool::SendBuffer> jobData;
+    uint64_t toolId;
+    int16_t resultCompressionLevel;
+    const Job * job = GetJobToSend( stream, jobData, toolId, resultCompressionLevel );
+    if ( job == nullptr )
     {
+        // tell the client we don't have anything right now
+        // (we completed or gave away the job already)
         EnqueueSend( Protocol::MsgNoJobAvailable() );
         return;
     }
 
+    // The job data follows the header, and is sent without copying it
+    Array<uint32_t> insertOffsets;
+    insertOffsets.SetSize( jobData.GetSize() );
+    for ( uint32_t & insertOffset : insertOffsets )
+    {
+        insertOffset = static_cast<uint32_t>( stream.GetSize() );
+    }
+
+    EnqueueSend( Protocol::MsgJob( toolId, resultCompressionLevel ),
+                 Move( ConstMemoryStream( Move( stream ) ) ),
+                 Move( jobData ),
+                 Move( insertOffsets ) );
+}
+
+// Process( MsgRequestJobs )
+//------------------------------------------------------------------------------
+void ClientToWorkerConnection::Process( const Protocol::MsgRequestJobs * msg )
+{
+    PROFILE_SECTION( "MsgRequestJobs" );
+
+    // Send as many jobs as we have, up to the requested number, in a single message.
+    // The job count is patched once known. The data for each job follows its header
+    // and is sent without copying it.
+    MemoryStream stream;
+    Array<TCPConnectionPool::SendBuffer> inserts;
+    Array<uint32_t> insertOffsets;
+    uint32_t numJobs = 0;
+    stream.Write( numJobs );
+
+    // While jobs are scarce, leave them for better workers with spare CPUs
+    // (they'll request them shortly, and we'll be asked again if not)
+    uint32_t numJobsToSend = msg->GetNumJobs();
+    const uint32_t numCPUsReserved = m_NumCPUsReservedForBetterWorkers.Load();
+    if ( numCPUsReserved > 0 )
+    {
+        const uint32_t numJobsAvailable = static_cast<uint32_t>( JobQueue::Get().GetNumDistributableJobsAvailable() );
+        numJobsToSend = ( numJobsAvailable > numCPUsReserved ) ? Math::Min( numJobsToSend, numJobsAvailable - numCPUsReserved ) : 0;
+    }
+
+    while ( numJobs < numJobsToSend )
+    {
+        MemoryStream jobStream;
+        Array<TCPConnectionPool::SendBuffer> jobData;
+        uint64_t toolId;
+        int16_t resultCompressionLevel;
+        const Job * job = GetJobToSend( jobStream, jobData, toolId, resultCompressionLevel );
+        if ( job == nullptr )
+        {
+            break; // no more jobs right now
+        }
+
+        uint32_t jobDataSize = 0;
+        for ( const TCPConnectionPool::SendBuffer & buffer : jobData )
+        {
+            jobDataSize += buffer.size;
+        }
+
+        stream.Write( toolId );
+        stream.Write( resultCompressionLevel );
+        stream.Write( static_cast<uint32_t>( jobStream.GetSize() + jobDataSize ) );
+        stream.WriteBuffer( jobStream.GetData(), jobStream.GetSize() );
+        for ( const TCPConnectionPool::SendBuffer & buffer : jobData )
+        {
+            inserts.Append( buffer );
+            insertOffsets.Append( static_cast<uint32_t>( stream.GetSize() ) );
+        }
+        ++numJobs;
+    }
+    memcpy( stream.GetDataMutable(), &numJobs, sizeof( numJobs ) );
+
+    // Respond even if we have no jobs, to return the credit
+    EnqueueSend( Protocol::MsgJobs( msg->GetNumJobs() ),
+                 Move( ConstMemoryStream( Move( stream ) ) ),
+                 Move( inserts ),
+                 Move( insertOffsets ) );
+}
+
+// GetJobToSend
+//------------------------------------------------------------------------------
+const Job * ClientToWorkerConnection::GetJobToSend( MemoryStream & outStream,
+                                                    Array<TCPConnectionPool::SendBuffer> & outData,
+                                                    uint64_t & outToolId,
+                                                    int16_t & outResultCompressionLevel )
+{
+    // no jobs for deny listed workers
+    if ( m_Worker->m_DenyListed )
+    {
+        return nullptr;
+    }
+
     // Some jobs require Server (Worker) changes which can be validated by
     // comparing the minor protocol version.
     const uint8_t workerMinorProtocolVersion = m_ProtocolVersionMinor.Load();
@@ -580,18 +1027,62 @@ void ClientToWorkerConnection::Process( const Protocol::MsgRequestJob * )
     if ( job == nullptr )
     {
         PROFILE_SECTION( "NoJob" );
-        // tell the client we don't have anything right now
-        // (we completed or gave away the job already)
-        EnqueueSend( Protocol::MsgNoJobAvailable() );
-        return;
+        return nullptr;
     }
 
-    // send the job to the client
-    MemoryStream stream;
-    job->Serialize( stream );
-
     MutexHolder mh( m_Mutex );
 
+    // The worker can use its cache (which should be the same shared cache) for
+    // cacheable jobs. Results stored by the worker don't need to be uploaded
+    // again by us.
+    uint8_t remoteCacheFlags = 0;
+    if ( ( workerMinorProtocolVersion >= 9 ) && ( job->GetCacheName().IsEmpty() == false ) )
+    {
+        const FBuildOptions & options = FBuild::Get().GetOptions();
+        if ( options.m_UseCacheRead )
+        {
+            remoteCacheFlags |= Job::REMOTE_CACHE_READ;
+        }
+        if ( options.m_UseCacheWrite && ( options.m_CacheDedup == false ) ) // Worker can't store deduplicated entries
+        {
+            remoteCacheFlags |= Job::REMOTE_CACHE_WRITE;
+        }
+    }
+
+    // serialize the job for sending (the data is sent separately, from where it is)
+    const Array<const HeaderFragment *> & fragments = job->GetHeaderFragments();
+    if ( ( fragments.IsEmpty() == false ) && ( workerMinorProtocolVersion >= 8 ) )
+    {
+        // Only fragments this server doesn't already have are sent (listed
+        // in the manifest which follows the header)
+        MemoryStream manifest;
+        Array<const HeaderFragment *> fragmentsToSend;
+        const uint32_t dataSize = HeaderFragmentStore::WriteFragments( fragments, m_SentHeaderFragments, manifest, fragmentsToSend );
+        job->SerializeHeaderForHeaderFragments( outStream, dataSize, remoteCacheFlags );
+        outStream.WriteBuffer( manifest.GetData(), manifest.GetSize() );
+        for ( const HeaderFragment * fragment : fragmentsToSend )
+        {
+            outData.Append( { fragment->m_CompressedSize, fragment->m_CompressedData } );
+        }
+    }
+    else
+    {
+        job->SerializeHeader( outStream, remoteCacheFlags );
+        outData.Append( { static_cast<uint32_t>( job->GetDataSize() ), job->GetData() } );
+
+        // If the job was compressed against a dictionary, the server needs the
+        // dictionary first. Queuing it now places it ahead of the job.
+        const CompressionDictionary * dictionary = job->GetCompressionDictionary();
+        if ( dictionary && ( dictionary != m_SentDictionary ) )
+        {
+            MemoryStream dictionaryStream( dictionary->GetDataSize() );
+            dictionaryStream.WriteBuffer( dictionary->GetData(), dictionary->GetDataSize() );
+            EnqueueSend( Protocol::MsgCompressionDictionary( dictionary->GetId() ),
+                         Move( ConstMemoryStream( Move( dictionaryStream ) ) ) );
+            m_SentDictionary = dictionary;
+        }
+    }
+
     m_Jobs.Append( job ); // Track in-flight job
 
     // Reset the Available Jobs count for this worker. This ensures that we send
@@ -633,8 +1124,9 @@ void ClientToWorkerConnection::Process( const Protocol::MsgRequestJob * )
     const bool allowZstdUse = true; // We can accept Zstd results
     job->SetResultCompressionLevel( resultCompressionLevel, allowZstdUse );
 
-    EnqueueSend( Protocol::MsgJob( toolId, resultCompressionLevel ),
-                 Move( ConstMemoryStream( Move( stream ) ) ) );
+    outToolId = toolId;
+    outResultCompressionLevel = resultCompressionLevel;
+    return job;
 }
 
 // Process( MsgJobResult )
@@ -678,6 +1170,52 @@ void ClientToWorkerConnection::Process( const Protocol::MsgConnectionAck * msg )
                ( m_WorkerVersion.Load() % 100U ),
                Protocol::kVersionMajor,
                m_ProtocolVersionMinor.Load() );
+
+    // The handshake gives us an initial round trip time
+    m_Worker->RecordRoundTripTime( m_ConnectionSendTime.Load(), Timer::GetNow() );
+}
+
+// Process( MsgServerStatus )
+//------------------------------------------------------------------------------
+void ClientToWorkerConnection::Process( const Protocol::MsgServerStatus * msg )
+{
+    PROFILE_SECTION( "MsgServerStatus" );
+
+    const int64_t receivedTime = Timer::GetNow();
+
+    // Is this the reply to the timed message?
+    const uint32_t index = m_NumServerStatusReceived.Load();
+    if ( index == m_TimedStatusIndex.Load() )
+    {
+        m_Worker->RecordRoundTripTime( m_TimedStatusSendTime.Load(), receivedTime );
+    }
+    m_NumServerStatusReceived.Store( index + 1 );
+
+    // CPUs in use by other Clients aren't available to us
+    const uint32_t numCPUs = msg->GetNumCPUs();
+    uint32_t numJobsOfOthers;
+    {
+        MutexHolder mh( m_Mutex );
+        const uint32_t numJobsActive = msg->GetNumJobsActive();
+        const uint32_t numJobsOurs = static_cast<uint32_t>( m_Jobs.GetSize() );
+        numJobsOfOthers = ( numJobsActive > numJobsOurs ) ? ( numJobsActive - numJobsOurs ) : 0;
+    }
+
+    m_Worker->m_NumCPUsAvailable.Store( ( numCPUs > numJobsOfOthers ) ? ( numCPUs - numJobsOfOthers ) : 0 );
+    m_Worker->m_FreeMemoryMiB.Store( msg->GetFreeMemoryMiB() );
+    m_Worker->m_IdlePercent.Store( msg->GetIdlePercent() );
+    m_Worker->m_HasServerStatus.Store( true );
+
+    if ( m_HasServerStatus.Load() == false )
+    {
+        DIST_INFO( " - Worker %s has %u CPUs available, %u MiB free, %u%% idle (RTT %2.2fms)\n",
+                   m_Worker->m_Address.Get(),
+                   m_Worker->m_NumCPUsAvailable.Load(),
+                   msg->GetFreeMemoryMiB(),
+                   msg->GetIdlePercent(),
+                   (double)( static_cast<float>( m_Worker->m_RoundTripTimeUS.Load() ) / 1000.0f ) );
+        m_HasServerStatus.Store( true );
+    }
 }
 
 // ProcessJobResultCommon
@@ -714,6 +1252,12 @@ void ClientToWorkerConnection::ProcessJobResultCommon( bool isCompressed,
     uint16_t remoteThreadId = 0;
     ms.Read( remoteThreadId );
 
+    uint8_t remoteCacheFlags = 0;
+    if ( m_ProtocolVersionMinor.Load() >= 9 )
+    {
+        ms.Read( remoteCacheFlags );
+    }
+
     // get result data (built data or errors if failed)
     uint32_t dataSize = 0;
     ms.Read( dataSize );
@@ -894,12 +1438,38 @@ void ClientToWorkerConnection::ProcessJobResultCommon( bool isCompressed,
 
         ObjectNode * objectNode = node->CastTo<ObjectNode>();
 
+        // Decompress if needed
+        MultiBuffer mb( data, dataSize );
+        const bool decompressed = ( isCompressed && mb.Decompress() );
+
+        // Results retrieved from or stored to the cache by the worker are
+        // already in the cache
+        const bool inCache = ( ( remoteCacheFlags & ( Job::REMOTE_CACHE_HIT | Job::REMOTE_CACHE_STORED ) ) != 0 );
+        if ( remoteCacheFlags & Job::REMOTE_CACHE_HIT )
+        {
+            objectNode->SetStatFlag( Node::STATS_CACHE_HIT );
+        }
+        if ( remoteCacheFlags & Job::REMOTE_CACHE_STORED )
+        {
+            objectNode->SetStatFlag( Node::STATS_CACHE_STORE );
+        }
+        if ( inCache && FBuild::Get().GetOptions().m_CacheVerbose )
+        {
+            FLOG_OUTPUT( "Obj: %s\n"
+                         " - Cache %s by Worker: %s '%s'\n",
+                         objectNode->GetName().Get(),
+                         ( remoteCacheFlags & Job::REMOTE_CACHE_HIT ) ? "Hit" : "Store",
+                         m_Worker->m_Address.Get(),
+                         job->GetCacheName().Get() );
+        }
+
         // Store to cache if needed
         const bool writeToCache = FBuild::Get().GetOptions().m_UseCacheWrite &&
-                                  objectNode->ShouldUseCache();
+                                  objectNode->ShouldUseCache() &&
+                                  ( inCache == false );
         if ( writeToCache )
         {
-            if ( isCompressed )
+            if ( isCompressed && ( FBuild::Get().GetOptions().m_CacheDedup == false ) )
             {
                 // Write already compressed result to cache
                 objectNode->WriteToCache_FromCompressedData( job,
@@ -907,20 +1477,14 @@ void ClientToWorkerConnection::ProcessJobResultCommon( bool isCompressed,
                                                              dataSize,
                                                              0 ); // compression time is remote and unknown
             }
-            else
+            else if ( ( isCompressed == false ) || decompressed )
             {
-                // Compress and write result to cache
-                objectNode->WriteToCache_FromUncompressedData( job, data, dataSize );
+                // Compress and write result to cache (deduplicated entries
+                // are chunked before compression)
+                objectNode->WriteToCache_FromUncompressedData( job, mb.GetData(), mb.GetDataSize() );
             }
         }
 
-        // Decompress if needed
-        MultiBuffer mb( data, dataSize );
-        if ( isCompressed )
-        {
-            mb.Decompress();
-        }
-
         const AString & nodeName = objectNode->GetName();
         if ( Node::EnsurePathExistsForFile( nodeName ) == false )
         {
@@ -1054,8 +1618,13 @@ void ClientToWorkerConnection::Process( const ConnectionInfo * connection,
         return;
     }
 
+    // Workers since v22.11 accept files described as chunks
     MemoryStream ms;
-    manifest->SerializeForRemote( ms );
+    if ( manifest->SerializeForRemote( ms, m_ProtocolVersionMinor.Load() >= 11 ) == false )
+    {
+        Disconnect( connection ); // SerializeForRemote emits an error
+        return;
+    }
 
     // Send manifest to worker
     EnqueueSend( Protocol::MsgManifest( toolId ),
@@ -1099,12 +1668,127 @@ void ClientToWorkerConnection::Process( const ConnectionInfo * connection,
                  Move( ms ) );
 }
 
+// Process ( MsgRequestFileChunks )
+//------------------------------------------------------------------------------
+void ClientToWorkerConnection::Process( const ConnectionInfo * connection,
+                                        const Protocol::MsgRequestFileChunks * msg,
+                                        const void * payload,
+                                        size_t payloadSize )
+{
+    PROFILE_SECTION( "MsgRequestFileChunks" );
+
+    // find a job associated with this client with this toolId
+    const uint64_t toolId = msg->GetToolId();
+    ASSERT( toolId != 0 ); // server should not request 'no sync' tool id
+    const ToolManifest * manifest = FindManifest( toolId );
+
+    // Worker must ask for chunks of a file which exists
+    const uint32_t fileId = msg->GetFileId();
+    Array<uint32_t> chunkIndices;
+    ConstMemoryStream requestStream( payload, payloadSize );
+    if ( ( manifest == nullptr ) ||
+         ( fileId >= manifest->GetFiles().GetSize() ) ||
+         ( requestStream.Read( chunkIndices ) == false ) )
+    {
+        ASSERT( false ); // this indicates a logic bug
+        Disconnect( connection );
+        return;
+    }
+
+    // Chunks were compressed when the manifest was sent
+    const ToolManifestFile & file = manifest->GetFiles()[ fileId ];
+    MemoryStream ms;
+    ms.Write( static_cast<uint32_t>( chunkIndices.GetSize() ) );
+    for ( const uint32_t chunkIndex : chunkIndices )
+    {
+        if ( chunkIndex >= file.GetChunks().GetSize() )
+        {
+            ASSERT( false ); // this indicates a logic bug
+            Disconnect( connection );
+            return;
+        }
+        size_t chunkDataSize = 0;
+        const void * chunkData = file.GetChunkData( chunkIndex, chunkDataSize );
+        if ( chunkData == nullptr )
+        {
+            ASSERT( false ); // manifest was not sent
+            Disconnect( connection );
+            return;
+        }
+        ms.Write( chunkIndex );
+        ms.Write( static_cast<uint32_t>( chunkDataSize ) );
+        ms.WriteBuffer( chunkData, chunkDataSize );
+    }
+
+    // Send chunks to worker
+    EnqueueSend( Protocol::MsgFileChunks( toolId, fileId ),
+                 Move( ConstMemoryStream( Move( ms ) ) ) );
+}
+
+// GetNumJobsInFlight
+//------------------------------------------------------------------------------
+uint32_t ClientToWorkerConnection::GetNumJobsInFlight() const
+{
+    MutexHolder mh( m_Mutex );
+    return static_cast<uint32_t>( m_Jobs.GetSize() );
+}
+
+// PrepareToolchain
+//  - Ask the worker to synchronize the first of the manifests it hasn't
+//    been asked for, returning true if there was one
+//------------------------------------------------------------------------------
+void ClientToWorkerConnection::PrepareToolchain( const Array<const ToolManifest *> & manifests )
+{
+    // Handshake must be complete, and the worker must support it
+    if ( m_Worker->m_DenyListed ||
+         ( m_ProtocolVersionMinor.Load() < 12 ) )
+    {
+        return;
+    }
+
+    const ToolManifest * manifestToPrepare = nullptr;
+    {
+        MutexHolder mh( m_Mutex );
+        if ( m_PreparedToolManifests.GetSize() >= TOOLCHAIN_PREPARE_MAX_PER_WORKER )
+        {
+            return;
+        }
+        for ( const ToolManifest * manifest : manifests )
+        {
+            if ( m_PreparedToolManifests.Find( manifest ) == nullptr )
+            {
+                manifestToPrepare = manifest;
+                break;
+            }
+        }
+        if ( manifestToPrepare == nullptr )
+        {
+            return;
+        }
+
+        // Keep so manifest and files can be provided when requested
+        m_PreparedToolManifests.Append( manifestToPrepare );
+    }
+
+    DIST_INFO( " - Preparing toolchain 0x%" PRIx64 " on %s\n", manifestToPrepare->GetToolId(), m_Worker->m_Address.Get() );
+    EnqueueSend( Protocol::MsgPrepareToolchain( manifestToPrepare->GetToolId() ) );
+}
+
 // FindManifest
 //------------------------------------------------------------------------------
 const ToolManifest * ClientToWorkerConnection::FindManifest( uint64_t toolId ) const
 {
     MutexHolder mh( m_Mutex );
 
+    // toolchains synchronized ahead of jobs
+    for ( const ToolManifest * manifest : m_PreparedToolManifests )
+    {
+        if ( manifest->GetToolId() == toolId )
+        {
+            return manifest;
+        }
+    }
+
     for ( const Job * job : m_Jobs )
     {
         const Node * n = job->GetNode()->CastTo<ObjectNode>()->GetCompiler();
@@ -1172,6 +1856,20 @@ void ClientToWorkerConnection::EnqueueSend( const T & msg, ConstMemoryStream &&
     m_SendThreadWakeSemaphore.Signal();
 }
 
+//------------------------------------------------------------------------------
+template <class T>
+void ClientToWorkerConnection::EnqueueSend( const T & msg,
+                                            ConstMemoryStream && payload,
+                                            Array<TCPConnectionPool::SendBuffer> && payloadInserts,
+                                            Array<uint32_t> && payloadInsertOffsets )
+{
+    {
+        MutexHolder lock( m_SendQueueMutex );
+        m_SendQueue.EmplaceBack( msg, Move( payload ), Move( payloadInserts ), Move( payloadInsertOffsets ) );
+    }
+    m_SendThreadWakeSemaphore.Signal();
+}
+
 //------------------------------------------------------------------------------
 void ClientToWorkerConnection::EnqueueSendJobAvailability( uint32_t numJobsAvailable )
 {
@@ -1227,6 +1925,8 @@ void ClientToWorkerConnection::SendQueueThreadFunc()
     const uint32_t num = static_cast<uint32_t>( JobQueue::Get().GetNumDistributableJobsAvailable() );
     m_NumJobsAvailableSentToClient.Store( num );
     const Protocol::MsgConnection msg( num );
+    m_ConnectionSendTime.Store( Timer::GetNow() );
+    m_NumStatusSent.Store( 1 ); // Also answered with a MsgServerStatus
     if ( msg.Send( ci ) )
     {
         SendQueueMainLoop( ci );
@@ -1255,11 +1955,13 @@ void ClientToWorkerConnection::SendQueueMainLoop( const ConnectionInfo * ci )
         // Take queue of messages to process, or take the MsgStatus and
         // send that first if needed.
         Array<ClientSendQueueItem> sendQueue;
+        bool isStatus = false;
         {
             MutexHolder lock( m_SendQueueMutex );
             if ( m_MsgStatus.m_Message.GetSize() > 0 )
             {
                 sendQueue.EmplaceBack( Move( m_MsgStatus ) );
+                isStatus = true;
             }
             else
             {
@@ -1267,27 +1969,59 @@ void ClientToWorkerConnection::SendQueueMainLoop( const ConnectionInfo * ci )
             }
         }
 
+        // Time the reply to the status if no other replies are outstanding.
+        // (Before sending, so the reply can't beat us to it)
+        if ( isStatus )
+        {
+            const uint32_t index = m_NumStatusSent.Load();
+            if ( m_NumServerStatusReceived.Load() == index )
+            {
+                m_TimedStatusSendTime.Store( Timer::GetNow() );
+                m_TimedStatusIndex.Store( index );
+            }
+            m_NumStatusSent.Store( index + 1 );
+        }
+
         for ( const ClientSendQueueItem & item : sendQueue )
         {
             PROFILE_SECTION( "SendMsg" );
 
             // Send message
-            const bool sendOk = item.m_HasPayload ? Send( ci,
-                                                          item.m_Message.GetData(),
-                                                          item.m_Message.GetSize(),
-                                                          item.m_Payload.GetData(),
-                                                          item.m_Payload.GetSize() )
-                                                  : Send( ci,
-                                                          item.m_Message.GetData(),
-                                                          item.m_Message.GetSize() );
-
-            // If the send fails, we should be disconnected
-            ASSERT( sendOk || ( m_SendThreadQuit.Load() == true ) );
-            (void)sendOk;
+            bool sendOk;
+            if ( item.m_PayloadInserts.IsEmpty() == false )
+            {
+                // Gather payload from multiple buffers
+                StackArray<SendBuffer> payloadBuffers;
+                item.GetPayloadBuffers( payloadBuffers );
+                sendOk = Send( ci,
+                               item.m_Message.GetData(),
+                               item.m_Message.GetSize(),
+                               payloadBuffers.Begin(),
+                               static_cast<uint32_t>( payloadBuffers.GetSize() ) );
+            }
+            else
+            {
+                sendOk = item.m_HasPayload ? Send( ci,
+                                                   item.m_Message.GetData(),
+                                                   item.m_Message.GetSize(),
+                                                   item.m_Payload.GetData(),
+                                                   item.m_Payload.GetSize() )
+                                           : Send( ci,
+                                                   item.m_Message.GetData(),
+                                                   item.m_Message.GetSize() );
+            }
+
+            // If the send fails, the connection is being closed. We might not
+            // have been signaled to exit yet, as OnDisconnected is called
+            // asynchronously, but there's no point sending anything else.
+            if ( sendOk == false )
+            {
+                return;
+            }
 
             // If signaled to exit for any reason, don't process additional items
-            // (exit signal can come from a send failure above, or a receive failure
-            // on the TCPConnectionPool receive thread)
+            // (exit signal can come from a receive failure on the TCPConnectionPool
+            // receive thread)
             if ( m_SendThreadQuit.Load() == true )
             {
                 return;
@@ -60,7 +60,11 @@ private:
     void RegisterFoundWorkers( const Array<AString> & workerList,
                                const AString * brokeragePaths );
     void ConnectToWorkers();
+    ClientWorkerInfo * FindWorkerToConnectTo();
+    void RecycleWorstConnection( size_t numConnections );
+    void UpdateWorkerPreference();
     void CommunicateJobAvailability();
+    void PrepareToolchains();
 
     // Worker pool
     bool m_WorkerDiscoveryDone = false;
@@ -75,6 +79,8 @@ private:
 
     // state
     Timer m_StatusUpdateTimer;
+    Timer m_WorkerPreferenceTimer;
+    Timer m_WorkerRecycleTimer;
 
     // Workers we are connected to (or establishing/cleaning up a connection to)
     Array<UniquePtr<ClientToWorkerConnection>> m_ActiveConnections;
@@ -12,6 +12,7 @@
 #include "Core/Env/Env.h"
 #include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Network/TCPConnectionPool.h"
 
 // system
@@ -42,6 +43,16 @@ const char * GetProtocolMessageDebugName( Protocol::MessageType msgType )
         "File",
         "JobResultCompressed",
         "ConnectionAck",
+        "RequestJobs",
+        "Jobs",
+        "CompressionDictionary",
+        "ServerStatus",
+        "BrokerageHeartbeat",
+        "BrokerageQuery",
+        "BrokerageWorkers",
+        "RequestFileChunks",
+        "FileChunks",
+        "PrepareToolchain",
     };
     // clang-format on
     static_assert( ( sizeof( msgNames ) / sizeof( const char * ) ) == Protocol::NUM_MESSAGES, "msgNames item count doesn't match NUM_MESSAGES" );
@@ -165,6 +176,31 @@ Protocol::MsgJob::MsgJob( uint64_t toolId, int16_t resultCompressionLevel )
     ASSERT( toolId );
 }
 
+// MsgRequestJobs
+//------------------------------------------------------------------------------
+Protocol::MsgRequestJobs::MsgRequestJobs( uint32_t numJobs )
+    : Protocol::IMessage( Protocol::MSG_REQUEST_JOBS, sizeof( MsgRequestJobs ), false )
+    , m_NumJobs( numJobs )
+{
+    ASSERT( numJobs > 0 );
+}
+
+// MsgJobs
+//------------------------------------------------------------------------------
+Protocol::MsgJobs::MsgJobs( uint32_t numJobsRequested )
+    : Protocol::IMessage( Protocol::MSG_JOBS, sizeof( MsgJobs ), true )
+    , m_NumJobsRequested( numJobsRequested )
+{
+}
+
+// MsgCompressionDictionary
+//------------------------------------------------------------------------------
+Protocol::MsgCompressionDictionary::MsgCompressionDictionary( uint32_t dictionaryId )
+    : Protocol::IMessage( Protocol::MSG_COMPRESSION_DICTIONARY, sizeof( MsgCompressionDictionary ), true )
+    , m_DictionaryId( dictionaryId )
+{
+}
+
 // MsgJobResult
 //------------------------------------------------------------------------------
 Protocol::MsgJobResult::MsgJobResult()
@@ -215,4 +251,81 @@ Protocol::MsgFile::MsgFile( uint64_t toolId, uint32_t fileId )
 {
 }
 
+// MsgRequestFileChunks
+//------------------------------------------------------------------------------
+Protocol::MsgRequestFileChunks::MsgRequestFileChunks( uint64_t toolId, uint32_t fileId )
+    : Protocol::IMessage( Protocol::MSG_REQUEST_FILE_CHUNKS, sizeof( MsgRequestFileChunks ), true )
+    , m_FileId( fileId )
+    , m_ToolId( toolId )
+{
+}
+
+// MsgFileChunks
+//------------------------------------------------------------------------------
+Protocol::MsgFileChunks::MsgFileChunks( uint64_t toolId, uint32_t fileId )
+    : Protocol::IMessage( Protocol::MSG_FILE_CHUNKS, sizeof( MsgFileChunks ), true )
+    , m_FileId( fileId )
+    , m_ToolId( toolId )
+{
+}
+
+// MsgPrepareToolchain
+//------------------------------------------------------------------------------
+Protocol::MsgPrepareToolchain::MsgPrepareToolchain( uint64_t toolId )
+    : Protocol::IMessage( Protocol::MSG_PREPARE_TOOLCHAIN, sizeof( MsgPrepareToolchain ), false )
+    , m_ToolId( toolId )
+{
+    memset( m_Padding2, 0, sizeof( m_Padding2 ) );
+}
+
+// MsgServerStatus
+//------------------------------------------------------------------------------
+Protocol::MsgServerStatus::MsgServerStatus( uint32_t numCPUs, uint32_t numJobsActive, uint32_t freeMemoryMiB, uint32_t idlePercent )
+    : Protocol::IMessage( Protocol::MSG_SERVER_STATUS, sizeof( MsgServerStatus ), false )
+    , m_NumCPUs( static_cast<uint16_t>( Math::Min<uint32_t>( numCPUs, 0xFFFF ) ) )
+    , m_NumJobsActive( static_cast<uint16_t>( Math::Min<uint32_t>( numJobsActive, 0xFFFF ) ) )
+    , m_FreeMemoryMiB( freeMemoryMiB )
+    , m_IdlePercent( static_cast<uint8_t>( Math::Min<uint32_t>( idlePercent, 100 ) ) )
+{
+    memset( m_Padding2, 0, sizeof( m_Padding2 ) );
+}
+
+// MsgBrokerageHeartbeat
+//------------------------------------------------------------------------------
+Protocol::MsgBrokerageHeartbeat::MsgBrokerageHeartbeat( const AString & workerAddress,
+                                                        bool available,
+                                                        uint32_t numCPUsAvailable,
+                                                        uint32_t numCPUsTotal,
+                                                        uint32_t numJobsActive,
+                                                        uint32_t freeMemoryMiB )
+    : Protocol::IMessage( Protocol::MSG_BROKERAGE_HEARTBEAT, sizeof( MsgBrokerageHeartbeat ), false )
+    , m_ProtocolVersion( kVersionMajor )
+    , m_Platform( Env::GetPlatform() )
+    , m_Available( available )
+    , m_NumCPUsAvailable( static_cast<uint16_t>( Math::Min<uint32_t>( numCPUsAvailable, 0xFFFF ) ) )
+    , m_NumCPUsTotal( static_cast<uint16_t>( Math::Min<uint32_t>( numCPUsTotal, 0xFFFF ) ) )
+    , m_NumJobsActive( static_cast<uint16_t>( Math::Min<uint32_t>( numJobsActive, 0xFFFF ) ) )
+    , m_FreeMemoryMiB( freeMemoryMiB )
+{
+    memset( m_WorkerAddress, 0, sizeof( m_WorkerAddress ) );
+    AString::Copy( workerAddress.Get(), m_WorkerAddress, Math::Min<size_t>( workerAddress.GetLength(), sizeof( m_WorkerAddress ) - 1 ) );
+}
+
+// MsgBrokerageQuery
+//------------------------------------------------------------------------------
+Protocol::MsgBrokerageQuery::MsgBrokerageQuery()
+    : Protocol::IMessage( Protocol::MSG_BROKERAGE_QUERY, sizeof( MsgBrokerageQuery ), false )
+    , m_ProtocolVersion( kVersionMajor )
+    , m_Platform( Env::GetPlatform() )
+{
+    memset( m_Padding2, 0, sizeof( m_Padding2 ) );
+}
+
+// MsgBrokerageWorkers
+//------------------------------------------------------------------------------
+Protocol::MsgBrokerageWorkers::MsgBrokerageWorkers()
+    : Protocol::IMessage( Protocol::MSG_BROKERAGE_WORKERS, sizeof( MsgBrokerageWorkers ), true )
+{
+}
+
 //------------------------------------------------------------------------------
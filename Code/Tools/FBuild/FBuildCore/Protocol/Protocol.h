@@ -9,6 +9,7 @@
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class AString;
 class ConnectionInfo;
 class ConstMemoryStream;
 class MemoryStream;
@@ -32,10 +33,13 @@ namespace Protocol
 
     // Protocol Version
     inline static const uint32_t kVersionMajor = 22; // Changes here make workers incompatible
-    inline static const uint8_t kVersionMinor = 5; // Changes must be forwards and backwards compatible
+    inline static const uint8_t kVersionMinor = 12; // Changes must be forwards and backwards compatible
 
     inline static const uint16_t kTestPort = kPort + 1; // Different port for use by tests
 
+    inline static const uint16_t kBrokeragePort = kPort + 2; // Brokerage service
+    inline static const uint16_t kBrokerageTestPort = kPort + 3; // Brokerage service for use by tests
+
     // Identifiers for all unique messages
     //------------------------------------------------------------------------------
     enum MessageType : uint8_t
@@ -65,6 +69,33 @@ namespace Protocol
 
         // v22.5 or later support /dynamicdeopt for MSVC 2022 v17.44.x or later
 
+        // v22.6 or later
+        MSG_REQUEST_JOBS = 13,// Server -> Client : Ask for up to N jobs to do
+        MSG_JOBS = 14,// Server <- Client : Respond with up to N jobs to do (possibly none)
+
+        // v22.7 or later
+        MSG_COMPRESSION_DICTIONARY = 15,// Server <- Client : Dictionary needed to decompress subsequent jobs
+
+        // v22.8 or later supports job data sent as header fragments (no packet changes)
+
+        // v22.9 or later supports job cache names, for use of the worker's cache (no packet changes)
+
+        // v22.10 or later
+        MSG_SERVER_STATUS = 16,// Server -> Client : Worker load, in response to handshake and each status update
+
+        // Brokerage service (on kBrokeragePort)
+        MSG_BROKERAGE_HEARTBEAT = 17,// Brokerage <- Worker : Availability, capabilities and load
+        MSG_BROKERAGE_QUERY = 18,// Brokerage <- Client : Ask for available workers
+        MSG_BROKERAGE_WORKERS = 19,// Brokerage -> Client : List of available workers
+
+        // v22.11 or later
+        //  - MsgManifest includes 64-bit file hashes and the chunks of each file
+        MSG_REQUEST_FILE_CHUNKS = 20,// Server -> Client : Ask client for the chunks of a file missing from the worker
+        MSG_FILE_CHUNKS = 21,// Server <- Client : Send requested chunks
+
+        // v22.12 or later
+        MSG_PREPARE_TOOLCHAIN = 22,// Server <- Client : Synchronize a toolchain ahead of the jobs which need it
+
         NUM_MESSAGES            // leave last
     };
 }
@@ -189,6 +220,54 @@ namespace Protocol
     };
     static_assert( sizeof( MsgJob ) == sizeof( IMessage ) + 4 /*alignment*/ + 8, "MsgJob message has incorrect size" );
 
+    // MsgRequestJobs
+    //  - Grants the Client credit to send up to N jobs. The Client must respond
+    //    with a single MsgJobs, returning any credit it doesn't use.
+    //------------------------------------------------------------------------------
+    class MsgRequestJobs : public IMessage
+    {
+    public:
+        explicit MsgRequestJobs( uint32_t numJobs );
+
+        uint32_t GetNumJobs() const { return m_NumJobs; }
+
+    private:
+        uint32_t m_NumJobs;
+    };
+    static_assert( sizeof( MsgRequestJobs ) == sizeof( IMessage ) + 4, "MsgRequestJobs message has incorrect size" );
+
+    // MsgJobs
+    //  - Payload is the number of jobs, followed by each job:
+    //    toolId, result compression level, serialized job size and serialized job
+    //------------------------------------------------------------------------------
+    class MsgJobs : public IMessage
+    {
+    public:
+        explicit MsgJobs( uint32_t numJobsRequested );
+
+        uint32_t GetNumJobsRequested() const { return m_NumJobsRequested; }
+
+    private:
+        uint32_t m_NumJobsRequested; // Credit being responded to
+    };
+    static_assert( sizeof( MsgJobs ) == sizeof( IMessage ) + 4, "MsgJobs message has incorrect size" );
+
+    // MsgCompressionDictionary
+    //  - Payload is the dictionary. Sent before the first job compressed
+    //    against it, and applies to all jobs which follow on the connection.
+    //------------------------------------------------------------------------------
+    class MsgCompressionDictionary : public IMessage
+    {
+    public:
+        explicit MsgCompressionDictionary( uint32_t dictionaryId );
+
+        uint32_t GetDictionaryId() const { return m_DictionaryId; }
+
+    private:
+        uint32_t m_DictionaryId;
+    };
+    static_assert( sizeof( MsgCompressionDictionary ) == sizeof( IMessage ) + 4, "MsgCompressionDictionary message has incorrect size" );
+
     // MsgJobResult
     //------------------------------------------------------------------------------
     class MsgJobResult : public IMessage
@@ -269,14 +348,139 @@ namespace Protocol
     };
     static_assert( sizeof( MsgFile ) == sizeof( IMessage ) + 12, "MsgFile message has incorrect size" );
 
+    // MsgRequestFileChunks
+    //  - Payload is the list of chunk indices required
+    //------------------------------------------------------------------------------
+    class MsgRequestFileChunks : public IMessage
+    {
+    public:
+        MsgRequestFileChunks( uint64_t toolId, uint32_t fileId );
+
+        uint64_t GetToolId() const { return m_ToolId; }
+        uint32_t GetFileId() const { return m_FileId; }
+
+    private:
+        uint32_t m_FileId;
+        uint64_t m_ToolId;
+    };
+    static_assert( sizeof( MsgRequestFileChunks ) == sizeof( IMessage ) + 12, "MsgRequestFileChunks message has incorrect size" );
+
+    // MsgFileChunks
+    //  - Payload is the index and compressed content of each requested chunk
+    //------------------------------------------------------------------------------
+    class MsgFileChunks : public IMessage
+    {
+    public:
+        MsgFileChunks( uint64_t toolId, uint32_t fileId );
+
+        uint64_t GetToolId() const { return m_ToolId; }
+        uint32_t GetFileId() const { return m_FileId; }
+
+    private:
+        uint32_t m_FileId;
+        uint64_t m_ToolId;
+    };
+    static_assert( sizeof( MsgFileChunks ) == sizeof( IMessage ) + 12, "MsgFileChunks message has incorrect size" );
+
+    // MsgPrepareToolchain
+    //------------------------------------------------------------------------------
+    class MsgPrepareToolchain : public IMessage
+    {
+    public:
+        explicit MsgPrepareToolchain( uint64_t toolId );
+
+        uint64_t GetToolId() const { return m_ToolId; }
+
+    private:
+        char m_Padding2[ 4 ];
+        uint64_t m_ToolId;
+    };
+    static_assert( sizeof( MsgPrepareToolchain ) == sizeof( IMessage ) + 4 /*alignment*/ + 8, "MsgPrepareToolchain message has incorrect size" );
+
     // MsgServerStatus
+    //  - Sent in response to MsgConnection and each MsgStatus, so the Client
+    //    can also use it to measure the round trip time.
     //------------------------------------------------------------------------------
     class MsgServerStatus : public IMessage
     {
     public:
-        MsgServerStatus();
+        MsgServerStatus( uint32_t numCPUs, uint32_t numJobsActive, uint32_t freeMemoryMiB, uint32_t idlePercent );
+
+        uint32_t GetNumCPUs() const { return m_NumCPUs; }
+        uint32_t GetNumJobsActive() const { return m_NumJobsActive; }
+        uint32_t GetFreeMemoryMiB() const { return m_FreeMemoryMiB; }
+        uint32_t GetIdlePercent() const { return m_IdlePercent; }
+
+    private:
+        uint16_t m_NumCPUs; // CPUs currently available for remote jobs
+        uint16_t m_NumJobsActive; // Jobs queued or building, for all Clients
+        uint32_t m_FreeMemoryMiB;
+        uint8_t m_IdlePercent; // CPU not in use by other processes (100 = entirely idle)
+        uint8_t m_Padding2[ 3 ];
+    };
+    static_assert( sizeof( MsgServerStatus ) == sizeof( IMessage ) + 12, "MsgServerStatus message has incorrect size" );
+
+    // MsgBrokerageHeartbeat
+    //  - Sent periodically (and when availability changes) by workers for the
+    //    lifetime of their connection to the brokerage service
+    //------------------------------------------------------------------------------
+    class MsgBrokerageHeartbeat : public IMessage
+    {
+    public:
+        MsgBrokerageHeartbeat( const AString & workerAddress,
+                               bool available,
+                               uint32_t numCPUsAvailable,
+                               uint32_t numCPUsTotal,
+                               uint32_t numJobsActive,
+                               uint32_t freeMemoryMiB );
+
+        uint32_t GetProtocolVersion() const { return m_ProtocolVersion; }
+        uint8_t GetPlatform() const { return m_Platform; }
+        bool IsAvailable() const { return m_Available; }
+        uint32_t GetNumCPUsAvailable() const { return m_NumCPUsAvailable; }
+        uint32_t GetNumCPUsTotal() const { return m_NumCPUsTotal; }
+        uint32_t GetNumJobsActive() const { return m_NumJobsActive; }
+        uint32_t GetFreeMemoryMiB() const { return m_FreeMemoryMiB; }
+        const char * GetWorkerAddress() const { return m_WorkerAddress; }
+
+    private:
+        uint32_t m_ProtocolVersion;
+        uint8_t m_Platform;
+        bool m_Available;
+        uint16_t m_NumCPUsAvailable;
+        uint16_t m_NumCPUsTotal;
+        uint16_t m_NumJobsActive;
+        uint32_t m_FreeMemoryMiB;
+        char m_WorkerAddress[ 64 ];
+    };
+    static_assert( sizeof( MsgBrokerageHeartbeat ) == sizeof( IMessage ) + 80, "MsgBrokerageHeartbeat message has incorrect size" );
+
+    // MsgBrokerageQuery
+    //------------------------------------------------------------------------------
+    class MsgBrokerageQuery : public IMessage
+    {
+    public:
+        MsgBrokerageQuery();
+
+        uint32_t GetProtocolVersion() const { return m_ProtocolVersion; }
+        uint8_t GetPlatform() const { return m_Platform; }
+
+    private:
+        uint32_t m_ProtocolVersion;
+        uint8_t m_Platform;
+        uint8_t m_Padding2[ 3 ];
+    };
+    static_assert( sizeof( MsgBrokerageQuery ) == sizeof( IMessage ) + 8, "MsgBrokerageQuery message has incorrect size" );
+
+    // MsgBrokerageWorkers
+    //  - Payload is the list of worker addresses, most available CPUs first
+    //------------------------------------------------------------------------------
+    class MsgBrokerageWorkers : public IMessage
+    {
+    public:
+        MsgBrokerageWorkers();
     };
-    static_assert( sizeof( MsgServerStatus ) == sizeof( IMessage ), "MsgServerStatus message has incorrect size" );
+    static_assert( sizeof( MsgBrokerageWorkers ) == sizeof( IMessage ), "MsgBrokerageWorkers message has incorrect size" );
 }
 
 //------------------------------------------------------------------------------
@@ -7,6 +7,8 @@
 #include "Protocol.h"
 
 #include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompressionDictionary.h"
+#include "Tools/FBuild/FBuildCore/Helpers/HeaderFragmentStore.h"
 #include "Tools/FBuild/FBuildCore/Helpers/ToolManifest.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueueRemote.h"
@@ -15,6 +17,8 @@
 #include "Core/Env/Env.h"
 #include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Mem/MemInfo.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
@@ -172,6 +176,13 @@ bool Server::IsSynchingTool( AString & statusStr ) const
             delete job;
         }
 
+        // Jobs still in flight hold their own reference
+        if ( cs->m_CompressionDictionary )
+        {
+            cs->m_CompressionDictionary->Release();
+        }
+        FDELETE cs->m_HeaderFragmentStore;
+
         FDELETE cs;
     }
 }
@@ -235,6 +246,21 @@ bool Server::IsSynchingTool( AString & statusStr ) const
         {
             const Protocol::MsgJob * msg = static_cast<const Protocol::MsgJob *>( imsg );
             Process( connection, msg, payload, payloadSize );
+            payload = nullptr; // Owned by the received job
+            break;
+        }
+        case Protocol::MSG_JOBS:
+        {
+            const Protocol::MsgJobs * msg = static_cast<const Protocol::MsgJobs *>( imsg );
+            Process( connection, msg, payload, payloadSize );
+            payload = nullptr; // Owned by the received jobs
+            break;
+        }
+        case Protocol::MSG_COMPRESSION_DICTIONARY:
+        {
+            const Protocol::MsgCompressionDictionary * msg = static_cast<const Protocol::MsgCompressionDictionary *>( imsg );
+            Process( connection, msg, payload, payloadSize );
+            payload = nullptr; // Owned by the dictionary
             break;
         }
         case Protocol::MSG_MANIFEST:
@@ -249,6 +275,18 @@ bool Server::IsSynchingTool( AString & statusStr ) const
             Process( connection, msg, payload, payloadSize );
             break;
         }
+        case Protocol::MSG_FILE_CHUNKS:
+        {
+            const Protocol::MsgFileChunks * msg = static_cast<const Protocol::MsgFileChunks *>( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
+        case Protocol::MSG_PREPARE_TOOLCHAIN:
+        {
+            const Protocol::MsgPrepareToolchain * msg = static_cast<const Protocol::MsgPrepareToolchain *>( imsg );
+            Process( connection, msg );
+            break;
+        }
         default:
         {
             // unknown message type
@@ -302,6 +340,12 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgConn
         const Protocol::MsgConnectionAck ack;
         ack.Send( connection );
     }
+
+    // If Client is new enough, let it know our initial load
+    if ( msg->GetProtocolVersionMinor() >= 10 )
+    {
+        SendServerStatus( connection );
+    }
 }
 
 // Process( MsgStatus )
@@ -314,6 +358,14 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgStat
 
     // Wake main thread to request jobs
     JobQueueRemote::Get().WakeMainThread();
+
+    // Reply with our current load (the Client also uses this to measure the
+    // round trip time)
+    if ( cs->m_ProtocolVersionMinor >= 10 )
+    {
+        MutexHolder mh( cs->m_Mutex ); // Serialize sends
+        SendServerStatus( connection );
+    }
 }
 
 // Process( MsgNoJobAvailable )
@@ -328,99 +380,252 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgNoJo
 
 // Process( MsgJob )
 //------------------------------------------------------------------------------
-void Server::Process( const ConnectionInfo * connection, const Protocol::MsgJob * msg, const void * payload, size_t payloadSize )
+void Server::Process( const ConnectionInfo * connection, const Protocol::MsgJob * msg, void * payload, size_t payloadSize )
+{
+    ClientState * cs = (ClientState *)connection->GetUserData();
+    ASSERT( cs->m_NumJobsRequested.Load() > 0 );
+    cs->m_NumJobsActive.Increment(); // Before decrementing requested to keep reserved count consistent
+    cs->m_NumJobsRequested.Decrement();
+
+    // The job references its data in the received payload, avoiding a copy
+    JobDataBuffer * dataBuffer = FNEW( JobDataBuffer( payload ) );
+    ReceiveJob( connection, cs, msg->GetToolId(), msg->GetResultCompressionLevel(), dataBuffer, payload, payloadSize );
+    dataBuffer->Release();
+}
+
+// Process( MsgJobs )
+//------------------------------------------------------------------------------
+void Server::Process( const ConnectionInfo * connection, const Protocol::MsgJobs * msg, void * payload, size_t payloadSize )
 {
     ClientState * cs = (ClientState *)connection->GetUserData();
+
+    // The jobs reference their data in the received payload (freed once all
+    // jobs are done with it), avoiding a copy
+    JobDataBuffer * dataBuffer = FNEW( JobDataBuffer( payload ) );
+
+    ConstMemoryStream ms( payload, payloadSize );
+    uint32_t numJobs = 0;
+    if ( ( ms.Read( numJobs ) == false ) || ( numJobs > msg->GetNumJobsRequested() ) )
+    {
+        ASSERT( false && "MsgJobs corrupt" ); // this indicates a protocol bug
+        dataBuffer->Release();
+        Disconnect( connection );
+        return;
+    }
+
+    // Return the credit for the request (including any which wasn't used)
+    ASSERT( cs->m_NumJobsRequested.Load() >= msg->GetNumJobsRequested() );
+    cs->m_NumJobsActive.Add( numJobs ); // Before decrementing requested to keep reserved count consistent
+    cs->m_NumJobsRequested.Sub( msg->GetNumJobsRequested() );
+
+    for ( uint32_t i = 0; i < numJobs; ++i )
+    {
+        uint64_t toolId = 0;
+        int16_t resultCompressionLevel = 0;
+        uint32_t jobSize = 0;
+        if ( ( ms.Read( toolId ) == false ) ||
+             ( ms.Read( resultCompressionLevel ) == false ) ||
+             ( ms.Read( jobSize ) == false ) ||
+             ( ( ms.GetSize() - static_cast<size_t>( ms.Tell() ) ) < jobSize ) )
+        {
+            ASSERT( false && "MsgJobs corrupt" ); // this indicates a protocol bug
+            cs->m_NumJobsActive.Sub( numJobs - i ); // Jobs which won't be received
+            dataBuffer->Release();
+            Disconnect( connection );
+            return;
+        }
+
+        const void * jobData = static_cast<const uint8_t *>( ms.GetData() ) + ms.Tell();
+        ms.Seek( ms.Tell() + jobSize );
+        ReceiveJob( connection, cs, toolId, resultCompressionLevel, dataBuffer, jobData, jobSize );
+    }
+    dataBuffer->Release();
+
+    // If the client had fewer jobs than requested, we can ask others
+    if ( numJobs < msg->GetNumJobsRequested() )
+    {
+        JobQueueRemote::Get().WakeMainThread();
+    }
+}
+
+// Process( MsgCompressionDictionary )
+//------------------------------------------------------------------------------
+void Server::Process( const ConnectionInfo * connection, const Protocol::MsgCompressionDictionary * msg, void * payload, size_t payloadSize )
+{
+    PROFILE_SECTION( "MsgCompressionDictionary" );
+
+    ClientState * cs = (ClientState *)connection->GetUserData();
+
+    // The dictionary uses the received payload directly
+    CompressionDictionary * dictionary = FNEW( CompressionDictionary( payload, payloadSize ) );
+    if ( dictionary->GetId() != msg->GetDictionaryId() )
     {
-        ASSERT( cs->m_NumJobsRequested.Load() > 0 );
-        cs->m_NumJobsRequested.Decrement();
-        cs->m_NumJobsActive.Increment();
+        ASSERT( false && "MsgCompressionDictionary corrupt" ); // this indicates a protocol bug
+        dictionary->Release();
+        Disconnect( connection );
+        return;
+    }
 
+    // Replace any previous dictionary. Jobs already received keep theirs.
+    MutexHolder mh( cs->m_Mutex );
+    if ( cs->m_CompressionDictionary )
+    {
+        cs->m_CompressionDictionary->Release();
+    }
+    cs->m_CompressionDictionary = dictionary;
+}
+
+// ReceiveJob
+//------------------------------------------------------------------------------
+void Server::ReceiveJob( const ConnectionInfo * connection,
+                         ClientState * cs,
+                         uint64_t toolId,
+                         int16_t resultCompressionLevel,
+                         JobDataBuffer * dataBuffer,
+                         const void * data,
+                         size_t dataSize )
+{
+    {
         MutexHolder mh( cs->m_Mutex );
 
         // deserialize job
-        ConstMemoryStream ms( payload, payloadSize );
+        ConstMemoryStream ms( data, dataSize );
 
-        Job * job = FNEW( Job( ms ) );
+        Job * job = FNEW( Job( ms, dataBuffer ) );
         job->SetUserData( cs );
+        job->SetCompressionDictionary( cs->m_CompressionDictionary );
+
+        // Reassemble data sent as fragments, which includes any we haven't
+        // received before
+        if ( job->IsDataHeaderFragments() )
+        {
+            if ( cs->m_HeaderFragmentStore == nullptr )
+            {
+                cs->m_HeaderFragmentStore = FNEW( HeaderFragmentStore );
+            }
+            ConstMemoryStream fragmentStream( job->GetData(), job->GetDataSize() );
+            void * jobData = nullptr;
+            size_t jobDataSize = 0;
+            if ( cs->m_HeaderFragmentStore->ReadFragments( fragmentStream, jobData, jobDataSize ) == false )
+            {
+                ASSERT( false && "Job fragments corrupt" ); // this indicates a protocol bug
+                FDELETE job;
+                Disconnect( connection );
+                return;
+            }
+            job->OwnData( jobData, jobDataSize, false );
+        }
 
         // Take not of client support requirements
         // - Zstd suport can become unconditional if protocol compatibility is broken
         static_assert( Protocol::kVersionMajor == 22 );
         const bool allowZstdUse = ( cs->m_ProtocolVersionMinor >= 4 );
-        job->SetResultCompressionLevel( msg->GetResultCompressionLevel(), allowZstdUse );
+        job->SetResultCompressionLevel( resultCompressionLevel, allowZstdUse );
 
-        // Get ToolId
-        const uint64_t toolId = msg->GetToolId();
+        // Check ToolId
         ASSERT( toolId );
 
         {
             // Find or create the manifest
             MutexHolder manifestMH( m_ToolManifestsMutex );
 
-            ToolManifest ** found = m_Tools.FindDeref( toolId );
-            ToolManifest * manifest = found ? *found : nullptr;
-            if ( manifest )
+            ToolManifest * manifest = SynchronizeTool( connection, toolId );
+            job->SetToolManifest( manifest );
+
+            // Is tool fully synchronized?
+            if ( manifest->IsSynchronized() )
             {
-                job->SetToolManifest( manifest );
+                // we have all the files - we can do the job
+                JobQueueRemote::Get().QueueJob( job );
+                return;
+            }
 
-                // Is tool fully synchronized?
-                if ( manifest->IsSynchronized() )
-                {
-                    // we have all the files - we can do the job
-                    JobQueueRemote::Get().QueueJob( job );
-                    return;
-                }
+            // can't start job yet - put it on hold
+            cs->m_WaitingJobs.Append( job );
+        }
+    }
+}
 
-                // If we have an associated connection, we're already synchronizing
-                // on that connection and don't need to do anything.
-                // That may be a connection to another client or to the same client
-                const bool isSynchronizing = ( manifest->GetUserData() != nullptr );
-                if ( isSynchronizing )
-                {
-                    // We just need to wait for synchronization to complete
-                }
-                else
-                {
-                    // Take ownership of toolchain
-                    manifest->SetUserData( (void *)connection );
+// Process( MsgPrepareToolchain )
+//------------------------------------------------------------------------------
+void Server::Process( const ConnectionInfo * connection, const Protocol::MsgPrepareToolchain * msg )
+{
+    const uint64_t toolId = msg->GetToolId();
+    if ( toolId == 0 )
+    {
+        ASSERT( false ); // this indicates a protocol bug
+        Disconnect( connection );
+        return;
+    }
 
-                    const bool hasManifest = ( manifest->GetFiles().IsEmpty() == false );
-                    if ( hasManifest )
-                    {
-                        // Missing some files - request any not already being sync'd
-                        RequestMissingFiles( connection, manifest );
-                    }
-                    else
-                    {
-                        // Manifest was not sync'd. This can happen if disconnection
-                        // occurs before the manifest was received.
+    // Start synchronizing (if needed) so the toolchain is ready when jobs
+    // which need it arrive
+    MutexHolder manifestMH( m_ToolManifestsMutex );
+    if ( m_Tools.FindDeref( toolId ) == nullptr )
+    {
+        m_NumToolchainsPrepared.Increment();
+    }
+    SynchronizeTool( connection, toolId );
+}
 
-                        // request manifest
-                        const Protocol::MsgRequestManifest reqMsg( toolId );
-                        reqMsg.Send( connection );
-                    }
-                }
-            }
-            else
-            {
-                // first time seeing this tool
+// SynchronizeTool
+//  - Find or create the manifest for a toolchain, starting synchronization
+//    from the given connection if it is not in progress elsewhere
+//------------------------------------------------------------------------------
+ToolManifest * Server::SynchronizeTool( const ConnectionInfo * connection, uint64_t toolId )
+{
+    ToolManifest ** found = m_Tools.FindDeref( toolId );
+    ToolManifest * manifest = found ? *found : nullptr;
+    if ( manifest )
+    {
+        // Is tool fully synchronized?
+        if ( manifest->IsSynchronized() )
+        {
+            return manifest;
+        }
 
-                // create manifest object
-                manifest = FNEW( ToolManifest( toolId ) );
-                manifest->SetUserData( (void *)connection ); // This connection owns synchronization
-                job->SetToolManifest( manifest );
-                m_Tools.Append( manifest );
+        // If we have an associated connection, we're already synchronizing
+        // on that connection and don't need to do anything.
+        // That may be a connection to another client or to the same client
+        const bool isSynchronizing = ( manifest->GetUserData() != nullptr );
+        if ( isSynchronizing )
+        {
+            // We just need to wait for synchronization to complete
+            return manifest;
+        }
 
-                // request manifest of tool chain
-                const Protocol::MsgRequestManifest reqMsg( toolId );
-                reqMsg.Send( connection );
-            }
+        // Take ownership of toolchain
+        manifest->SetUserData( (void *)connection );
 
-            // can't start job yet - put it on hold
-            cs->m_WaitingJobs.Append( job );
+        const bool hasManifest = ( manifest->GetFiles().IsEmpty() == false );
+        if ( hasManifest )
+        {
+            // Missing some files - request any not already being sync'd
+            RequestMissingFiles( connection, manifest );
         }
+        else
+        {
+            // Manifest was not sync'd. This can happen if disconnection
+            // occurs before the manifest was received.
+
+            // request manifest
+            const Protocol::MsgRequestManifest reqMsg( toolId );
+            reqMsg.Send( connection );
+        }
+        return manifest;
     }
+
+    // first time seeing this tool
+
+    // create manifest object
+    manifest = FNEW( ToolManifest( toolId ) );
+    manifest->SetUserData( (void *)connection ); // This connection owns synchronization
+    m_Tools.Append( manifest );
+
+    // request manifest of tool chain
+    const Protocol::MsgRequestManifest reqMsg( toolId );
+    reqMsg.Send( connection );
+    return manifest;
 }
 
 // Process( MsgManifest )
@@ -431,6 +636,10 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgMani
     const uint64_t toolId = msg->GetToolId();
     ConstMemoryStream ms( payload, payloadSize );
 
+    // Clients since v22.11 describe files as chunks
+    const ClientState * cs = (const ClientState *)connection->GetUserData();
+    const bool withChunks = ( cs->m_ProtocolVersionMinor >= 11 );
+
     {
         MutexHolder manifestMH( m_ToolManifestsMutex ); // ensure we don't make redundant requests
 
@@ -438,7 +647,7 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgMani
         ToolManifest ** found = m_Tools.FindDeref( toolId );
         ASSERT( found );
         manifest = *found;
-        if ( manifest->DeserializeFromRemote( ms ) == false )
+        if ( manifest->DeserializeFromRemote( ms, withChunks ) == false )
         {
             // NOTE: In clients prior to v1.07 a bug could cause MsgManifest messages to be
             //       corrupt and for deserialization to corrupt internal state.
@@ -454,7 +663,6 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgMani
             ASSERT( false && "MsgManifest corrupt" );
 
             // Disconnect to handle old workers misbehaving
-            ClientState * cs = (ClientState *)connection->GetUserData();
             AStackString remoteAddr;
             TCPConnectionPool::GetAddressAsString( connection->GetRemoteAddress(), remoteAddr );
             FLOG_WARN( "Disconnecting '%s' (%s) due to corrupt MsgManifest (Client protocol %u.%u)\n",
@@ -554,14 +762,73 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgFile
     CheckWaitingJobs( manifest );
 }
 
+// Process( MsgFileChunks )
+//------------------------------------------------------------------------------
+void Server::Process( const ConnectionInfo * connection, const Protocol::MsgFileChunks * msg, const void * payload, size_t payloadSize )
+{
+    const uint64_t toolId = msg->GetToolId();
+    const uint32_t fileId = msg->GetFileId();
+
+    // Update the Manifest
+    ToolManifest * manifest = nullptr;
+    {
+        MutexHolder manifestMH( m_ToolManifestsMutex );
+
+        ToolManifest ** found = m_Tools.FindDeref( toolId );
+        ASSERT( found );
+        manifest = *found;
+        ASSERT( manifest->GetUserData() == connection );
+
+        bool corruptData = false;
+        if ( manifest->ReceiveFileChunks( fileId, payload, payloadSize, corruptData ) == false )
+        {
+            if ( corruptData )
+            {
+                const ClientState * cs = (const ClientState *)connection->GetUserData();
+                AStackString remoteAddr;
+                TCPConnectionPool::GetAddressAsString( connection->GetRemoteAddress(), remoteAddr );
+                FLOG_WARN( "Disconnecting '%s' (%s) due to corrupt MsgFileChunks (Client protocol %u.%u)\n",
+                           remoteAddr.Get(),
+                           cs->m_HostName.Get(),
+                           Protocol::kVersionMajor,
+                           cs->m_ProtocolVersionMinor );
+            }
+            else
+            {
+                // something went wrong storing the file
+                AStackString fileName;
+                manifest->GetRemoteFilePath( fileId, fileName );
+                FLOG_WARN( "Failed to store fileId %u for manifest 0x%" PRIx64 "\n"
+                           " - %s\n",
+                           fileId,
+                           toolId,
+                           fileName.Get() );
+            }
+
+            Disconnect( connection );
+            return;
+        }
+
+        if ( manifest->IsSynchronized() == false )
+        {
+            // wait for more files
+            return;
+        }
+        manifest->SetUserData( nullptr );
+    }
+
+    // ToolChain is now synchronized
+    // Allow any jobs that were waiting on it to start
+    CheckWaitingJobs( manifest );
+}
+
 // CheckWaitingJobs
 //------------------------------------------------------------------------------
 void Server::CheckWaitingJobs( const ToolManifest * manifest )
 {
     // queue for start any jobs that may now be ready
-#ifdef ASSERTS_ENABLED
-    bool atLeastOneJobStarted = false;
-#endif
+    // NOTE: ToolChains synchronized ahead of jobs (MsgPrepareToolchain) may
+    //       have no jobs waiting
 
     {
         MutexHolder mhC( m_ClientListMutex );
@@ -582,17 +849,10 @@ void Server::CheckWaitingJobs( const ToolManifest * manifest )
                     cs->m_WaitingJobs.EraseIndex( (size_t)i );
                     JobQueueRemote::Get().QueueJob( job );
                     PROTOCOL_DEBUG( "Server: Job %x can now be started\n", job );
-#ifdef ASSERTS_ENABLED
-                    atLeastOneJobStarted = true;
-#endif
                 }
             }
         }
     }
-
-    // We should only have called this function when a ToolChain sync was complete
-    // so at least 1 job should have been waiting for it
-    ASSERT( atLeastOneJobStarted );
 }
 
 // ThreadFuncStatic
@@ -622,6 +882,27 @@ void Server::ThreadFunc()
     }
 }
 
+// SendServerStatus
+//  - ClientState mutex must be held
+//------------------------------------------------------------------------------
+void Server::SendServerStatus( const ConnectionInfo * connection )
+{
+    PROFILE_FUNCTION;
+
+    SystemMemInfo memInfo;
+    MemInfo::GetSystemInfo( memInfo );
+
+    // CPUs in use are limited by the number of threads
+    const JobQueueRemote & jqr = JobQueueRemote::Get();
+    const uint32_t numCPUs = Math::Min( WorkerThreadRemote::GetNumCPUsToUse(), static_cast<uint32_t>( jqr.GetNumWorkers() ) );
+
+    const Protocol::MsgServerStatus msg( numCPUs,
+                                         jqr.GetNumJobsActive(),
+                                         memInfo.m_AvailPhysMiB,
+                                         m_IdlePercent.Load() );
+    msg.Send( connection );
+}
+
 // FindNeedyClients
 //------------------------------------------------------------------------------
 void Server::FindNeedyClients()
@@ -639,7 +920,8 @@ void Server::FindNeedyClients()
     {
         return;
     }
-    ++availableJobs; // over request to parallelize building/network transfers
+    // over request to parallelize building/network transfers
+    availableJobs += (int32_t)JobQueueRemote::Get().GetNumJobsToPrefetch();
 
     {
         MutexHolder mh( m_ClientListMutex );
@@ -663,15 +945,22 @@ void Server::FindNeedyClients()
         // sort clients to find neediest first
         m_ClientList.SortDeref();
 
-        const Protocol::MsgRequestJob msg;
-
+        // distribute requests between clients
+        const size_t numClients = m_ClientList.GetSize();
+        StackArray<uint32_t> jobsToRequest;
+        jobsToRequest.SetSize( numClients );
+        for ( uint32_t & numJobs : jobsToRequest )
+        {
+            numJobs = 0;
+        }
         while ( availableJobs > 0 )
         {
             bool anyJobsRequested = false;
 
-            for ( ClientState * cs : m_ClientList )
+            for ( size_t i = 0; i < numClients; ++i )
             {
-                const uint32_t reservedJobs = cs->m_NumJobsRequested.Load();
+                const ClientState * cs = m_ClientList[ i ];
+                const uint32_t reservedJobs = cs->m_NumJobsRequested.Load() + jobsToRequest[ i ];
 
                 if ( reservedJobs >= cs->m_NumJobsAvailable.Load() )
                 {
@@ -679,16 +968,7 @@ void Server::FindNeedyClients()
                 }
 
                 // request job from this client
-                {
-                    // Acquire the lock but don't wait if unavailable
-                    TryMutexHolder tryLock( cs->m_Mutex );
-                    if ( tryLock.IsLocked() == false )
-                    {
-                        continue; // Skip this worker for now
-                    }
-                    cs->m_NumJobsRequested.Increment(); // Must be before Send() to ensure consistent counts
-                    msg.Send( cs->m_Connection );
-                }
+                ++jobsToRequest[ i ];
                 availableJobs--;
                 anyJobsRequested = true;
 
@@ -705,6 +985,42 @@ void Server::FindNeedyClients()
                 break;
             }
         }
+
+        // send requests
+        for ( size_t i = 0; i < numClients; ++i )
+        {
+            const uint32_t numJobs = jobsToRequest[ i ];
+            if ( numJobs == 0 )
+            {
+                continue;
+            }
+
+            ClientState * cs = m_ClientList[ i ];
+
+            // Acquire the lock but don't wait if unavailable
+            TryMutexHolder tryLock( cs->m_Mutex );
+            if ( tryLock.IsLocked() == false )
+            {
+                continue; // Skip this worker for now
+            }
+            cs->m_NumJobsRequested.Add( numJobs ); // Must be before Send() to ensure consistent counts
+
+            if ( cs->m_ProtocolVersionMinor >= 6 )
+            {
+                // Request all jobs at once
+                const Protocol::MsgRequestJobs msg( numJobs );
+                msg.Send( cs->m_Connection );
+            }
+            else
+            {
+                // Older clients only support requesting jobs individually
+                const Protocol::MsgRequestJob msg;
+                for ( uint32_t j = 0; j < numJobs; ++j )
+                {
+                    msg.Send( cs->m_Connection );
+                }
+            }
+        }
     }
 }
 
@@ -738,6 +1054,10 @@ void Server::FinalizeCompletedJobs()
                 ms.Write( job->GetMessages() );
                 ms.Write( job->GetNode()->GetLastBuildTime() );
                 ms.Write( job->GetRemoteThreadIndex() ); // The thread used to build the job to assist with visualization
+                if ( cs->m_ProtocolVersionMinor >= 9 )
+                {
+                    ms.Write( static_cast<uint8_t>( job->GetRemoteCacheFlags() & ( Job::REMOTE_CACHE_HIT | Job::REMOTE_CACHE_STORED ) ) );
+                }
 
                 // write the data - build result for success, or output+errors for failure
                 ms.Write( (uint32_t)job->GetDataSize() );
@@ -801,6 +1121,10 @@ void Server::RequestMissingFiles( const ConnectionInfo * connection, ToolManifes
 {
     MutexHolder manifestMH( m_ToolManifestsMutex );
 
+    // Only chunks we don't already have are requested, if the Client supports it
+    const ClientState * cs = (const ClientState *)connection->GetUserData();
+    const bool requestChunks = ( manifest->HasChunks() && ( cs->m_ProtocolVersionMinor >= 11 ) );
+
     const Array<ToolManifestFile> & files = manifest->GetFiles();
     const size_t numFiles = files.GetSize();
     for ( size_t i = 0; i < numFiles; ++i )
@@ -809,8 +1133,18 @@ void Server::RequestMissingFiles( const ConnectionInfo * connection, ToolManifes
         if ( f.GetSyncState() == ToolManifestFile::NOT_SYNCHRONIZED )
         {
             // request this file
-            const Protocol::MsgRequestFile reqFileMsg( manifest->GetToolId(), (uint32_t)i );
-            reqFileMsg.Send( connection );
+            if ( requestChunks )
+            {
+                MemoryStream ms;
+                ms.Write( f.GetMissingChunks() );
+                const Protocol::MsgRequestFileChunks reqChunksMsg( manifest->GetToolId(), (uint32_t)i );
+                reqChunksMsg.Send( connection, ms );
+            }
+            else
+            {
+                const Protocol::MsgRequestFile reqFileMsg( manifest->GetToolId(), (uint32_t)i );
+                reqFileMsg.Send( connection );
+            }
 
             // prevent it being requested again
             manifest->MarkFileAsSynchronizing( i );
@@ -10,17 +10,24 @@
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class CompressionDictionary;
+class HeaderFragmentStore;
 class Job;
+class JobDataBuffer;
 class JobQueueRemote;
 namespace Protocol
 {
     class IMessage;
+    class MsgCompressionDictionary;
     class MsgConnection;
     class MsgJob;
+    class MsgJobs;
     class MsgManifest;
     class MsgNoJobAvailable;
     class MsgStatus;
     class MsgFile;
+    class MsgFileChunks;
+    class MsgPrepareToolchain;
 }
 class ToolManifest;
 
@@ -36,6 +43,12 @@ public:
 
     bool IsSynchingTool( AString & statusStr ) const;
 
+    // Idle score reported to Clients (from idle detection on the worker)
+    void SetIdlePercent( uint32_t idlePercent ) { m_IdlePercent.Store( idlePercent ); }
+
+    // Toolchains synchronized ahead of any job needing them (MsgPrepareToolchain)
+    uint32_t GetNumToolchainsPrepared() const { return m_NumToolchainsPrepared.Load(); }
+
 private:
     // TCPConnection interface
     virtual void OnConnected( const ConnectionInfo * connection ) override;
@@ -46,9 +59,13 @@ private:
     void Process( const ConnectionInfo * connection, const Protocol::MsgConnection * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgStatus * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgNoJobAvailable * msg );
-    void Process( const ConnectionInfo * connection, const Protocol::MsgJob * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgJob * msg, void * payload, size_t payloadSize ); // Takes ownership of payload
+    void Process( const ConnectionInfo * connection, const Protocol::MsgJobs * msg, void * payload, size_t payloadSize ); // Takes ownership of payload
+    void Process( const ConnectionInfo * connection, const Protocol::MsgCompressionDictionary * msg, void * payload, size_t payloadSize ); // Takes ownership of payload
     void Process( const ConnectionInfo * connection, const Protocol::MsgManifest * msg, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgFile * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgFileChunks * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgPrepareToolchain * msg );
 
     static uint32_t ThreadFuncStatic( void * param );
     void ThreadFunc();
@@ -58,7 +75,18 @@ private:
     void TouchToolchains();
     void CheckWaitingJobs( const ToolManifest * manifest );
 
+    ToolManifest * SynchronizeTool( const ConnectionInfo * connection, uint64_t toolId );
     void RequestMissingFiles( const ConnectionInfo * connection, ToolManifest * manifest ) const;
+    void SendServerStatus( const ConnectionInfo * connection );
+
+    struct ClientState;
+    void ReceiveJob( const ConnectionInfo * connection,
+                     ClientState * cs,
+                     uint64_t toolId,
+                     int16_t resultCompressionLevel,
+                     JobDataBuffer * dataBuffer,
+                     const void * data,
+                     size_t dataSize );
 
     struct ClientState
     {
@@ -82,6 +110,8 @@ private:
         AString m_HostName;
 
         Array<Job *> m_WaitingJobs; // jobs waiting for manifests/toolchains
+        CompressionDictionary * m_CompressionDictionary = nullptr; // for jobs which follow
+        HeaderFragmentStore * m_HeaderFragmentStore = nullptr; // fragments received, for jobs which follow
 
         Timer m_StatusTimer;
     };
@@ -92,6 +122,8 @@ private:
     Thread m_Thread; // the thread to manage workload
     Mutex m_ClientListMutex;
     Array<ClientState *> m_ClientList;
+    Atomic<uint32_t> m_IdlePercent{ 100 };
+    Atomic<uint32_t> m_NumToolchainsPrepared;
 
     mutable Mutex m_ToolManifestsMutex;
     Array<ToolManifest *> m_Tools;
@@ -0,0 +1,212 @@
+// BrokerageService - In-memory worker discovery
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "BrokerageService.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+
+// Static Data
+//------------------------------------------------------------------------------
+static const float sBrokerageServiceWorkerTimeout = ( 30.0f ); // Forget workers which stop sending heartbeats
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+BrokerageService::BrokerageService() = default;
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+BrokerageService::~BrokerageService()
+{
+    ShutdownAllConnections();
+
+    // Records are normally removed on disconnection
+    for ( WorkerRecord * worker : m_Workers )
+    {
+        FDELETE worker;
+    }
+}
+
+// GetNumWorkers
+//------------------------------------------------------------------------------
+size_t BrokerageService::GetNumWorkers() const
+{
+    MutexHolder mh( m_WorkersMutex );
+    return m_Workers.GetSize();
+}
+
+// OnDisconnected
+//------------------------------------------------------------------------------
+/*virtual*/ void BrokerageService::OnDisconnected( const ConnectionInfo * connection )
+{
+    // Forget the worker (if it is one)
+    WorkerRecord * worker = static_cast<WorkerRecord *>( connection->GetUserData() );
+    if ( worker )
+    {
+        {
+            MutexHolder mh( m_WorkersMutex );
+            WorkerRecord ** iter = m_Workers.Find( worker );
+            ASSERT( iter );
+            m_Workers.Erase( iter );
+        }
+        FDELETE worker;
+        connection->SetUserData( nullptr );
+    }
+}
+
+// OnReceive
+//------------------------------------------------------------------------------
+/*virtual*/ void BrokerageService::OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & /*keepMemory*/ )
+{
+    // All messages to the service are without a payload, but they may come
+    // from anywhere so are checked before use
+    const Protocol::IMessage * imsg = static_cast<const Protocol::IMessage *>( data );
+    if ( ( size < sizeof( Protocol::IMessage ) ) ||
+         ( imsg->GetSize() != size ) ||
+         ( imsg->HasPayload() ) )
+    {
+        Disconnect( connection );
+        return;
+    }
+
+    switch ( imsg->GetType() )
+    {
+        case Protocol::MSG_BROKERAGE_HEARTBEAT:
+        {
+            if ( size == sizeof( Protocol::MsgBrokerageHeartbeat ) )
+            {
+                Process( connection, static_cast<const Protocol::MsgBrokerageHeartbeat *>( imsg ) );
+                return;
+            }
+            break;
+        }
+        case Protocol::MSG_BROKERAGE_QUERY:
+        {
+            if ( size == sizeof( Protocol::MsgBrokerageQuery ) )
+            {
+                Process( connection, static_cast<const Protocol::MsgBrokerageQuery *>( imsg ) );
+                return;
+            }
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+
+    // unknown or malformed message
+    Disconnect( connection );
+}
+
+// Process( MsgBrokerageHeartbeat )
+//------------------------------------------------------------------------------
+void BrokerageService::Process( const ConnectionInfo * connection, const Protocol::MsgBrokerageHeartbeat * msg )
+{
+    // Address is null terminated, unless malformed
+    const char * address = msg->GetWorkerAddress();
+    const char * addressEnd = address;
+    while ( ( *addressEnd != 0 ) && ( addressEnd < ( address + 63 ) ) )
+    {
+        ++addressEnd;
+    }
+
+    MutexHolder mh( m_WorkersMutex );
+
+    // First heartbeat registers the worker
+    WorkerRecord * worker = static_cast<WorkerRecord *>( connection->GetUserData() );
+    if ( worker == nullptr )
+    {
+        worker = FNEW( WorkerRecord );
+        worker->m_Connection = connection;
+        connection->SetUserData( worker );
+        m_Workers.Append( worker );
+    }
+
+    worker->m_Address.Assign( address, addressEnd );
+    worker->m_ProtocolVersion = msg->GetProtocolVersion();
+    worker->m_Platform = msg->GetPlatform();
+    worker->m_Available = msg->IsAvailable();
+    worker->m_NumCPUsAvailable = msg->GetNumCPUsAvailable();
+    worker->m_NumCPUsTotal = msg->GetNumCPUsTotal();
+    worker->m_NumJobsActive = msg->GetNumJobsActive();
+    worker->m_FreeMemoryMiB = msg->GetFreeMemoryMiB();
+    worker->m_LastHeartbeat.Restart();
+}
+
+// Process( MsgBrokerageQuery )
+//------------------------------------------------------------------------------
+void BrokerageService::Process( const ConnectionInfo * connection, const Protocol::MsgBrokerageQuery * msg )
+{
+    PROFILE_FUNCTION;
+
+    // Compatible workers which are available and still alive
+    class Candidate
+    {
+    public:
+        const AString * m_Address;
+        uint32_t m_NumCPUsSpare;
+        uint32_t m_NumCPUsAvailable;
+    };
+    Array<AString> workers;
+    {
+        MutexHolder mh( m_WorkersMutex );
+
+        Array<Candidate> candidates;
+        candidates.SetCapacity( m_Workers.GetSize() );
+        for ( const WorkerRecord * worker : m_Workers )
+        {
+            if ( ( worker->m_ProtocolVersion != msg->GetProtocolVersion() ) ||
+                 ( worker->m_Platform != msg->GetPlatform() ) ||
+                 ( worker->m_Available == false ) ||
+                 ( worker->m_NumCPUsAvailable == 0 ) ||
+                 ( worker->m_Address.IsEmpty() ) ||
+                 ( worker->m_LastHeartbeat.GetElapsed() > sBrokerageServiceWorkerTimeout ) )
+            {
+                continue;
+            }
+            const uint32_t numCPUsSpare = ( worker->m_NumCPUsAvailable > worker->m_NumJobsActive ) ? ( worker->m_NumCPUsAvailable - worker->m_NumJobsActive ) : 0;
+            candidates.Append( Candidate{ &worker->m_Address, numCPUsSpare, worker->m_NumCPUsAvailable } );
+        }
+
+        // Most spare CPUs first
+        class CandidateSorter
+        {
+        public:
+            bool operator()( const Candidate & a, const Candidate & b ) const
+            {
+                if ( a.m_NumCPUsSpare != b.m_NumCPUsSpare )
+                {
+                    return ( a.m_NumCPUsSpare > b.m_NumCPUsSpare );
+                }
+                if ( a.m_NumCPUsAvailable != b.m_NumCPUsAvailable )
+                {
+                    return ( a.m_NumCPUsAvailable > b.m_NumCPUsAvailable );
+                }
+                return ( *a.m_Address < *b.m_Address );
+            }
+        };
+        candidates.Sort( CandidateSorter() );
+
+        workers.SetCapacity( candidates.GetSize() );
+        for ( const Candidate & candidate : candidates )
+        {
+            workers.Append( *candidate.m_Address );
+        }
+    }
+
+    MemoryStream ms;
+    ms.Write( workers );
+    const Protocol::MsgBrokerageWorkers reply;
+    reply.Send( connection, ms );
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,66 @@
+// BrokerageService - In-memory worker discovery
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Network/TCPConnectionPool.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Strings/AString.h"
+#include "Core/Time/Timer.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+namespace Protocol
+{
+    class MsgBrokerageHeartbeat;
+    class MsgBrokerageQuery;
+}
+
+// BrokerageService
+//  - An alternative to the brokerage path, for large numbers of workers.
+//  - Workers stay connected, sending heartbeats with their availability,
+//    capabilities and load, which are kept in memory. A worker is forgotten
+//    as soon as it disconnects (or stops sending heartbeats).
+//  - Clients query the available workers, without any file system access.
+//------------------------------------------------------------------------------
+class BrokerageService : public TCPConnectionPool
+{
+public:
+    explicit BrokerageService();
+    virtual ~BrokerageService() override;
+
+    // Number of workers currently registered (available or not)
+    size_t GetNumWorkers() const;
+
+private:
+    // TCPConnectionPool interface
+    virtual void OnDisconnected( const ConnectionInfo * connection ) override;
+    virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory ) override;
+
+    // helpers to handle messages
+    void Process( const ConnectionInfo * connection, const Protocol::MsgBrokerageHeartbeat * msg );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgBrokerageQuery * msg );
+
+    class WorkerRecord
+    {
+    public:
+        const ConnectionInfo * m_Connection = nullptr;
+        AString m_Address;
+        uint32_t m_ProtocolVersion = 0;
+        uint8_t m_Platform = 0;
+        bool m_Available = false;
+        uint32_t m_NumCPUsAvailable = 0;
+        uint32_t m_NumCPUsTotal = 0;
+        uint32_t m_NumJobsActive = 0;
+        uint32_t m_FreeMemoryMiB = 0;
+        Timer m_LastHeartbeat;
+    };
+
+    mutable Mutex m_WorkersMutex;
+    Array<WorkerRecord *> m_Workers;
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,209 @@
+// BrokerageServiceConnection - Connection to a BrokerageService
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "BrokerageServiceConnection.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
+
+// Core
+#include "Core/Containers/Move.h"
+#include "Core/Env/Assert.h"
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+BrokerageServiceConnection::BrokerageServiceConnection() = default;
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+BrokerageServiceConnection::~BrokerageServiceConnection()
+{
+    ShutdownAllConnections();
+
+    // Free message if disconnected while waiting for the payload
+    if ( m_CurrentMessage )
+    {
+        FREE( (void *)( m_CurrentMessage ) );
+    }
+}
+
+// ConnectToService
+//------------------------------------------------------------------------------
+bool BrokerageServiceConnection::ConnectToService( const AString & serviceAddress, uint32_t timeoutMS )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( IsConnected() == false );
+
+    // Optional port
+    AStackString host( serviceAddress );
+    uint16_t port = Protocol::kBrokeragePort;
+    const char * portSeparator = serviceAddress.FindLast( ':' );
+    if ( portSeparator )
+    {
+        uint32_t customPort = 0;
+        if ( ( AString::ScanS( portSeparator + 1, "%u", &customPort ) != 1 ) ||
+             ( customPort == 0 ) ||
+             ( customPort > 0xFFFF ) )
+        {
+            return false;
+        }
+        port = static_cast<uint16_t>( customPort );
+        host.Assign( serviceAddress.Get(), portSeparator );
+    }
+
+    const ConnectionInfo * connection = Connect( host, port, timeoutMS );
+    if ( connection == nullptr )
+    {
+        return false;
+    }
+
+    MutexHolder mh( m_Mutex );
+    m_Connection = connection;
+    return true;
+}
+
+// IsConnected
+//------------------------------------------------------------------------------
+bool BrokerageServiceConnection::IsConnected() const
+{
+    MutexHolder mh( m_Mutex );
+    return ( m_Connection != nullptr );
+}
+
+// SendHeartbeat
+//------------------------------------------------------------------------------
+bool BrokerageServiceConnection::SendHeartbeat( const AString & workerAddress,
+                                                bool available,
+                                                uint32_t numCPUsAvailable,
+                                                uint32_t numCPUsTotal,
+                                                uint32_t numJobsActive,
+                                                uint32_t freeMemoryMiB )
+{
+    MutexHolder mh( m_Mutex );
+    if ( m_Connection == nullptr )
+    {
+        return false;
+    }
+
+    const Protocol::MsgBrokerageHeartbeat msg( workerAddress,
+                                               available,
+                                               numCPUsAvailable,
+                                               numCPUsTotal,
+                                               numJobsActive,
+                                               freeMemoryMiB );
+    return msg.Send( m_Connection );
+}
+
+// QueryWorkers
+//------------------------------------------------------------------------------
+bool BrokerageServiceConnection::QueryWorkers( Array<AString> & outWorkers, uint32_t timeoutMS )
+{
+    PROFILE_FUNCTION;
+
+    {
+        MutexHolder mh( m_Mutex );
+        if ( m_Connection == nullptr )
+        {
+            return false;
+        }
+
+        m_QueryResult.Clear();
+        m_QueryResultReceived = false;
+
+        const Protocol::MsgBrokerageQuery msg;
+        if ( msg.Send( m_Connection ) == false )
+        {
+            return false;
+        }
+    }
+
+    // Wait for the reply (or disconnection)
+    const bool signalled = m_QueryResultSemaphore.Wait( timeoutMS );
+
+    MutexHolder mh( m_Mutex );
+    if ( m_QueryResultReceived )
+    {
+        outWorkers.Append( m_QueryResult );
+        m_QueryResult.Clear();
+        m_QueryResultReceived = false;
+        return true;
+    }
+
+    // An unresponsive service is abandoned so a late reply can't be
+    // mistaken for the reply to a later query
+    if ( ( signalled == false ) && m_Connection )
+    {
+        Disconnect( m_Connection );
+    }
+    return false;
+}
+
+// OnDisconnected
+//------------------------------------------------------------------------------
+/*virtual*/ void BrokerageServiceConnection::OnDisconnected( const ConnectionInfo * connection )
+{
+    MutexHolder mh( m_Mutex );
+    if ( connection == m_Connection )
+    {
+        m_Connection = nullptr;
+
+        // Unblock any query in progress
+        m_QueryResultSemaphore.Signal();
+    }
+}
+
+// OnReceive
+//------------------------------------------------------------------------------
+/*virtual*/ void BrokerageServiceConnection::OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory )
+{
+    keepMemory = true; // we'll take care of freeing the memory
+
+    // are we expecting a msg, or the payload for a msg?
+    if ( m_CurrentMessage == nullptr )
+    {
+        // message
+        m_CurrentMessage = static_cast<const Protocol::IMessage *>( data );
+        if ( ( size == sizeof( Protocol::MsgBrokerageWorkers ) ) &&
+             ( m_CurrentMessage->GetType() == Protocol::MSG_BROKERAGE_WORKERS ) &&
+             m_CurrentMessage->HasPayload() )
+        {
+            return; // wait for the payload
+        }
+
+        // Only the list of workers is expected
+        Disconnect( connection );
+        FREE( data );
+        m_CurrentMessage = nullptr;
+        return;
+    }
+
+    // payload
+    Array<AString> workers;
+    ConstMemoryStream ms( data, size );
+    const bool ok = ms.Read( workers );
+    FREE( data );
+    FREE( (void *)( m_CurrentMessage ) );
+    m_CurrentMessage = nullptr;
+
+    if ( ok == false )
+    {
+        Disconnect( connection );
+        return;
+    }
+
+    {
+        MutexHolder mh( m_Mutex );
+        m_QueryResult = Move( workers );
+        m_QueryResultReceived = true;
+    }
+    m_QueryResultSemaphore.Signal();
+}
+
+//------------------------------------------------------------------------------
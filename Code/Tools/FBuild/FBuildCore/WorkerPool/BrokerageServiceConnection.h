@@ -0,0 +1,58 @@
+// BrokerageServiceConnection - Connection to a BrokerageService
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Network/TCPConnectionPool.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Semaphore.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+namespace Protocol
+{
+    class IMessage;
+}
+
+// BrokerageServiceConnection
+//  - Used by workers to send heartbeats and by clients to query workers
+//------------------------------------------------------------------------------
+class BrokerageServiceConnection : public TCPConnectionPool
+{
+public:
+    explicit BrokerageServiceConnection();
+    virtual ~BrokerageServiceConnection() override;
+
+    // Address is "host" or "host:port"
+    bool ConnectToService( const AString & serviceAddress, uint32_t timeoutMS );
+    bool IsConnected() const;
+
+    // Worker side
+    bool SendHeartbeat( const AString & workerAddress,
+                        bool available,
+                        uint32_t numCPUsAvailable,
+                        uint32_t numCPUsTotal,
+                        uint32_t numJobsActive,
+                        uint32_t freeMemoryMiB );
+
+    // Client side
+    bool QueryWorkers( Array<AString> & outWorkers, uint32_t timeoutMS );
+
+private:
+    // TCPConnectionPool interface
+    virtual void OnDisconnected( const ConnectionInfo * connection ) override;
+    virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory ) override;
+
+    mutable Mutex m_Mutex;
+    const ConnectionInfo * m_Connection = nullptr;
+    const Protocol::IMessage * m_CurrentMessage = nullptr;
+    Array<AString> m_QueryResult;
+    bool m_QueryResultReceived = false;
+    Semaphore m_QueryResultSemaphore;
+};
+
+//------------------------------------------------------------------------------
@@ -8,9 +8,11 @@
 // FBuildCore
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompressionDictionary.h"
 
 // Core
 #include "Core/Env/Assert.h"
+#include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/IOStream.h"
 #include "Core/Process/Atomic.h"
@@ -25,11 +27,37 @@
 static uint32_t s_LastJobId( 0 );
 /*static*/ Atomic<int64_t> Job::s_TotalLocalDataMemoryUsage( 0 );
 
+// JobDataBuffer - CONSTRUCTOR
+//------------------------------------------------------------------------------
+JobDataBuffer::JobDataBuffer( void * memory )
+    : m_Memory( memory )
+{
+}
+
+// JobDataBuffer - DESTRUCTOR
+//------------------------------------------------------------------------------
+JobDataBuffer::~JobDataBuffer()
+{
+    FREE( m_Memory );
+}
+
+// JobDataBuffer::Release
+//------------------------------------------------------------------------------
+void JobDataBuffer::Release()
+{
+    ASSERT( m_RefCount.Load() > 0 );
+    if ( m_RefCount.Decrement() == 0 )
+    {
+        FDELETE this;
+    }
+}
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 Job::Job( Node * node )
     : m_Node( node )
     , m_DataIsCompressed( false )
+    , m_DataIsHeaderFragments( false )
     , m_IsLocal( true )
     , m_AllowZstdUse( false )
 {
@@ -40,12 +68,13 @@ Job::Job( Node * node )
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
-Job::Job( IOStream & stream )
+Job::Job( ConstMemoryStream & stream, JobDataBuffer * dataBuffer )
     : m_DataIsCompressed( false )
+    , m_DataIsHeaderFragments( false )
     , m_IsLocal( false )
     , m_AllowZstdUse( false )
 {
-    Deserialize( stream );
+    Deserialize( stream, dataBuffer );
 }
 
 // DESTRUCTOR
@@ -56,6 +85,7 @@ Job::~Job()
     {
         OwnData( nullptr, 0, false );
     }
+    SetCompressionDictionary( nullptr );
 
     if ( m_IsLocal == false )
     {
@@ -89,7 +119,13 @@ void Job::OwnData( void * data, size_t size, bool compressed )
     ASSERT( data != m_Data ); // Invalid to set redundantly
 
     // Free any old data
-    if ( m_Data )
+    if ( m_DataBuffer )
+    {
+        // Data is within a buffer which might be shared with other jobs
+        m_DataBuffer->Release();
+        m_DataBuffer = nullptr;
+    }
+    else if ( m_Data )
     {
         FREE( m_Data );
 
@@ -104,6 +140,7 @@ void Job::OwnData( void * data, size_t size, bool compressed )
     m_Data = data;
     m_DataSize = (uint32_t)size;
     m_DataIsCompressed = compressed;
+    m_DataIsHeaderFragments = false;
 
     // Update total memory use tracking
     if ( m_IsLocal )
@@ -112,6 +149,21 @@ void Job::OwnData( void * data, size_t size, bool compressed )
     }
 }
 
+// SetCompressionDictionary
+//------------------------------------------------------------------------------
+void Job::SetCompressionDictionary( CompressionDictionary * dictionary )
+{
+    if ( dictionary )
+    {
+        dictionary->AddRef();
+    }
+    if ( m_CompressionDictionary )
+    {
+        m_CompressionDictionary->Release();
+    }
+    m_CompressionDictionary = dictionary;
+}
+
 // Error
 //------------------------------------------------------------------------------
 void Job::Error( MSVC_SAL_PRINTF const char * format, ... )
@@ -164,10 +216,27 @@ void Job::SetMessages( const Array<AString> & messages )
     m_Messages = messages;
 }
 
-// Serialize
+// SerializeHeader
 //------------------------------------------------------------------------------
-void Job::Serialize( IOStream & stream )
+void Job::SerializeHeader( IOStream & stream, uint8_t remoteCacheFlags ) const
 {
+    SerializeHeaderCommon( stream, IsDataCompressed() ? DATA_COMPRESSED : DATA_UNCOMPRESSED, m_DataSize, remoteCacheFlags );
+}
+
+// SerializeHeaderForHeaderFragments
+//------------------------------------------------------------------------------
+void Job::SerializeHeaderForHeaderFragments( IOStream & stream, uint32_t dataSize, uint8_t remoteCacheFlags ) const
+{
+    SerializeHeaderCommon( stream, DATA_HEADER_FRAGMENTS, dataSize, remoteCacheFlags );
+}
+
+// SerializeHeaderCommon
+//------------------------------------------------------------------------------
+void Job::SerializeHeaderCommon( IOStream & stream, DataFormat dataFormat, uint32_t dataSize, uint8_t remoteCacheFlags ) const
+{
+    ASSERT( ( remoteCacheFlags & ~( REMOTE_CACHE_READ | REMOTE_CACHE_WRITE ) ) == 0 );
+    ASSERT( ( remoteCacheFlags == 0 ) || ( m_CacheName.IsEmpty() == false ) );
+
     PROFILE_FUNCTION;
 
     // write jobid
@@ -180,15 +249,19 @@ void Job::Serialize( IOStream & stream )
     // write properties of node
     Node::SaveRemote( stream, m_Node );
 
-    stream.Write( IsDataCompressed() );
+    // Compatible with older versions, which serialized a "compressed" bool
+    stream.Write( static_cast<uint8_t>( dataFormat | remoteCacheFlags ) );
+    if ( remoteCacheFlags != 0 )
+    {
+        stream.Write( m_CacheName );
+    }
 
-    stream.Write( m_DataSize );
-    stream.Write( m_Data, m_DataSize );
+    stream.Write( dataSize );
 }
 
 // Deserialize
 //------------------------------------------------------------------------------
-void Job::Deserialize( IOStream & stream )
+void Job::Deserialize( ConstMemoryStream & stream, JobDataBuffer * dataBuffer )
 {
     // read jobid
     stream.Read( m_JobId );
@@ -198,16 +271,26 @@ void Job::Deserialize( IOStream & stream )
     // read properties of node
     m_Node = Node::LoadRemote( stream );
 
-    bool compressed;
-    stream.Read( compressed );
+    uint8_t dataFormat;
+    stream.Read( dataFormat );
+    m_RemoteCacheFlags = static_cast<uint8_t>( dataFormat & ~DATA_FORMAT_MASK );
+    dataFormat &= DATA_FORMAT_MASK;
+    if ( m_RemoteCacheFlags != 0 )
+    {
+        stream.Read( m_CacheName );
+    }
 
-    // read extra data
+    // reference extra data in place
     uint32_t dataSize;
     stream.Read( dataSize );
-    void * data = ALLOC( dataSize );
-    stream.Read( data, dataSize );
-
-    OwnData( data, dataSize, compressed );
+    ASSERT( ( stream.GetSize() - static_cast<size_t>( stream.Tell() ) ) >= dataSize );
+    void * data = const_cast<uint8_t *>( static_cast<const uint8_t *>( stream.GetData() ) + stream.Tell() );
+    stream.Seek( stream.Tell() + dataSize );
+
+    OwnData( data, dataSize, ( dataFormat == DATA_COMPRESSED ) );
+    m_DataIsHeaderFragments = ( dataFormat == DATA_HEADER_FRAGMENTS );
+    dataBuffer->AddRef();
+    m_DataBuffer = dataBuffer;
 }
 
 // GetMessagesForLog
@@ -4,6 +4,7 @@
 
 // Includes
 //------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
 #include "Core/Env/MSVCStaticAnalysis.h"
 #include "Core/Env/Types.h"
 #include "Core/Process/Atomic.h"
@@ -12,17 +13,39 @@
 // Forward Declarations
 //------------------------------------------------------------------------------
 class BuildProfilerScope;
+class CompressionDictionary;
+class ConstMemoryStream;
+class HeaderFragment;
 class IOStream;
 class Node;
 class ToolManifest;
 
+// JobDataBuffer
+//  - Received memory holding the data for one or more jobs, which reference
+//    their data in place. Freed when the last reference is released.
+//------------------------------------------------------------------------------
+class JobDataBuffer
+{
+public:
+    explicit JobDataBuffer( void * memory );
+
+    void AddRef() { m_RefCount.Increment(); }
+    void Release();
+
+private:
+    ~JobDataBuffer();
+
+    void * m_Memory;
+    Atomic<uint32_t> m_RefCount{ 1 };
+};
+
 // Job
 //------------------------------------------------------------------------------
 class Job
 {
 public:
     explicit Job( Node * node );
-    explicit Job( IOStream & stream );
+    explicit Job( ConstMemoryStream & stream, JobDataBuffer * dataBuffer );
     ~Job();
 
     uint32_t GetJobId() const { return m_JobId; }
@@ -35,6 +58,17 @@ public:
     void SetCacheName( const AString & cacheName ) { m_CacheName = cacheName; }
     const AString & GetCacheName() const { return m_CacheName; }
 
+    // use of the worker's cache (v22.9 or later)
+    enum RemoteCacheFlags : uint8_t
+    {
+        REMOTE_CACHE_READ = 0x10, // Client -> Worker : Result can be retrieved from the cache
+        REMOTE_CACHE_WRITE = 0x20, // Client -> Worker : Result can be stored to the cache
+        REMOTE_CACHE_HIT = 0x40, // Worker -> Client : Result was retrieved from the cache
+        REMOTE_CACHE_STORED = 0x80, // Worker -> Client : Result was stored to the cache
+    };
+    void SetRemoteCacheFlags( uint8_t flags ) { m_RemoteCacheFlags = flags; }
+    uint8_t GetRemoteCacheFlags() const { return m_RemoteCacheFlags; }
+
     const volatile bool * GetAbortFlagPointer() const { return &m_Abort; }
     void CancelDueToRemoteRaceWin();
 
@@ -51,6 +85,16 @@ public:
     ToolManifest * GetToolManifest() const { return m_ToolManifest; }
 
     bool IsDataCompressed() const { return m_DataIsCompressed; }
+
+    // dictionary needed to decompress the data (if it was compressed with one)
+    void SetCompressionDictionary( CompressionDictionary * dictionary );
+    CompressionDictionary * GetCompressionDictionary() const { return m_CompressionDictionary; }
+
+    // data split into fragments, which can be sent deduplicated (see HeaderFragmentStore)
+    void SetHeaderFragments( Array<const HeaderFragment *> && fragments ) { m_HeaderFragments = Move( fragments ); }
+    const Array<const HeaderFragment *> & GetHeaderFragments() const { return m_HeaderFragments; }
+    bool IsDataHeaderFragments() const { return m_DataIsHeaderFragments; } // received data must be reassembled
+
     bool IsLocal() const { return m_IsLocal; }
 
     const Array<AString> & GetMessages() const { return m_Messages; }
@@ -65,8 +109,13 @@ public:
     uint8_t GetSystemErrorCount() const { return m_SystemErrorCount; }
 
     // serialization for remote distribution
-    void Serialize( IOStream & stream );
-    void Deserialize( IOStream & stream );
+    // - the data is not written, so it can be sent from where it is (see GetData)
+    // - the data is expected to follow, and is referenced in place in the dataBuffer
+    // - alternatively, the data can be sent as header fragments (v22.8 or later)
+    // - the cache name is sent if the worker can use its cache (v22.9 or later)
+    void SerializeHeader( IOStream & stream, uint8_t remoteCacheFlags ) const;
+    void SerializeHeaderForHeaderFragments( IOStream & stream, uint32_t dataSize, uint8_t remoteCacheFlags ) const;
+    void Deserialize( ConstMemoryStream & stream, JobDataBuffer * dataBuffer );
 
     void GetMessagesForLog( AString & buffer ) const;
     static void GetMessagesForLog( const Array<AString> & messages, AString & buffer );
@@ -110,16 +159,30 @@ public:
     BuildProfilerScope * GetBuildProfilerScope() const { return m_BuildProfilerScope; }
 
 private:
+    // Format of the data, as serialized
+    enum DataFormat : uint8_t
+    {
+        DATA_UNCOMPRESSED = 0,
+        DATA_COMPRESSED = 1,
+        DATA_HEADER_FRAGMENTS = 2, // v22.8 or later
+
+        DATA_FORMAT_MASK = 0x0F, // Remaining bits are RemoteCacheFlags
+    };
+    void SerializeHeaderCommon( IOStream & stream, DataFormat dataFormat, uint32_t dataSize, uint8_t remoteCacheFlags ) const;
+
     uint32_t m_JobId = 0;
     uint32_t m_DataSize = 0;
     Node * m_Node = nullptr;
     void * m_Data = nullptr;
     void * m_UserData = nullptr;
+    JobDataBuffer * m_DataBuffer = nullptr; // If set, m_Data is within this (shared) buffer
     volatile bool m_Abort = false;
     bool m_DataIsCompressed:1;
+    bool m_DataIsHeaderFragments:1;
     bool m_IsLocal:1;
     bool m_AllowZstdUse:1; // Can client accept Zstd results?
     uint8_t m_SystemErrorCount = 0; // On client, the total error count, on the worker a flag for the current attempt
+    uint8_t m_RemoteCacheFlags = 0; // RemoteCacheFlags
     DistributionState m_DistributionState = DIST_NONE;
     int16_t m_ResultCompressionLevel = 0; // Compression level of returned results
     uint16_t m_RemoteThreadIndex = 0; // On server, the thread index used to build
@@ -128,6 +191,8 @@ private:
     AString m_CacheName;
     BuildProfilerScope * m_BuildProfilerScope = nullptr; // Additional context when profiling a build
     ToolManifest * m_ToolManifest = nullptr;
+    CompressionDictionary * m_CompressionDictionary = nullptr;
+    Array<const HeaderFragment *> m_HeaderFragments;
 
     Array<AString> m_Messages;
 
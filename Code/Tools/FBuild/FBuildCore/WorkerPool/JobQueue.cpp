@@ -10,13 +10,16 @@
 // FBuildCore
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Graph/CompilerNode.h"
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Graph/SettingsNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
+#include "Tools/FBuild/FBuildCore/Helpers/DirectorySnapshotCache.h"
 
 // Core
 #include "Core/FileIO/FileIO.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Process/ThreadPool.h"
 #include "Core/Profile/Profile.h"
@@ -29,14 +32,16 @@ class JobCostSorter
 public:
     bool operator()( const Job * job1, const Job * job2 ) const
     {
-        return ( job1->GetNode()->GetRecursiveCost() < job2->GetNode()->GetRecursiveCost() );
+        return ( job1->GetNode()->GetRecursiveCost() > job2->GetNode()->GetRecursiveCost() );
     }
 };
 
 // JobSubQueue CONSTRUCTOR
 //------------------------------------------------------------------------------
-JobSubQueue::JobSubQueue()
-    : m_Count( 0 )
+JobSubQueue::JobSubQueue( uint32_t numShards )
+    : m_NumShards( Math::Max( numShards, 1U ) )
+    , m_NextShard( 0 )
+    , m_Shards( FNEW_ARRAY( WorkStealingQueue<Job *>[ kNumCostBuckets * m_NumShards ] ) )
 {
 }
 
@@ -44,15 +49,20 @@ JobSubQueue::JobSubQueue()
 //------------------------------------------------------------------------------
 JobSubQueue::~JobSubQueue()
 {
-    ASSERT( m_Jobs.IsEmpty() );
-    ASSERT( AtomicLoadRelaxed( &m_Count ) == 0 );
+    ASSERT( GetCount() == 0 );
+    FDELETE_ARRAY m_Shards;
 }
 
 // GetCount
 //------------------------------------------------------------------------------
 uint32_t JobSubQueue::GetCount() const
 {
-    return AtomicLoadRelaxed( &m_Count );
+    uint32_t count = 0;
+    for ( const CostBucket & bucket : m_Buckets )
+    {
+        count += AtomicLoadRelaxed( &bucket.m_Count );
+    }
+    return count;
 }
 
 // JobSubQueue:QueueJobs
@@ -70,84 +80,92 @@ void JobSubQueue::QueueJobs( Array<Node *> & nodes )
         jobs.Append( job );
     }
 
-    // Sort Jobs by cost
+    // Sort Jobs by cost, most expensive first. Items are taken from each
+    // shard in the order they are added, so within a bucket the most
+    // expensive jobs from this batch will be taken first.
     JobCostSorter sorter;
     jobs.Sort( sorter );
 
-    // lock to add job
-    MutexHolder mh( m_Mutex );
-    const bool wasEmpty = m_Jobs.IsEmpty();
-
-    AtomicAdd( &m_Count, (uint32_t)jobs.GetSize() );
-
-    if ( wasEmpty )
-    {
-        m_Jobs.Swap( jobs );
-        return; // skip re-sorting
-    }
-
-    // Merge lists
-    Array<Job *> mergedList;
-    mergedList.SetSize( m_Jobs.GetSize() + jobs.GetSize() );
-    Job ** dst = mergedList.Begin();
-    Job ** src1 = m_Jobs.Begin();
-    const Job * const * end1 = m_Jobs.End();
-    Job ** src2 = jobs.Begin();
-    const Job * const * end2 = jobs.End();
-    while ( ( src1 < end1 ) && ( src2 < end2 ) )
+    // Distribute jobs across the shards of each bucket
+    const Job * const * const end = jobs.End();
+    Job ** it = jobs.Begin();
+    while ( it < end )
     {
-        if ( sorter( *src1, *src2 ) )
+        // Find the range of jobs in this bucket
+        const uint32_t bucketIndex = GetCostBucket( ( *it )->GetNode()->GetRecursiveCost() );
+        Job ** bucketEnd = it + 1;
+        while ( ( bucketEnd < end ) && ( GetCostBucket( ( *bucketEnd )->GetNode()->GetRecursiveCost() ) == bucketIndex ) )
         {
-            *dst++ = *src1++;
+            ++bucketEnd;
         }
-        else
+
+        // Update the count before the jobs are visible so it never underflows
+        AtomicAdd( &m_Buckets[ bucketIndex ].m_Count, static_cast<uint32_t>( bucketEnd - it ) );
+
+        WorkStealingQueue<Job *> * shards = &m_Shards[ bucketIndex * m_NumShards ];
+        for ( ; it < bucketEnd; ++it )
         {
-            *dst++ = *src2++;
+            shards[ m_NextShard ].Push( *it );
+            m_NextShard = ( m_NextShard + 1 ) % m_NumShards;
         }
     }
-    while ( src1 < end1 )
-    {
-        *dst++ = *src1++;
-    }
-    while ( src2 < end2 )
-    {
-        *dst++ = *src2++;
-    }
-    ASSERT( dst == mergedList.End() );
-    m_Jobs.Swap( mergedList );
 }
 
 // RemoveJob
 //------------------------------------------------------------------------------
 Job * JobSubQueue::RemoveJob()
 {
-    // lock-free early out if there are no jobs
-    if ( AtomicLoadRelaxed( &m_Count ) == 0 )
+    // Workers prefer their own shard (main thread is 0, workers start at 1)
+    const uint32_t homeShard = ( WorkerThread::GetThreadIndex() % m_NumShards );
+
+    // Take from the most expensive buckets first
+    for ( uint32_t bucketIndex = kNumCostBuckets; bucketIndex-- > 0; )
     {
-        return nullptr;
-    }
+        CostBucket & bucket = m_Buckets[ bucketIndex ];
 
-    // lock to remove job
-    MutexHolder mh( m_Mutex );
+        // lock-free early out if there are no jobs
+        if ( AtomicLoadRelaxed( &bucket.m_Count ) == 0 )
+        {
+            continue;
+        }
 
-    // possible that job has been removed between job count check and mutex lock
-    if ( m_Jobs.IsEmpty() )
-    {
-        return nullptr;
-    }
+        // Check own shard first, then try to steal from the others
+        WorkStealingQueue<Job *> * shards = &m_Shards[ bucketIndex * m_NumShards ];
+        for ( uint32_t i = 0; i < m_NumShards; ++i )
+        {
+            Job * job;
+            if ( shards[ ( homeShard + i ) % m_NumShards ].Steal( job ) )
+            {
+                VERIFY( AtomicDec( &bucket.m_Count ) != static_cast<uint32_t>( -1 ) );
+                return job;
+            }
+        }
 
-    VERIFY( AtomicDec( &m_Count ) != static_cast<uint32_t>( -1 ) );
+        // possible that jobs have been removed between count check and
+        // checking the shards
+    }
 
-    Job * job = m_Jobs.Top();
-    m_Jobs.Pop();
+    return nullptr;
+}
 
-    return job;
+// GetCostBucket
+//------------------------------------------------------------------------------
+/*static*/ uint32_t JobSubQueue::GetCostBucket( uint32_t recursiveCost )
+{
+    uint32_t bucketIndex = 0;
+    while ( recursiveCost )
+    {
+        recursiveCost >>= 1;
+        ++bucketIndex;
+    }
+    return Math::Min( bucketIndex, kNumCostBuckets - 1 );
 }
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 JobQueue::JobQueue( uint32_t numWorkerThreads, ThreadPool * threadPool )
-    : m_NumLocalJobsActive( 0 )
+    : m_LocalJobs_Available( numWorkerThreads )
+    , m_NumLocalJobsActive( 0 )
 #if defined( __WINDOWS__ )
     , m_MainThreadSemaphore( 1 ) // On Windows, take advantage of signalling limit
 #else
@@ -262,6 +280,56 @@ size_t JobQueue::GetNumDistributableJobsAvailable() const
     return m_DistributableJobs_Available.GetSize();
 }
 
+// GetToolManifestsForDistributableJobs
+//  - Toolchains used by available jobs, most used first
+//------------------------------------------------------------------------------
+void JobQueue::GetToolManifestsForDistributableJobs( Array<const ToolManifest *> & outManifests ) const
+{
+    PROFILE_FUNCTION;
+
+    class ToolManifestUsage
+    {
+    public:
+        const ToolManifest * m_Manifest;
+        uint32_t m_NumJobs;
+
+        bool operator<( const ToolManifestUsage & other ) const { return ( m_NumJobs > other.m_NumJobs ); }
+    };
+    StackArray<ToolManifestUsage> usages;
+    {
+        MutexHolder m( m_DistributedJobsMutex );
+        for ( const Job * job : m_DistributableJobs_Available )
+        {
+            const Node * compiler = job->GetNode()->CastTo<ObjectNode>()->GetCompiler();
+            const ToolManifest * manifest = &compiler->CastTo<CompilerNode>()->GetManifest();
+            ToolManifestUsage * usage = nullptr;
+            for ( ToolManifestUsage & existing : usages )
+            {
+                if ( existing.m_Manifest == manifest )
+                {
+                    usage = &existing;
+                    break;
+                }
+            }
+            if ( usage )
+            {
+                ++usage->m_NumJobs;
+            }
+            else
+            {
+                usages.Append( ToolManifestUsage{ manifest, 1 } );
+            }
+        }
+    }
+
+    usages.Sort();
+    outManifests.SetCapacity( outManifests.GetSize() + usages.GetSize() );
+    for ( const ToolManifestUsage & usage : usages )
+    {
+        outManifests.Append( usage.m_Manifest );
+    }
+}
+
 // GetJobStats
 //------------------------------------------------------------------------------
 void JobQueue::GetJobStats( uint32_t & numJobs,
@@ -478,6 +546,13 @@ Job * JobQueue::GetDistributableJobToProcess( bool remote, uint8_t workerMinorPr
                 continue;
             }
 
+            // Jobs compressed against a dictionary require minor protocol 7 or later
+            if ( potentialJob->GetCompressionDictionary() &&
+                 ( workerMinorProtocolVersion < 7 ) )
+            {
+                continue;
+            }
+
             job = potentialJob;
             m_DistributableJobs_Available.EraseIndex( static_cast<size_t>( i ) );
             break;
@@ -686,6 +761,7 @@ void JobQueue::FinalizeCompletedJobs( NodeGraph & nodeGraph )
     }
 
     // Process results
+    DirectorySnapshotCache * snapshotCache = FBuild::IsValid() ? FBuild::Get().GetDirectorySnapshotCache() : nullptr;
     Array<Job *> * jobArrays[] = { &m_CompletedJobs2,
                                    &m_CompletedJobsAborted2,
                                    &m_CompletedJobsFailed2 };
@@ -702,6 +778,12 @@ void JobQueue::FinalizeCompletedJobs( NodeGraph & nodeGraph )
             const uint8_t groupIndex = n->GetConcurrencyGroupIndex();
             m_ConcurrencyGroupsState[ groupIndex ].m_ActiveJobs -= 1;
 
+            // Directory walks by later nodes must see the files written
+            if ( n->IsAFile() && ( n->GetType() != Node::FILE_NODE ) && snapshotCache )
+            {
+                snapshotCache->OnFileWritten( n->GetName() );
+            }
+
             if ( completedJob )
             {
                 // Finalize completed jobs
@@ -720,6 +802,12 @@ void JobQueue::FinalizeCompletedJobs( NodeGraph & nodeGraph )
                 n->SetState( Node::FAILED );
             }
 
+            // Unblock nodes waiting on this one (-eventdriven)
+            if ( completedJob || failedJob )
+            {
+                nodeGraph.NotifyWaitingNodes( n );
+            }
+
             // Free normal jobs
             if ( job->GetDistributionState() == Job::DIST_NONE )
             {
@@ -779,6 +867,95 @@ void JobQueue::MainThreadWait( uint32_t maxWaitMS )
     m_MainThreadSemaphore.Wait( maxWaitMS );
 }
 
+// PrepareWaitingNodes
+//------------------------------------------------------------------------------
+void JobQueue::PrepareWaitingNodes( size_t numNodes )
+{
+    ASSERT( Thread::IsMainThread() );
+    m_NumPendingDependencies.Clear();
+    m_FirstWaitingNode.Clear();
+    m_WaitingNodes.Clear();
+    GrowWaitingNodes( numNodes );
+    m_WaitingNodes.SetCapacity( numNodes );
+}
+
+// AddWaitingNode
+//------------------------------------------------------------------------------
+void JobQueue::AddWaitingNode( Node * dependency, Node * waitingNode )
+{
+    ASSERT( Thread::IsMainThread() );
+
+    // Nodes can be created during the build (dynamic dependencies)
+    const uint32_t dependencyIndex = dependency->GetIndex();
+    const uint32_t waitingIndex = waitingNode->GetIndex();
+    GrowWaitingNodes( Math::Max( dependencyIndex, waitingIndex ) + 1 );
+
+    // Push onto the list of nodes waiting on the dependency
+    WaitingNode & entry = m_WaitingNodes.EmplaceBack();
+    entry.m_Node = waitingNode;
+    entry.m_Next = m_FirstWaitingNode[ dependencyIndex ];
+    m_FirstWaitingNode[ dependencyIndex ] = static_cast<uint32_t>( m_WaitingNodes.GetSize() - 1 );
+
+    m_NumPendingDependencies[ waitingIndex ]++;
+}
+
+// IsWaitingOnDependencies
+//------------------------------------------------------------------------------
+bool JobQueue::IsWaitingOnDependencies( const Node * node )
+{
+    ASSERT( Thread::IsMainThread() );
+    const uint32_t index = node->GetIndex();
+    return ( ( index < m_NumPendingDependencies.GetSize() ) && ( m_NumPendingDependencies[ index ] > 0 ) );
+}
+
+// OnNodeCompleted
+//------------------------------------------------------------------------------
+void JobQueue::OnNodeCompleted( const Node * completedNode, Array<Node *> & outReadyNodes )
+{
+    ASSERT( Thread::IsMainThread() );
+    const uint32_t completedIndex = completedNode->GetIndex();
+    if ( completedIndex >= m_FirstWaitingNode.GetSize() )
+    {
+        return; // Not using -eventdriven, or nothing waiting on this node
+    }
+
+    uint32_t entryIndex = m_FirstWaitingNode[ completedIndex ];
+    m_FirstWaitingNode[ completedIndex ] = kNoWaitingNode;
+    while ( entryIndex != kNoWaitingNode )
+    {
+        const WaitingNode & entry = m_WaitingNodes[ entryIndex ];
+        uint32_t & numPending = m_NumPendingDependencies[ entry.m_Node->GetIndex() ];
+        ASSERT( numPending > 0 );
+        numPending--;
+        if ( numPending == 0 )
+        {
+            outReadyNodes.Append( entry.m_Node );
+        }
+        entryIndex = entry.m_Next;
+    }
+}
+
+// GrowWaitingNodes
+//------------------------------------------------------------------------------
+void JobQueue::GrowWaitingNodes( size_t numNodes )
+{
+    const size_t oldSize = m_NumPendingDependencies.GetSize();
+    if ( numNodes <= oldSize )
+    {
+        return;
+    }
+
+    // Grow geometrically, as nodes created during the build are added one by one
+    const size_t newSize = Math::Max( numNodes, oldSize + ( oldSize >> 1 ) );
+    m_NumPendingDependencies.SetSize( newSize );
+    m_FirstWaitingNode.SetSize( newSize );
+    for ( size_t i = oldSize; i < newSize; ++i )
+    {
+        m_NumPendingDependencies[ i ] = 0;
+        m_FirstWaitingNode[ i ] = kNoWaitingNode;
+    }
+}
+
 // WorkerThreadWait
 //------------------------------------------------------------------------------
 void JobQueue::WorkerThreadWait( uint32_t maxWaitMS )
@@ -10,6 +10,7 @@
 // Core
 #include "Core/Containers/Array.h"
 #include "Core/Containers/Singleton.h"
+#include "Core/Containers/WorkStealingQueue.h"
 
 #include "Core/Process/Mutex.h"
 #include "Core/Process/Semaphore.h"
@@ -20,14 +21,19 @@ class Node;
 class Job;
 class SettingsNode;
 class ThreadPool;
+class ToolManifest;
 class WorkerThread;
 
 // JobSubQueue
+//  - Jobs are bucketed by recursive cost so the most expensive are taken first
+//  - Each bucket is sharded into lock-free queues to reduce contention
+//    between workers, which take from their own shard before stealing from
+//    others
 //------------------------------------------------------------------------------
 class JobSubQueue
 {
 public:
-    JobSubQueue();
+    explicit JobSubQueue( uint32_t numShards );
     ~JobSubQueue();
 
     uint32_t GetCount() const;
@@ -39,9 +45,21 @@ public:
     Job * RemoveJob();
 
 private:
-    uint32_t m_Count; // access the current count
-    Mutex m_Mutex; // lock to add/remove jobs
-    Array<Job *> m_Jobs; // Sorted, most expensive at end
+    static uint32_t GetCostBucket( uint32_t recursiveCost );
+
+    static const uint32_t kNumCostBuckets = 24; // Log2 of recursive cost (ms)
+
+    class CostBucket
+    {
+    public:
+        uint32_t m_Count = 0; // Jobs in all shards of this bucket
+        uint8_t m_Padding[ 64 - sizeof( uint32_t ) ]; // Avoid false sharing between buckets
+    };
+
+    uint32_t m_NumShards;
+    uint32_t m_NextShard; // Round-robin distribution of jobs (main thread)
+    CostBucket m_Buckets[ kNumCostBuckets ];
+    WorkStealingQueue<Job *> * m_Shards; // kNumCostBuckets * m_NumShards
 };
 
 // JobQueue
@@ -59,6 +77,12 @@ public:
     void FinalizeCompletedJobs( NodeGraph & nodeGraph );
     void MainThreadWait( uint32_t maxWaitMS );
 
+    // -eventdriven: nodes blocked on incomplete dependencies (main thread only)
+    void PrepareWaitingNodes( size_t numNodes );
+    void AddWaitingNode( Node * dependency, Node * waitingNode );
+    bool IsWaitingOnDependencies( const Node * node );
+    void OnNodeCompleted( const Node * completedNode, Array<Node *> & outReadyNodes );
+
     // main thread can be signalled
     void WakeMainThread() { m_MainThreadSemaphore.Signal(); }
 
@@ -68,6 +92,7 @@ public:
 
     // access state
     size_t GetNumDistributableJobsAvailable() const;
+    void GetToolManifestsForDistributableJobs( Array<const ToolManifest *> & outManifests ) const;
 
     void GetJobStats( uint32_t & numJobs,
                       uint32_t & numJobsActive,
@@ -133,6 +158,21 @@ private:
     Array<Job *> m_CompletedJobsFailed2;
 
     Array<WorkerThread *> m_Workers;
+
+    // Dependency tracking for -eventdriven (only populated when used). Per-node
+    // state is indexed by Node::GetIndex(), and the nodes waiting on each node
+    // are linked lists of entries in a shared pool.
+    class WaitingNode
+    {
+    public:
+        Node * m_Node; // Node waiting for a dependency to complete
+        uint32_t m_Next; // Next node waiting on the same dependency
+    };
+    static const uint32_t kNoWaitingNode = 0xFFFFFFFF;
+    void GrowWaitingNodes( size_t numNodes );
+    Array<uint32_t> m_NumPendingDependencies; // Incomplete dependencies each node is waiting on
+    Array<uint32_t> m_FirstWaitingNode; // First node waiting on each node, or kNoWaitingNode
+    Array<WaitingNode> m_WaitingNodes;
 };
 
 //------------------------------------------------------------------------------
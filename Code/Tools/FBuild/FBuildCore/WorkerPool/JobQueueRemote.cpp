@@ -7,11 +7,13 @@
 #include "Job.h"
 #include "WorkerThreadRemote.h"
 
+#include "Tools/FBuild/FBuildCore/Cache/ICache.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
 #include "Tools/FBuild/FBuildCore/Helpers/MultiBuffer.h"
 
 // Core
@@ -19,11 +21,16 @@
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/PathUtils.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Mem/Mem.h"
 #include "Core/Process/ThreadPool.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Time/Timer.h"
 #include "Core/Tracing/Tracing.h"
 
+// system
+#include <string.h> // for memcpy
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 JobQueueRemote::JobQueueRemote( uint32_t numWorkerThreads )
@@ -108,6 +115,39 @@ void JobQueueRemote::GetWorkerStatus( size_t index, AString & hostName, AString
     ( (WorkerThreadRemote *)m_Workers[ index ] )->GetStatus( hostName, status, isIdle );
 }
 
+// GetNumJobsToPrefetch
+//------------------------------------------------------------------------------
+uint32_t JobQueueRemote::GetNumJobsToPrefetch() const
+{
+    // Keep one job queued for each thread in use, so a thread completing a
+    // job can start another immediately rather than waiting a round trip
+    return Math::Min( WorkerThreadRemote::GetNumCPUsToUse(), static_cast<uint32_t>( m_Workers.GetSize() ) );
+}
+
+// GetNumJobsActive
+//------------------------------------------------------------------------------
+uint32_t JobQueueRemote::GetNumJobsActive() const
+{
+    size_t numJobs = 0;
+    {
+        MutexHolder m( m_PendingJobsMutex );
+        numJobs += m_PendingJobs.GetSize();
+    }
+    {
+        MutexHolder m( m_InFlightJobsMutex );
+        numJobs += m_InFlightJobs.GetSize();
+    }
+    return static_cast<uint32_t>( numJobs );
+}
+
+// SetCache
+//------------------------------------------------------------------------------
+void JobQueueRemote::SetCache( ICache * cache, bool allowWrite )
+{
+    m_Cache = cache;
+    m_CacheWrite = ( cache && allowWrite );
+}
+
 // MainThreadWait
 //------------------------------------------------------------------------------
 void JobQueueRemote::MainThreadWait( uint32_t timeoutMS )
@@ -338,7 +378,11 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, Node::BuildResult result
         FileIO::FileDelete( pdbName.Get() );
     }
 
-    Node::BuildResult result;
+    // The result might already be in the cache
+    const bool cacheHit = ( job->IsLocal() == false ) && RetrieveFromCache( job );
+
+    Node::BuildResult result = Node::BuildResult::eOk;
+    if ( cacheHit == false )
     {
         PROFILE_SECTION( racingRemoteJob ? "RACE" : "LOCAL" );
         result = ( (Node *)node )->DoBuild2( job, racingRemoteJob );
@@ -390,13 +434,17 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, Node::BuildResult result
                     ( node->m_Stamp == FileIO::GetFileLastWriteTime( node->GetName() ) ) );
 
             // TODO:A Also read into job if cache is being used
-            if ( job->IsLocal() == false )
+            if ( ( job->IsLocal() == false ) && ( cacheHit == false ) )
             {
                 // read results into memory to send back to client
                 if ( ReadResults( job ) == false )
                 {
                     result = Node::BuildResult::eFailed;
                 }
+                else
+                {
+                    WriteToCache( job );
+                }
             }
             break;
         }
@@ -501,4 +549,99 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, Node::BuildResult result
     return true;
 }
 
+// CanUseCache
+//------------------------------------------------------------------------------
+/*static*/ bool JobQueueRemote::CanUseCache( const Job * job )
+{
+    // Results and cache entries are interchangeable when they hold the same
+    // files, which excludes PDBs (results only), as well as precompiled headers
+    // and coverage data (cache entries only)
+    const ObjectNode * node = job->GetNode()->CastTo<ObjectNode>();
+    return ( job->GetCacheName().IsEmpty() == false ) &&
+           ( node->IsUsingPDB() == false ) &&
+           ( node->IsCreatingPCH() == false ) &&
+           ( node->IsUsingGcovCoverage() == false );
+}
+
+// RetrieveFromCache
+//------------------------------------------------------------------------------
+/*static*/ bool JobQueueRemote::RetrieveFromCache( Job * job )
+{
+    ICache * cache = Get().m_Cache;
+    if ( ( cache == nullptr ) ||
+         ( ( job->GetRemoteCacheFlags() & Job::REMOTE_CACHE_READ ) == 0 ) ||
+         ( CanUseCache( job ) == false ) )
+    {
+        return false;
+    }
+
+    PROFILE_FUNCTION;
+
+    void * cacheData = nullptr;
+    size_t cacheDataSize = 0;
+    if ( cache->Retrieve( job->GetCacheName(), cacheData, cacheDataSize ) == false )
+    {
+        return false;
+    }
+
+    // The entry is returned as the result, decompressed if the client wants
+    // an uncompressed result
+    bool ok = Compressor::IsValidData( cacheData, cacheDataSize );
+    if ( ok && ( job->GetResultCompressionLevel() != 0 ) )
+    {
+        void * data = ALLOC( cacheDataSize );
+        memcpy( data, cacheData, cacheDataSize );
+        job->OwnData( data, cacheDataSize );
+    }
+    else if ( ok )
+    {
+        Compressor c;
+        ok = c.Decompress( cacheData );
+        if ( ok )
+        {
+            const size_t dataSize = c.GetResultSize();
+            job->OwnData( c.ReleaseResult(), dataSize );
+        }
+    }
+    cache->FreeMemory( cacheData, cacheDataSize );
+
+    if ( ok )
+    {
+        job->SetRemoteCacheFlags( job->GetRemoteCacheFlags() | Job::REMOTE_CACHE_HIT );
+    }
+    return ok;
+}
+
+// WriteToCache
+//------------------------------------------------------------------------------
+/*static*/ void JobQueueRemote::WriteToCache( Job * job )
+{
+    ICache * cache = Get().m_Cache;
+    if ( ( Get().m_CacheWrite == false ) ||
+         ( ( job->GetRemoteCacheFlags() & Job::REMOTE_CACHE_WRITE ) == 0 ) ||
+         ( CanUseCache( job ) == false ) )
+    {
+        return;
+    }
+
+    PROFILE_FUNCTION;
+
+    // Cache entries are always compressed. Results are compressed at the
+    // client's cache compression level when it would have stored them itself.
+    const void * data = job->GetData();
+    size_t dataSize = job->GetDataSize();
+    Compressor c;
+    if ( job->GetResultCompressionLevel() == 0 )
+    {
+        c.Compress( data, dataSize );
+        data = c.GetResult();
+        dataSize = c.GetResultSize();
+    }
+
+    if ( cache->Publish( job->GetCacheName(), data, dataSize ) )
+    {
+        job->SetRemoteCacheFlags( job->GetRemoteCacheFlags() | Job::REMOTE_CACHE_STORED );
+    }
+}
+
 //------------------------------------------------------------------------------
@@ -15,6 +15,7 @@
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class ICache;
 class Node;
 class Job;
 class ThreadPool;
@@ -40,6 +41,16 @@ public:
     size_t GetNumWorkers() const { return m_Workers.GetSize(); }
     void GetWorkerStatus( size_t index, AString & hostName, AString & status, bool & isIdle ) const;
 
+    // Jobs to request beyond those which can be built immediately, so that
+    // threads don't sit idle while further jobs are requested
+    uint32_t GetNumJobsToPrefetch() const;
+
+    // Jobs queued or being built, for all Clients
+    uint32_t GetNumJobsActive() const;
+
+    // Cache to use for jobs which permit it (not owned)
+    void SetCache( ICache * cache, bool allowWrite );
+
     void MainThreadWait( uint32_t timeoutMS );
     void WakeMainThread();
 
@@ -57,6 +68,9 @@ private:
 
     // internal helpers
     static bool ReadResults( Job * job );
+    static bool CanUseCache( const Job * job );
+    static bool RetrieveFromCache( Job * job );
+    static void WriteToCache( Job * job );
 
     mutable Mutex m_PendingJobsMutex;
     Array<Job *> m_PendingJobs;
@@ -73,6 +87,9 @@ private:
 
     ThreadPool * m_ThreadPool;
     Array<WorkerThread *> m_Workers;
+
+    ICache * m_Cache = nullptr;
+    bool m_CacheWrite = false;
 };
 
 //------------------------------------------------------------------------------
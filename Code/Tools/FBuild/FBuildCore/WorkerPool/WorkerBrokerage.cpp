@@ -88,6 +88,11 @@ void WorkerBrokerage::InitBrokerage()
         }
     }
 
+    // optional brokerage service, used in preference to the brokerage path
+    Env::GetEnvVariable( "FASTBUILD_BROKERAGE_SERVICE", m_BrokerageServiceAddress );
+    m_BrokerageServiceAddress.TrimStart( ' ' );
+    m_BrokerageServiceAddress.TrimEnd( ' ' );
+
     m_BrokerageInitialized = true;
 }
 
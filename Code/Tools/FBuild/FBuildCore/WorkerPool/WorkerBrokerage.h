@@ -19,12 +19,14 @@ public:
     ~WorkerBrokerage();
 
     const AString & GetBrokerageRootPaths() const { return m_BrokerageRootPaths; }
+    const AString & GetBrokerageServiceAddress() const { return m_BrokerageServiceAddress; }
 
 protected:
     void InitBrokerage();
 
     Array<AString> m_BrokerageRoots;
     AString m_BrokerageRootPaths;
+    AString m_BrokerageServiceAddress; // Optional BrokerageService (host[:port])
     bool m_BrokerageInitialized;
 };
 
@@ -7,14 +7,20 @@
 
 // FBuildCore
 #include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/BrokerageServiceConnection.h"
 
 // Core
+#include "Core/Containers/Move.h"
 #include "Core/Env/Env.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/PathUtils.h"
 #include "Core/Network/Network.h"
 #include "Core/Profile/Profile.h"
 
+// Static Data
+//------------------------------------------------------------------------------
+static const uint32_t sBrokerageServiceTimeoutMS = ( 2000 );
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 WorkerBrokerageClient::WorkerBrokerageClient() = default;
@@ -42,10 +48,22 @@ void WorkerBrokerageClient::FindWorkers( Array<AString> & outWorkerList )
         }
     }
 
-    // check for workers through brokerage
-
     // Init the brokerage
     InitBrokerage();
+
+    // check for workers through brokerage service
+    if ( m_BrokerageServiceAddress.IsEmpty() == false )
+    {
+        if ( FindWorkersFromService( outWorkerList ) )
+        {
+            m_WorkerSource = m_BrokerageServiceAddress;
+            return;
+        }
+        FLOG_WARN( "Brokerage service '%s' unavailable", m_BrokerageServiceAddress.Get() );
+    }
+
+    // check for workers through brokerage
+    m_WorkerSource = m_BrokerageRootPaths;
     if ( m_BrokerageRoots.IsEmpty() )
     {
         FLOG_WARN( "No brokerage root; did you set FASTBUILD_BROKERAGE_PATH?" );
@@ -96,4 +114,39 @@ void WorkerBrokerageClient::FindWorkers( Array<AString> & outWorkerList )
     }
 }
 
+// FindWorkersFromService
+//------------------------------------------------------------------------------
+bool WorkerBrokerageClient::FindWorkersFromService( Array<AString> & outWorkerList )
+{
+    PROFILE_FUNCTION;
+
+    Array<AString> results;
+    {
+        BrokerageServiceConnection service;
+        if ( ( service.ConnectToService( m_BrokerageServiceAddress, sBrokerageServiceTimeoutMS ) == false ) ||
+             ( service.QueryWorkers( results, sBrokerageServiceTimeoutMS ) == false ) )
+        {
+            return false;
+        }
+    }
+    FLOG_VERBOSE( "%zu workers found via '%s'", results.GetSize(), m_BrokerageServiceAddress.Get() );
+
+    // Get addresses for the local host
+    StackArray<AString> localAddresses;
+    Network::GetIPv4Addresses( localAddresses );
+
+    // Service orders workers by availability, which is preserved
+    outWorkerList.SetCapacity( outWorkerList.GetSize() + results.GetSize() );
+    for ( AString & worker : results )
+    {
+        // Filter out local addresses
+        if ( localAddresses.Find( worker ) )
+        {
+            continue;
+        }
+        outWorkerList.Append( Move( worker ) );
+    }
+    return true;
+}
+
 //------------------------------------------------------------------------------
@@ -19,6 +19,14 @@ public:
     ~WorkerBrokerageClient();
 
     void FindWorkers( Array<AString> & outWorkerList );
+
+    // Where the workers were found (brokerage paths or service)
+    const AString & GetWorkerSource() const { return m_WorkerSource; }
+
+protected:
+    bool FindWorkersFromService( Array<AString> & outWorkerList );
+
+    AString m_WorkerSource;
 };
 
 //------------------------------------------------------------------------------
@@ -8,11 +8,16 @@
 // FBuildCore
 #include "Tools/FBuild/FBuildCore/FBuildVersion.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/BrokerageServiceConnection.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/JobQueueRemote.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThreadRemote.h"
 #include "Tools/FBuild/FBuildWorker/Worker/WorkerSettings.h"
 
 // Core
 #include "Core/Env/Env.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Mem/MemInfo.h"
 #include "Core/Network/Network.h"
 #include "Core/Network/TCPConnectionPool.h"
 #include "Core/Strings/AStackString.h"
@@ -24,6 +29,9 @@ static const float sBrokerageElapsedTimeBetweenClean = ( 12 * 60 * 60.0f );
 static const uint32_t sBrokerageCleanOlderThan = ( 24 * 60 * 60 );
 static const float sBrokerageAvailabilityUpdateTime = ( 10.0f );
 static const float sBrokerageIPAddressUpdateTime = ( 5 * 60.0f );
+static const float sBrokerageServiceHeartbeatTime = ( 2.0f );
+static const float sBrokerageServiceReconnectTime = ( 10.0f );
+static const uint32_t sBrokerageServiceConnectTimeoutMS = ( 1000 );
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
@@ -31,12 +39,20 @@ WorkerBrokerageServer::WorkerBrokerageServer()
 {
     // Modify timer so we trigger right away
     m_TimerLastCleanBroker.SetElapsed( sBrokerageElapsedTimeBetweenClean );
+    m_TimerLastServiceConnect.SetElapsed( sBrokerageServiceReconnectTime );
 }
 
 // DESTRUCTOR
 //------------------------------------------------------------------------------
 WorkerBrokerageServer::~WorkerBrokerageServer()
 {
+    // Service forgets us when we disconnect
+    if ( m_BrokerageService )
+    {
+        FDELETE m_BrokerageService;
+        return;
+    }
+
     // Make a best-effort attempt to remove our token
     if ( m_Available )
     {
@@ -51,6 +67,14 @@ void WorkerBrokerageServer::SetAvailability( bool available )
     // Init the brokerage if not already
     InitBrokerage();
 
+    // brokerage service takes precedence over brokerage path
+    if ( m_BrokerageServiceAddress.IsEmpty() == false )
+    {
+        UpdateBrokerageService( available );
+        m_Available = available;
+        return;
+    }
+
     // ignore if brokerage not configured
     if ( m_BrokerageRoots.IsEmpty() )
     {
@@ -71,44 +95,17 @@ void WorkerBrokerageServer::SetAvailability( bool available )
             const uint64_t settingsWriteTime = workerSettings.GetSettingsWriteTime();
             bool createBrokerageFile = ( settingsWriteTime > m_SettingsWriteTime );
 
-            // Check IP last update time and determine if host name or IP address has changed
-            if ( m_HostName.IsEmpty() ||
-                 m_IPAddress.IsEmpty() ||
-                 ( m_TimerLastIPUpdate.GetElapsed() >= sBrokerageIPAddressUpdateTime ) )
+            // Check if host name or IP address has changed
+            if ( UpdateHostInfo() )
             {
-                AStackString hostName;
-                AStackString domainName;
-                AStackString ipAddress;
-
-                // Get host and domain name as FQDN could have changed
-                Network::GetHostName( hostName );
-                Network::GetDomainName( domainName );
-
-                // Resolve host name to ip address
-                const uint32_t ip = Network::GetHostIPFromName( hostName );
-                if ( ( ip != 0 ) && ( ip != 0x0100007f ) )
-                {
-                    TCPConnectionPool::GetAddressAsString( ip, ipAddress );
-                }
-
-                if ( ( hostName != m_HostName ) || ( domainName != m_DomainName ) || ( ipAddress != m_IPAddress ) )
-                {
-                    m_HostName = hostName;
-                    m_DomainName = domainName;
-                    m_IPAddress = ipAddress;
+                // Remove existing brokerage file, as filename is being updated
+                FileIO::FileDelete( m_BrokerageFilePath.Get() );
 
-                    // Remove existing brokerage file, as filename is being updated
-                    FileIO::FileDelete( m_BrokerageFilePath.Get() );
+                // Update brokerage path
+                UpdateBrokerageFilePath();
 
-                    // Update brokerage path
-                    UpdateBrokerageFilePath();
-
-                    // Host name, domain name, or IP address changed - create the file
-                    createBrokerageFile = true;
-                }
-
-                // Restart the IP timer
-                m_TimerLastIPUpdate.Restart();
+                // Host name, domain name, or IP address changed - create the file
+                createBrokerageFile = true;
             }
 
             if ( createBrokerageFile == false )
@@ -220,6 +217,96 @@ void WorkerBrokerageServer::SetAvailability( bool available )
     }
 }
 
+// UpdateHostInfo
+//  - Returns true if host name, domain name or IP address changed
+//------------------------------------------------------------------------------
+bool WorkerBrokerageServer::UpdateHostInfo()
+{
+    // Check IP last update time
+    if ( ( m_HostName.IsEmpty() == false ) &&
+         ( m_IPAddress.IsEmpty() == false ) &&
+         ( m_TimerLastIPUpdate.GetElapsed() < sBrokerageIPAddressUpdateTime ) )
+    {
+        return false;
+    }
+
+    AStackString hostName;
+    AStackString domainName;
+    AStackString ipAddress;
+
+    // Get host and domain name as FQDN could have changed
+    Network::GetHostName( hostName );
+    Network::GetDomainName( domainName );
+
+    // Resolve host name to ip address
+    const uint32_t ip = Network::GetHostIPFromName( hostName );
+    if ( ( ip != 0 ) && ( ip != 0x0100007f ) )
+    {
+        TCPConnectionPool::GetAddressAsString( ip, ipAddress );
+    }
+
+    bool changed = false;
+    if ( ( hostName != m_HostName ) || ( domainName != m_DomainName ) || ( ipAddress != m_IPAddress ) )
+    {
+        m_HostName = hostName;
+        m_DomainName = domainName;
+        m_IPAddress = ipAddress;
+        changed = true;
+    }
+
+    // Restart the IP timer
+    m_TimerLastIPUpdate.Restart();
+
+    return changed;
+}
+
+// UpdateBrokerageService
+//------------------------------------------------------------------------------
+void WorkerBrokerageServer::UpdateBrokerageService( bool available )
+{
+    // (Re)connect if needed, throttled in case the service is down
+    if ( ( m_BrokerageService == nullptr ) || ( m_BrokerageService->IsConnected() == false ) )
+    {
+        if ( m_TimerLastServiceConnect.GetElapsed() < sBrokerageServiceReconnectTime )
+        {
+            return;
+        }
+        m_TimerLastServiceConnect.Restart();
+
+        FDELETE m_BrokerageService;
+        m_BrokerageService = FNEW( BrokerageServiceConnection );
+        if ( m_BrokerageService->ConnectToService( m_BrokerageServiceAddress, sBrokerageServiceConnectTimeoutMS ) == false )
+        {
+            return;
+        }
+
+        // Register right away
+        m_TimerLastHeartbeat.SetElapsed( sBrokerageServiceHeartbeatTime );
+    }
+
+    // Send periodic heartbeats, or immediately if availability changes
+    if ( ( available == m_Available ) &&
+         ( m_TimerLastHeartbeat.GetElapsed() < sBrokerageServiceHeartbeatTime ) )
+    {
+        return;
+    }
+    m_TimerLastHeartbeat.Restart();
+
+    UpdateHostInfo();
+
+    SystemMemInfo memInfo;
+    MemInfo::GetSystemInfo( memInfo );
+
+    static const uint32_t numProcessors = Env::GetNumProcessors();
+    const uint32_t numJobsActive = JobQueueRemote::IsValid() ? JobQueueRemote::Get().GetNumJobsActive() : 0;
+    m_BrokerageService->SendHeartbeat( m_IPAddress.IsEmpty() ? m_HostName : m_IPAddress,
+                                       available,
+                                       available ? WorkerThreadRemote::GetNumCPUsToUse() : 0,
+                                       numProcessors,
+                                       numJobsActive,
+                                       memInfo.m_AvailPhysMiB );
+}
+
 // UpdateBrokerageFilePath
 //------------------------------------------------------------------------------
 void WorkerBrokerageServer::UpdateBrokerageFilePath()
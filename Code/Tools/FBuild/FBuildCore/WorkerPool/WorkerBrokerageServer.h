@@ -12,6 +12,7 @@
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class BrokerageServiceConnection;
 
 // WorkerBrokerageClient
 //------------------------------------------------------------------------------
@@ -27,6 +28,8 @@ public:
 
 protected:
     void UpdateBrokerageFilePath();
+    bool UpdateHostInfo();
+    void UpdateBrokerageService( bool available );
 
     Timer m_TimerLastUpdate; // Throttle network access
     Timer m_TimerLastIPUpdate; // Throttle dns access
@@ -37,6 +40,11 @@ protected:
     AString m_IPAddress;
     AString m_DomainName;
     AString m_HostName;
+
+    // Brokerage service (if used instead of brokerage path)
+    BrokerageServiceConnection * m_BrokerageService = nullptr;
+    Timer m_TimerLastServiceConnect; // Throttle reconnection attempts
+    Timer m_TimerLastHeartbeat;
 };
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,325 @@
+// Common.h - Content shared by all translation units
+//------------------------------------------------------------------------------
+#pragma once
+
+inline int CommonFunction0( int a, int b )
+{
+    return ( a * 3 ) + ( b ^ 0 );
+}
+
+inline int CommonFunction1( int a, int b )
+{
+    return ( a * 4 ) + ( b ^ 37 );
+}
+
+inline int CommonFunction2( int a, int b )
+{
+    return ( a * 5 ) + ( b ^ 74 );
+}
+
+inline int CommonFunction3( int a, int b )
+{
+    return ( a * 6 ) + ( b ^ 10 );
+}
+
+inline int CommonFunction4( int a, int b )
+{
+    return ( a * 7 ) + ( b ^ 47 );
+}
+
+inline int CommonFunction5( int a, int b )
+{
+    return ( a * 8 ) + ( b ^ 84 );
+}
+
+inline int CommonFunction6( int a, int b )
+{
+    return ( a * 9 ) + ( b ^ 20 );
+}
+
+inline int CommonFunction7( int a, int b )
+{
+    return ( a * 10 ) + ( b ^ 57 );
+}
+
+inline int CommonFunction8( int a, int b )
+{
+    return ( a * 11 ) + ( b ^ 94 );
+}
+
+inline int CommonFunction9( int a, int b )
+{
+    return ( a * 12 ) + ( b ^ 30 );
+}
+
+inline int CommonFunction10( int a, int b )
+{
+    return ( a * 13 ) + ( b ^ 67 );
+}
+
+inline int CommonFunction11( int a, int b )
+{
+    return ( a * 14 ) + ( b ^ 3 );
+}
+
+inline int CommonFunction12( int a, int b )
+{
+    return ( a * 15 ) + ( b ^ 40 );
+}
+
+inline int CommonFunction13( int a, int b )
+{
+    return ( a * 16 ) + ( b ^ 77 );
+}
+
+inline int CommonFunction14( int a, int b )
+{
+    return ( a * 17 ) + ( b ^ 13 );
+}
+
+inline int CommonFunction15( int a, int b )
+{
+    return ( a * 18 ) + ( b ^ 50 );
+}
+
+inline int CommonFunction16( int a, int b )
+{
+    return ( a * 19 ) + ( b ^ 87 );
+}
+
+inline int CommonFunction17( int a, int b )
+{
+    return ( a * 20 ) + ( b ^ 23 );
+}
+
+inline int CommonFunction18( int a, int b )
+{
+    return ( a * 21 ) + ( b ^ 60 );
+}
+
+inline int CommonFunction19( int a, int b )
+{
+    return ( a * 22 ) + ( b ^ 97 );
+}
+
+inline int CommonFunction20( int a, int b )
+{
+    return ( a * 23 ) + ( b ^ 33 );
+}
+
+inline int CommonFunction21( int a, int b )
+{
+    return ( a * 24 ) + ( b ^ 70 );
+}
+
+inline int CommonFunction22( int a, int b )
+{
+    return ( a * 25 ) + ( b ^ 6 );
+}
+
+inline int CommonFunction23( int a, int b )
+{
+    return ( a * 26 ) + ( b ^ 43 );
+}
+
+inline int CommonFunction24( int a, int b )
+{
+    return ( a * 27 ) + ( b ^ 80 );
+}
+
+inline int CommonFunction25( int a, int b )
+{
+    return ( a * 28 ) + ( b ^ 16 );
+}
+
+inline int CommonFunction26( int a, int b )
+{
+    return ( a * 29 ) + ( b ^ 53 );
+}
+
+inline int CommonFunction27( int a, int b )
+{
+    return ( a * 30 ) + ( b ^ 90 );
+}
+
+inline int CommonFunction28( int a, int b )
+{
+    return ( a * 31 ) + ( b ^ 26 );
+}
+
+inline int CommonFunction29( int a, int b )
+{
+    return ( a * 32 ) + ( b ^ 63 );
+}
+
+inline int CommonFunction30( int a, int b )
+{
+    return ( a * 33 ) + ( b ^ 100 );
+}
+
+inline int CommonFunction31( int a, int b )
+{
+    return ( a * 34 ) + ( b ^ 36 );
+}
+
+inline int CommonFunction32( int a, int b )
+{
+    return ( a * 35 ) + ( b ^ 73 );
+}
+
+inline int CommonFunction33( int a, int b )
+{
+    return ( a * 36 ) + ( b ^ 9 );
+}
+
+inline int CommonFunction34( int a, int b )
+{
+    return ( a * 37 ) + ( b ^ 46 );
+}
+
+inline int CommonFunction35( int a, int b )
+{
+    return ( a * 38 ) + ( b ^ 83 );
+}
+
+inline int CommonFunction36( int a, int b )
+{
+    return ( a * 39 ) + ( b ^ 19 );
+}
+
+inline int CommonFunction37( int a, int b )
+{
+    return ( a * 40 ) + ( b ^ 56 );
+}
+
+inline int CommonFunction38( int a, int b )
+{
+    return ( a * 41 ) + ( b ^ 93 );
+}
+
+inline int CommonFunction39( int a, int b )
+{
+    return ( a * 42 ) + ( b ^ 29 );
+}
+
+inline int CommonFunction40( int a, int b )
+{
+    return ( a * 43 ) + ( b ^ 66 );
+}
+
+inline int CommonFunction41( int a, int b )
+{
+    return ( a * 44 ) + ( b ^ 2 );
+}
+
+inline int CommonFunction42( int a, int b )
+{
+    return ( a * 45 ) + ( b ^ 39 );
+}
+
+inline int CommonFunction43( int a, int b )
+{
+    return ( a * 46 ) + ( b ^ 76 );
+}
+
+inline int CommonFunction44( int a, int b )
+{
+    return ( a * 47 ) + ( b ^ 12 );
+}
+
+inline int CommonFunction45( int a, int b )
+{
+    return ( a * 48 ) + ( b ^ 49 );
+}
+
+inline int CommonFunction46( int a, int b )
+{
+    return ( a * 49 ) + ( b ^ 86 );
+}
+
+inline int CommonFunction47( int a, int b )
+{
+    return ( a * 50 ) + ( b ^ 22 );
+}
+
+inline int CommonFunction48( int a, int b )
+{
+    return ( a * 51 ) + ( b ^ 59 );
+}
+
+inline int CommonFunction49( int a, int b )
+{
+    return ( a * 52 ) + ( b ^ 96 );
+}
+
+inline int CommonFunction50( int a, int b )
+{
+    return ( a * 53 ) + ( b ^ 32 );
+}
+
+inline int CommonFunction51( int a, int b )
+{
+    return ( a * 54 ) + ( b ^ 69 );
+}
+
+inline int CommonFunction52( int a, int b )
+{
+    return ( a * 55 ) + ( b ^ 5 );
+}
+
+inline int CommonFunction53( int a, int b )
+{
+    return ( a * 56 ) + ( b ^ 42 );
+}
+
+inline int CommonFunction54( int a, int b )
+{
+    return ( a * 57 ) + ( b ^ 79 );
+}
+
+inline int CommonFunction55( int a, int b )
+{
+    return ( a * 58 ) + ( b ^ 15 );
+}
+
+inline int CommonFunction56( int a, int b )
+{
+    return ( a * 59 ) + ( b ^ 52 );
+}
+
+inline int CommonFunction57( int a, int b )
+{
+    return ( a * 60 ) + ( b ^ 89 );
+}
+
+inline int CommonFunction58( int a, int b )
+{
+    return ( a * 61 ) + ( b ^ 25 );
+}
+
+inline int CommonFunction59( int a, int b )
+{
+    return ( a * 62 ) + ( b ^ 62 );
+}
+
+inline int CommonFunction60( int a, int b )
+{
+    return ( a * 63 ) + ( b ^ 99 );
+}
+
+inline int CommonFunction61( int a, int b )
+{
+    return ( a * 64 ) + ( b ^ 35 );
+}
+
+inline int CommonFunction62( int a, int b )
+{
+    return ( a * 65 ) + ( b ^ 72 );
+}
+
+inline int CommonFunction63( int a, int b )
+{
+    return ( a * 66 ) + ( b ^ 8 );
+}
+
+//------------------------------------------------------------------------------
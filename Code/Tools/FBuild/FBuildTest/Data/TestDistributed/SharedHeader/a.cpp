@@ -0,0 +1,8 @@
+// a.cpp
+//------------------------------------------------------------------------------
+#include "Common.h"
+
+int Function_a()
+{
+    return CommonFunction0( 1, 2 ) + CommonFunction63( 3, 4 );
+}
@@ -0,0 +1,8 @@
+// b.cpp
+//------------------------------------------------------------------------------
+#include "Common.h"
+
+int Function_b()
+{
+    return CommonFunction0( 1, 2 ) + CommonFunction63( 3, 4 );
+}
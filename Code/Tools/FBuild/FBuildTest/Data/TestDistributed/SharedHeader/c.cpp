@@ -0,0 +1,8 @@
+// c.cpp
+//------------------------------------------------------------------------------
+#include "Common.h"
+
+int Function_c()
+{
+    return CommonFunction0( 1, 2 ) + CommonFunction63( 3, 4 );
+}
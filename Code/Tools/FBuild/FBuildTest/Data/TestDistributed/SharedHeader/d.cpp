@@ -0,0 +1,8 @@
+// d.cpp
+//------------------------------------------------------------------------------
+#include "Common.h"
+
+int Function_d()
+{
+    return CommonFunction0( 1, 2 ) + CommonFunction63( 3, 4 );
+}
@@ -6,17 +6,33 @@
 #include "FBuildTest.h"
 
 // FBuild
+#include "Tools/FBuild/FBuildCore/Cache/Cache.h"
+#include "Tools/FBuild/FBuildCore/Cache/CacheChunkStore.h"
+#include "Tools/FBuild/FBuildCore/Cache/CacheIndex.h"
+#include "Tools/FBuild/FBuildCore/Cache/CacheLockFile.h"
+#include "Tools/FBuild/FBuildCore/Cache/CacheShardIndex.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Graph/SettingsNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/MultiBuffer.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Server.h"
 
 // Core
+#include "Core/Containers/UniquePtr.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Math/Random.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Process/Thread.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
 #include "Core/Tracing/Tracing.h"
 
+// system
+#include <string.h> // for memset
+
 // TestCache
 //------------------------------------------------------------------------------
 class TestCache : public FBuildTest
@@ -27,6 +43,11 @@ private:
     void Write() const;
     void Read() const;
     void ReadWrite() const;
+    void TrimLeastRecentlyUsed() const;
+    void IndexUpdateLock() const;
+    void ShardIndex() const;
+    void RetrieveToFiles() const;
+    void Deduplication() const;
     void ConsistentCacheKeysWithDist() const;
 
     void LightCache_IncludeUsingMacro() const;
@@ -72,6 +93,11 @@ REGISTER_TESTS_BEGIN( TestCache )
     REGISTER_TEST( Write )
     REGISTER_TEST( Read )
     REGISTER_TEST( ReadWrite )
+    REGISTER_TEST( TrimLeastRecentlyUsed )
+    REGISTER_TEST( IndexUpdateLock )
+    REGISTER_TEST( ShardIndex )
+    REGISTER_TEST( RetrieveToFiles )
+    REGISTER_TEST( Deduplication )
     REGISTER_TEST( ConsistentCacheKeysWithDist )
     REGISTER_TEST( ExtraFiles_GCNO )
 #if defined( __WINDOWS__ )
@@ -275,6 +301,572 @@ void TestCache::ReadWrite() const
 #endif
 }
 
+// TrimLeastRecentlyUsed
+//------------------------------------------------------------------------------
+void TestCache::TrimLeastRecentlyUsed() const
+{
+    const AStackString cachePath( "../tmp/Test/Cache/TrimLeastRecentlyUsed/" );
+    AStackString indexPath;
+    CacheIndex::GetIndexPath( cachePath, indexPath );
+
+    AStackString idA, idB, idC;
+    ICache::GetCacheId( 1, 0, 0, 0, idA );
+    ICache::GetCacheId( 2, 0, 0, 0, idB );
+    ICache::GetCacheId( 3, 0, 0, 0, idC );
+
+    // 1 MiB entries
+    Array<char> data;
+    data.SetSize( MEGABYTE );
+    memset( data.Begin(), 0, data.GetSize() );
+
+    // Publish entries, then access the oldest
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+
+        // Remove anything left over from previous runs
+        TEST_ASSERT( cache.Trim( false, 0 ) );
+
+        // (Sleeps ensure access times differ, even on low resolution clocks)
+        TEST_ASSERT( cache.Publish( idA, data.Begin(), data.GetSize() ) );
+        Thread::Sleep( 20 );
+        TEST_ASSERT( cache.Publish( idB, data.Begin(), data.GetSize() ) );
+        Thread::Sleep( 20 );
+        TEST_ASSERT( cache.Publish( idC, data.Begin(), data.GetSize() ) );
+        Thread::Sleep( 20 );
+
+        void * retrievedData = nullptr;
+        size_t retrievedDataSize = 0;
+        TEST_ASSERT( cache.Retrieve( idA, retrievedData, retrievedDataSize ) );
+        TEST_ASSERT( retrievedDataSize == data.GetSize() );
+        cache.FreeMemory( retrievedData, retrievedDataSize );
+
+        // Accesses are logged on shutdown
+        cache.Shutdown();
+    }
+
+    // Trim from another process, evicting the least recently used
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.Trim( false, 2 ) );
+
+        void * retrievedData = nullptr;
+        size_t retrievedDataSize = 0;
+        TEST_ASSERT( cache.Retrieve( idB, retrievedData, retrievedDataSize ) == false );
+        TEST_ASSERT( cache.Retrieve( idC, retrievedData, retrievedDataSize ) );
+        cache.FreeMemory( retrievedData, retrievedDataSize );
+        Thread::Sleep( 20 );
+        TEST_ASSERT( cache.Retrieve( idA, retrievedData, retrievedDataSize ) );
+        cache.FreeMemory( retrievedData, retrievedDataSize );
+
+        // Access logs were merged into the index
+        Array<AString> accessLogs;
+        FileIO::GetFiles( indexPath, AStackString( "*.log" ), false, &accessLogs );
+        TEST_ASSERT( accessLogs.IsEmpty() );
+
+        cache.Shutdown();
+    }
+
+    // Trim again using the saved index. C is now least recently used.
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.Trim( false, 1 ) );
+
+        void * retrievedData = nullptr;
+        size_t retrievedDataSize = 0;
+        TEST_ASSERT( cache.Retrieve( idC, retrievedData, retrievedDataSize ) == false );
+        TEST_ASSERT( cache.Retrieve( idA, retrievedData, retrievedDataSize ) );
+        cache.FreeMemory( retrievedData, retrievedDataSize );
+
+        cache.Shutdown();
+    }
+}
+
+// IndexUpdateLock
+//------------------------------------------------------------------------------
+void TestCache::IndexUpdateLock() const
+{
+    const AStackString cachePath( "../tmp/Test/Cache/IndexUpdateLock/" );
+    AStackString indexPath;
+    CacheIndex::GetIndexPath( cachePath, indexPath );
+
+    const char data[] = "data";
+
+    // Remove anything left over from previous runs
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.Trim( false, 0 ) );
+    }
+
+    // Many builds without a trim
+    const uint32_t numBuilds = 100;
+    for ( uint32_t i = 0; i < numBuilds; ++i )
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        AStackString cacheId;
+        ICache::GetCacheId( i + 1, 0, 0, 0, cacheId );
+        TEST_ASSERT( cache.Publish( cacheId, data, sizeof( data ) ) );
+        cache.Shutdown();
+    }
+
+    // Access logs are compacted so they don't grow without bound
+    Array<AString> accessLogs;
+    FileIO::GetFiles( indexPath, AStackString( "*.log" ), false, &accessLogs );
+    TEST_ASSERT( accessLogs.GetSize() < numBuilds );
+
+    // Trim is skipped while another process is updating the index
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+
+        CacheIndex index;
+        index.Init( cachePath );
+        AStackString lockFileName;
+        index.GetUpdateLockFileName( lockFileName );
+        CacheLockFile lock( lockFileName, CacheIndex::kUpdateLockStaleSecs );
+        TEST_ASSERT( lock.TryLock() );
+
+        TEST_ASSERT( cache.Trim( false, 0 ) == false );
+        Array<AString> accessLogsAfterTrim;
+        FileIO::GetFiles( indexPath, AStackString( "*.log" ), false, &accessLogsAfterTrim );
+        TEST_ASSERT( accessLogsAfterTrim.GetSize() == accessLogs.GetSize() );
+
+        lock.Unlock();
+        TEST_ASSERT( cache.Trim( false, 0 ) );
+    }
+
+    // No access was lost by compaction: every entry was in the index and trimmed
+    for ( uint32_t i = 0; i < numBuilds; ++i )
+    {
+        AStackString cacheId;
+        ICache::GetCacheId( i + 1, 0, 0, 0, cacheId );
+        Cache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        void * retrievedData = nullptr;
+        size_t retrievedDataSize = 0;
+        TEST_ASSERT( cache.Retrieve( cacheId, retrievedData, retrievedDataSize ) == false );
+    }
+}
+
+// ShardIndex
+//------------------------------------------------------------------------------
+void TestCache::ShardIndex() const
+{
+    const AStackString cachePath( "../tmp/Test/Cache/ShardIndex/" );
+    const char data[] = "data";
+
+    AStackString idA, idB, idC;
+    ICache::GetCacheId( 1, 0, 0, 0, idA );
+    ICache::GetCacheId( 2, 0, 0, 0, idB );
+    ICache::GetCacheId( 3, 0, 0, 0, idC );
+    AStackString fullPathC;
+    fullPathC.Format( "%s%c%c/%c%c/%s", cachePath.Get(), idC[ 0 ], idC[ 1 ], idC[ 2 ], idC[ 3 ], idC.Get() );
+
+    // Publish an entry before the index exists
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+
+        // Remove anything left over from previous runs
+        TEST_ASSERT( cache.Trim( false, 0 ) );
+        FileIO::FileDelete( fullPathC.Get() );
+
+        TEST_ASSERT( cache.Publish( idA, data, sizeof( data ) ) );
+        cache.Shutdown();
+    }
+
+    // Create the index
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.BuildIndex( false ) );
+        cache.Shutdown();
+    }
+
+    // Use the index
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+
+        // Existing entry is found
+        void * retrievedData = nullptr;
+        size_t retrievedDataSize = 0;
+        TEST_ASSERT( cache.Retrieve( idA, retrievedData, retrievedDataSize ) );
+        cache.FreeMemory( retrievedData, retrievedDataSize );
+
+        // Published entries are added
+        TEST_ASSERT( cache.Retrieve( idB, retrievedData, retrievedDataSize ) == false );
+        TEST_ASSERT( cache.Publish( idB, data, sizeof( data ) ) );
+        TEST_ASSERT( cache.Retrieve( idB, retrievedData, retrievedDataSize ) );
+        cache.FreeMemory( retrievedData, retrievedDataSize );
+
+        // Misses are determined without accessing the cache dirs, so an entry
+        // added to the cache without updating the index is not seen
+        {
+            TEST_ASSERT( FileIO::EnsurePathExistsForFile( fullPathC ) );
+            FileStream f;
+            TEST_ASSERT( f.Open( fullPathC.Get(), FileStream::WRITE_ONLY ) );
+            TEST_ASSERT( f.WriteBuffer( data, sizeof( data ) ) == sizeof( data ) );
+        }
+        TEST_ASSERT( cache.Retrieve( idC, retrievedData, retrievedDataSize ) == false );
+
+        // Publish enough entries to a single shard that it must grow
+        Array<AString> ids;
+        for ( uint64_t i = 100; ids.GetSize() < 1000; ++i )
+        {
+            AStackString id;
+            ICache::GetCacheId( i, 0, 0, 0, id );
+            if ( ( xxHash3::Calc64( id ) >> 56 ) == 0 )
+            {
+                TEST_ASSERT( cache.Publish( id, data, sizeof( data ) ) );
+                ids.Append( id );
+            }
+        }
+        for ( const AString & id : ids )
+        {
+            TEST_ASSERT( cache.Retrieve( id, retrievedData, retrievedDataSize ) );
+            cache.FreeMemory( retrievedData, retrievedDataSize );
+        }
+
+        cache.Shutdown();
+    }
+
+    // Trimmed entries are removed from the index
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.Trim( false, 0 ) );
+
+        void * retrievedData = nullptr;
+        size_t retrievedDataSize = 0;
+        TEST_ASSERT( cache.Retrieve( idA, retrievedData, retrievedDataSize ) == false );
+        TEST_ASSERT( cache.Retrieve( idB, retrievedData, retrievedDataSize ) == false );
+
+        cache.Shutdown();
+    }
+
+    // Updating the index adds entries which were written without updating it
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.BuildIndex( false ) );
+
+        void * retrievedData = nullptr;
+        size_t retrievedDataSize = 0;
+        TEST_ASSERT( cache.Retrieve( idC, retrievedData, retrievedDataSize ) );
+        cache.FreeMemory( retrievedData, retrievedDataSize );
+
+        cache.Shutdown();
+    }
+
+    // Publishing doesn't wait for shards locked by other processes. The entry
+    // is added to the index on shutdown instead.
+    AStackString idD;
+    for ( uint64_t i = 10000; ; ++i )
+    {
+        ICache::GetCacheId( i, 0, 0, 0, idD );
+        if ( ( xxHash3::Calc64( idD ) >> 56 ) == 0 )
+        {
+            break;
+        }
+    }
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+
+        AStackString lockFileName;
+        CacheShardIndex::GetShardsPath( cachePath, lockFileName );
+        lockFileName += "00.lock";
+        CacheLockFile lock( lockFileName, 30 );
+        TEST_ASSERT( lock.TryLock() );
+        TEST_ASSERT( cache.Publish( idD, data, sizeof( data ) ) );
+        lock.Unlock();
+
+        cache.Shutdown();
+    }
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+
+        void * retrievedData = nullptr;
+        size_t retrievedDataSize = 0;
+        TEST_ASSERT( cache.Retrieve( idD, retrievedData, retrievedDataSize ) );
+        cache.FreeMemory( retrievedData, retrievedDataSize );
+
+        cache.Shutdown();
+    }
+}
+
+// RetrieveToFiles
+//------------------------------------------------------------------------------
+void TestCache::RetrieveToFiles() const
+{
+    const AStackString cachePath( "../tmp/Test/Cache/RetrieveToFiles/Cache/" );
+    const AStackString outputPath( "../tmp/Test/Cache/RetrieveToFiles/" );
+
+    // Create files similar to an object and pdb, plus an empty file
+    const size_t fileSizes[] = { 1 * MEGABYTE, 256 * 1024, 0 };
+    StackArray<AString> srcFiles;
+    StackArray<AString> dstFiles;
+    StackArray<uint64_t> srcHashes;
+    Random r( 1234 );
+    for ( size_t i = 0; i < 3; ++i )
+    {
+        // Semi-compressible contents (runs of random bytes)
+        MemoryStream ms( fileSizes[ i ] );
+        while ( ms.GetSize() < fileSizes[ i ] )
+        {
+            const uint8_t value = static_cast<uint8_t>( r.GetRand() );
+            const size_t runLength = Math::Min<size_t>( 1 + r.GetRandIndex( 8 ), fileSizes[ i ] - ms.GetSize() );
+            for ( size_t j = 0; j < runLength; ++j )
+            {
+                ms.Write( value );
+            }
+        }
+        srcHashes.Append( xxHash3::Calc64( ms.GetData(), ms.GetSize() ) );
+
+        AString & srcFile = srcFiles.EmplaceBack();
+        srcFile.Format( "%sfile%u.src", outputPath.Get(), static_cast<uint32_t>( i ) );
+        AString & dstFile = dstFiles.EmplaceBack();
+        dstFile.Format( "%sfile%u.dst", outputPath.Get(), static_cast<uint32_t>( i ) );
+
+        TEST_ASSERT( FileIO::EnsurePathExistsForFile( srcFile ) );
+        FileStream f;
+        TEST_ASSERT( f.Open( srcFile.Get(), FileStream::WRITE_ONLY ) );
+        if ( ms.GetSize() > 0 )
+        {
+            TEST_ASSERT( f.WriteBuffer( ms.GetData(), ms.GetSize() ) == ms.GetSize() );
+        }
+    }
+
+    Cache cache;
+    TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+
+    class Format
+    {
+    public:
+        int32_t m_Level;
+        bool m_Zstd;
+    };
+    // clang-format off
+    const Format formats[] =
+    {
+        { 0,  false }, // None
+        { -1, false }, // LZ4
+        { 1,  true },  // Zstd
+    };
+    // clang-format on
+
+    for ( const Format & format : formats )
+    {
+        // Publish entry
+        AStackString cacheId;
+        ICache::GetCacheId( 1, 0, 0, static_cast<uint64_t>( format.m_Level ), cacheId );
+        {
+            MultiBuffer mb;
+            TEST_ASSERT( mb.CreateFromFiles( srcFiles ) );
+            mb.Compress( format.m_Level, format.m_Zstd );
+            TEST_ASSERT( cache.Publish( cacheId, mb.GetData(), static_cast<size_t>( mb.GetDataSize() ) ) );
+        }
+
+        // Decompress directly into the files
+        {
+            void * data = nullptr;
+            size_t dataSize = 0;
+            TEST_ASSERT( cache.Retrieve( cacheId, data, dataSize ) );
+            const MultiBuffer mb( data, dataSize );
+            TEST_ASSERT( mb.DecompressToFiles( dstFiles ) );
+            cache.FreeMemory( data, dataSize );
+        }
+
+        // Check results
+        for ( size_t j = 0; j < dstFiles.GetSize(); ++j )
+        {
+            FileStream f;
+            TEST_ASSERT( f.Open( dstFiles[ j ].Get() ) );
+            TEST_ASSERT( f.GetFileSize() == fileSizes[ j ] );
+            if ( fileSizes[ j ] > 0 )
+            {
+                MemoryStream ms;
+                TEST_ASSERT( ms.WriteBuffer( f, fileSizes[ j ] ) == fileSizes[ j ] );
+                TEST_ASSERT( xxHash3::Calc64( ms.GetData(), ms.GetSize() ) == srcHashes[ j ] );
+            }
+        }
+    }
+
+    // Corrupt data is detected
+    {
+        AStackString cacheId;
+        ICache::GetCacheId( 2, 0, 0, 0, cacheId );
+        MultiBuffer mb;
+        TEST_ASSERT( mb.CreateFromFiles( srcFiles ) );
+        mb.Compress( 1, true );
+        size_t dataSize = 0;
+        UniquePtr<char, FreeDeletor> data( static_cast<char *>( mb.Release( dataSize ) ) );
+        const size_t truncatedSize = ( dataSize / 2 );
+        reinterpret_cast<uint32_t *>( data.Get() )[ 2 ] = static_cast<uint32_t>( truncatedSize - 12 ); // Keep header consistent
+        const MultiBuffer truncated( data.Get(), truncatedSize );
+        size_t problemFileIndex = dstFiles.GetSize();
+        TEST_ASSERT( truncated.DecompressToFiles( dstFiles, &problemFileIndex ) == false );
+        TEST_ASSERT( problemFileIndex == dstFiles.GetSize() ); // Not a write failure
+    }
+
+    cache.Shutdown();
+}
+
+// Deduplication
+//------------------------------------------------------------------------------
+void TestCache::Deduplication() const
+{
+    const AStackString cachePath( "../tmp/Test/Cache/Deduplication/" );
+    AStackString chunksPath;
+    CacheChunkStore::GetChunksPath( cachePath, chunksPath );
+
+    Cache cache;
+    TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+    cache.SetDeduplication( true, 1 );
+
+    // Remove anything left over from previous runs (unused chunks are only
+    // trimmed once they are old)
+    TEST_ASSERT( cache.Trim( false, 0 ) );
+    {
+        Array<AString> chunkFiles;
+        FileIO::GetFiles( chunksPath, AStackString( "*" ), true, &chunkFiles );
+        for ( const AString & chunkFile : chunkFiles )
+        {
+            TEST_ASSERT( FileIO::FileDelete( chunkFile.Get() ) );
+        }
+    }
+
+    // Two large entries, where the second has some bytes inserted
+    const size_t dataSize = ( 2 * MEGABYTE );
+    const size_t insertPos = ( MEGABYTE + 12345 );
+    const size_t insertSize = 100;
+    MemoryStream dataA;
+    MemoryStream dataB;
+    Random r( 5678 );
+    for ( size_t i = 0; i < dataSize; ++i )
+    {
+        if ( i == insertPos )
+        {
+            for ( size_t j = 0; j < insertSize; ++j )
+            {
+                dataB.Write( static_cast<uint8_t>( j ) );
+            }
+        }
+        const uint8_t value = static_cast<uint8_t>( r.GetRand() );
+        dataA.Write( value );
+        dataB.Write( value );
+    }
+
+    AStackString idA, idB, idSmall;
+    ICache::GetCacheId( 1, 0, 0, 0, idA );
+    ICache::GetCacheId( 2, 0, 0, 0, idB );
+    ICache::GetCacheId( 3, 0, 0, 0, idSmall );
+
+    // Only chunks around the modification are stored for the second entry
+    Array<AString> chunkFiles;
+    TEST_ASSERT( cache.Publish( idA, dataA.GetData(), dataA.GetSize() ) );
+    FileIO::GetFiles( chunksPath, AStackString( "*" ), true, &chunkFiles );
+    const size_t numChunksA = chunkFiles.GetSize();
+    TEST_ASSERT( numChunksA >= 8 );
+    TEST_ASSERT( cache.Publish( idB, dataB.GetData(), dataB.GetSize() ) );
+    chunkFiles.Clear();
+    FileIO::GetFiles( chunksPath, AStackString( "*" ), true, &chunkFiles );
+    const size_t numChunksB = ( chunkFiles.GetSize() - numChunksA );
+    TEST_ASSERT( ( numChunksB >= 1 ) && ( numChunksB <= 3 ) );
+
+    // Small entries are stored inline
+    const char smallData[] = "small";
+    TEST_ASSERT( cache.Publish( idSmall, smallData, sizeof( smallData ) ) );
+    chunkFiles.Clear();
+    FileIO::GetFiles( chunksPath, AStackString( "*" ), true, &chunkFiles );
+    TEST_ASSERT( chunkFiles.GetSize() == ( numChunksA + numChunksB ) );
+
+    // Entries are reassembled exactly, with or without deduplication enabled
+    {
+        Cache readOnlyCache;
+        TEST_ASSERT( readOnlyCache.Init( cachePath, AString::GetEmpty(), true, false, false, AString::GetEmpty() ) );
+        const MemoryStream * const expectedData[] = { &dataA, &dataB };
+        const AString * const ids[] = { &idA, &idB };
+        for ( size_t i = 0; i < 2; ++i )
+        {
+            void * data = nullptr;
+            size_t size = 0;
+            TEST_ASSERT( readOnlyCache.Retrieve( *ids[ i ], data, size ) );
+            TEST_ASSERT( size == expectedData[ i ]->GetSize() );
+            TEST_ASSERT( memcmp( data, expectedData[ i ]->GetData(), size ) == 0 );
+            readOnlyCache.FreeMemory( data, size );
+        }
+
+        void * data = nullptr;
+        size_t size = 0;
+        TEST_ASSERT( readOnlyCache.Retrieve( idSmall, data, size ) );
+        TEST_ASSERT( ( size == sizeof( smallData ) ) && ( memcmp( data, smallData, size ) == 0 ) );
+        readOnlyCache.FreeMemory( data, size );
+        readOnlyCache.Shutdown();
+    }
+
+    // Chunks are removed along with the last entry using them
+    TEST_ASSERT( cache.Trim( false, 1024 ) );
+    chunkFiles.Clear();
+    FileIO::GetFiles( chunksPath, AStackString( "*" ), true, &chunkFiles );
+    TEST_ASSERT( chunkFiles.GetSize() == ( numChunksA + numChunksB ) );
+    TEST_ASSERT( cache.Trim( false, 0 ) );
+    chunkFiles.Clear();
+    FileIO::GetFiles( chunksPath, AStackString( "*" ), true, &chunkFiles );
+    TEST_ASSERT( chunkFiles.GetSize() == ( numChunksA + numChunksB ) ); // Recently used chunks are kept
+    for ( const AString & chunkFile : chunkFiles )
+    {
+        TEST_ASSERT( FileIO::SetFileLastWriteTime( chunkFile, 1 ) ); // Make chunks old
+    }
+
+    // Reusing a chunk protects it from trimming, even before the index knows
+    // about the entry using it (accesses from another process are not flushed)
+    {
+        Cache otherCache;
+        TEST_ASSERT( otherCache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        otherCache.SetDeduplication( true, 1 );
+        TEST_ASSERT( otherCache.Publish( idB, dataB.GetData(), dataB.GetSize() ) );
+
+        TEST_ASSERT( cache.Trim( false, 1024 ) );
+        void * data = nullptr;
+        size_t size = 0;
+        TEST_ASSERT( cache.Retrieve( idB, data, size ) );
+        cache.FreeMemory( data, size );
+
+        otherCache.Shutdown();
+    }
+
+    // Chunks are removed once no longer used
+    TEST_ASSERT( cache.Trim( false, 0 ) );
+    chunkFiles.Clear();
+    FileIO::GetFiles( chunksPath, AStackString( "*" ), true, &chunkFiles );
+    for ( const AString & chunkFile : chunkFiles )
+    {
+        TEST_ASSERT( FileIO::SetFileLastWriteTime( chunkFile, 1 ) );
+    }
+    TEST_ASSERT( cache.Trim( false, 0 ) );
+    chunkFiles.Clear();
+    FileIO::GetFiles( chunksPath, AStackString( "*" ), true, &chunkFiles );
+    TEST_ASSERT( chunkFiles.IsEmpty() );
+
+    // A missing chunk results in a cache miss
+    TEST_ASSERT( cache.Publish( idA, dataA.GetData(), dataA.GetSize() ) );
+    chunkFiles.Clear();
+    FileIO::GetFiles( chunksPath, AStackString( "*" ), true, &chunkFiles );
+    TEST_ASSERT( FileIO::FileDelete( chunkFiles[ 0 ].Get() ) );
+    void * data = nullptr;
+    size_t size = 0;
+    TEST_ASSERT( cache.Retrieve( idA, data, size ) == false );
+
+    cache.Shutdown();
+}
+
 // ConsistentCacheKeysWithDist
 //------------------------------------------------------------------------------
 void TestCache::ConsistentCacheKeysWithDist() const
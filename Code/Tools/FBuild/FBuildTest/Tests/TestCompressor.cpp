@@ -5,9 +5,11 @@
 //------------------------------------------------------------------------------
 #include "FBuildTest.h"
 
+#include "Tools/FBuild/FBuildCore/Helpers/CompressionDictionary.h"
 #include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
 
 // Core
+#include "Core/Containers/Array.h"
 #include "Core/Containers/UniquePtr.h"
 #include "Core/FileIO/FileStream.h"
 #include "Core/Strings/AString.h"
@@ -27,6 +29,7 @@ private:
     void CompressPreprocessedFile() const;
     void CompressObjFile() const;
     void TestHeaderValidity() const;
+    void CompressWithDictionary() const;
 
     void CompressSimpleHelper( const char * data,
                                size_t size,
@@ -43,6 +46,7 @@ REGISTER_TESTS_BEGIN( TestCompressor )
     REGISTER_TEST( CompressPreprocessedFile )
     REGISTER_TEST( CompressObjFile )
     REGISTER_TEST( TestHeaderValidity )
+    REGISTER_TEST( CompressWithDictionary )
 REGISTER_TESTS_END
 
 // CompressSimple
@@ -307,4 +311,85 @@ void TestCompressor::TestHeaderValidity() const
     TEST_ASSERT( Compressor::IsValidData( buffer.Get(), 44 ) == false );
 }
 
+// CompressWithDictionary
+//------------------------------------------------------------------------------
+void TestCompressor::CompressWithDictionary() const
+{
+    // Make samples with common content (like included headers) followed by
+    // content unique to each (like the translation unit itself)
+    AString common;
+    for ( uint32_t i = 0; i < 2000; ++i )
+    {
+        common.AppendFormat( "inline int CommonFunction%u( int a ) { return a * %u; }\n", i, ( i * 7919 ) % 1000 );
+    }
+    Array<AString> samples;
+    for ( uint32_t i = 0; i < 5; ++i )
+    {
+        AString & sample = samples.EmplaceBack( common );
+        for ( uint32_t j = 0; j < 100; ++j )
+        {
+            sample.AppendFormat( "int UniqueFunction%u_%u() { return %u; }\n", i, j, ( i * j * 104729 ) % 9973 );
+        }
+    }
+
+    // Train on all but the last sample
+    Array<const char *> trainingSamples;
+    Array<size_t> trainingSampleSizes;
+    for ( size_t i = 0; i < ( samples.GetSize() - 1 ); ++i )
+    {
+        trainingSamples.Append( samples[ i ].Get() );
+        trainingSampleSizes.Append( samples[ i ].GetLength() );
+    }
+    CompressionDictionary * dictionary = CompressionDictionaryBuilder::Train( trainingSamples, trainingSampleSizes );
+    TEST_ASSERT( dictionary );
+
+    // Compress the last sample with and without the dictionary
+    const AString & data = samples.Top();
+    Compressor withoutDictionary;
+    TEST_ASSERT( withoutDictionary.CompressZstd( data.Get(), data.GetLength(), 3 ) );
+    Compressor withDictionary;
+    TEST_ASSERT( withDictionary.CompressZstd( data.Get(), data.GetLength(), 3, *dictionary ) );
+    TEST_ASSERT( withDictionary.GetResultSize() < withoutDictionary.GetResultSize() );
+
+    // Decompress with the dictionary
+    {
+        Compressor d;
+        TEST_ASSERT( d.Decompress( withDictionary.GetResult(), dictionary ) );
+        TEST_ASSERT( d.GetResultSize() == data.GetLength() );
+        TEST_ASSERT( memcmp( data.Get(), d.GetResult(), data.GetLength() ) == 0 );
+    }
+
+    // Decompression fails without the dictionary
+    {
+        Compressor d;
+        TEST_ASSERT( d.Decompress( withDictionary.GetResult() ) == false );
+    }
+
+    // Decompression fails with a different dictionary
+    {
+        const char otherContent[] = "Some other dictionary content";
+        void * otherData = ALLOC( sizeof( otherContent ) );
+        memcpy( otherData, otherContent, sizeof( otherContent ) );
+        CompressionDictionary * otherDictionary = FNEW( CompressionDictionary( otherData, sizeof( otherContent ) ) );
+        Compressor d;
+        TEST_ASSERT( d.Decompress( withDictionary.GetResult(), otherDictionary ) == false );
+        otherDictionary->Release();
+    }
+
+    // Samples with nothing in common produce no dictionary
+    {
+        const char * a = "int a;\n";
+        const char * b = "int b;\n";
+        Array<const char *> uniqueSamples;
+        Array<size_t> uniqueSampleSizes;
+        uniqueSamples.Append( a );
+        uniqueSampleSizes.Append( AString::StrLen( a ) );
+        uniqueSamples.Append( b );
+        uniqueSampleSizes.Append( AString::StrLen( b ) );
+        TEST_ASSERT( CompressionDictionaryBuilder::Train( uniqueSamples, uniqueSampleSizes ) == nullptr );
+    }
+
+    dictionary->Release();
+}
+
 //------------------------------------------------------------------------------
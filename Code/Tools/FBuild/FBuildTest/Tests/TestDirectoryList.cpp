@@ -7,11 +7,13 @@
 
 // FBuildCore
 #include "Tools/FBuild/FBuildCore/Graph/DirectoryListNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/DirectorySnapshotCache.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
 
 // Core
 #include "Core/Containers/Array.h"
 #include "Core/FileIO/PathUtils.h"
+#include "Core/Process/Thread.h"
 #include "Core/Strings/AStackString.h"
 
 // TestGraph
@@ -23,6 +25,10 @@ private:
 
     void Build() const;
     void Names() const;
+    void SharedSnapshots() const;
+    void ParallelWalk() const;
+
+    static void GetSortedFiles( const Array<FileIO::FileInfo> & files, Array<AString> & outFiles );
 };
 
 // Register Tests
@@ -30,6 +36,8 @@ private:
 REGISTER_TESTS_BEGIN( TestDirectoryList )
     REGISTER_TEST( Build )
     REGISTER_TEST( Names )
+    REGISTER_TEST( SharedSnapshots )
+    REGISTER_TEST( ParallelWalk )
 REGISTER_TESTS_END
 
 // Build
@@ -217,4 +225,189 @@ void TestDirectoryList::Names() const
     }
 }
 
+// SharedSnapshots
+//------------------------------------------------------------------------------
+void TestDirectoryList::SharedSnapshots() const
+{
+    // Files used by this test
+    AStackString root( "../tmp/Test/DirectoryList/SharedSnapshots/" );
+    AStackString newFile( "../tmp/Test/DirectoryList/SharedSnapshots/d.cpp" );
+    PathUtils::FixupFolderPath( root );
+    PathUtils::FixupFilePath( newFile );
+    EnsureFileDoesNotExist( newFile );
+    EnsureDirExists( "../tmp/Test/DirectoryList/SharedSnapshots/Sub/" );
+    MakeFile( "../tmp/Test/DirectoryList/SharedSnapshots/a.cpp", "" );
+    MakeFile( "../tmp/Test/DirectoryList/SharedSnapshots/b.h", "" );
+    MakeFile( "../tmp/Test/DirectoryList/SharedSnapshots/Sub/c.cpp", "" );
+
+    StackArray<AString> cppPattern;
+    cppPattern.EmplaceBack( "*.cpp" );
+    StackArray<AString> hPattern;
+    hPattern.EmplaceBack( "*.h" );
+
+    DirectorySnapshotCache cache;
+
+    // First walk reads each directory, and the attributes of the files found
+    {
+        GetFilesHelper helper( cppPattern );
+        cache.GetFiles( root, helper );
+        TEST_ASSERT( helper.GetFiles().GetSize() == 2 );
+        TEST_ASSERT( cache.GetNumDirectoriesRead() == 2 );
+        TEST_ASSERT( cache.GetNumDirectoriesReused() == 0 );
+        TEST_ASSERT( cache.GetNumFileInfosRead() == 2 );
+
+        // Results are the same as walking the directories directly
+        GetFilesHelper uncachedHelper( cppPattern );
+        FileIO::GetFiles( root, uncachedHelper );
+        TEST_ASSERT( uncachedHelper.GetFiles().GetSize() == 2 );
+        for ( const FileIO::FileInfo & info : uncachedHelper.GetFiles() )
+        {
+            bool found = false;
+            for ( const FileIO::FileInfo & cachedInfo : helper.GetFiles() )
+            {
+                if ( ( cachedInfo.m_Name == info.m_Name ) &&
+                     ( cachedInfo.m_Size == info.m_Size ) &&
+                     ( cachedInfo.m_LastWriteTime == info.m_LastWriteTime ) )
+                {
+                    found = true;
+                }
+            }
+            TEST_ASSERT( found );
+        }
+    }
+
+    // Different pattern uses the same snapshots
+    {
+        GetFilesHelper helper( hPattern );
+        cache.GetFiles( root, helper );
+        TEST_ASSERT( helper.GetFiles().GetSize() == 1 );
+        TEST_ASSERT( cache.GetNumDirectoriesRead() == 2 );
+        TEST_ASSERT( cache.GetNumDirectoriesReused() == 2 );
+        TEST_ASSERT( cache.GetNumFileInfosRead() == 3 );
+        TEST_ASSERT( cache.GetNumFileInfosReused() == 0 );
+    }
+
+    // Same pattern uses the same file attributes
+    {
+        GetFilesHelper helper( cppPattern );
+        cache.GetFiles( root, helper );
+        TEST_ASSERT( helper.GetFiles().GetSize() == 2 );
+        TEST_ASSERT( cache.GetNumDirectoriesRead() == 2 );
+        TEST_ASSERT( cache.GetNumFileInfosRead() == 3 );
+        TEST_ASSERT( cache.GetNumFileInfosReused() == 2 );
+    }
+
+#if defined( __OSX__ )
+    Thread::Sleep( 1000 ); // Work around low time resolution of HFS+
+#endif
+
+    // Files added (e.g. generated during the build) cause the directory to be read again
+    MakeFile( newFile.Get(), "" );
+    {
+        GetFilesHelper helper( cppPattern );
+        cache.GetFiles( root, helper );
+        TEST_ASSERT( helper.GetFiles().GetSize() == 3 );
+        TEST_ASSERT( cache.GetNumDirectoriesRead() == 3 ); // Sub-directory is unchanged
+    }
+
+    // Files written by the build cause the directory to be read again, even
+    // if the last write time of the directory doesn't change
+    MakeFile( newFile.Get(), "Modified" );
+    {
+        GetFilesHelper helper( cppPattern );
+        cache.GetFiles( root, helper );
+        TEST_ASSERT( cache.GetNumDirectoriesRead() == 3 ); // Previous attributes are used
+    }
+    cache.OnFileWritten( newFile );
+    {
+        GetFilesHelper helper( cppPattern );
+        cache.GetFiles( root, helper );
+        TEST_ASSERT( cache.GetNumDirectoriesRead() == 4 ); // Sub-directory is unchanged
+        bool found = false;
+        for ( const FileIO::FileInfo & info : helper.GetFiles() )
+        {
+            if ( info.m_Name == newFile )
+            {
+                found = ( info.m_Size == 8 );
+            }
+        }
+        TEST_ASSERT( found );
+    }
+}
+
+// ParallelWalk
+//------------------------------------------------------------------------------
+void TestDirectoryList::ParallelWalk() const
+{
+    // A tree with several levels, and enough files in one directory to
+    // retrieve attributes in more than one batch
+    AStackString root( "../tmp/Test/DirectoryList/ParallelWalk/" );
+    PathUtils::FixupFolderPath( root );
+    AStackString dirName;
+    AStackString fileName;
+    for ( uint32_t i = 0; i < 4; ++i )
+    {
+        for ( uint32_t j = 0; j < 3; ++j )
+        {
+            dirName.Format( "%sDir%u/Sub%u/", root.Get(), i, j );
+            PathUtils::FixupFolderPath( dirName );
+            EnsureDirExists( dirName );
+            fileName.Format( "%sfile.cpp", dirName.Get() );
+            MakeFile( fileName.Get(), "" );
+        }
+    }
+    for ( uint32_t i = 0; i < 150; ++i )
+    {
+        fileName.Format( "%sDir0/file%03u.cpp", root.Get(), i );
+        PathUtils::FixupFilePath( fileName );
+        MakeFile( fileName.Get(), "" );
+        fileName.Format( "%sDir0/file%03u.h", root.Get(), i );
+        PathUtils::FixupFilePath( fileName );
+        MakeFile( fileName.Get(), "" );
+    }
+
+    StackArray<AString> cppPattern;
+    cppPattern.EmplaceBack( "*.cpp" );
+
+    // Walk directly
+    Array<AString> expectedFiles;
+    {
+        GetFilesHelper helper( cppPattern );
+        FileIO::GetFiles( root, helper );
+        TEST_ASSERT( helper.GetFiles().GetSize() == ( 12 + 150 ) );
+        GetSortedFiles( helper.GetFiles(), expectedFiles );
+    }
+
+    // Walk on the calling thread only, and in parallel
+    const uint32_t numThreadsToTest[] = { 0, DirectorySnapshotCache::kDefaultNumThreads };
+    for ( const uint32_t numThreads : numThreadsToTest )
+    {
+        DirectorySnapshotCache cache( numThreads );
+        GetFilesHelper helper( cppPattern );
+        cache.GetFiles( root, helper );
+        TEST_ASSERT( cache.GetNumDirectoriesRead() == ( 1 + 4 + 12 ) );
+
+        Array<AString> files;
+        GetSortedFiles( helper.GetFiles(), files );
+        TEST_ASSERT( files.GetSize() == expectedFiles.GetSize() );
+        for ( size_t i = 0; i < files.GetSize(); ++i )
+        {
+            TEST_ASSERT( files[ i ] == expectedFiles[ i ] );
+        }
+    }
+}
+
+// GetSortedFiles
+//------------------------------------------------------------------------------
+/*static*/ void TestDirectoryList::GetSortedFiles( const Array<FileIO::FileInfo> & files, Array<AString> & outFiles )
+{
+    // Names and attributes, in a form which can be compared
+    for ( const FileIO::FileInfo & info : files )
+    {
+        AString & file = outFiles.EmplaceBack();
+        file.Format( "%s|%" PRIu64 "|%" PRIu64 "|%u", info.m_Name.Get(), info.m_Size, info.m_LastWriteTime, info.m_Attributes );
+    }
+    outFiles.Sort();
+}
+
 //------------------------------------------------------------------------------
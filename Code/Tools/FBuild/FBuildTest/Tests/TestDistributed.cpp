@@ -5,16 +5,28 @@
 //------------------------------------------------------------------------------
 #include "Tools/FBuild/FBuildTest/Tests/FBuildTest.h"
 
+#include "Tools/FBuild/FBuildCore/Cache/Cache.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
+#include "Tools/FBuild/FBuildCore/Graph/SettingsNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompressionDictionary.h"
+#include "Tools/FBuild/FBuildCore/Helpers/HeaderFragmentStore.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ToolChunkStore.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Server.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/BrokerageService.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/BrokerageServiceConnection.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueueRemote.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThreadRemote.h"
 
 // Core
 #include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Thread.h"
 #include "Core/Strings/AStackString.h"
+#include "Core/Time/Timer.h"
 #include "Core/Tracing/Tracing.h"
 
 // Defines
@@ -40,11 +52,18 @@ private:
     void RemoteRaceSystemFailure();
 #endif
     void AnonymousNamespaces();
+    void WithCompressionDictionary() const;
+    void WithHeaderFragments() const;
+    void ToolChunkBoundaries() const;
+    void WorkerCache() const;
+    void WorkerStatus() const;
+    void BrokerageServiceDiscovery() const;
     void ErrorsAreCorrectlyReported_MSVC() const;
     void ErrorsAreCorrectlyReported_Clang() const;
     void WarningsAreCorrectlyReported_MSVC() const;
     void WarningsAreCorrectlyReported_Clang() const;
     void ShutdownMemoryLeak() const;
+    void PrepareToolchainBeforeJobs() const;
     void TestForceInclude() const;
     void TestZiDebugFormat() const;
     void TestZiDebugFormat_Local() const;
@@ -71,7 +90,14 @@ REGISTER_TESTS_BEGIN( TestDistributed )
     REGISTER_TEST( RemoteRaceSystemFailure )
 #endif
     REGISTER_TEST( AnonymousNamespaces )
+    REGISTER_TEST( WithCompressionDictionary )
+    REGISTER_TEST( WithHeaderFragments )
+    REGISTER_TEST( ToolChunkBoundaries )
+    REGISTER_TEST( WorkerCache )
+    REGISTER_TEST( WorkerStatus )
+    REGISTER_TEST( BrokerageServiceDiscovery )
     REGISTER_TEST( ShutdownMemoryLeak )
+    REGISTER_TEST( PrepareToolchainBeforeJobs )
 #if defined( __WINDOWS__ )
     REGISTER_TEST( ErrorsAreCorrectlyReported_MSVC ) // TODO:B Enable for OSX and Linux
     REGISTER_TEST( ErrorsAreCorrectlyReported_Clang ) // TODO:B Enable for OSX and Linux
@@ -257,6 +283,320 @@ void TestDistributed::TestForceInclude() const
     TestHelper( target, 1 );
 }
 
+// WithCompressionDictionary
+//------------------------------------------------------------------------------
+void TestDistributed::WithCompressionDictionary() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/fbuild.bff";
+    options.m_AllowDistributed = true;
+    options.m_NumWorkerThreads = 1;
+    options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+    options.m_ForceCleanBuild = true;
+    options.m_DistributionDictionarySamples = 2; // Train on the first 2 jobs, so later jobs use the dictionary
+
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+
+    // start a client to emulate the other end
+    Server s( 1 );
+    s.Listen( Protocol::kTestPort );
+
+    TEST_ASSERT( fBuild.Build( "../tmp/Test/Distributed/SharedHeader/SharedHeader.lib" ) );
+
+    // The common header should have been found
+    TEST_ASSERT( fBuild.GetDistributionDictionaryBuilder() );
+    TEST_ASSERT( fBuild.GetDistributionDictionaryBuilder()->GetDictionary() );
+}
+
+// WithHeaderFragments
+//------------------------------------------------------------------------------
+void TestDistributed::WithHeaderFragments() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/fbuild.bff";
+    options.m_AllowDistributed = true;
+    options.m_NumWorkerThreads = 1;
+    options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+    options.m_ForceCleanBuild = true;
+    options.m_DistributionDeduplication = true;
+
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+
+    // start a client to emulate the other end
+    Server s( 1 );
+    s.Listen( Protocol::kTestPort );
+
+    TEST_ASSERT( fBuild.Build( "../tmp/Test/Distributed/SharedHeader/SharedHeader.lib" ) );
+
+    // The shared header should have been stored (and so sent) only once
+    const HeaderFragmentStore * fragmentStore = fBuild.GetDistributionHeaderFragmentStore();
+    TEST_ASSERT( fragmentStore );
+    TEST_ASSERT( fragmentStore->GetNumFragmentReferences() > fragmentStore->GetNumFragments() );
+}
+
+// ToolChunkBoundaries
+//------------------------------------------------------------------------------
+void TestDistributed::ToolChunkBoundaries() const
+{
+    // Pseudo-random content (like a binary)
+    const size_t dataSize = ( 4 * 1024 * 1024 );
+    Array<uint8_t> data;
+    data.SetSize( dataSize );
+    uint32_t state = 0x12345678;
+    for ( uint8_t & byte : data )
+    {
+        state = ( state * 1664525 ) + 1013904223; // LCG
+        byte = static_cast<uint8_t>( state >> 24 );
+    }
+
+    Array<uint32_t> chunkSizes;
+    ToolChunkStore::FindChunks( data.Begin(), data.GetSize(), chunkSizes );
+
+    // Chunks must cover the data and respect the size limits
+    size_t total = 0;
+    for ( size_t i = 0; i < chunkSizes.GetSize(); ++i )
+    {
+        TEST_ASSERT( chunkSizes[ i ] <= ToolChunkStore::kMaxChunkSize );
+        TEST_ASSERT( ( chunkSizes[ i ] >= ToolChunkStore::kMinChunkSize ) || ( i == ( chunkSizes.GetSize() - 1 ) ) );
+        total += chunkSizes[ i ];
+    }
+    TEST_ASSERT( total == dataSize );
+    TEST_ASSERT( chunkSizes.GetSize() > 8 ); // boundaries are found from the content
+
+    // Insert some bytes near the start
+    Array<uint8_t> modifiedData;
+    modifiedData.SetCapacity( dataSize + 100 );
+    modifiedData.Append( data.Begin(), data.Begin() + 1000 );
+    for ( uint8_t i = 0; i < 100; ++i )
+    {
+        modifiedData.Append( i );
+    }
+    modifiedData.Append( data.Begin() + 1000, data.End() );
+
+    Array<uint32_t> modifiedChunkSizes;
+    ToolChunkStore::FindChunks( modifiedData.Begin(), modifiedData.GetSize(), modifiedChunkSizes );
+
+    // Only the chunks around the insertion should change, so most of the
+    // content can be reused
+    TEST_ASSERT( modifiedChunkSizes.GetSize() == chunkSizes.GetSize() );
+    size_t numUnchanged = 0;
+    for ( size_t i = 0; i < chunkSizes.GetSize(); ++i )
+    {
+        numUnchanged += ( chunkSizes[ i ] == modifiedChunkSizes[ i ] ) ? 1 : 0;
+    }
+    TEST_ASSERT( numUnchanged == ( chunkSizes.GetSize() - 1 ) );
+}
+
+// WorkerCache
+//------------------------------------------------------------------------------
+void TestDistributed::WorkerCache() const
+{
+    // A cache which counts use by the worker
+    class WorkerCacheForTest : public Cache
+    {
+    public:
+        virtual bool Publish( const AString & cacheId, const void * data, size_t dataSize ) override
+        {
+            const bool stored = Cache::Publish( cacheId, data, dataSize );
+            m_NumStores.Add( stored ? 1 : 0 );
+            return stored;
+        }
+        virtual bool Retrieve( const AString & cacheId, void *& data, size_t & dataSize ) override
+        {
+            const bool hit = Cache::Retrieve( cacheId, data, dataSize );
+            m_NumHits.Add( hit ? 1 : 0 );
+            return hit;
+        }
+
+        Atomic<uint32_t> m_NumStores;
+        Atomic<uint32_t> m_NumHits;
+    };
+
+    // The worker has its own cache, so the client doesn't see the results it stores
+    const AStackString workerCachePath( "../tmp/Test/Distributed/WorkerCache/" );
+    Array<AString> files;
+    FileIO::GetFiles( workerCachePath, AStackString( "*" ), true, &files );
+    for ( const AString & file : files )
+    {
+        FileIO::FileDelete( file.Get() );
+    }
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/fbuild.bff";
+    options.m_AllowDistributed = true;
+    options.m_NumWorkerThreads = 1;
+    options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+    options.m_AllowLocalRace = false;
+    options.m_ForceCleanBuild = true;
+
+    const char * target = "../tmp/Test/Distributed/SharedHeader/SharedHeader.lib";
+    const uint32_t numObjects = 4;
+
+    // Client writing to the cache
+    AStackString clientCachePath;
+    {
+        options.m_UseCacheWrite = true;
+
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        clientCachePath = fBuild.GetSettings()->GetCachePath();
+        PathUtils::EnsureTrailingSlash( clientCachePath );
+
+        WorkerCacheForTest workerCache;
+        TEST_ASSERT( workerCache.Init( workerCachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        Server s( 1 );
+        JobQueueRemote::Get().SetCache( &workerCache, true );
+        s.Listen( Protocol::kTestPort );
+
+        TEST_ASSERT( fBuild.Build( target ) );
+
+        // Results were stored by the worker, instead of the client
+        TEST_ASSERT( workerCache.m_NumStores.Load() == numObjects );
+        const FBuildStats::Stats & objStats = fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumCacheStores == numObjects );
+        TEST_ASSERT( objStats.m_NumBuilt == numObjects );
+    }
+
+    // Remove the results from the client's cache, where previous runs may have stored them
+    files.Clear();
+    FileIO::GetFiles( workerCachePath, AStackString( "*.I" ), true, &files );
+    TEST_ASSERT( files.GetSize() == numObjects );
+    for ( const AString & file : files )
+    {
+        const char * cacheId = ( file.FindLast( NATIVE_SLASH ) + 1 );
+        AStackString clientFile;
+        clientFile.Format( "%s%c%c/%c%c/%s", clientCachePath.Get(), cacheId[ 0 ], cacheId[ 1 ], cacheId[ 2 ], cacheId[ 3 ], cacheId );
+        FileIO::FileDelete( clientFile.Get() );
+    }
+
+    // Client reading from the cache
+    {
+        options.m_UseCacheRead = true;
+
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        WorkerCacheForTest workerCache;
+        TEST_ASSERT( workerCache.Init( workerCachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        Server s( 1 );
+        JobQueueRemote::Get().SetCache( &workerCache, true );
+        s.Listen( Protocol::kTestPort );
+
+        TEST_ASSERT( fBuild.Build( target ) );
+
+        // Results were retrieved by the worker, so nothing was stored
+        TEST_ASSERT( workerCache.m_NumHits.Load() == numObjects );
+        TEST_ASSERT( workerCache.m_NumStores.Load() == 0 );
+        const FBuildStats::Stats & objStats = fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumCacheHits == numObjects );
+        TEST_ASSERT( objStats.m_NumCacheStores == 0 );
+    }
+}
+
+// WorkerStatus
+//------------------------------------------------------------------------------
+void TestDistributed::WorkerStatus() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/fbuild.bff";
+    options.m_AllowDistributed = true;
+    options.m_NumWorkerThreads = 1;
+    options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+    options.m_ForceCleanBuild = true;
+    options.m_DistVerbose = true;
+
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+
+    // start a client to emulate the other end
+    Server s( 4 );
+    s.SetIdlePercent( 75 );
+    s.Listen( Protocol::kTestPort );
+
+    TEST_ASSERT( fBuild.Build( "../tmp/Test/Distributed/dist.lib" ) );
+
+    // The worker should have reported its load when we connected
+    TEST_ASSERT( GetRecordedOutput().Find( "has 4 CPUs available" ) );
+    TEST_ASSERT( GetRecordedOutput().Find( "75% idle" ) );
+}
+
+// BrokerageServiceDiscovery
+//------------------------------------------------------------------------------
+void TestDistributed::BrokerageServiceDiscovery() const
+{
+    // start a loopback service
+    BrokerageService service;
+    TEST_ASSERT( service.Listen( Protocol::kBrokerageTestPort ) );
+
+    AStackString serviceAddress;
+    serviceAddress.Format( "127.0.0.1:%u", Protocol::kBrokerageTestPort );
+
+    // register some workers
+    BrokerageServiceConnection worker1;
+    BrokerageServiceConnection worker2;
+    BrokerageServiceConnection worker3;
+    TEST_ASSERT( worker1.ConnectToService( serviceAddress, 2000 ) );
+    TEST_ASSERT( worker2.ConnectToService( serviceAddress, 2000 ) );
+    TEST_ASSERT( worker3.ConnectToService( serviceAddress, 2000 ) );
+    TEST_ASSERT( worker1.SendHeartbeat( AStackString( "10.0.0.1" ), true, 8, 8, 0, 1024 ) );
+    TEST_ASSERT( worker2.SendHeartbeat( AStackString( "10.0.0.2" ), true, 64, 64, 0, 1024 ) );
+    TEST_ASSERT( worker3.SendHeartbeat( AStackString( "10.0.0.3" ), false, 0, 16, 0, 1024 ) );
+
+    const Timer t;
+    while ( service.GetNumWorkers() < 3 )
+    {
+        TEST_ASSERT( t.GetElapsed() < 5.0f );
+        Thread::Sleep( 1 );
+    }
+
+    // query them, most available first (unavailable worker excluded)
+    {
+        BrokerageServiceConnection client;
+        TEST_ASSERT( client.ConnectToService( serviceAddress, 2000 ) );
+        Array<AString> workers;
+        TEST_ASSERT( client.QueryWorkers( workers, 2000 ) );
+        TEST_ASSERT( workers.GetSize() == 2 );
+        TEST_ASSERT( workers[ 0 ] == "10.0.0.2" );
+        TEST_ASSERT( workers[ 1 ] == "10.0.0.1" );
+    }
+
+    // busy workers are less preferable (heartbeat can arrive after a query)
+    TEST_ASSERT( worker2.SendHeartbeat( AStackString( "10.0.0.2" ), true, 64, 64, 60, 1024 ) );
+    {
+        BrokerageServiceConnection client;
+        TEST_ASSERT( client.ConnectToService( serviceAddress, 2000 ) );
+        const Timer t1;
+        for ( ;; )
+        {
+            Array<AString> workers;
+            TEST_ASSERT( client.QueryWorkers( workers, 2000 ) );
+            TEST_ASSERT( workers.GetSize() == 2 );
+            if ( workers[ 0 ] == "10.0.0.1" )
+            {
+                TEST_ASSERT( workers[ 1 ] == "10.0.0.2" );
+                break;
+            }
+            TEST_ASSERT( t1.GetElapsed() < 5.0f );
+            Thread::Sleep( 1 );
+        }
+    }
+
+    // workers are forgotten when they disconnect
+    worker1.ShutdownAllConnections();
+    worker2.ShutdownAllConnections();
+    worker3.ShutdownAllConnections();
+    const Timer t2;
+    while ( service.GetNumWorkers() > 0 )
+    {
+        TEST_ASSERT( t2.GetElapsed() < 5.0f );
+        Thread::Sleep( 1 );
+    }
+
+    service.ShutdownAllConnections();
+}
+
 // ErrorsAreCorrectlyReported_MSVC
 //------------------------------------------------------------------------------
 void TestDistributed::ErrorsAreCorrectlyReported_MSVC() const
@@ -424,6 +764,67 @@ void TestDistributed::ShutdownMemoryLeak() const
     TEST_ASSERT( detectedDistributedJobs );
 }
 
+// PrepareToolchainBeforeJobs
+//------------------------------------------------------------------------------
+void TestDistributed::PrepareToolchainBeforeJobs() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/fbuild.bff";
+    options.m_AllowDistributed = true;
+    options.m_NumWorkerThreads = 1;
+    options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+    options.m_ForceCleanBuild = true;
+
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+
+    // A worker with no CPUs available never requests jobs
+    Server s( 1 );
+    const uint32_t numCPUsToUse = WorkerThreadRemote::GetNumCPUsToUse();
+    WorkerThreadRemote::SetNumCPUsToUse( 0 );
+    s.Listen( Protocol::kTestPort );
+
+    // Create thread that gives the worker CPUs once it is synchronizing the toolchain
+    class Helper
+    {
+    public:
+        static uint32_t AllowJobs( void * data )
+        {
+            Helper & helper = *static_cast<Helper *>( data );
+
+            // Wait for the worker to start synchronizing the toolchain
+            const Timer t;
+            while ( t.GetElapsed() < 10.0f )
+            {
+                if ( helper.m_Server->GetNumToolchainsPrepared() > 0 )
+                {
+                    helper.m_PreparedBeforeJobs = true;
+                    break;
+                }
+                Thread::Sleep( 1 );
+            }
+
+            // Allow the worker to request jobs, so the build can complete
+            WorkerThreadRemote::SetNumCPUsToUse( helper.m_NumCPUsToUse );
+            return 0;
+        }
+
+        const Server * m_Server;
+        uint32_t m_NumCPUsToUse;
+        bool m_PreparedBeforeJobs;
+    };
+    Helper helper{ &s, numCPUsToUse, false };
+    Thread thread;
+    thread.Start( Helper::AllowJobs, "TestDistributed", &helper );
+
+    TEST_ASSERT( fBuild.Build( "../tmp/Test/Distributed/dist.lib" ) );
+
+    thread.Join();
+
+    TEST_ASSERT( helper.m_PreparedBeforeJobs );
+    TEST_ASSERT( s.GetNumToolchainsPrepared() == 1 );
+}
+
 // TestZiDebugFormat
 //------------------------------------------------------------------------------
 void TestDistributed::TestZiDebugFormat() const
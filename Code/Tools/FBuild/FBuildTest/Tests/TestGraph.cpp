@@ -36,6 +36,10 @@
 #include "Core/Process/Thread.h"
 #include "Core/Strings/AStackString.h"
 #include "Core/Time/Timer.h"
+#include "Core/Tracing/Tracing.h"
+
+// system
+#include <string.h> // for memcpy
 
 // TestGraph
 //------------------------------------------------------------------------------
@@ -53,13 +57,28 @@ private:
     void TestSerialization() const;
     void TestDeepGraph() const;
     void TestNoStopOnFirstError() const;
+    void EventDriven() const;
+    void EventDriven_NoStopOnFirstError() const;
+    void EventDriven_CompareBuildTimes() const;
     void DBLocationChanged() const;
     void DBCorrupt() const;
+    void DBJournal() const;
+    void DBJournalCorrupt() const;
+    void DBCheckpoint() const;
+    void DBSaveAsync() const;
     void BFFDirtied() const;
     void DBVersionChanged() const;
     void FixupErrorPaths() const;
     void CyclicDependency() const;
     void DBLocation() const;
+    void Watch() const;
+    void WatchIgnoresOwnWrites() const;
+
+    // Helpers
+    static void CheckFilesAreIdentical( const char * fileA, const char * fileB );
+    static uint64_t GetFileHash( const char * fileName );
+    static void WriteTextFile( const char * fileName, const char * contents );
+    void ResetDBJournalData() const;
 };
 
 // Register Tests
@@ -74,13 +93,24 @@ REGISTER_TESTS_BEGIN( TestGraph )
     REGISTER_TEST( TestSerialization )
     REGISTER_TEST( TestDeepGraph )
     REGISTER_TEST( TestNoStopOnFirstError )
+    REGISTER_TEST( EventDriven )
+    REGISTER_TEST( EventDriven_NoStopOnFirstError )
+    REGISTER_TEST( EventDriven_CompareBuildTimes )
     REGISTER_TEST( DBLocationChanged )
     REGISTER_TEST( DBCorrupt )
+    REGISTER_TEST( DBJournal )
+    REGISTER_TEST( DBJournalCorrupt )
+    REGISTER_TEST( DBCheckpoint )
+    REGISTER_TEST( DBSaveAsync )
     REGISTER_TEST( BFFDirtied )
     REGISTER_TEST( DBVersionChanged )
     REGISTER_TEST( FixupErrorPaths )
     REGISTER_TEST( CyclicDependency )
     REGISTER_TEST( DBLocation )
+#if defined( __LINUX__ )
+    REGISTER_TEST( Watch )
+    REGISTER_TEST( WatchIgnoresOwnWrites )
+#endif
 REGISTER_TESTS_END
 
 // NodeTestHelper
@@ -244,24 +274,86 @@ void TestGraph::TestSerialization() const
         // keep working dir active
 
         // compare the two files
-        FileStream fs1;
-        FileStream fs2;
-        fs1.Open( dbFile1 );
-        fs2.Open( dbFile2 );
-        TEST_ASSERT( fs1.GetFileSize() == fs2.GetFileSize() ); // size should be the same
-        UniquePtr<char, FreeDeletor> buffer1( (char *)ALLOC( MEGABYTE ) );
-        UniquePtr<char, FreeDeletor> buffer2( (char *)ALLOC( MEGABYTE ) );
-        uint32_t remaining = (uint32_t)fs1.GetFileSize();
-        while ( remaining > 0 )
-        {
-            const uint32_t readNow = Math::Min<uint32_t>( remaining, MEGABYTE );
-            TEST_ASSERT( fs1.Read( buffer1.Get(), readNow ) == readNow );
-            TEST_ASSERT( fs2.Read( buffer2.Get(), readNow ) == readNow );
-            remaining -= readNow;
+        CheckFilesAreIdentical( dbFile1, dbFile2 );
+    }
+
+    // load from the db again, splitting the load over many threads
+    {
+        const char * dbFile3 = "../tmp/Test/Graph/fbuild.db.3";
+
+        FBuildOptions options;
+        options.m_ConfigFile = "fbuild.bff";
+        options.m_NumWorkerThreads = 8;
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile1 ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile3 ) );
+
+        CheckFilesAreIdentical( dbFile1, dbFile3 );
+    }
+}
+
+// GetFileHash
+//------------------------------------------------------------------------------
+/*static*/ uint64_t TestGraph::GetFileHash( const char * fileName )
+{
+    FileStream f;
+    TEST_ASSERT( f.Open( fileName, FileStream::READ_ONLY ) );
+    AString buffer;
+    buffer.SetLength( (uint32_t)f.GetFileSize() );
+    TEST_ASSERT( f.ReadBuffer( buffer.Get(), f.GetFileSize() ) == f.GetFileSize() );
+    return xxHash3::Calc64( buffer );
+}
+
+// WriteTextFile
+//------------------------------------------------------------------------------
+/*static*/ void TestGraph::WriteTextFile( const char * fileName, const char * contents )
+{
+    FileStream f;
+    TEST_ASSERT( f.Open( fileName, FileStream::WRITE_ONLY ) );
+    TEST_ASSERT( f.WriteBuffer( contents, AString::StrLen( contents ) ) == AString::StrLen( contents ) );
+}
 
-            // content should be the same
-            TEST_ASSERT( AString::StrNCmp( buffer1.Get(), buffer2.Get(), readNow ) == 0 );
+// ResetDBJournalData
+//------------------------------------------------------------------------------
+void TestGraph::ResetDBJournalData() const
+{
+    // Remove files which may have been created by previous runs
+    const char * const dirs[] = { "../tmp/Test/Graph/DBJournal/Src/", "../tmp/Test/Graph/DBJournal/Dst/" };
+    const char * const files[] = { "a.txt", "b.txt", "c.txt" };
+    for ( const char * dir : dirs )
+    {
+        for ( const char * file : files )
+        {
+            AStackString path;
+            path.Format( "%s%s", dir, file );
+            EnsureFileDoesNotExist( path.Get() );
         }
+        EnsureDirDoesNotExist( dir );
+    }
+    TEST_ASSERT( FileIO::EnsurePathExists( AStackString( dirs[ 0 ] ) ) );
+}
+
+// CheckFilesAreIdentical
+//------------------------------------------------------------------------------
+/*static*/ void TestGraph::CheckFilesAreIdentical( const char * fileA, const char * fileB )
+{
+    FileStream fs1;
+    FileStream fs2;
+    fs1.Open( fileA );
+    fs2.Open( fileB );
+    TEST_ASSERT( fs1.GetFileSize() == fs2.GetFileSize() ); // size should be the same
+    UniquePtr<char, FreeDeletor> buffer1( (char *)ALLOC( MEGABYTE ) );
+    UniquePtr<char, FreeDeletor> buffer2( (char *)ALLOC( MEGABYTE ) );
+    uint32_t remaining = (uint32_t)fs1.GetFileSize();
+    while ( remaining > 0 )
+    {
+        const uint32_t readNow = Math::Min<uint32_t>( remaining, MEGABYTE );
+        TEST_ASSERT( fs1.Read( buffer1.Get(), readNow ) == readNow );
+        TEST_ASSERT( fs2.Read( buffer2.Get(), readNow ) == readNow );
+        remaining -= readNow;
+
+        // content should be the same
+        TEST_ASSERT( AString::StrNCmp( buffer1.Get(), buffer2.Get(), readNow ) == 0 );
     }
 }
 
@@ -545,6 +637,147 @@ void TestGraph::TestNoStopOnFirstError() const
     }
 }
 
+// EventDriven
+//------------------------------------------------------------------------------
+void TestGraph::EventDriven() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/DeepGraph.bff";
+    options.m_EventDrivenScheduling = true;
+
+    const char * dbFile = "../tmp/Test/Graph/EventDriven/DeepGraph.fdb";
+
+    {
+        // do a clean build
+        options.m_ForceCleanBuild = true;
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        CheckStatsNode( 1, 1, Node::OBJECT_NODE );
+        CheckStatsNode( 31, 31, Node::OBJECT_LIST_NODE );
+
+        // save the DB
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+    }
+
+    {
+        // no op build
+        options.m_ForceCleanBuild = false;
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        CheckStatsNode( 1, 0, Node::OBJECT_NODE );
+    }
+}
+
+// EventDriven_NoStopOnFirstError
+//------------------------------------------------------------------------------
+void TestGraph::EventDriven_NoStopOnFirstError() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/NoStopOnFirstError/fbuild.bff";
+    options.m_EventDrivenScheduling = true;
+    options.m_StopOnFirstError = false;
+
+    // Failures must propagate to waiting nodes, without stalling the build
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+    TEST_ASSERT( fBuild.Build( "all" ) == false ); // Expect build to fail
+
+    // Check stats: Seen, Built, Type
+    CheckStatsNode( 4, 0, Node::OBJECT_NODE );
+    CheckStatsNode( 2, 0, Node::LIBRARY_NODE );
+    CheckStatsNode( 1, 0, Node::ALIAS_NODE );
+
+    // All 4 nodes should have failed
+    const FBuildStats::Stats & nodeStats = fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE );
+    TEST_ASSERT( nodeStats.m_NumFailed == 4 );
+}
+
+// EventDriven_CompareBuildTimes
+//------------------------------------------------------------------------------
+void TestGraph::EventDriven_CompareBuildTimes() const
+{
+    // Build a synthetic graph of trivial nodes, arranged in layers with each
+    // node depending on two nodes in the previous layer. Work becomes available
+    // gradually, requiring many build passes. The graph is kept small so this
+    // runs quickly. Rather than relying on timings, the scheduling work done
+    // (the number of nodes visited by build passes) is compared.
+    const uint32_t width = 1000;
+    const uint32_t depth = 10;
+    const uint32_t numNodes = ( width * depth ) + 1;
+
+    uint32_t passes[ 2 ] = { 0, 0 };
+    uint64_t visited[ 2 ] = { 0, 0 };
+    float passTimes[ 2 ] = { 0.0f, 0.0f };
+    float times[ 2 ] = { 0.0f, 0.0f };
+    for ( uint32_t pass = 0; pass < 2; ++pass )
+    {
+        const bool eventDriven = ( pass == 1 );
+
+        FBuildTestOptions options;
+        options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/EventDriven/fbuild.bff";
+        options.m_EventDrivenScheduling = eventDriven;
+        options.m_ShowSummary = true; // required to generate stats for node count checks
+        options.m_Profile = false;
+        options.m_EnableMonitor = false;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        // Create graph
+        NodeGraph & nodeGraph = fBuild.GetDependencyGraph();
+        Array<Node *> previousLayer;
+        Array<Node *> layer;
+        previousLayer.SetCapacity( width );
+        layer.SetCapacity( width );
+        for ( uint32_t l = 0; l < depth; ++l )
+        {
+            for ( uint32_t i = 0; i < width; ++i )
+            {
+                AStackString name;
+                name.Format( "Node-%u-%u", l, i );
+                AliasNode * node = nodeGraph.CreateNode<AliasNode>( name );
+                if ( l > 0 )
+                {
+                    node->m_StaticDependencies.Add( previousLayer[ i ] );
+                    node->m_StaticDependencies.Add( previousLayer[ ( i + 1 ) % width ] );
+                }
+                layer.Append( node );
+            }
+            previousLayer.Swap( layer );
+            layer.Clear();
+        }
+        AliasNode * root = nodeGraph.CreateNode<AliasNode>( AStackString( "Root" ) );
+        for ( Node * node : previousLayer )
+        {
+            root->m_StaticDependencies.Add( node );
+        }
+
+        // Build
+        const Timer t;
+        TEST_ASSERT( fBuild.Build( root ) );
+        times[ pass ] = t.GetElapsed();
+
+        passes[ pass ] = nodeGraph.GetNumBuildPasses();
+        visited[ pass ] = nodeGraph.GetNumNodesVisited();
+        passTimes[ pass ] = nodeGraph.GetBuildPassTime();
+
+        // Both schedulers must build every node exactly once
+        CheckStatsNode( numNodes, numNodes, Node::ALIAS_NODE );
+    }
+
+    // Event-driven scheduling progresses each node when it becomes ready (and
+    // once more if it had to wait), instead of revisiting it every pass
+    TEST_ASSERT( visited[ 1 ] <= ( 2 * numNodes ) );
+    TEST_ASSERT( ( visited[ 1 ] * 2 ) < visited[ 0 ] );
+
+    OUTPUT( "Nodes       : %u\n", numNodes );
+    OUTPUT( "             Passes   Visited   PassTime   Total\n" );
+    OUTPUT( "Sweep       : %6u  %8" PRIu64 "   %2.3fs     %2.3fs\n", passes[ 0 ], visited[ 0 ], (double)passTimes[ 0 ], (double)times[ 0 ] );
+    OUTPUT( "EventDriven : %6u  %8" PRIu64 "   %2.3fs     %2.3fs\n", passes[ 1 ], visited[ 1 ], (double)passTimes[ 1 ], (double)times[ 1 ] );
+}
+
 // DBLocationChanged
 //------------------------------------------------------------------------------
 void TestGraph::DBLocationChanged() const
@@ -654,6 +887,267 @@ void TestGraph::DBCorrupt() const
     }
 }
 
+// DBJournal
+//------------------------------------------------------------------------------
+void TestGraph::DBJournal() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/DBJournal/fbuild.bff";
+    options.m_ShowSummary = true; // required to generate stats for node count checks
+    options.m_DBJournal = true;
+
+    const char * dbFile = "../tmp/Test/Graph/DBJournal/fbuild.fdb";
+    const char * journalFile = "../tmp/Test/Graph/DBJournal/fbuild.fdb.journal";
+
+    // Clean up anything left over from previous runs
+    EnsureFileDoesNotExist( dbFile );
+    EnsureFileDoesNotExist( journalFile );
+    ResetDBJournalData();
+    WriteTextFile( "../tmp/Test/Graph/DBJournal/Src/a.txt", "a" );
+
+    // Initial build must write the entire DB
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "CopyDir" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+        CheckStatsNode( 1, 1, Node::COPY_FILE_NODE );
+        EnsureFileExists( dbFile );
+        EnsureFileDoesNotExist( journalFile );
+    }
+    const uint64_t dbHash = GetFileHash( dbFile );
+
+    // Adding a file creates new nodes, which are journaled
+    WriteTextFile( "../tmp/Test/Graph/DBJournal/Src/b.txt", "b" );
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "CopyDir" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+        CheckStatsNode( 2, 1, Node::COPY_FILE_NODE );
+        EnsureFileExists( journalFile );
+        TEST_ASSERT( GetFileHash( dbFile ) == dbHash ); // DB is not rewritten
+    }
+
+    // Nothing should build if the journal was replayed
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "CopyDir" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+        CheckStatsNode( 2, 0, Node::COPY_FILE_NODE );
+        TEST_ASSERT( GetFileHash( dbFile ) == dbHash );
+    }
+
+    // Journal is compacted into the DB once it exceeds the ratio
+    WriteTextFile( "../tmp/Test/Graph/DBJournal/Src/c.txt", "c" );
+    {
+        options.m_DBJournalCompactRatio = 0;
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "CopyDir" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+        CheckStatsNode( 3, 1, Node::COPY_FILE_NODE );
+        EnsureFileDoesNotExist( journalFile );
+        TEST_ASSERT( GetFileHash( dbFile ) != dbHash );
+    }
+
+    // Compacted DB is up-to-date
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "CopyDir" ) );
+        CheckStatsNode( 3, 0, Node::COPY_FILE_NODE );
+    }
+}
+
+// DBJournalCorrupt
+//------------------------------------------------------------------------------
+void TestGraph::DBJournalCorrupt() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/DBJournal/fbuild.bff";
+    options.m_ShowSummary = true; // required to generate stats for node count checks
+    options.m_DBJournal = true;
+
+    const char * dbFile = "../tmp/Test/Graph/DBJournal/corrupt.fdb";
+    const char * journalFile = "../tmp/Test/Graph/DBJournal/corrupt.fdb.journal";
+
+    // Clean up anything left over from previous runs
+    EnsureFileDoesNotExist( dbFile );
+    EnsureFileDoesNotExist( journalFile );
+    ResetDBJournalData();
+    WriteTextFile( "../tmp/Test/Graph/DBJournal/Src/a.txt", "a" );
+
+    // Write a DB, then a journal with new nodes
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "CopyDir" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+    }
+    WriteTextFile( "../tmp/Test/Graph/DBJournal/Src/b.txt", "b" );
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "CopyDir" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+        EnsureFileExists( journalFile );
+    }
+
+    // Append a correctly hashed entry which refers to a node that doesn't exist
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( journalFile, FileStream::READ_ONLY ) );
+        AString buffer;
+        buffer.SetLength( (uint32_t)f.GetFileSize() );
+        TEST_ASSERT( f.ReadBuffer( buffer.Get(), f.GetFileSize() ) == f.GetFileSize() );
+        f.Close();
+        MemoryStream journal;
+        journal.WriteBuffer( buffer.Get(), buffer.GetLength() );
+
+        // Node count of the first entry (after the header, entry size and hash)
+        uint32_t numNodes = 0;
+        memcpy( &numNodes, static_cast<const char *>( journal.GetData() ) + sizeof( NodeGraphJournalHeader ) + ( sizeof( uint64_t ) * 2 ), sizeof( uint32_t ) );
+
+        MemoryStream entry;
+        entry.Write( numNodes );
+        entry.Write( static_cast<uint32_t>( 1 ) ); // numRecords
+        entry.Write( static_cast<uint32_t>( 0x7FFFFFFF ) ); // index
+        entry.Write( static_cast<uint32_t>( 0 ) ); // size
+        entry.Write( static_cast<uint64_t>( 0 ) ); // hash
+        journal.Write( static_cast<uint64_t>( entry.GetSize() ) );
+        journal.Write( xxHash3::Calc64( entry.GetData(), entry.GetSize() ) );
+        journal.WriteBuffer( entry.GetData(), entry.GetSize() );
+
+        TEST_ASSERT( f.Open( journalFile, FileStream::WRITE_ONLY ) );
+        TEST_ASSERT( f.WriteBuffer( journal.GetData(), journal.GetSize() ) == journal.GetSize() );
+    }
+
+    // The entire journal is dropped, so nodes it added are recreated
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "CopyDir" ) );
+        CheckStatsNode( 2, 1, Node::COPY_FILE_NODE );
+    }
+}
+
+// DBCheckpoint
+//------------------------------------------------------------------------------
+void TestGraph::DBCheckpoint() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/DBJournal/fbuild.bff";
+    options.m_ShowSummary = true; // required to generate stats for node count checks
+
+    const char * dbFile = "../tmp/Test/Graph/DBCheckpoint/fbuild.fdb";
+    const char * journalFile = "../tmp/Test/Graph/DBCheckpoint/fbuild.fdb.journal";
+
+    // Clean up anything left over from previous runs
+    EnsureFileDoesNotExist( dbFile );
+    EnsureFileDoesNotExist( journalFile );
+    ResetDBJournalData();
+    WriteTextFile( "../tmp/Test/Graph/DBJournal/Src/a.txt", "a" );
+    WriteTextFile( "../tmp/Test/Graph/DBJournal/Src/b.txt", "b" );
+
+    // Build without saving at the end, as if the build was killed, but
+    // checkpoint after every build pass
+    {
+        options.m_DBCheckpointInterval = 0.000001f;
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "CopyDir" ) );
+        CheckStatsNode( 2, 2, Node::COPY_FILE_NODE );
+
+        // DB is saved before the build, and progress is journaled
+        EnsureFileExists( dbFile );
+        EnsureFileExists( journalFile );
+    }
+
+    // Completed work was recorded
+    {
+        options.m_DBCheckpointInterval = 0.0f;
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "CopyDir" ) );
+        CheckStatsNode( 2, 0, Node::COPY_FILE_NODE );
+    }
+}
+
+// DBSaveAsync
+//------------------------------------------------------------------------------
+void TestGraph::DBSaveAsync() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/DBJournal/fbuild.bff";
+    options.m_ShowSummary = true; // required to generate stats for node count checks
+
+    const char * dbFile = "../tmp/Test/Graph/DBSaveAsync/fbuild.fdb";
+    const char * dbFileTmp = "../tmp/Test/Graph/DBSaveAsync/fbuild.fdb.tmp";
+
+    // Clean up anything left over from previous runs
+    EnsureFileDoesNotExist( dbFile );
+    ResetDBJournalData();
+    WriteTextFile( "../tmp/Test/Graph/DBJournal/Src/a.txt", "a" );
+
+    // Save in the background
+    {
+        options.m_DBSaveAsync = true;
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "CopyDir" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+        TEST_ASSERT( fBuild.WaitForDependencyGraphSave() );
+
+        // DB was written via a temp file
+        EnsureFileExists( dbFile );
+        EnsureFileDoesNotExist( dbFileTmp );
+
+        // Save again, relying on destruction to complete it
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+    }
+    EnsureFileDoesNotExist( dbFileTmp );
+
+    // DB is valid
+    {
+        options.m_DBSaveAsync = false;
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "CopyDir" ) );
+        CheckStatsNode( 1, 0, Node::COPY_FILE_NODE );
+    }
+
+    // A failed background write must not be relied upon by later saves
+    {
+        const char * failDBFile = "../tmp/Test/Graph/DBSaveAsync/fail.fdb";
+        const char * failDBFileTmp = "../tmp/Test/Graph/DBSaveAsync/fail.fdb.tmp";
+        const char * failJournalFile = "../tmp/Test/Graph/DBSaveAsync/fail.fdb.journal";
+        EnsureFileDoesNotExist( failDBFile );
+        EnsureFileDoesNotExist( failJournalFile );
+        EnsureDirDoesNotExist( failDBFileTmp );
+
+        options.m_DBSaveAsync = true;
+        options.m_DBJournal = true;
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( failDBFile ) );
+        TEST_ASSERT( fBuild.Build( "CopyDir" ) );
+
+        // Temp file can't be created if a directory is in the way
+        EnsureDirExists( failDBFileTmp );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( failDBFile ) );
+        TEST_ASSERT( fBuild.WaitForDependencyGraphSave() == false );
+        EnsureFileDoesNotExist( failDBFile );
+        EnsureDirDoesNotExist( failDBFileTmp );
+
+        // Next save is a full save, rather than a journal for a missing DB
+        TEST_ASSERT( fBuild.SaveDependencyGraph( failDBFile ) );
+        TEST_ASSERT( fBuild.WaitForDependencyGraphSave() );
+        EnsureFileExists( failDBFile );
+        EnsureFileDoesNotExist( failJournalFile );
+    }
+}
+
 // BFFDirtied
 //------------------------------------------------------------------------------
 void TestGraph::BFFDirtied() const
@@ -947,4 +1441,102 @@ void TestGraph::DBLocation() const
     }
 }
 
+// Watch
+//------------------------------------------------------------------------------
+void TestGraph::Watch() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/Watch/fbuild.bff";
+    options.m_ShowSummary = true; // required to generate stats for node count checks
+
+    // Remove files which may have been created by previous runs
+    const char * const dirs[] = { "../tmp/Test/Graph/Watch/Src/", "../tmp/Test/Graph/Watch/Dst/" };
+    const char * const files[] = { "a.txt", "b.txt", "c.txt" };
+    for ( const char * dir : dirs )
+    {
+        for ( const char * file : files )
+        {
+            AStackString path;
+            path.Format( "%s%s", dir, file );
+            EnsureFileDoesNotExist( path.Get() );
+        }
+        EnsureDirDoesNotExist( dir );
+    }
+    TEST_ASSERT( FileIO::EnsurePathExists( AStackString( dirs[ 0 ] ) ) );
+    WriteTextFile( "../tmp/Test/Graph/Watch/Src/a.txt", "a" );
+    WriteTextFile( "../tmp/Test/Graph/Watch/Src/b.txt", "b" );
+
+    StackArray<AString> targets;
+    targets.EmplaceBack( "CopyDir" );
+
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+    TEST_ASSERT( fBuild.Build( targets ) );
+    CheckStatsNode( 2, 2, Node::FILE_NODE );
+    CheckStatsNode( 2, 2, Node::COPY_FILE_NODE );
+
+    TEST_ASSERT( fBuild.StartWatching() );
+    bool result = false;
+
+    // Nothing changed
+    TEST_ASSERT( fBuild.BuildChanges( targets, result ) == FBuild::WatchResult::NO_CHANGES );
+
+    // Only the modified file is checked (the other is seen, but not built)
+    Thread::Sleep( 10 ); // Ensure time stamp changes
+    WriteTextFile( "../tmp/Test/Graph/Watch/Src/a.txt", "aa" );
+    TEST_ASSERT( fBuild.BuildChanges( targets, result ) == FBuild::WatchResult::BUILT );
+    TEST_ASSERT( result );
+    CheckStatsNode( 2, 1, Node::FILE_NODE );
+    CheckStatsNode( 1, 1, Node::DIRECTORY_LIST_NODE );
+    CheckStatsNode( 2, 1, Node::COPY_FILE_NODE );
+
+    // Output files written by the build don't cause another build
+    TEST_ASSERT( fBuild.BuildChanges( targets, result ) == FBuild::WatchResult::NO_CHANGES );
+
+    // New files are found
+    WriteTextFile( "../tmp/Test/Graph/Watch/Src/c.txt", "c" );
+    TEST_ASSERT( fBuild.BuildChanges( targets, result ) == FBuild::WatchResult::BUILT );
+    TEST_ASSERT( result );
+    CheckStatsNode( 3, 1, Node::FILE_NODE );
+    CheckStatsNode( 3, 1, Node::COPY_FILE_NODE );
+    EnsureFileExists( "../tmp/Test/Graph/Watch/Dst/c.txt" );
+}
+
+// WatchIgnoresOwnWrites
+//------------------------------------------------------------------------------
+void TestGraph::WatchIgnoresOwnWrites() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/Watch/fbuild.bff";
+    options.m_DBFile = "../tmp/Test/Graph/Watch/InPlace/fbuild.fdb"; // Inside the listed directory
+    options.m_SaveDBOnCompletion = true;
+
+    // Remove files which may have been created by previous runs
+    EnsureFileDoesNotExist( "../tmp/Test/Graph/Watch/InPlace/Dst/a.txt" );
+    EnsureDirDoesNotExist( "../tmp/Test/Graph/Watch/InPlace/Dst/" );
+    TEST_ASSERT( FileIO::EnsurePathExists( AStackString( "../tmp/Test/Graph/Watch/InPlace/" ) ) );
+    WriteTextFile( "../tmp/Test/Graph/Watch/InPlace/a.txt", "a" );
+
+    StackArray<AString> targets;
+    targets.EmplaceBack( "CopyDirInPlace" );
+
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+    TEST_ASSERT( fBuild.Build( targets ) );
+
+    TEST_ASSERT( fBuild.StartWatching() );
+    bool result = false;
+
+    // Rebuild, saving the DB and writing the copy inside the listed directory
+    Thread::Sleep( 10 ); // Ensure time stamp changes
+    WriteTextFile( "../tmp/Test/Graph/Watch/InPlace/a.txt", "aa" );
+    TEST_ASSERT( fBuild.BuildChanges( targets, result ) == FBuild::WatchResult::BUILT );
+    TEST_ASSERT( result );
+    EnsureFileExists( "../tmp/Test/Graph/Watch/InPlace/Dst/a.txt" );
+
+    // Nothing the build wrote causes another build, so watching goes idle
+    TEST_ASSERT( fBuild.BuildChanges( targets, result ) == FBuild::WatchResult::NO_CHANGES );
+    TEST_ASSERT( fBuild.BuildChanges( targets, result ) == FBuild::WatchResult::NO_CHANGES );
+}
+
 //------------------------------------------------------------------------------
@@ -28,6 +28,8 @@ private:
     const char * GetTestGenerateDBFileName() const { return "../tmp/Test/Unity/generate.fdb"; }
     FBuildStats BuildCompile( FBuildTestOptions options = FBuildTestOptions(), bool useDB = true, bool forceMigration = false ) const;
     const char * GetTestCompileDBFileName() const { return "../tmp/Test/Unity/compile.fdb"; }
+    void GetUnityContents( const FBuildForTest & fBuild, const char * nodeName, Array<AString> & outUnities ) const;
+    static size_t CountChangedUnities( const Array<AString> & before, const Array<AString> & after );
 
     // Tests
     void TestGenerate() const;
@@ -50,6 +52,8 @@ private:
     void CacheUsingRelativePaths() const;
     void NoUnityCommandLineOption() const;
     void NoUnityCache() const;
+    void BalanceByCost() const;
+    void StablePartitioning() const;
 };
 
 // Register Tests
@@ -75,6 +79,8 @@ REGISTER_TESTS_BEGIN( TestUnity )
     REGISTER_TEST( CacheUsingRelativePaths )
     REGISTER_TEST( NoUnityCommandLineOption )
     REGISTER_TEST( NoUnityCache )
+    REGISTER_TEST( BalanceByCost )
+    REGISTER_TEST( StablePartitioning )
 REGISTER_TESTS_END
 
 // BuildGenerate
@@ -95,6 +101,39 @@ FBuildStats TestUnity::BuildGenerate( FBuildTestOptions options, bool useDB, boo
     return fBuild.GetStats();
 }
 
+// GetUnityContents
+//  - Name and contents of each Unity file, for comparison between builds
+//------------------------------------------------------------------------------
+void TestUnity::GetUnityContents( const FBuildForTest & fBuild, const char * nodeName, Array<AString> & outUnities ) const
+{
+    const Node * node = fBuild.GetNode( nodeName );
+    TEST_ASSERT( node );
+    for ( const AString & unityFileName : node->CastTo<UnityNode>()->GetUnityFileNames() )
+    {
+        AString contents;
+        LoadFileContentsAsString( unityFileName.Get(), contents );
+        AString & unity = outUnities.EmplaceBack( unityFileName );
+        unity += '\n';
+        unity += contents;
+    }
+}
+
+// CountChangedUnities
+//  - Unity files with a new name or different contents
+//------------------------------------------------------------------------------
+/*static*/ size_t TestUnity::CountChangedUnities( const Array<AString> & before, const Array<AString> & after )
+{
+    size_t numChanged = 0;
+    for ( const AString & unity : after )
+    {
+        if ( before.Find( unity ) == nullptr )
+        {
+            ++numChanged;
+        }
+    }
+    return numChanged;
+}
+
 // TestGenerate
 //------------------------------------------------------------------------------
 void TestUnity::TestGenerate() const
@@ -1115,4 +1154,208 @@ void TestUnity::NoUnityCache() const
     }
 }
 
+// BalanceByCost
+//------------------------------------------------------------------------------
+void TestUnity::BalanceByCost() const
+{
+    // One file is much larger than the others, so is initially given a Unity
+    // of its own instead of files being split evenly by count. The small
+    // files are the expensive ones though, which the recorded compile times
+    // reveal, so the next build splits them up.
+
+    // Code files generated/used by this test
+    const char * fileA = "../tmp/Test/Unity/BalanceByCost/Generated/a.cpp";
+    const char * fileB = "../tmp/Test/Unity/BalanceByCost/Generated/b.cpp";
+    const char * fileC = "../tmp/Test/Unity/BalanceByCost/Generated/c.cpp";
+    const char * fileD = "../tmp/Test/Unity/BalanceByCost/Generated/d.cpp";
+    const char * unity1 = "../tmp/Test/Unity/BalanceByCost/Output/Unity1.cpp";
+    const char * unity2 = "../tmp/Test/Unity/BalanceByCost/Output/Unity2.cpp";
+    AStackString<8192> fileAContents;
+    for ( size_t i = 0; i < 64; ++i )
+    {
+        fileAContents.AppendFormat( "int FunctionA%u() { return %u; }\n", (uint32_t)i, (uint32_t)i );
+    }
+
+    // Create files
+    EnsureDirExists( "../tmp/Test/Unity/BalanceByCost/Generated/" );
+    MakeFile( fileA, fileAContents.Get() );
+    MakeFile( fileB, "int FunctionB() { return 0; }\n" );
+    MakeFile( fileC, "template <int N, int M> struct C { static int F() { return C<N - 1, M * 2>::F() + C<N - 1, M * 2 + 1>::F(); } };\n"
+                     "template <int M> struct C<0, M> { static int F() { return M; } };\n"
+                     "int FunctionC() { return C<10, 0>::F(); }\n" ); // Many template instantiations
+    MakeFile( fileD, "template <int N, int M> struct D { static int F() { return D<N - 1, M * 2>::F() + D<N - 1, M * 2 + 1>::F(); } };\n"
+                     "template <int M> struct D<0, M> { static int F() { return M; } };\n"
+                     "int FunctionD() { return D<10, 0>::F(); }\n" );
+
+    // Common options
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestUnity/BalanceByCost/fbuild.bff";
+    options.m_ForceCleanBuild = true;
+    const char * dbFile = "../tmp/Test/Unity/BalanceByCost/fbuild.fdb";
+
+    // Compile
+    uint32_t minMS1;
+    uint32_t maxMS1;
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "BalanceByCost" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        // Check stats: Seen, Built, Type
+        CheckStatsNode( 1, 1, Node::UNITY_NODE );
+        CheckStatsNode( 2, 2, Node::OBJECT_NODE );
+        CheckStatsNode( 1, 1, Node::LIBRARY_NODE );
+
+        // Check spread is reported
+        TEST_ASSERT( GetRecordedOutput().Find( "Unity Balance:" ) );
+        TEST_ASSERT( fBuild.GetNode( "Unity" )->CastTo<UnityNode>()->GetActualCostSpread( minMS1, maxMS1 ) );
+    }
+
+    // Check allocation of files (by size, as there are no recorded times)
+    {
+        AString unity1Contents;
+        AString unity2Contents;
+        LoadFileContentsAsString( unity1, unity1Contents );
+        LoadFileContentsAsString( unity2, unity2Contents );
+        TEST_ASSERT( unity1Contents.Find( "a.cpp" ) );
+        TEST_ASSERT( unity1Contents.Find( "b.cpp" ) == nullptr );
+        TEST_ASSERT( unity2Contents.Find( "b.cpp" ) );
+        TEST_ASSERT( unity2Contents.Find( "c.cpp" ) );
+        TEST_ASSERT( unity2Contents.Find( "d.cpp" ) );
+    }
+
+    // Compile again, using the recorded times
+    uint32_t minMS2;
+    uint32_t maxMS2;
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "BalanceByCost" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        TEST_ASSERT( GetRecordedOutput().Find( "Unity Balance:" ) );
+        TEST_ASSERT( fBuild.GetNode( "Unity" )->CastTo<UnityNode>()->GetActualCostSpread( minMS2, maxMS2 ) );
+    }
+
+    // Check expensive files were split up
+    {
+        AString unity1Contents;
+        AString unity2Contents;
+        LoadFileContentsAsString( unity1, unity1Contents );
+        LoadFileContentsAsString( unity2, unity2Contents );
+        TEST_ASSERT( unity1Contents.Find( "a.cpp" ) );
+        TEST_ASSERT( unity1Contents.Find( "b.cpp" ) );
+        TEST_ASSERT( unity2Contents.Find( "b.cpp" ) == nullptr );
+        TEST_ASSERT( unity2Contents.Find( "d.cpp" ) );
+    }
+
+    // Check spread of compile times was reduced
+    TEST_ASSERT( ( maxMS2 - minMS2 ) < ( maxMS1 - minMS1 ) );
+
+    // Check recorded costs don't cause anything to rebuild
+    options.m_ForceCleanBuild = false;
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "BalanceByCost" ) );
+
+        // Check stats: Seen, Built, Type
+        CheckStatsNode( 1, 0, Node::UNITY_NODE );
+        CheckStatsNode( 2, 0, Node::OBJECT_NODE );
+        CheckStatsNode( 1, 0, Node::LIBRARY_NODE );
+    }
+}
+
+// StablePartitioning
+//------------------------------------------------------------------------------
+void TestUnity::StablePartitioning() const
+{
+    // Adding a file should only change the unities near it, so other unity
+    // objects can still be retrieved from the cache
+
+    // Code files generated/used by this test
+    EnsureDirExists( "../tmp/Test/Unity/StablePartitioning/Generated/" );
+    for ( uint32_t i = 0; i < 64; ++i )
+    {
+        AStackString fileName;
+        AStackString fileContents;
+        fileName.Format( "../tmp/Test/Unity/StablePartitioning/Generated/File%02u.cpp", i );
+        fileContents.Format( "int Function%02u() { return 0; }\n", i );
+        MakeFile( fileName.Get(), fileContents.Get() );
+    }
+    const char * addedFile = "../tmp/Test/Unity/StablePartitioning/Generated/File31b.cpp";
+    EnsureFileDoesNotExist( addedFile );
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestUnity/StablePartitioning/fbuild.bff";
+    options.m_ForceCleanBuild = true;
+
+    // Generate
+    Array<AString> byCountBefore;
+    Array<AString> stableBefore;
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "All" ) );
+        GetUnityContents( fBuild, "ByCount", byCountBefore );
+        GetUnityContents( fBuild, "Stable", stableBefore );
+    }
+    TEST_ASSERT( byCountBefore.GetSize() == 8 );
+    TEST_ASSERT( stableBefore.GetSize() > 1 );
+
+    // Add a file in the middle
+    MakeFile( addedFile, "int Function31b() { return 0; }\n" );
+
+    // Generate again
+    Array<AString> byCountAfter;
+    Array<AString> stableAfter;
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "All" ) );
+        GetUnityContents( fBuild, "ByCount", byCountAfter );
+        GetUnityContents( fBuild, "Stable", stableAfter );
+    }
+
+    // Splitting by count changes every unity after the new file, but
+    // splitting by name only changes the unity containing it (or two, if
+    // the new file starts a unity)
+    const size_t numChangedByCount = CountChangedUnities( byCountBefore, byCountAfter );
+    const size_t numChangedStable = CountChangedUnities( stableBefore, stableAfter );
+    TEST_ASSERT( numChangedByCount >= 4 );
+    TEST_ASSERT( ( numChangedStable >= 1 ) && ( numChangedStable <= 2 ) );
+
+    // Remove it again, which restores the original unities
+    EnsureFileDoesNotExist( addedFile );
+    const char * dbFile = "../tmp/Test/Unity/StablePartitioning/fbuild.fdb";
+    Array<AString> stableRestored;
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "All" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+        GetUnityContents( fBuild, "Stable", stableRestored );
+    }
+    TEST_ASSERT( stableRestored.GetSize() == stableBefore.GetSize() );
+    TEST_ASSERT( CountChangedUnities( stableBefore, stableRestored ) == 0 );
+
+    // Remove the first file, which renames the first unity
+    const AStackString firstUnityFileName( stableRestored[ 0 ].Get(), stableRestored[ 0 ].Find( '\n' ) );
+    EnsureFileExists( firstUnityFileName.Get() );
+    EnsureFileDoesNotExist( "../tmp/Test/Unity/StablePartitioning/Generated/File00.cpp" );
+    Array<AString> stableRenamed;
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "All" ) );
+        GetUnityContents( fBuild, "Stable", stableRenamed );
+    }
+    TEST_ASSERT( stableRenamed.GetSize() == stableBefore.GetSize() );
+    TEST_ASSERT( CountChangedUnities( stableBefore, stableRenamed ) == 1 );
+
+    // Check the old unity was deleted, so unities don't accumulate
+    TEST_ASSERT( FileIO::FileExists( firstUnityFileName.Get() ) == false );
+}
+
 //------------------------------------------------------------------------------
@@ -7,6 +7,7 @@
 
 // FBuildCore
 #include "Tools/FBuild/FBuildCore/FBuildVersion.h"
+#include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
 
 // Core
 #include "Core/Containers/Array.h"
@@ -49,7 +50,24 @@ bool FBuildWorkerOptions::ProcessCommandLine( const AString & commandLine )
             continue;
         }
 #endif
-        if ( token.BeginsWith( "-cpus=" ) )
+        if ( token == "-brokerageservice" )
+        {
+            m_BrokerageService = true;
+            m_BrokerageServicePort = Protocol::kBrokeragePort;
+            continue;
+        }
+        else if ( token.BeginsWith( "-brokerageservice=" ) )
+        {
+            uint32_t port( 0 );
+            if ( ( AString::ScanS( token.Get() + 18, "%u", &port ) == 1 ) && ( port > 0 ) && ( port <= 0xFFFF ) )
+            {
+                m_BrokerageService = true;
+                m_BrokerageServicePort = static_cast<uint16_t>( port );
+                continue;
+            }
+            // problem... fall through
+        }
+        else if ( token.BeginsWith( "-cpus=" ) )
         {
             const int32_t numCPUs = (int32_t)Env::GetNumProcessors();
             int32_t num( 0 );
@@ -78,6 +96,20 @@ bool FBuildWorkerOptions::ProcessCommandLine( const AString & commandLine )
             }
             // problem... fall through
         }
+        else if ( token.BeginsWith( "-cachepath=" ) )
+        {
+            m_CachePath = ( token.Get() + 11 );
+            if ( m_CachePath.IsEmpty() == false )
+            {
+                continue;
+            }
+            // problem... fall through
+        }
+        else if ( token == "-cachereadonly" )
+        {
+            m_CacheWrite = false;
+            continue;
+        }
         else if ( token == "-mode=disabled" )
         {
             m_WorkMode = WorkerSettings::DISABLED;
@@ -150,6 +182,14 @@ void FBuildWorkerOptions::ShowUsageError()
                        "\n"
                        "Command Line Options:\n"
                        "---------------------------------------------------------------------------\n"
+                       " -brokerageservice[=<port>]\n"
+                       "        Run a brokerage service for worker discovery, instead of a\n"
+                       "        worker.\n"
+                       " -cachepath=<path>\n"
+                       "        Retrieve results of jobs from, and store them to, a\n"
+                       "        cache shared with clients.\n"
+                       " -cachereadonly\n"
+                       "        Don't store results to the cache.\n"
                        " -console\n"
                        "        (Windows/OSX) Operate from console instead of GUI.\n"
                        " -cpus=<n|-n|n%>   Set number of CPUs to use:\n"
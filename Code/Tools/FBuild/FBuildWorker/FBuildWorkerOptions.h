@@ -9,10 +9,7 @@
 
 // Core
 #include "Core/Env/Types.h"
-
-// Forward Declaration
-//------------------------------------------------------------------------------
-class AString;
+#include "Core/Strings/AString.h"
 
 // FBuildWorkerOptions
 //------------------------------------------------------------------------------
@@ -36,9 +33,17 @@ public:
     WorkerSettings::Mode m_WorkMode = WorkerSettings::WHEN_IDLE;
     uint32_t m_MinimumFreeMemoryMiB = 0; // Minimum OS free memory including virtual memory to let worker do its work
 
+    // Cache (shared with clients)
+    AString m_CachePath;
+    bool m_CacheWrite = true;
+
     // Console mode
     bool m_ConsoleMode = false;
 
+    // Run as a brokerage service instead of a worker
+    bool m_BrokerageService = false;
+    uint16_t m_BrokerageServicePort = 0;
+
     // Other
     bool m_PeriodicRestart = false;
 
@@ -4,6 +4,9 @@
 // Includes
 //------------------------------------------------------------------------------
 
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/WorkerPool/BrokerageService.h"
+
 // FBuildWorker
 #include "Tools/FBuild/FBuildWorker/FBuildWorkerOptions.h"
 #include "Tools/FBuild/FBuildWorker/Worker/Worker.h"
@@ -14,15 +17,19 @@
 #include "Core/Env/ErrorFormat.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/Mem/MemTracker.h"
+#include "Core/Process/Atomic.h"
 #include "Core/Process/Process.h"
 #include "Core/Process/SystemMutex.h"
 #include "Core/Process/Thread.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
+#include "Core/Tracing/Tracing.h"
 
 // system
 #if defined( __WINDOWS__ )
     #include "Core/Env/WindowsHeader.h"
+#else
+    #include <signal.h>
 #endif
 
 // Global Data
@@ -30,9 +37,18 @@
 // only allow 1 worker per system
 static SystemMutex g_OneProcessMutex( "Global\\FBuildWorker" );
 
+// set when the brokerage service is asked to terminate
+static volatile bool g_QuitBrokerageService = false;
+
 // Functions
 //------------------------------------------------------------------------------
 int Main( const AString & args );
+int RunBrokerageService( uint16_t port, bool consoleMode );
+#if defined( __WINDOWS__ )
+BOOL WINAPI BrokerageServiceCtrlHandler( DWORD fdwCtrlType );
+#else
+void BrokerageServiceSignalHandler( int signal );
+#endif
 #if defined( __WINDOWS__ )
 int LaunchSubProcess( const AString & args );
 #endif
@@ -88,6 +104,12 @@ int Main( const AString & args )
         return -3;
     }
 
+    // brokerage service is independent of any worker on this system
+    if ( options.m_BrokerageService )
+    {
+        return RunBrokerageService( options.m_BrokerageServicePort, options.m_ConsoleMode );
+    }
+
     // only allow 1 worker per system
     const Timer t;
     while ( g_OneProcessMutex.TryLock() == false )
@@ -139,12 +161,72 @@ int Main( const AString & args )
         {
             WorkerSettings::Get().SetMinimumFreeMemoryMiB( options.m_MinimumFreeMemoryMiB );
         }
+        if ( options.m_CachePath.IsEmpty() == false )
+        {
+            worker.InitCache( options.m_CachePath, options.m_CacheWrite );
+        }
         ret = worker.Work();
     }
 
     return ret;
 }
 
+// RunBrokerageService
+//------------------------------------------------------------------------------
+int RunBrokerageService( uint16_t port, bool consoleMode )
+{
+    // Stop cleanly when terminated
+    #if defined( __WINDOWS__ )
+        VERIFY( SetConsoleCtrlHandler( (PHANDLER_ROUTINE)BrokerageServiceCtrlHandler, TRUE ) );
+    #else
+        signal( SIGINT, BrokerageServiceSignalHandler );
+        signal( SIGTERM, BrokerageServiceSignalHandler );
+    #endif
+
+    BrokerageService service;
+    if ( service.Listen( port ) == false )
+    {
+        AStackString msg;
+        msg.Format( "Failed to listen on port %u for brokerage service.", port );
+        if ( consoleMode )
+        {
+            OUTPUT( "%s\n", msg.Get() );
+        }
+        else
+        {
+            Env::ShowMsgBox( "FBuildWorker", msg.Get() );
+        }
+        service.ShutdownAllConnections();
+        return -4;
+    }
+    OUTPUT( "Brokerage service listening on port %u\n", port );
+
+    // Run until terminated
+    while ( AtomicLoadRelaxed( &g_QuitBrokerageService ) == false )
+    {
+        Thread::Sleep( 100 );
+    }
+
+    OUTPUT( "Brokerage service stopping\n" );
+    service.ShutdownAllConnections();
+    return 0;
+}
+
+// BrokerageServiceCtrlHandler / BrokerageServiceSignalHandler
+//------------------------------------------------------------------------------
+#if defined( __WINDOWS__ )
+BOOL WINAPI BrokerageServiceCtrlHandler( DWORD /*fdwCtrlType*/ )
+{
+    AtomicStoreRelaxed( &g_QuitBrokerageService, true );
+    return TRUE; // tell Windows we've "handled" it
+}
+#else
+void BrokerageServiceSignalHandler( int /*signal*/ )
+{
+    AtomicStoreRelaxed( &g_QuitBrokerageService, true );
+}
+#endif
+
 // LaunchSubProcess
 //------------------------------------------------------------------------------
 #if defined( __WINDOWS__ )
@@ -14,6 +14,7 @@
 #include "Tools/FBuild/FBuildWorker/Worker/WorkerWindow.h"
 
 // FBuild
+#include "Tools/FBuild/FBuildCore/Cache/Cache.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FBuildVersion.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
@@ -66,6 +67,11 @@ Worker::~Worker()
 {
     FDELETE m_NetworkStartupHelper;
     FDELETE m_ConnectionPool;
+    if ( m_Cache )
+    {
+        m_Cache->Shutdown();
+        FDELETE m_Cache;
+    }
     FDELETE m_MainWindow;
     FDELETE m_WorkerSettings;
 
@@ -96,6 +102,28 @@ Worker::~Worker()
     }
 }
 
+// InitCache
+//------------------------------------------------------------------------------
+void Worker::InitCache( const AString & cachePath, bool allowWrite )
+{
+    ASSERT( m_Cache == nullptr );
+
+    Cache * cache = FNEW( Cache() );
+    if ( cache->Init( cachePath,
+                      AString::GetEmpty(), // mount point
+                      true, // cacheRead
+                      allowWrite,
+                      false, // cacheVerbose
+                      AString::GetEmpty() ) == false ) // pluginDLLConfig
+    {
+        FDELETE cache; // Init will have emitted a warning
+        return;
+    }
+    m_Cache = cache;
+
+    JobQueueRemote::Get().SetCache( m_Cache, allowWrite );
+}
+
 // Work
 //------------------------------------------------------------------------------
 int32_t Worker::Work()
@@ -356,6 +384,10 @@ void Worker::UpdateAvailability()
 
     WorkerThreadRemote::SetNumCPUsToUse( numCPUsToUse );
 
+    // Let Clients know how idle we are, so they can prefer idle workers
+    const float idle = m_IdleDetection.IsIdleFloat();
+    m_ConnectionPool->SetIdlePercent( ( ( idle >= 0.0f ) && ( idle <= 1.0f ) ) ? static_cast<uint32_t>( idle * 100.0f ) : 0 );
+
     m_WorkerBrokerage.SetAvailability( numCPUsToUse > 0 );
 }
 
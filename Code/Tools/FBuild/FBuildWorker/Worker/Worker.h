@@ -16,6 +16,7 @@
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class ICache;
 class Server;
 class WorkerWindow;
 class JobQueueRemote;
@@ -30,6 +31,9 @@ public:
     explicit Worker( const AString & args, bool consoleMode, bool periodicRestart );
     ~Worker();
 
+    // Use a (shared) cache for jobs which permit it
+    void InitCache( const AString & cachePath, bool allowWrite );
+
     int32_t Work();
 
     void SetWantToQuit() { m_WantToQuit = true; }
@@ -57,6 +61,7 @@ private:
     Server * m_ConnectionPool = nullptr;
     NetworkStartupHelper * m_NetworkStartupHelper = nullptr;
     WorkerSettings * m_WorkerSettings = nullptr;
+    ICache * m_Cache = nullptr;
     IdleDetection m_IdleDetection;
     WorkerBrokerageServer m_WorkerBrokerage;
     AString m_BaseExeName;